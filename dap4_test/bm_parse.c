@@ -0,0 +1,285 @@
+/*********************************************************************
+ *   Copyright 2019, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+/**
+Benchmark the metadata parsers: DAP4 DMRs (from .dmr files or from
+the DMR chunk of .dap files, e.g. dmrtestfiles and daptestfiles) and
+DAP2 DDS/DAS pairs (given as their .dds files and read through
+file:// urls). Each document is parsed and reclaimed repeatedly and
+the time per parse is printed.
+
+Usage: bm_parse [-r reps] [-s nvars] file...
+
+-s nvars adds a DMR and a DDS/DAS pair with nvars variables, each with
+two dimensions and two attributes, to show how the parsers scale.
+*/
+
+#include "d4includes.h"
+#include "oc.h"
+
+#define DEFAULTREPS 100
+
+static int reps = DEFAULTREPS;
+
+static double
+now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv,NULL);
+    return (double)tv.tv_sec + ((double)tv.tv_usec / 1.0e6);
+}
+
+static int
+readfile(const char* filename, NCbytes* content)
+{
+    FILE* stream;
+    char part[8192];
+
+    stream = fopen(filename,"rb");
+    if(stream == NULL) return errno;
+    for(;;) {
+	size_t count = fread(part, 1, sizeof(part), stream);
+	if(count <= 0) break;
+	ncbytesappendn(content,part,count);
+	if(ferror(stream)) {fclose(stream); return NC_EIO;}
+	if(feof(stream)) break;
+    }
+    ncbytesnull(content);
+    fclose(stream);
+    return NC_NOERR;
+}
+
+static NCD4meta*
+newmeta(NCD4mode mode, NCbytes* input)
+{
+    NCD4meta* metadata = NCD4_newmeta(ncbyteslength(input),ncbytescontents(input));
+    NCD4INFO* controller = (NCD4INFO*)calloc(1,sizeof(NCD4INFO));
+    if(metadata == NULL || controller == NULL) return NULL;
+    metadata->mode = mode;
+    metadata->controller = controller;
+    controller->controls.translation = NCD4_TRANSNC4;
+    NCD4_applyclientparamcontrols(controller);
+    return metadata;
+}
+
+static void
+freemeta(NCD4meta* metadata)
+{
+    free(metadata->controller);
+    NCD4_reclaimMeta(metadata);
+}
+
+static void
+report(const char* name, size_t size, double secs)
+{
+    double per = secs / reps;
+    printf("%-40s %10lu bytes %10.1f us/parse %8.1f MB/s\n",
+	   name,(unsigned long)size,per*1.0e6,
+	   (per > 0 ? ((double)size / per) / 1.0e6 : 0.0));
+}
+
+/* Parse a DMR repeatedly; the parser writes into its input, so each
+   parse gets a fresh copy */
+static int
+benchdmr(const char* name, const char* dmr)
+{
+    int ret = NC_NOERR;
+    int i;
+    double total = 0;
+    NCbytes* dummy = ncbytesnew();
+
+    for(i=0;i<reps;i++) {
+	double start;
+	NCD4meta* metadata = newmeta(NCD4_DMR,dummy);
+	if(metadata == NULL) {ret = NC_ENOMEM; goto done;}
+	metadata->serial.dmr = strdup(dmr);
+	start = now();
+	ret = NCD4_parse(metadata);
+	freemeta(metadata);
+	total += (now() - start);
+	if(ret) goto done;
+    }
+    report(name,strlen(dmr),total);
+done:
+    ncbytesfree(dummy);
+    return ret;
+}
+
+static int
+benchdap4(const char* path)
+{
+    int ret = NC_NOERR;
+    NCbytes* input = ncbytesnew();
+    NCD4meta* metadata = NULL;
+    const char* name = strrchr(path,'/');
+    size_t len = strlen(path);
+    int isdap = (len > 4 && strcmp(path+len-4,".dap") == 0);
+
+    name = (name == NULL ? path : name+1);
+    if((ret = readfile(path,input))) goto done;
+    if((metadata = newmeta(isdap?NCD4_DAP:NCD4_DMR,input)) == NULL)
+	{ret = NC_ENOMEM; goto done;}
+    /* Extract the DMR once */
+    if((ret = NCD4_dechunk(metadata))) goto done;
+    ret = benchdmr(name,metadata->serial.dmr);
+done:
+    if(metadata != NULL) freemeta(metadata);
+    ncbytesfree(input);
+    return ret;
+}
+
+/* Fetch the DDS and the DAS of a file:// url repeatedly and merge them */
+static int
+benchdap2(const char* path)
+{
+    int ret = NC_NOERR;
+    int i;
+    double total = 0;
+    char* url = NULL;
+    char* p;
+    const char* name = strrchr(path,'/');
+    size_t size = 0;
+    NCbytes* input = ncbytesnew();
+
+    name = (name == NULL ? path : name+1);
+    if((ret = readfile(path,input))) goto done;
+    size = ncbyteslength(input);
+    url = (char*)malloc(strlen("file://")+strlen(path)+1);
+    if(url == NULL) {ret = NC_ENOMEM; goto done;}
+    strcpy(url,"file://");
+    strcat(url,path);
+    if((p = strrchr(url,'.')) != NULL) *p = '\0';
+    ncbytesclear(input);
+    strcpy(p,".das");
+    if(readfile(url+strlen("file://"),input) == NC_NOERR)
+	size += ncbyteslength(input);
+    *p = '\0';
+
+    for(i=0;i<reps;i++) {
+	OClink link = NULL;
+	OCddsnode dds = NULL;
+	OCddsnode das = NULL;
+	double start = now();
+	if((ret = oc_open(url,&link))) goto ocfail;
+	if((ret = oc_fetch(link,NULL,OCDDS,0,&dds))) goto ocfail;
+	if((ret = oc_fetch(link,NULL,OCDAS,0,&das))) goto ocfail;
+	if((ret = oc_merge_das(link,das,dds))) goto ocfail;
+	oc_root_free(link,das);
+	oc_root_free(link,dds);
+	oc_close(link);
+	total += (now() - start);
+    }
+    report(name,size,total);
+done:
+    nullfree(url);
+    ncbytesfree(input);
+    return ret;
+ocfail:
+    fprintf(stderr,"%s: oc error %d\n",path,ret);
+    ret = NC_EDAP;
+    goto done;
+}
+
+/* Synthesize a DMR and a DDS/DAS pair with nvars variables */
+static int
+benchsynthetic(int nvars)
+{
+    int ret = NC_NOERR;
+    int i;
+    char line[1024];
+    char name[64];
+    char path[64];
+    FILE* dds = NULL;
+    FILE* das = NULL;
+    NCbytes* dmr = ncbytesnew();
+
+    ncbytescat(dmr,"<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n"
+	"<Dataset name=\"synthetic\" dapVersion=\"4.0\" dmrVersion=\"1.0\""
+	" xmlns=\"http://xml.opendap.org/ns/DAP/4.0#\">\n"
+	"<Dimension name=\"d0\" size=\"10\"/>\n"
+	"<Dimension name=\"d1\" size=\"20\"/>\n");
+    for(i=0;i<nvars;i++) {
+	snprintf(line,sizeof(line),"<Float32 name=\"v%d\">\n"
+	    "  <Dim name=\"/d0\"/>\n  <Dim name=\"/d1\"/>\n"
+	    "  <Attribute name=\"units\" type=\"String\"><Value value=\"K\"/></Attribute>\n"
+	    "  <Attribute name=\"scale\" type=\"Float32\"><Value value=\"1.5\"/></Attribute>\n"
+	    "</Float32>\n",i);
+	ncbytescat(dmr,line);
+    }
+    ncbytescat(dmr,"</Dataset>\n");
+    snprintf(name,sizeof(name),"synthetic %d vars (DMR)",nvars);
+    if((ret = benchdmr(name,ncbytescontents(dmr)))) goto done;
+
+    snprintf(path,sizeof(path),"bm_parse_%d.dds",nvars);
+    if((dds = fopen(path,"w")) == NULL) {ret = errno; goto done;}
+    snprintf(path,sizeof(path),"bm_parse_%d.das",nvars);
+    if((das = fopen(path,"w")) == NULL) {ret = errno; goto done;}
+    fprintf(dds,"Dataset {\n");
+    fprintf(das,"Attributes {\n");
+    for(i=0;i<nvars;i++) {
+	fprintf(dds,"    Float32 v%d[d0 = 10][d1 = 20];\n",i);
+	fprintf(das,"    v%d {\n        String units \"K\";\n"
+		"        Float32 scale 1.5;\n    }\n",i);
+    }
+    fprintf(dds,"} synthetic;\n");
+    fprintf(das,"}\n");
+    fclose(dds); dds = NULL;
+    fclose(das); das = NULL;
+    if(getcwd(line,sizeof(line)) == NULL) {ret = errno; goto done;}
+    snprintf(line+strlen(line),sizeof(line)-strlen(line),"/bm_parse_%d.dds",nvars);
+    ret = benchdap2(line);
+    unlink(line);
+    strcpy(line+strlen(line)-4,".das");
+    unlink(line);
+done:
+    if(dds != NULL) fclose(dds);
+    if(das != NULL) fclose(das);
+    ncbytesfree(dmr);
+    return ret;
+}
+
+int
+main(int argc, char** argv)
+{
+    int ret = NC_NOERR;
+    int c;
+    int nvars = 0;
+
+    while ((c = getopt(argc, argv, "r:s:")) != EOF) {
+	switch(c) {
+	case 'r': reps = atoi(optarg); break;
+	case 's': nvars = atoi(optarg); break;
+	default:
+	    fprintf(stderr,"usage: bm_parse [-r reps] [-s nvars] file...\n");
+	    exit(1);
+	}
+    }
+    if(reps <= 0) reps = 1;
+    /* oc_open() needs the library's global state */
+    if((ret = nc_initialize())) {
+	fprintf(stderr,"nc_initialize: %s\n",nc_strerror(ret));
+	exit(1);
+    }
+
+    for(c=optind;c<argc;c++) {
+	const char* path = argv[c];
+	size_t len = strlen(path);
+	if(len > 4 && strcmp(path+len-4,".dds") == 0)
+	    ret = benchdap2(path);
+	else if(len > 4 && strcmp(path+len-4,".das") == 0)
+	    continue; /* done with its .dds */
+	else
+	    ret = benchdap4(path);
+	if(ret) {
+	    fprintf(stderr,"%s: %s\n",path,nc_strerror(ret));
+	    exit(1);
+	}
+    }
+    if(nvars > 0 && (ret = benchsynthetic(nvars))) {
+	fprintf(stderr,"synthetic: %s\n",nc_strerror(ret));
+	exit(1);
+    }
+    exit(0);
+}
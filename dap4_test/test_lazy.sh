@@ -0,0 +1,70 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+set -e
+. ${srcdir}/d4test_common.sh
+
+echo "test_lazy.sh:"
+
+# Compute the set of testfiles
+cd ${srcdir}/daptestfiles
+F=`ls -1d *.dap`
+cd -
+F=`echo $F | tr '\r\n' '  '`
+F=`echo $F | sed -e s/.dap//g`
+
+# Remote testfiles with rows of atomic arrays to fetch one at a time
+R="test_atomic_array.nc test_atomic_types.nc test_enum_array.nc test_struct_array.nc"
+
+setresultdir results_test_lazy
+
+# A file cannot apply constraints, so in lazy mode its data are
+# decoded when the first variable is read; the dump must not change
+for f in $F ; do
+    echo "testing: $f"
+    URL="[lazy][show=fetch][log][dap4]file://${DAPTESTFILES}/${f}"
+    if ! ${NCDUMP} "${URL}" > ${builddir}/results_test_lazy/${f}.dmp 2> ${builddir}/results_test_lazy/${f}.log; then
+        failure "${URL}"
+    fi
+    if ! diff -wBb ${BASELINERAW}/${f}.dmp ${builddir}/results_test_lazy/${f}.dmp ; then
+	failure "diff ${f}.dmp"
+    fi
+    if ! grep -q "lazy fetch:" ${builddir}/results_test_lazy/${f}.log ; then
+	failure "${f}: data not decoded lazily"
+    fi
+done
+
+# From the test server, each variable is fetched with a constraint
+# of its own; with a [lazylimit] of one byte, each row that ncdump
+# reads of an atomic array is fetched by itself
+TESTSERVER=
+if test -x ${execdir}/findtestserver4 ; then
+    TESTSERVER=`${execdir}/findtestserver4 dap4 d4ts` || TESTSERVER=
+fi
+if test "x$TESTSERVER" = x ; then
+    echo "*** Skip remote lazy tests: cannot find d4ts testserver"
+else
+    for f in $R ; do
+	echo "testing: ${TESTSERVER}/testfiles/${f}"
+	URL="[dap4]${TESTSERVER}/testfiles/${f}"
+	if ! ${NCDUMP} "${URL}" > ${builddir}/results_test_lazy/${f}.dmp; then
+	    failure "${URL}"
+	fi
+	LURL="[lazy][lazylimit=1][show=fetch][log]${URL}"
+	if ! ${NCDUMP} "${LURL}" > ${builddir}/results_test_lazy/${f}.lazy.dmp 2> ${builddir}/results_test_lazy/${f}.log; then
+	    failure "${LURL}"
+	fi
+	if ! diff -wBb ${builddir}/results_test_lazy/${f}.dmp ${builddir}/results_test_lazy/${f}.lazy.dmp ; then
+	    failure "diff ${f}.lazy.dmp"
+	fi
+    done
+    # Some rows of test_atomic_array.nc must have been fetched as slabs
+    if ! grep -q "lazy fetch: dap4.ce=/vu8\[" ${builddir}/results_test_lazy/test_atomic_array.nc.log ; then
+	failure "test_atomic_array.nc: no slab fetched"
+    fi
+fi
+rm -rf ${builddir}/results_test_lazy
+
+finish
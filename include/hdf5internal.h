@@ -19,6 +19,7 @@
 #include "nc4dispatch.h"
 #include "hdf5dispatch.h"
 #include "netcdf_filter.h"
+#include "netcdf_chunk.h"
 
 #define NC_MAX_HDF5_NAME (NC_MAX_NAME + 10)
 
@@ -172,6 +173,54 @@ int nc4_get_var_meta(NC_VAR_INFO_T *var);
 
 /* Define Filter API Function */
 int nc4_filter_action(int action, int formatx, int id, NC_FILTER_INFO* info);
+
+/* In-library filters, in hdf5filter.c. */
+void nc4_hdf5_filter_initialize(void);
+int nc4_filter_provide(unsigned int id);
+void nc4_shuffle(const unsigned char *src, unsigned char *dst, size_t nbytes,
+                 size_t size, int reverse);
+int nc4_bitshuffle(const unsigned char *src, unsigned char *dst, size_t nbytes,
+                   size_t size, size_t blocksize, int reverse);
+unsigned int nc4_fletcher32(const unsigned char *data, size_t len);
+int nc4_fletcher32_check(const unsigned char *data, size_t nbytes);
+void nc4_fletcher32_append(unsigned char *data, size_t nbytes);
+
+/* Access intent API functions (see libdispatch/dchunk.c) */
+int NC4_hdf5_def_var_chunk_intent(int ncid, int varid, int intent);
+int NC4_hdf5_inq_var_chunk_intent(int ncid, int varid, int *intentp);
+
+/* Write an attribute, bypassing the reserved name checks if force. */
+int nc4_put_att(NC_GRP_INFO_T *grp, int varid, const char *name, nc_type file_type,
+                size_t len, const void *data, nc_type mem_type, int force);
+
+/* Quantization API functions (see libdispatch/dvar.c) */
+int NC4_hdf5_def_var_quantize(int ncid, int varid, int quantize_mode, int nsd);
+int NC4_hdf5_inq_var_quantize(int ncid, int varid, int *quantize_modep, int *nsdp);
+
+/* Filter chain queries (see libdispatch/dfilter.c) */
+int NC4_hdf5_inq_var_filter_ids(int ncid, int varid, size_t *nfiltersp,
+                                unsigned int *filterids);
+int NC4_hdf5_inq_var_filter_info(int ncid, int varid, unsigned int id,
+                                 size_t *nparamsp, unsigned int *params);
+
+/* Direct chunk I/O, in hdf5chunk.c. */
+int NC4_hdf5_read_chunk(int ncid, int varid, const size_t *offset,
+                        unsigned int *filtermaskp, size_t *nbytesp, void *data);
+int NC4_hdf5_write_chunk(int ncid, int varid, const size_t *offset,
+                         unsigned int filtermask, size_t nbytes, const void *data);
+int NC4_hdf5_inq_var_chunk_info(int ncid, int varid, size_t maxchunks,
+                                size_t *nchunksp, size_t *offsets,
+                                unsigned long long *addrs, size_t *nbytes,
+                                unsigned int *filtermasks);
+int nc4_direct_get_vars(NC_FILE_INFO_T *h5, NC_VAR_INFO_T *var,
+                        const hsize_t *start, const hsize_t *count,
+                        const hsize_t *stride, const hsize_t *fdims,
+                        nc_type mem_nc_type, void *data, int *donep);
+int nc4_direct_put_vars(NC_FILE_INFO_T *h5, NC_VAR_INFO_T *var,
+                        const hsize_t *start, const hsize_t *count,
+                        const hsize_t *stride, const hsize_t *fdims,
+                        const void *data, int *donep);
+
 /* Support functions for provenance info (defined in nc4hdf.c) */
 extern int NC4_hdf5get_libversion(unsigned*,unsigned*,unsigned*);/*libsrc4/nc4hdf.c*/
 extern int NC4_hdf5get_superblock(struct NC_FILE_INFO*, int*);/*libsrc4/nc4hdf.c*/
@@ -247,6 +247,15 @@ extern "C" {
     EXTERNL int
     NC4_def_var_filter(int, int, unsigned int, size_t, const unsigned int*);
 
+    EXTERNL int
+    NC4_inq_var_filter_ids(int, int, size_t *, unsigned int *);
+
+    EXTERNL int
+    NC4_inq_var_filter_info(int, int, unsigned int, size_t *, unsigned int *);
+
+    EXTERNL int
+    NC4_inq_var_quantize(int, int, int *, int *);
+
     EXTERNL int
     NC4_get_var_chunk_cache(int, int, size_t *, size_t *, float *);
 
@@ -180,6 +180,17 @@ typedef struct NC_ATT_INFO
     char **stdata;          /**< String data (only for string type). */
 } NC_ATT_INFO_T;
 
+/** One filter of a variable's filter chain. Shuffle and fletcher32
+ * are kept as flags instead, since they always run first and last;
+ * deflate is both a flag and an entry, so its place in the chain is
+ * known. */
+typedef struct NC_FILTER_SPEC
+{
+    unsigned int filterid; /**< ID of the filter. */
+    size_t nparams;        /**< Number of parameters. */
+    unsigned int *params;  /**< Parameters, or NULL. */
+} NC_FILTER_SPEC_T;
+
 /** This is a struct to handle the var metadata. */
 typedef struct NC_VAR_INFO
 {
@@ -215,9 +226,10 @@ typedef struct NC_VAR_INFO
     size_t chunk_cache_size, chunk_cache_nelems;
     float chunk_cache_preemption;
     void *format_var_info;       /**< Pointer to any binary format info. */
-    unsigned int filterid;       /**< ID for arbitrary filter. */
-    size_t nparams;              /**< nparams for arbitrary filter. */
-    unsigned int *params;        /**< Params for arbitrary filter. */
+    NClist *filters;             /**< NClist<NC_FILTER_SPEC_T*>, in pipeline order. */
+    int chunk_intent;            /**< Access intent used for default chunk shape. */
+    int quantize_mode;           /**< NC_NOQUANTIZE or NC_QUANTIZE_BITGROOM. */
+    int nsd;                     /**< Significant digits kept by quantization. */
 } NC_VAR_INFO_T;
 
 /** This is a struct to handle the field metadata from a user-defined
@@ -307,6 +319,7 @@ typedef struct  NC_FILE_INFO
     nc_bool_t parallel;   /**< True if file is open for parallel access */
     nc_bool_t redef;      /**< True if redefining an existing file */
     int fill_mode;        /**< Fill mode for vars - Unused internally currently */
+    int chunk_intent;     /**< Default access intent for new vars. */
     nc_bool_t no_write;   /**< true if nc_open has mode NC_NOWRITE. */
     NC_GRP_INFO_T *root_grp; /**< Pointer to root group. */
     short next_nc_grpid;  /**< Next available group ID. */
@@ -351,6 +364,8 @@ int nc4_get_typelen_mem(NC_FILE_INFO_T *h5, nc_type xtype, size_t *len);
 int nc4_convert_type(const void *src, void *dest, const nc_type src_type,
                      const nc_type dest_type, const size_t len, int *range_error,
                      const void *fill_value, int strict_nc3);
+int nc4_quantize_data(void *data, nc_type type, size_t len, int nsd,
+                      const void *fill_value);
 
 /* These functions do HDF5 things. */
 int nc4_reopen_dataset(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var);
@@ -396,6 +411,11 @@ int nc4_var_list_add2(NC_GRP_INFO_T* grp, const char* name,
                       NC_VAR_INFO_T **var);
 int nc4_var_set_ndims(NC_VAR_INFO_T *var, int ndims);
 int nc4_var_list_del(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var);
+int nc4_var_filter_add(NC_VAR_INFO_T *var, unsigned int id, size_t nparams,
+                       const unsigned int *params);
+int nc4_var_filter_remove(NC_VAR_INFO_T *var, unsigned int id);
+NC_FILTER_SPEC_T *nc4_var_filter_find(NC_VAR_INFO_T *var, unsigned int id);
+
 int nc4_dim_list_add(NC_GRP_INFO_T *grp, const char *name, size_t len,
                      int assignedid, NC_DIM_INFO_T **dim);
 int nc4_dim_list_del(NC_GRP_INFO_T *grp, NC_DIM_INFO_T *dim);
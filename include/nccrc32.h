@@ -0,0 +1,30 @@
+/*********************************************************************
+ *   Copyright 2019, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+#ifndef NCCRC32_H
+#define NCCRC32_H
+
+#include <stddef.h>
+#include "ncexternl.h"
+
+#if defined(_CPLUSPLUS_) || defined(__CPLUSPLUS__)
+extern "C" {
+#endif
+
+/* Update crc, the CRC-32 (as in zlib and the DAP4 checksums) of the
+   bytes so far, with the len bytes at buf; start with crc = 0. The
+   buffer need not be aligned. Long buffers are done with PCLMULQDQ
+   when the CPU has it. */
+EXTERNL unsigned int NC_crc32(unsigned int crc, const void* buf, size_t len);
+
+/* The same, always using the portable slicing-by-8 tables; for
+   testing and benchmarking */
+EXTERNL unsigned int NC_crc32_portable(unsigned int crc, const void* buf, size_t len);
+
+#if defined(_CPLUSPLUS_) || defined(__CPLUSPLUS__)
+}
+#endif
+
+#endif /*NCCRC32_H*/
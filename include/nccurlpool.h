@@ -0,0 +1,49 @@
+/*********************************************************************
+ *   Copyright 2019, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+#ifndef NCCURLPOOL_H
+#define NCCURLPOOL_H
+
+#include <stddef.h>
+#include <curl/curl.h>
+#include "ncexternl.h"
+
+/* Number of idle curl handles kept for reuse */
+#define NC_CURL_POOLMAX 8
+
+#if defined(_CPLUSPLUS_) || defined(__CPLUSPLUS__)
+extern "C" {
+#endif
+
+/* Return a curl handle with default options that shares the DNS
+   cache, TLS sessions and (libcurl >= 7.57) open connections with
+   every other handle from this pool, so that opening a second url on
+   the same server does not pay for a new connection. Returns NULL if
+   curl cannot create a handle. */
+EXTERNL CURL* NC_curl_acquire(void);
+
+/* Return a copy of curl, with all of its options, attached to the
+   pool's share; curl_easy_duphandle alone would drop the share.
+   Returns NULL if curl cannot copy the handle. */
+EXTERNL CURL* NC_curl_duplicate(CURL* curl);
+
+/* Give back a handle from NC_curl_acquire or NC_curl_duplicate.
+   Its options are reset; the connections it opened stay in the
+   shared cache. NULL is ignored. */
+EXTERNL void NC_curl_release(CURL* curl);
+
+/* Number of handles created and of handles handed out again since
+   the process started; for tests and debugging */
+EXTERNL void NC_curl_poolstats(size_t* createdp, size_t* reusedp);
+
+/* Free the idle handles and the shared state; called when the
+   library is finalized, before curl_global_cleanup */
+EXTERNL void NC_curl_poolfinalize(void);
+
+#if defined(_CPLUSPLUS_) || defined(__CPLUSPLUS__)
+}
+#endif
+
+#endif /*NCCURLPOOL_H*/
@@ -36,6 +36,8 @@ typedef unsigned int NCFLAGS;
 #define NCF_PREFETCH_ALL    (0x0800) /* Prefetch all variables */
 /* Allow _FillValue/Variable type mismatch */
 #define NCF_FILLMISMATCH    (0x1000)
+#define NCF_AGGREGATE       (0x2000) /* fetch slabs of co-read variables together */
+#define NCF_READAHEAD       (0x4000) /* fetch the predicted next slab in the background */
 /*COLUMBIA_HACK*/
 #define NCF_COLUMBIA        (0x80000000) /* Hack for columbia server */
 
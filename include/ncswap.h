@@ -0,0 +1,32 @@
+/*********************************************************************
+ *   Copyright 2019, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+#ifndef NCSWAP_H
+#define NCSWAP_H
+
+#include <stddef.h>
+#include "ncexternl.h"
+
+/* Arrays with fewer elements than this are better swapped inline
+   than through the bulk kernels below */
+#define NC_SWAP_BULK 16
+
+#if defined(_CPLUSPLUS_) || defined(__CPLUSPLUS__)
+extern "C" {
+#endif
+
+/* Reverse the byte order of each of the n 2, 4 or 8 byte elements at
+   src, storing them at dst. dst may be the same as src, but the two
+   must not otherwise overlap; neither needs to be aligned. Vector
+   kernels are used when the CPU has them. */
+EXTERNL void NC_swapn2(void* dst, const void* src, size_t n);
+EXTERNL void NC_swapn4(void* dst, const void* src, size_t n);
+EXTERNL void NC_swapn8(void* dst, const void* src, size_t n);
+
+#if defined(_CPLUSPLUS_) || defined(__CPLUSPLUS__)
+}
+#endif
+
+#endif /*NCSWAP_H*/
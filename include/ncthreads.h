@@ -0,0 +1,48 @@
+/*********************************************************************
+ *   Copyright 2019, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+#ifndef NCTHREADS_H
+#define NCTHREADS_H
+
+#include <stddef.h>
+#include "ncexternl.h"
+
+/* Upper bound on the number of worker threads NC_run_tasks will start */
+#define NC_MAX_THREADS 64
+
+/* A task function is called once for each task index in [0,ntasks);
+   it returns an NC_XXX error code. */
+typedef int (*NCtaskfcn)(void* state, size_t task);
+
+#if defined(_CPLUSPLUS_) || defined(__CPLUSPLUS__)
+extern "C" {
+#endif
+
+/* Run ntasks tasks on up to nthreads threads and wait for all of them
+   to finish. Tasks are handed out in index order. Returns the error of
+   the lowest-numbered failing task, or NC_NOERR. Without thread support
+   the tasks are run serially. */
+EXTERNL int NC_run_tasks(int nthreads, size_t ntasks, NCtaskfcn fcn, void* state);
+
+/* Non-zero if NC_run_tasks can actually run tasks concurrently */
+EXTERNL int NC_threads_available(void);
+
+/* A single task running in the background; see NC_start_task */
+typedef struct NCbgtask NCbgtask;
+
+/* Start task 0 of fcn on a thread of its own and return at once; the
+   task must be passed to NC_join_task exactly once. Without thread
+   support the task is run before returning. */
+EXTERNL int NC_start_task(NCtaskfcn fcn, void* state, NCbgtask** taskp);
+
+/* Wait for a task started by NC_start_task, free it and return the
+   error code of the task. */
+EXTERNL int NC_join_task(NCbgtask* task);
+
+#if defined(_CPLUSPLUS_) || defined(__CPLUSPLUS__)
+}
+#endif
+
+#endif /*NCTHREADS_H*/
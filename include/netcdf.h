@@ -316,6 +316,20 @@ there. */
 #define NC_MIN_DEFLATE_LEVEL 0 /**< Minimum deflate level. */
 #define NC_MAX_DEFLATE_LEVEL 9 /**< Maximum deflate level. */
 
+/**@{*/
+/** Control quantization of float and double variables. Quantization
+ * trims the precision of the data to a number of significant decimal
+ * digits before it is written, so that it compresses better. It is
+ * set with nc_def_var_quantize(), and recorded in the attribute
+ * NC_QUANTIZE_BITGROOM_ATT_NAME of the variable. */
+#define NC_NOQUANTIZE 0
+#define NC_QUANTIZE_BITGROOM 1
+#define NC_QUANTIZE_MAX 1
+#define NC_QUANTIZE_BITGROOM_ATT_NAME "_QuantizeBitGroomNumberOfSignificantDigits"
+#define NC_QUANTIZE_MAX_FLOAT_NSD 7   /**< Most significant digits of a float. */
+#define NC_QUANTIZE_MAX_DOUBLE_NSD 15 /**< Most significant digits of a double. */
+/**@}*/
+
 /** The netcdf version 3 functions all return integer error status.
  * These are the possible values, in addition to certain values from
  * the system errno.h.
@@ -862,6 +876,15 @@ nc_def_var_fletcher32(int ncid, int varid, int fletcher32);
 EXTERNL int
 nc_inq_var_fletcher32(int ncid, int varid, int *fletcher32p);
 
+/* Set quantization (lossy precision trimming) for a float or double
+   var. This must be done after nc_def_var and before nc_enddef. */
+EXTERNL int
+nc_def_var_quantize(int ncid, int varid, int quantize_mode, int nsd);
+
+/* Inquire about quantization for a var. */
+EXTERNL int
+nc_inq_var_quantize(int ncid, int varid, int *quantize_modep, int *nsdp);
+
 /* Define chunking for a variable. This must be done after nc_def_var
    and before nc_enddef. */
 EXTERNL int
@@ -0,0 +1,70 @@
+/* Copyright 2019, UCAR/Unidata and OPeNDAP, Inc.
+   See the COPYRIGHT file for more information. */
+
+/*
+ * In order to use any of the netcdf_XXX.h files, it is necessary
+ * to include netcdf.h followed by any netcdf_XXX.h files.
+ * Various things (like EXTERNL) are defined in netcdf.h
+ * to make them available for use by the netcdf_XXX.h files.
+*/
+
+#ifndef NETCDF_CHUNK_H
+#define NETCDF_CHUNK_H 1
+
+/* API for libdispatch/dchunk.c */
+
+/* Declared access intents; these steer the choice of default chunk
+   shapes for netCDF-4 variables. The leading dimension of a variable
+   is taken to be its "time" dimension, the rest its "spatial"
+   dimensions. */
+#define NC_CHUNK_INTENT_DEFAULT    0 /* Use the library default chunk shape */
+#define NC_CHUNK_INTENT_BALANCED   1 /* Balance map and time series reads */
+#define NC_CHUNK_INTENT_SPATIAL    2 /* Optimize for full-field map reads */
+#define NC_CHUNK_INTENT_TIMESERIES 3 /* Optimize for full time series reads */
+#define NC_CHUNK_INTENT_MAX        NC_CHUNK_INTENT_TIMESERIES
+
+/* Notional length used for an unlimited leading dimension when
+   computing intent-based chunk shapes. */
+#define NC_CHUNK_UNLIM_EXTENT 1024
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Set/get the access intent of a variable; varid == NC_GLOBAL sets
+   the default for variables subsequently defined in the file. */
+EXTERNL int nc_def_var_chunk_intent(int ncid, int varid, int intent);
+EXTERNL int nc_inq_var_chunk_intent(int ncid, int varid, int* intentp);
+
+/* Chunk-shape optimizer shared by the library and the utilities. */
+EXTERNL int NC_compute_chunk_shape(int intent, size_t typesize, size_t chunkbytes,
+                                   int ndims, const size_t* dimlens,
+                                   const int* unlimited, size_t* chunksizes);
+
+/* Number of threads used to decode chunks on the direct chunk I/O
+   path; 0 (the default) disables that path. */
+EXTERNL int nc_set_chunk_threads(int nthreads);
+EXTERNL int nc_get_chunk_threads(int* nthreadsp);
+
+/* Read/write one chunk exactly as it is stored in the file, i.e. still
+   filtered. The offset is the index of the first element of the chunk.
+   Bit i of the filter mask is set if filter i was not applied. */
+EXTERNL int nc_read_chunk(int ncid, int varid, const size_t* offset,
+                          unsigned int* filtermaskp, size_t* nbytesp, void* data);
+EXTERNL int nc_write_chunk(int ncid, int varid, const size_t* offset,
+                           unsigned int filtermask, size_t nbytes, const void* data);
+
+/* List the chunks of a variable that have storage in the file: their
+   offsets (ndims entries per chunk), file addresses, stored sizes and
+   filter masks. The arrays have room for maxchunks chunks; call with
+   NULL arrays first to get the count. */
+EXTERNL int nc_inq_var_chunk_info(int ncid, int varid, size_t maxchunks,
+                                  size_t* nchunksp, size_t* offsets,
+                                  unsigned long long* addrs, size_t* nbytes,
+                                  unsigned int* filtermasks);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* NETCDF_CHUNK_H */
@@ -137,6 +137,26 @@ struct NC_Dispatch
     int (*set_var_chunk_cache)(int, int, size_t, size_t, float);
     int (*get_var_chunk_cache)(int ncid, int varid, size_t *sizep,
                                size_t *nelemsp, float *preemptionp);
+
+    /* Access intent used to choose default chunk sizes */
+    int (*def_var_chunk_intent)(int, int, int);
+    int (*inq_var_chunk_intent)(int, int, int *);
+
+    /* Direct chunk I/O, bypassing the filter pipeline */
+    int (*read_chunk)(int, int, const size_t *, unsigned int *, size_t *, void *);
+    int (*write_chunk)(int, int, const size_t *, unsigned int, size_t, const void *);
+
+    /* Allocated chunks of a variable */
+    int (*inq_var_chunk_info)(int, int, size_t, size_t *, size_t *,
+                              unsigned long long *, size_t *, unsigned int *);
+
+    /* The filter chain of a variable */
+    int (*inq_var_filter_ids)(int, int, size_t *, unsigned int *);
+    int (*inq_var_filter_info)(int, int, unsigned int, size_t *, unsigned int *);
+
+    /* Quantization of floating point data */
+    int (*def_var_quantize)(int, int, int, int);
+    int (*inq_var_quantize)(int, int, int *, int *);
 };
 
 #if defined(__cplusplus)
@@ -219,6 +239,20 @@ extern "C" {
     EXTERNL int NC_NOTNC4_inq_user_type(int, nc_type, char *, size_t *,
                                         nc_type *, size_t *, int *);
     EXTERNL int NC_NOTNC4_inq_typeid(int, const char *, nc_type *);
+    EXTERNL int NC_NOTNC4_def_var_chunk_intent(int, int, int);
+    EXTERNL int NC_NOTNC4_inq_var_chunk_intent(int, int, int *);
+    EXTERNL int NC_NOTNC4_read_chunk(int, int, const size_t *, unsigned int *,
+                                     size_t *, void *);
+    EXTERNL int NC_NOTNC4_write_chunk(int, int, const size_t *, unsigned int,
+                                      size_t, const void *);
+    EXTERNL int NC_NOTNC4_inq_var_chunk_info(int, int, size_t, size_t *,
+                                             size_t *, unsigned long long *,
+                                             size_t *, unsigned int *);
+    EXTERNL int NC_NOTNC4_inq_var_filter_ids(int, int, size_t *, unsigned int *);
+    EXTERNL int NC_NOTNC4_inq_var_filter_info(int, int, unsigned int, size_t *,
+                                              unsigned int *);
+    EXTERNL int NC_NOTNC4_def_var_quantize(int, int, int, int);
+    EXTERNL int NC_NOTNC4_inq_var_quantize(int, int, int *, int *);
 #if defined(__cplusplus)
 }
 #endif
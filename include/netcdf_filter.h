@@ -14,10 +14,29 @@
 /* API for libdispatch/dfilter.c */
 
 /* Must match values in <H5Zpublic.h> */
+#ifndef H5Z_FILTER_DEFLATE
+#define H5Z_FILTER_DEFLATE 1
+#endif
+#ifndef H5Z_FILTER_SHUFFLE
+#define H5Z_FILTER_SHUFFLE 2
+#endif
+#ifndef H5Z_FILTER_FLETCHER32
+#define H5Z_FILTER_FLETCHER32 3
+#endif
 #ifndef H5Z_FILTER_SZIP
 #define H5Z_FILTER_SZIP 4
 #endif
 
+/* Registered id of the bitshuffle filter, which the library supplies
+   (without compression) when no plugin does. Its parameters are the
+   format version (two values), element size, block size in elements
+   (0 for the default) and compression (0 for none). All are filled in
+   when the variable is created, so nc_def_var_filter() may be given
+   none, or four to set the block size. */
+#ifndef H5Z_FILTER_BITSHUFFLE
+#define H5Z_FILTER_BITSHUFFLE 32008
+#endif
+
 /* Define the known filter formats */
 #define NC_FILTER_FORMAT_HDF5 1 /* Use the H5Z_class2_t format */
 
@@ -46,6 +65,13 @@ EXTERNL int NC_parsefilterspec(const char* spec, unsigned int* idp, size_t* npar
 
 EXTERNL void NC_filterfix8(unsigned char* mem, int decode);
 
+/* Inquire about the filter chain of a variable, in the order the
+   filters are applied when writing. Shuffle and fletcher32 are not
+   listed (see nc_inq_var_deflate() and nc_inq_var_fletcher32());
+   deflate is. */
+EXTERNL int nc_inq_var_filter_ids(int ncid, int varid, size_t* nfiltersp, unsigned int* filterids);
+EXTERNL int nc_inq_var_filter_info(int ncid, int varid, unsigned int id, size_t* nparamsp, unsigned int* params);
+
 /* Support direct user defined filters */
 EXTERNL int nc_filter_register(NC_FILTER_INFO* filter_info);
 EXTERNL int nc_filter_unregister(int format, int id);
@@ -14,6 +14,7 @@ So this flag controls this. By default, it is on.
 #define GRADS_PREFETCH
 
 static int iscacheableconstraint(DCEconstraint* con);
+static void purgeexpired(NCDAPCOMMON* nccomm);
 
 /* Return 1 if we can reuse cached data to address
    the current get_vara request; return 0 otherwise.
@@ -30,6 +31,7 @@ iscached(NCDAPCOMMON* nccomm, CDFnode* target, NCcachenode** cachenodep)
 
     found = 0;
     if(target == NULL) goto done;
+    purgeexpired(nccomm);
 
     /* Match the target variable against the prefetch, if any */
     /* Note that prefetches are always whole variable */
@@ -83,6 +85,264 @@ else
     return found;
 }
 
+/* Purge the cache nodes (other than the prefetch) that are older
+   than the cacheage parameter allows */
+static void
+purgeexpired(NCDAPCOMMON* nccomm)
+{
+    int i;
+    NCcache* cache = nccomm->cdf.cache;
+    time_t now;
+
+    if(cache->cacheage <= 0 || nclistlength(cache->nodes) == 0) return;
+    now = time(NULL);
+    for(i=nclistlength(cache->nodes)-1;i>=0;i--) {
+        NCcachenode* node = (NCcachenode*)nclistget(cache->nodes,i);
+	if(difftime(now,node->fetchtime) <= (double)cache->cacheage) continue;
+	nclistremove(cache->nodes,i);
+	cache->cachesize -= node->xdrsize;
+	cache->stats.expirations++;
+	freenccachenode(nccomm,node);
+    }
+}
+
+/* If the request slab lies within the cached slab, with a stride
+   that is a multiple of the cached one, return 1 and a copy of request
+   whose slices address the request within the cached data. */
+static int
+slabcontains(DCEprojection* cached, DCEprojection* request,
+	     DCEprojection** walkp)
+{
+    int i,j,nsegs;
+    NClist* csegs = cached->var->segments;
+    NClist* rsegs = request->var->segments;
+    DCEprojection* walk;
+
+    nsegs = nclistlength(rsegs);
+    if(nclistlength(csegs) != nsegs) return 0;
+    for(i=0;i<nsegs;i++) {
+	DCEsegment* cseg = (DCEsegment*)nclistget(csegs,i);
+	DCEsegment* rseg = (DCEsegment*)nclistget(rsegs,i);
+	if(strcmp(cseg->name,rseg->name) != 0 || cseg->rank != rseg->rank)
+	    return 0;
+	if(rseg->rank == 0) continue;
+	/* only the last segment may be dimensioned */
+	if(i < nsegs-1) return 0;
+	for(j=0;j<rseg->rank;j++) {
+	    DCEslice* c = &cseg->slices[j];
+	    DCEslice* r = &rseg->slices[j];
+	    size_t clast = c->first + c->stride*(c->count-1);
+	    size_t rlast = r->first + r->stride*(r->count-1);
+	    if(c->count == 0 || r->count == 0) return 0;
+	    if(r->first < c->first || rlast > clast) return 0;
+	    if((r->first - c->first) % c->stride != 0) return 0;
+	    if(r->count > 1 && r->stride % c->stride != 0) return 0;
+	}
+    }
+    walk = (DCEprojection*)dceclone((DCEnode*)request);
+    if(walk == NULL) return 0;
+    for(i=0;i<nsegs;i++) {
+	DCEsegment* cseg = (DCEsegment*)nclistget(csegs,i);
+	DCEsegment* wseg = (DCEsegment*)nclistget(walk->var->segments,i);
+	for(j=0;j<wseg->rank;j++) {
+	    DCEslice* c = &cseg->slices[j];
+	    DCEslice* w = &wseg->slices[j];
+	    w->first = (w->first - c->first) / c->stride;
+	    w->stride = (w->count > 1 ? w->stride / c->stride : 1);
+	    w->length = w->stride*(w->count-1) + 1;
+	    w->last = w->first + w->length - 1;
+	    w->declsize = c->count;
+	}
+    }
+    *walkp = walk;
+    return 1;
+}
+
+/* Return 1 if some cache node that is not whole variable was
+   fetched with exactly the given (server space) projection, as
+   happens when a variable was fetched along with another one or read
+   ahead. If allowsubset is set, the projection may also lie within
+   one of the cached slabs; then *walkprojectionp receives the
+   projection to walk the cached data with. Return 0 otherwise.
+*/
+int
+iscachedpart(NCDAPCOMMON* nccomm, DCEprojection* fetchprojection,
+	     int allowsubset, NCcachenode** cachenodep,
+	     DCEprojection** walkprojectionp)
+{
+    int i,j,found,index;
+    NCcache* cache = nccomm->cdf.cache;
+    NCcachenode* cachenode = NULL;
+    DCEprojection* walk = NULL;
+    char* want = NULL;
+
+    found = 0;
+    purgeexpired(nccomm);
+    if(fetchprojection == NULL || nclistlength(cache->nodes) == 0) goto done;
+    want = dcetostring((DCEnode*)fetchprojection);
+    index = 0;
+    for(i=nclistlength(cache->nodes)-1;i>=0;i--) {
+        cachenode = (NCcachenode*)nclistget(cache->nodes,i);
+	if(cachenode->wholevariable || cachenode->constraint == NULL) continue;
+	for(j=0;j<nclistlength(cachenode->constraint->projections);j++) {
+	    DCEprojection* p = (DCEprojection*)nclistget(cachenode->constraint->projections,j);
+	    char* have = dcetostring((DCEnode*)p);
+	    found = (strcmp(have,want) == 0);
+	    nullfree(have);
+	    if(!found && allowsubset)
+		found = slabcontains(p,fetchprojection,&walk);
+	    if(found) {index = i; break;}
+	}
+	if(found) break;
+    }
+    if(found) {
+        if(nclistlength(cache->nodes) > 1) {
+	    /* Manage the cache nodes as LRU */
+	    nclistremove(cache->nodes,index);
+	    nclistpush(cache->nodes,(void*)cachenode);
+	}
+        if(cachenodep) *cachenodep = cachenode;
+    }
+done:
+    if(walkprojectionp)
+	*walkprojectionp = walk;
+    else
+	dcefree((DCEnode*)walk);
+    nullfree(want);
+    return found;
+}
+
+/* Access history.
+   The recent get_vara requests are kept so that nc3d_getvarx can
+   recognize the common loop of reading the same slab of several
+   variables, one step at a time, and fetch those variables together
+   and the next step ahead.
+*/
+
+static void
+freeaccess(NCaccess* rec)
+{
+    if(rec == NULL) return;
+    nullfree(rec->slab);
+    free(rec);
+}
+
+void
+dapaccessrecord(NCcache* cache, CDFnode* var, size_t rank,
+		const size_t* start, const size_t* count, const ptrdiff_t* stride)
+{
+    size_t i;
+    NCaccess* rec = (NCaccess*)calloc(1,sizeof(NCaccess));
+    if(rec == NULL) return;
+    if(rank > 0 && (rec->slab = (size_t*)malloc(3*rank*sizeof(size_t))) == NULL)
+	{free(rec); return;}
+    rec->var = var;
+    rec->rank = rank;
+    for(i=0;i<rank;i++) {
+	rec->slab[i] = start[i];
+	rec->slab[rank+i] = count[i];
+	rec->slab[2*rank+i] = (size_t)stride[i];
+    }
+    if(cache->history == NULL) cache->history = nclistnew();
+    while(nclistlength(cache->history) >= DFALTHISTORY)
+	freeaccess((NCaccess*)nclistremove(cache->history,0));
+    nclistpush(cache->history,(void*)rec);
+}
+
+/* Index of the latest request for var, or -1 */
+static int
+lastaccess(NCcache* cache, CDFnode* var)
+{
+    int i;
+    for(i=nclistlength(cache->history)-1;i>=0;i--) {
+	NCaccess* rec = (NCaccess*)nclistget(cache->history,i);
+	if(rec->var == var) return i;
+    }
+    return -1;
+}
+
+static int
+sameshape(NCaccess* rec, size_t rank, const size_t* count, const ptrdiff_t* stride)
+{
+    size_t i;
+    if(rec->rank != rank) return 0;
+    for(i=0;i<rank;i++) {
+	if(rec->slab[rank+i] != count[i]
+	   || rec->slab[2*rank+i] != (size_t)stride[i]) return 0;
+    }
+    return 1;
+}
+
+/* Return the (possibly empty) list of the other variables that were
+   read, with the same start, count and stride, after the latest
+   request for var with this count and stride.
+*/
+NClist*
+dapaccesscompanions(NCcache* cache, CDFnode* var, size_t rank,
+		    const size_t* count, const ptrdiff_t* stride)
+{
+    int i,last;
+    NCaccess* prev;
+    NClist* companions = nclistnew();
+
+    last = lastaccess(cache,var);
+    if(last < 0) goto done;
+    prev = (NCaccess*)nclistget(cache->history,last);
+    if(!sameshape(prev,rank,count,stride)) goto done;
+    for(i=last+1;i<nclistlength(cache->history);i++) {
+	NCaccess* rec = (NCaccess*)nclistget(cache->history,i);
+	if(!sameshape(rec,rank,count,stride)) continue;
+	if(rank > 0 && memcmp(rec->slab,prev->slab,rank*sizeof(size_t)) != 0)
+	    continue;
+	if(!nclistcontains(companions,(void*)rec->var))
+	    nclistpush(companions,(void*)rec->var);
+    }
+done:
+    return companions;
+}
+
+/* If the latest request for var had the same count and stride and a
+   different start, predict that the next one will move on by the
+   same amount and return 1 if that is still within the variable.
+*/
+int
+dapaccesspredict(NCcache* cache, CDFnode* var, size_t rank,
+		 const size_t* start, const size_t* count,
+		 const ptrdiff_t* stride, size_t* nextstart)
+{
+    size_t i;
+    int last, moved = 0;
+    NCaccess* prev;
+    NClist* dims = var->array.dimsetall;
+
+    last = lastaccess(cache,var);
+    if(last < 0 || rank == 0 || nclistlength(dims) != rank) return 0;
+    prev = (NCaccess*)nclistget(cache->history,last);
+    if(!sameshape(prev,rank,count,stride)) return 0;
+    for(i=0;i<rank;i++) {
+	CDFnode* dim = (CDFnode*)nclistget(dims,i);
+	size_t end;
+	if(start[i] != prev->slab[i]) moved = 1;
+	/* next = 2*start - prev, which must stay in [0,declsize) */
+	if(start[i] < prev->slab[i] && prev->slab[i] - start[i] > start[i])
+	    return 0;
+	nextstart[i] = (start[i] + start[i]) - prev->slab[i];
+	end = nextstart[i] + (size_t)stride[i]*(count[i]-1);
+	if(nextstart[i] >= dim->dim.declsize || end >= dim->dim.declsize)
+	    return 0;
+    }
+    return moved;
+}
+
+void
+clearreadahead(NCcache* cache)
+{
+    dcefree((DCEnode*)cache->readahead.constraint);
+    cache->readahead.constraint = NULL;
+    nclistfree(cache->readahead.vars);
+    cache->readahead.vars = NULL;
+}
+
 /* Compute the set of prefetched data.
    Notes:
    1. All prefetches are whole variable fetches.
@@ -254,6 +514,7 @@ buildcachenode(NCDAPCOMMON* nccomm,
     constraint = NULL;
     cachenode->wholevariable = iscacheableconstraint(cachenode->constraint);
 
+    cachenode->fetchtime = time(NULL);
     /* save the root content*/
     cachenode->ocroot = ocroot;
     ocstat = oc_data_getroot(conn,ocroot,&cachenode->content);
@@ -262,6 +523,7 @@ buildcachenode(NCDAPCOMMON* nccomm,
     /* capture the packet size */
     ocstat = oc_raw_xdrsize(conn,ocroot,&cachenode->xdrsize);
     if(ocstat) {THROWCHK(ocerrtoncerr(ocstat)); goto done;}
+    nccomm->cdf.cache->stats.fetched += cachenode->xdrsize;
 
 #ifdef DEBUG
 fprintf(stderr,"buildcachenode: new cache node: %s\n",
@@ -282,6 +544,7 @@ fprintf(stderr,"buildcachenode: purge cache node: %s\n",
 	dumpcachenode(cachenode));
 #endif
 	    cache->cachesize -= node->xdrsize;
+	    cache->stats.evictions++;
 	    freenccachenode(nccomm,node);
 	}
 	/* Remove cache nodes to get below the max cache count */
@@ -293,6 +556,7 @@ fprintf(stderr,"buildcachenode: count purge cache node: %s\n",
 	dumpcachenode(node));
 #endif
 	    cache->cachesize -= node->xdrsize;
+	    cache->stats.evictions++;
 	    freenccachenode(nccomm,node);
         }
         nclistpush(nccomm->cdf.cache->nodes,(void*)cachenode);
@@ -343,11 +607,19 @@ freenccache(NCDAPCOMMON* nccomm, NCcache* cache)
 {
     int i;
     if(cache == NULL) return;
+    nclog(NCLOGNOTE,"cache: %lu hits (%lu within a larger slab), %lu misses, %lu evictions, %lu expirations, %lld bytes fetched",
+	  cache->stats.hits,cache->stats.subsethits,cache->stats.misses,
+	  cache->stats.evictions,cache->stats.expirations,
+	  (long long)cache->stats.fetched);
     freenccachenode(nccomm,cache->prefetch);
     for(i=0;i<nclistlength(cache->nodes);i++) {
 	freenccachenode(nccomm,(NCcachenode*)nclistget(cache->nodes,i));
     }
     nclistfree(cache->nodes);
+    for(i=0;i<nclistlength(cache->history);i++)
+	freeaccess((NCaccess*)nclistget(cache->history,i));
+    nclistfree(cache->history);
+    clearreadahead(cache);
     nullfree(cache);
 }
 
@@ -6,6 +6,7 @@
 #include "dapincludes.h"
 #include "daputil.h"
 #include "dapdump.h"
+#include "nchashmap.h"
 
 #ifdef DAPDEBUG
 extern char* ocfqn(OCddsnode);
@@ -29,6 +30,12 @@ static NCerror buildcdftreer(NCDAPCOMMON*, OCddsnode, CDFnode*, CDFtree*, CDFnod
 static void free1cdfnode(CDFnode* node);
 static NCerror fixnodes(NCDAPCOMMON*, NClist* cdfnodes);
 static void defdimensions(OCddsnode ocnode, CDFnode* cdfnode, NCDAPCOMMON* nccomm, CDFtree* tree);
+static size_t* nameindex(NClist* nodes, int fullname, NC_hashmap** firstp);
+static size_t namefirst(NC_hashmap* first, const char* name);
+
+/* Lists of subnodes shorter than this are searched linearly */
+#define NAMEINDEXMIN 16
+#define NOINDEX ((size_t)-1)
 
 /* Accumulate useful node sets  */
 NCerror
@@ -214,7 +221,9 @@ Figure out the names for variables.
 NCerror
 computecdfvarnames(NCDAPCOMMON* nccomm, CDFnode* root, NClist* varnodes)
 {
-    unsigned int i,j,d;
+    unsigned int i,d;
+    NC_hashmap* first = NULL;
+    size_t* next = NULL;
 
     /* clear all elided marks; except for dataset and grids */
     for(i=0;i<nclistlength(root->tree->nodes);i++) {
@@ -235,6 +244,11 @@ fprintf(stderr,"var names: %s %s %s\n",
 #endif
     }
 
+    /* Chain the variables by full name; the checks below only
+       compare variables with the same full name */
+    if((next = nameindex(varnodes,1,&first)) == NULL)
+	return NC_ENOMEM;
+
     /*  unify all variables with same fullname and dimensions
 	basevar fields says: "for duplicate grid variables";
         when does this happen?
@@ -242,15 +256,14 @@ fprintf(stderr,"var names: %s %s %s\n",
     if(FLAGSET(nccomm->controls,NCF_NC3)) {
         for(i=0;i<nclistlength(varnodes);i++) {
 	    int match;
+	    size_t j;
 	    CDFnode* var = (CDFnode*)nclistget(varnodes,i);
-	    for(j=0;j<i;j++) {
+	    for(j=namefirst(first,var->ncfullname);j<i;j=next[j]) {
 	        CDFnode* testnode = (CDFnode*)nclistget(varnodes,j);
 		match = 1;
 	        if(testnode->array.basevar != NULL)
 		    continue; /* already processed */
-	        if(strcmp(var->ncfullname,testnode->ncfullname) != 0)
-		    match = 0;
-		else if(nclistlength(testnode->array.dimsetall)
+		if(nclistlength(testnode->array.dimsetall)
 			!= nclistlength(var->array.dimsetall))
 		    match = 0;
 	        else for(d=0;d<nclistlength(testnode->array.dimsetall);d++) {
@@ -271,19 +284,65 @@ fprintf(stderr,"basevar invoked: %s\n",var->ncfullname);
 
     /* Finally, verify unique names */
     for(i=0;i<nclistlength(varnodes);i++) {
+	size_t j;
 	CDFnode* var1 = (CDFnode*)nclistget(varnodes,i);
 	if(var1->array.basevar != NULL) continue;
-	for(j=0;j<i;j++) {
+	for(j=namefirst(first,var1->ncfullname);j<i;j=next[j]) {
 	    CDFnode* var2 = (CDFnode*)nclistget(varnodes,j);
 	    if(var2->array.basevar != NULL) continue;
-	    if(strcmp(var1->ncfullname,var2->ncfullname)==0) {
-		PANIC1("duplicate var names: %s",var1->ncfullname);
-	    }
+	    PANIC1("duplicate var names: %s",var1->ncfullname);
 	}
     }
+    NC_hashmapfree(first);
+    free(next);
     return NC_NOERR;
 }
 
+/*
+Chain the nodes of a list by ocname (or ncfullname) so that all the
+nodes with a given name can be visited in list order: namefirst()
+gives the index of the first and the returned array the index of
+each next one, NOINDEX at the end. The chains are built in reverse
+so that each comes out in list order.
+*/
+static size_t*
+nameindex(NClist* nodes, int fullname, NC_hashmap** firstp)
+{
+    size_t i, len = nclistlength(nodes);
+    NC_hashmap* first = NC_hashmapnew(len);
+    size_t* next = (size_t*)malloc(sizeof(size_t)*(len+1));
+    if(first == NULL || next == NULL) {
+	if(first != NULL) NC_hashmapfree(first);
+	nullfree(next);
+	return NULL;
+    }
+    for(i=len;i-- > 0;) {
+	CDFnode* node = (CDFnode*)nclistget(nodes,i);
+	const char* name = (fullname ? node->ncfullname : node->ocname);
+	uintptr_t head;
+	size_t namelen;
+	next[i] = NOINDEX;
+	if(name == NULL) continue;
+	namelen = strlen(name)+1;
+	if(NC_hashmapget(first,name,namelen,&head)) {
+	    next[i] = (size_t)head;
+	    NC_hashmapsetdata(first,name,namelen,(uintptr_t)i);
+	} else
+	    NC_hashmapadd(first,(uintptr_t)i,name,namelen);
+    }
+    *firstp = first;
+    return next;
+}
+
+static size_t
+namefirst(NC_hashmap* first, const char* name)
+{
+    uintptr_t head;
+    if(name == NULL || !NC_hashmapget(first,name,strlen(name)+1,&head))
+	return NOINDEX;
+    return (size_t)head;
+}
+
 
 /* locate and connect usable sequences and vars.
 A sequence is usable iff:
@@ -593,8 +652,10 @@ done:
 static NCerror
 mapnodesr(CDFnode* connode, CDFnode* fullnode, int depth)
 {
-    unsigned int i,j;
+    size_t i,j;
     NCerror ncstat = NC_NOERR;
+    NC_hashmap* first = NULL;
+    size_t* next = NULL;
 
     ASSERT((simplenodematch(connode,fullnode)));
 
@@ -627,10 +688,17 @@ nullfree(path1); nullfree(path2);
     /* Try to match connode subnodes against fullnode subnodes */
     ASSERT(nclistlength(connode->subnodes) <= nclistlength(fullnode->subnodes));
 
+    /* Matching nodes have the same name, so only those need testing */
+    if(nclistlength(fullnode->subnodes) >= NAMEINDEXMIN
+       && (next = nameindex(fullnode->subnodes,0,&first)) == NULL)
+	{ncstat = NC_ENOMEM; goto done;}
+
     for(i=0;i<nclistlength(connode->subnodes);i++) {
         CDFnode* consubnode = (CDFnode*)nclistget(connode->subnodes,i);
 	/* Search full subnodes for a matching subnode from con */
-        for(j=0;j<nclistlength(fullnode->subnodes);j++) {
+        for(j=(next?namefirst(first,consubnode->ocname):0);
+	    j!=NOINDEX && j<nclistlength(fullnode->subnodes);
+	    j=(next?next[j]:j+1)) {
             CDFnode* fullsubnode = (CDFnode*)nclistget(fullnode->subnodes,j);
             if(simplenodematch(fullsubnode,consubnode)) {
                 ncstat = mapnodesr(consubnode,fullsubnode,depth+1);
@@ -639,6 +707,8 @@ nullfree(path1); nullfree(path2);
 	}
     }
 done:
+    if(first != NULL) NC_hashmapfree(first);
+    nullfree(next);
     return THROW(ncstat);
 }
 
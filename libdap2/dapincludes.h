@@ -12,6 +12,7 @@
 #endif
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "netcdf.h"
 
@@ -87,6 +88,14 @@ extern NCerror nc3d_getvarx(int ncid, int varid,
 	    void *data,
 	    nc_type dsttype0);
 
+extern NCerror nc3d_getvarmx(int ncid, int varid,
+	    const size_t *startp,
+	    const size_t *countp,
+	    const ptrdiff_t *stridep,
+	    const ptrdiff_t *imapp,
+	    void *data,
+	    nc_type dsttype0);
+
 /**************************************************/
 
 extern NCerror nc3d_open(const char* path, int mode, int* ncidp);
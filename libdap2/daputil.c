@@ -656,6 +656,7 @@ dap_fetch(NCDAPCOMMON* nccomm, OClink conn, const char* ce,
     char* ext = NULL;
     OCflags flags = 0;
     int httpcode = 0;
+    unsigned long long wire0 = 0, decoded0 = 0;
 #ifdef HAVE_GETTIMEOFDAY
     struct timeval time0;
     struct timeval time1;
@@ -684,12 +685,14 @@ dap_fetch(NCDAPCOMMON* nccomm, OClink conn, const char* ce,
 	else
             LOG2(NCLOGNOTE,"fetch: %s?%s",baseurl,ce);
 	nullfree(baseurl);
+	(void)oc_transfer_counts(conn,&wire0,&decoded0);
 #ifdef HAVE_GETTIMEOFDAY
 	gettimeofday(&time0,NULL);
 #endif
     }
     ocstat = oc_fetch(conn,ce,dxd,flags,rootp);
     if(FLAGSET(nccomm->controls,NCF_SHOWFETCH)) {
+	unsigned long long wire1 = 0, decoded1 = 0;
 #ifdef HAVE_GETTIMEOFDAY
         double secs;
 	gettimeofday(&time1,NULL);
@@ -698,6 +701,11 @@ dap_fetch(NCDAPCOMMON* nccomm, OClink conn, const char* ce,
 #else
 	nclog(NCLOGNOTE,"fetch complete.");
 #endif
+	/* The two differ when the server compressed the response */
+	(void)oc_transfer_counts(conn,&wire1,&decoded1);
+	if(wire1 > wire0 || decoded1 > decoded0)
+	    nclog(NCLOGNOTE,"fetch size: %llu bytes received, %llu decoded",
+		  wire1-wire0,decoded1-decoded0);
     }
 #ifdef DEBUG2
 fprintf(stderr,"fetch: dds:\n");
@@ -9,8 +9,7 @@
 #include "dapdump.h"
 #include "ncd2dispatch.h"
 #include "ocx.h"
-
-#define NEWVARM
+#include "ncthreads.h"
 
 /* Define a tracker for memory to support*/
 /* the concatenation*/
@@ -32,6 +31,15 @@ static NCerror movetofield(NCDAPCOMMON*, OCdatanode,
 
 static int findfield(CDFnode* node, CDFnode* subnode);
 static NCerror removepseudodims(DCEprojection* proj);
+static NCerror buildfetchprojection(NCDAPCOMMON*, CDFnode* var, const size_t*, const size_t*, const ptrdiff_t*, DCEprojection**);
+static NCerror buildslabconstraint(NCDAPCOMMON*, NClist* vars, const size_t*, const size_t*, const ptrdiff_t*, DCEconstraint**);
+static NClist* aggregatevars(NCDAPCOMMON*, CDFnode* var, size_t rank, const size_t*, const size_t*, const ptrdiff_t*);
+static int canaggregate(NCDAPCOMMON*, CDFnode* var);
+static int readaheadcovers(NCcache*, DCEprojection* fetchprojection);
+static void startreadahead(NCDAPCOMMON*, NClist* vars, size_t rank, const size_t*, const size_t*, const ptrdiff_t*);
+static int isstreamable(NCDAPCOMMON*, CDFnode* var, size_t rank, const size_t*);
+static NCerror streamvara(NCDAPCOMMON*, CDFnode* var, const size_t*, const size_t*, const ptrdiff_t*, nc_type, void*);
+static int conversionrequired(nc_type t1, nc_type t2);
 
 static int extract(NCDAPCOMMON*, Getvara*, CDFnode*, DCEsegment*, size_t dimindex, OClink, OCdatanode, struct NCMEMORY*);
 static int extractstring(NCDAPCOMMON*, Getvara*, CDFnode*, DCEsegment*, size_t dimindex, OClink, OCdatanode, struct NCMEMORY*);
@@ -67,6 +75,19 @@ c. Vara is requesting part of a variable but NCF_WHOLEVAR flag is set.
 	   fetchprojection = unsliced vara variable => fetch whole variable
 d. Vara is requesting part of a variable and NCF_WHOLEVAR flag is not set.
 	   fetchprojection = sliced vara variable => fetch part variable
+   In case d, the very same slab may already be in the cache because
+   it was fetched along with another variable or read ahead, or
+   the slab may lie within a larger cached slab of the variable:
+	   fetchprojection = N.A. since the slab is in the cache
+   Otherwise, if enabled by the [aggregate] and [readahead] client
+   parameters, the access history (see cache.c) is used to
+   add the same slab of the variables that were read right after
+   this one last time to the fetch constraint, and to start reading
+   the next slab (of all of them) in the background when this
+   variable is being read a step at a time.
+   A slab of a top-level array that is larger than the fetch limit
+   is neither cached nor aggregated: its values are decoded straight
+   into the caller's memory as the response arrives (FETCHSTREAM).
 
 2. At this point, all or part of the target variable is available in the cache.
 
@@ -75,7 +96,9 @@ d. Vara is requesting part of a variable and NCF_WHOLEVAR flag is not set.
    For cases a,b,c:
        walkprojection = merge(urlprojection,varaprojection)
    For case d:
-       walkprojection =  varaprojection without slicing.
+       walkprojection =  varaprojection without slicing,
+       or, when the slab lies within a larger cached slab, the slab
+       relative to the cached one.
        This means we need only extract the complete contents of the cache.
        Notice that this will not necessarily be a direct memory to
        memory copy because the dap encoding still needs to be
@@ -114,11 +137,15 @@ nc3d_getvarx(int ncid, int varid,
     DCEconstraint* fetchconstraint = NULL;
     DCEprojection* fetchprojection = NULL;
     DCEprojection* walkprojection = NULL;
+    DCEprojection* partprojection = NULL;
+    DCEprojection* subsetwalk = NULL;
     int state;
 #define FETCHWHOLE 1 /* fetch whole data set */
 #define FETCHVAR   2 /* fetch whole variable */
 #define FETCHPART  4 /* fetch constrained variable */
 #define CACHED     8 /* whole variable is already in the cache */
+#define CACHEDPART 16 /* constrained variable is already in the cache */
+#define FETCHSTREAM 32 /* stream constrained variable into memory */
 
     ncstat = NC_check_id(ncid, (NC**)&drno);
     if(ncstat != NC_NOERR) goto fail;
@@ -282,10 +309,27 @@ fprintf(stderr,"var is in cache\n");
     } else {/* load using constraints */
         if(FLAGSET(dapcomm->controls,NCF_WHOLEVAR))
 	    state = FETCHVAR;
-	else
-	    state = FETCHPART;
+	else {
+	    ncstat = buildfetchprojection(dapcomm,varainfo->target,
+					  startp,countp,stridep,&partprojection);
+	    if(ncstat != NC_NOERR) {THROWCHK(ncstat); goto fail;}
+	    if(iscachedpart(dapcomm,partprojection,
+			    canaggregate(dapcomm,varainfo->target),
+			    &cachenode,&subsetwalk))
+		state = CACHEDPART;
+	    else if(!readaheadcovers(dapcomm->cdf.cache,partprojection)
+		    && isstreamable(dapcomm,varainfo->target,ncrank,countp))
+		state = FETCHSTREAM;
+	    else
+		state = FETCHPART;
+	}
     }
     ASSERT(state != 0);
+    if(state == CACHED || state == CACHEDPART) {
+	dapcomm->cdf.cache->stats.hits++;
+	if(subsetwalk != NULL) dapcomm->cdf.cache->stats.subsethits++;
+    } else
+	dapcomm->cdf.cache->stats.misses++;
 
     switch (state) {
 
@@ -345,31 +389,40 @@ fprintf(stderr,"getvarx: FETCHVAR: fetchconstraint: %s\n",dumpconstraint(fetchco
 	if(ncstat != NC_NOERR) {THROWCHK(ncstat); goto fail;}
     } break;
 
+    case CACHEDPART:
     case FETCHPART: {
-        /* Create fetch projection as the merge of the url projections
-           and the vara projection */
-        ncstat = daprestrictprojection(dapcomm->oc.dapconstraint->projections,
-				       varaprojection,&fetchprojection);
-	/* elide any sequence and string dimensions (dap servers do not allow such). */
-	ncstat = removepseudodims(fetchprojection);
-        if(ncstat != NC_NOERR) {THROWCHK(ncstat); goto fail;}
+	NCcache* cache = dapcomm->cdf.cache;
 
-	/* Shift the varaprojection for simple walk */
 	dcefree((DCEnode*)walkprojection) ; /* reclaim any existing walkprojection */
-	walkprojection = (DCEprojection*)dceclone((DCEnode*)varaprojection);
-        dapshiftprojection(walkprojection);
-
-#ifdef DEBUG
-        fprintf(stderr,"getvarx: FETCHPART: fetchprojection: |%s|\n",dumpprojection(fetchprojection));
-#endif
+	if(subsetwalk != NULL) {
+	    /* Walk the part of the larger cached slab that was asked for */
+	    walkprojection = subsetwalk;
+	    subsetwalk = NULL;
+	    varainfo->subset = 1;
+	} else {
+	    /* Shift the varaprojection for simple walk */
+	    walkprojection = (DCEprojection*)dceclone((DCEnode*)varaprojection);
+            dapshiftprojection(walkprojection);
+	}
 
-        /* Build the complete constraint to use in the fetch */
-        fetchconstraint = (DCEconstraint*)dcecreate(CES_CONSTRAINT);
-        /* merged constraint just uses the url constraint selection */
-        fetchconstraint->selections = dceclonelist(dapcomm->oc.dapconstraint->selections);
-	/* and the created fetch projection */
-        fetchconstraint->projections = nclistnew();
-        nclistpush(fetchconstraint->projections,(void*)fetchprojection);
+	if(state == CACHEDPART) break;
+
+	if(readaheadcovers(cache,partprojection)) {
+	    /* Reuse the constraint so oc can match the read ahead */
+	    fetchconstraint = cache->readahead.constraint;
+	    nclistfree(vars);
+	    vars = cache->readahead.vars;
+	    cache->readahead.constraint = NULL;
+	    cache->readahead.vars = NULL;
+	} else {
+	    clearreadahead(cache);
+	    nclistfree(vars);
+	    vars = aggregatevars(dapcomm,varainfo->target,ncrank,
+				 startp,countp,stridep);
+	    ncstat = buildslabconstraint(dapcomm,vars,startp,countp,stridep,
+					 &fetchconstraint);
+	    if(ncstat != NC_NOERR) {THROWCHK(ncstat); goto fail;}
+	}
 #ifdef DEBUG
         fprintf(stderr,"getvarx: FETCHPART: fetchconstraint: %s\n",dumpconstraint(fetchconstraint));
 #endif
@@ -380,6 +433,18 @@ fprintf(stderr,"getvarx: FETCHVAR: fetchconstraint: %s\n",dumpconstraint(fetchco
 
 	fetchconstraint = NULL; /*buildcachenode34 takes control of fetchconstraint.*/
 	if(ncstat != NC_NOERR) {THROWCHK(ncstat); goto fail;}
+
+	if(FLAGSET(dapcomm->controls,NCF_READAHEAD) && NC_threads_available())
+	    startreadahead(dapcomm,vars,ncrank,startp,countp,stridep);
+    } break;
+
+    case FETCHSTREAM: {
+	clearreadahead(dapcomm->cdf.cache);
+	ncstat = streamvara(dapcomm,varainfo->target,startp,countp,stridep,
+			    dsttype,data);
+	if(ncstat != NC_NOERR) {THROWCHK(ncstat); goto fail;}
+	dapaccessrecord(dapcomm->cdf.cache,cdfvar,ncrank,startp,countp,stridep);
+	goto fail; /* the data are already in place */
     } break;
 
     default: PANIC1("unknown fetch state: %d\n",state);
@@ -413,15 +478,268 @@ fprintf(stderr,"cache.datadds=%s\n",dumptree(cachenode->datadds));
     ncstat = moveto(dapcomm,varainfo,varainfo->cache->datadds,data);
     if(ncstat != NC_NOERR) {THROWCHK(ncstat); goto fail;}
 
+    dapaccessrecord(dapcomm->cdf.cache,cdfvar,ncrank,startp,countp,stridep);
+
 fail:
     if(vars != NULL) nclistfree(vars);
     if(varaprojection != NULL) dcefree((DCEnode*)varaprojection);
+    if(partprojection != NULL) dcefree((DCEnode*)partprojection);
+    if(subsetwalk != NULL) dcefree((DCEnode*)subsetwalk);
     if(fetchconstraint != NULL) dcefree((DCEnode*)fetchconstraint);
     if(varainfo != NULL) freegetvara(varainfo);
     if(ocstat != OC_NOERR) ncstat = ocerrtoncerr(ocstat);
     return THROW(ncstat);
 }
 
+/* Build the fetch projection for a slab of var: its vara projection
+   restricted by the url projections, minus any pseudo dimensions */
+static NCerror
+buildfetchprojection(NCDAPCOMMON* dapcomm, CDFnode* var,
+		     const size_t* startp, const size_t* countp,
+		     const ptrdiff_t* stridep, DCEprojection** projectionp)
+{
+    NCerror ncstat = NC_NOERR;
+    DCEprojection* varaprojection = NULL;
+    DCEprojection* projection = NULL;
+
+    ncstat = dapbuildvaraprojection(var,startp,countp,stridep,&varaprojection);
+    if(ncstat != NC_NOERR) goto done;
+    ncstat = daprestrictprojection(dapcomm->oc.dapconstraint->projections,
+				   varaprojection,&projection);
+    if(ncstat != NC_NOERR) goto done;
+    /* elide any sequence and string dimensions (dap servers do not allow such). */
+    ncstat = removepseudodims(projection);
+    if(ncstat != NC_NOERR) goto done;
+    *projectionp = projection;
+    projection = NULL;
+done:
+    dcefree((DCEnode*)varaprojection);
+    dcefree((DCEnode*)projection);
+    return THROW(ncstat);
+}
+
+/* Build the constraint fetching the same slab of each of vars,
+   with the url selections */
+static NCerror
+buildslabconstraint(NCDAPCOMMON* dapcomm, NClist* vars,
+		    const size_t* startp, const size_t* countp,
+		    const ptrdiff_t* stridep, DCEconstraint** constraintp)
+{
+    int i;
+    NCerror ncstat = NC_NOERR;
+    DCEconstraint* constraint = (DCEconstraint*)dcecreate(CES_CONSTRAINT);
+
+    /* merged constraint just uses the url constraint selection */
+    constraint->selections = dceclonelist(dapcomm->oc.dapconstraint->selections);
+    constraint->projections = nclistnew();
+    for(i=0;i<nclistlength(vars);i++) {
+	DCEprojection* projection = NULL;
+	ncstat = buildfetchprojection(dapcomm,(CDFnode*)nclistget(vars,i),
+				      startp,countp,stridep,&projection);
+	if(ncstat != NC_NOERR) goto done;
+	nclistpush(constraint->projections,(void*)projection);
+    }
+    *constraintp = constraint;
+    constraint = NULL;
+done:
+    dcefree((DCEnode*)constraint);
+    return THROW(ncstat);
+}
+
+/* Can a slab of var be fetched along with some other variable's? */
+static int
+canaggregate(NCDAPCOMMON* dapcomm, CDFnode* var)
+{
+    if(nclistlength(dapcomm->oc.dapconstraint->projections) > 0)
+	return 0; /* keep the url projections simple to apply */
+    switch (var->etype) {
+    case NC_STRING: case NC_URL: return 0;
+    default: break;
+    }
+    return !var->invisible && !dapinsequence(var);
+}
+
+/* Return the list of var followed by the variables whose same slab
+   should be fetched with it, within the cache size limit */
+static NClist*
+aggregatevars(NCDAPCOMMON* dapcomm, CDFnode* var, size_t rank,
+	      const size_t* startp, const size_t* countp,
+	      const ptrdiff_t* stridep)
+{
+    int i;
+    size_t j, nelems, total;
+    NClist* companions = NULL;
+    NClist* vars = nclistnew();
+
+    nclistpush(vars,(void*)var);
+    if(!FLAGSET(dapcomm->controls,NCF_AGGREGATE) || !canaggregate(dapcomm,var))
+	goto done;
+    for(nelems=1,j=0;j<rank;j++) nelems *= countp[j];
+    total = nelems * nctypesizeof(var->etype);
+    companions = dapaccesscompanions(dapcomm->cdf.cache,var,rank,countp,stridep);
+    for(i=0;i<nclistlength(companions);i++) {
+	CDFnode* other = (CDFnode*)nclistget(companions,i);
+	NClist* dims = other->array.dimsetall;
+	size_t size = nelems * nctypesizeof(other->etype);
+	int fits = (nclistlength(dims) == rank);
+	if(!fits || !canaggregate(dapcomm,other)) continue;
+	for(j=0;j<rank;j++) {
+	    CDFnode* dim = (CDFnode*)nclistget(dims,j);
+	    if(startp[j] + (size_t)stridep[j]*(countp[j]-1) >= dim->dim.declsize)
+		{fits = 0; break;}
+	}
+	if(!fits || iscached(dapcomm,other,NULL)) continue;
+	if(total + size > dapcomm->cdf.cache->cachelimit) break;
+	total += size;
+	nclistpush(vars,(void*)other);
+    }
+done:
+    nclistfree(companions);
+    return vars;
+}
+
+/* Is this slab among those being read ahead? */
+static int
+readaheadcovers(NCcache* cache, DCEprojection* fetchprojection)
+{
+    int i, found = 0;
+    char* want;
+    DCEconstraint* constraint = cache->readahead.constraint;
+
+    if(constraint == NULL || fetchprojection == NULL) return 0;
+    want = dcetostring((DCEnode*)fetchprojection);
+    for(i=0;!found && i<nclistlength(constraint->projections);i++) {
+	char* have = dcetostring((DCEnode*)nclistget(constraint->projections,i));
+	found = (strcmp(have,want) == 0);
+	nullfree(have);
+    }
+    nullfree(want);
+    return found;
+}
+
+/* If the first of vars is being read a step at a time, ask oc to
+   fetch the next step of all of vars in the background */
+static void
+startreadahead(NCDAPCOMMON* dapcomm, NClist* vars, size_t rank,
+	       const size_t* startp, const size_t* countp,
+	       const ptrdiff_t* stridep)
+{
+    int i;
+    size_t j, nextstart[NC_MAX_VAR_DIMS];
+    NCcache* cache = dapcomm->cdf.cache;
+    CDFnode* var = (CDFnode*)nclistget(vars,0);
+    DCEconstraint* constraint = NULL;
+    char* ce = NULL;
+
+    if(!canaggregate(dapcomm,var)
+       || !dapaccesspredict(cache,var,rank,startp,countp,stridep,nextstart))
+	return;
+    /* All of vars must have room for the next slab */
+    for(i=1;i<nclistlength(vars);i++) {
+	NClist* dims = ((CDFnode*)nclistget(vars,i))->array.dimsetall;
+	for(j=0;j<rank;j++) {
+	    CDFnode* dim = (CDFnode*)nclistget(dims,j);
+	    if(nextstart[j] + (size_t)stridep[j]*(countp[j]-1) >= dim->dim.declsize)
+		return;
+	}
+    }
+    if(buildslabconstraint(dapcomm,vars,nextstart,countp,stridep,&constraint) != NC_NOERR)
+	return;
+    ce = dcebuildconstraintstring(constraint);
+    if(FLAGSET(dapcomm->controls,NCF_SHOWFETCH)) {
+	LOG1(NCLOGNOTE,"readahead: %s",ce);
+    }
+    if(ce != NULL && oc_prefetch(dapcomm->oc.conn,ce) == OC_NOERR) {
+	cache->readahead.constraint = constraint;
+	cache->readahead.vars = nclistclone(vars);
+	constraint = NULL;
+    }
+    nullfree(ce);
+    dcefree((DCEnode*)constraint);
+}
+
+/* Should this slab of var be streamed rather than cached? */
+static int
+isstreamable(NCDAPCOMMON* dapcomm, CDFnode* var, size_t rank,
+	     const size_t* countp)
+{
+    size_t i, size;
+    if(rank == 0 || !canaggregate(dapcomm,var)
+       || nclistlength(dapcomm->oc.dapconstraint->selections) > 0
+       || var->container == NULL || var->container->nctype != NC_Dataset)
+	return 0;
+    for(size=nctypesizeof(var->etype),i=0;i<rank;i++) size *= countp[i];
+    return (size > dapcomm->cdf.fetchlimit);
+}
+
+/* Where streamed values go */
+struct NCSTREAM {
+    nc_type srctype;
+    nc_type dsttype;
+    size_t dstsize;
+    int requireconversion;
+    char* memory;
+    NCerror ncstat;
+};
+
+static OCerror
+streamvalues(void* userdata, const void* values, size_t start, size_t count)
+{
+    struct NCSTREAM* st = (struct NCSTREAM*)userdata;
+    char* memory = st->memory + start*st->dstsize;
+    if(!st->requireconversion)
+	memcpy(memory,values,count*st->dstsize);
+    else {
+	st->ncstat = dapconvert(st->srctype,st->dsttype,memory,(char*)values,count);
+	if(st->ncstat != NC_NOERR) return OC_EINVAL;
+    }
+    return OC_NOERR;
+}
+
+/* Fetch a slab of a top-level array straight into memory */
+static NCerror
+streamvara(NCDAPCOMMON* dapcomm, CDFnode* var,
+	   const size_t* startp, const size_t* countp,
+	   const ptrdiff_t* stridep, nc_type dsttype, void* memory)
+{
+    int i;
+    NCerror ncstat = NC_NOERR;
+    OCerror ocstat = OC_NOERR;
+    OCtype octype;
+    size_t nelems;
+    NClist* vars = nclistnew();
+    DCEconstraint* constraint = NULL;
+    char* ce = NULL;
+    struct NCSTREAM st;
+
+    ocstat = oc_dds_atomictype(dapcomm->oc.conn,var->ocnode,&octype);
+    if(ocstat != OC_NOERR) goto done;
+    for(nelems=1,i=0;i<nclistlength(var->array.dimsetall);i++)
+	nelems *= countp[i];
+    nclistpush(vars,(void*)var);
+    ncstat = buildslabconstraint(dapcomm,vars,startp,countp,stridep,&constraint);
+    if(ncstat != NC_NOERR) goto done;
+    ce = dcebuildconstraintstring(constraint);
+
+    st.srctype = var->etype;
+    st.dsttype = dsttype;
+    st.dstsize = nctypesizeof(dsttype);
+    st.requireconversion = conversionrequired(dsttype,var->etype);
+    st.memory = (char*)memory;
+    st.ncstat = NC_NOERR;
+    if(FLAGSET(dapcomm->controls,NCF_SHOWFETCH)) {
+	LOG1(NCLOGNOTE,"stream: %s",ce);
+    }
+    ocstat = oc_stream_data(dapcomm->oc.conn,ce,octype,nelems,streamvalues,&st);
+    if(st.ncstat != NC_NOERR) ncstat = st.ncstat;
+done:
+    nclistfree(vars);
+    dcefree((DCEnode*)constraint);
+    nullfree(ce);
+    if(ncstat == NC_NOERR && ocstat != OC_NOERR) ncstat = ocerrtoncerr(ocstat);
+    return THROW(ncstat);
+}
+
 /* Remove any pseudodimensions (sequence and string)*/
 static NCerror
 removepseudodims(DCEprojection* proj)
@@ -682,33 +1000,6 @@ done:
     return THROW(ncstat);
 }
 
-#if 0
-
-/* Determine the index in the odometer at which
-   the odometer will be walking the whole subslice
-   This will allow us to optimize.
-*/
-static int
-wholeslicepoint(Dapodometer* odom)
-{
-    unsigned int i;
-    int point;
-    for(point=-1,i=0;i<odom->rank;i++) {
-        ASSERT((odom->size[i] != 0));
-        if(odom->start[i] != 0 || odom->stride[i] != 1
-           || odom->count[i] != odom->size[i])
-	    point = i;
-    }
-    if(point == -1)
-	point = 0; /* wholevariable */
-    else if(point == (odom->rank - 1))
-	point = -1; /* no whole point */
-    else
-	point += 1; /* intermediate point */
-    return point;
-}
-#endif
-
 static int
 findfield(CDFnode* node, CDFnode* field)
 {
@@ -797,7 +1088,7 @@ fprintf(stderr,"\n");
             if(ncstat != NC_NOERR) {THROWCHK(ncstat); goto done;}
         }
         memory->next += (externtypesize);
-    } else if(xgetvar->cache->wholevariable) {/* && rank0 > 0 */
+    } else if(xgetvar->cache->wholevariable || xgetvar->subset) {/* && rank0 > 0 */
 	/* There are multiple cases, assuming no conversion required.
            1) client is asking for whole variable
               => start=0, count=totalsize, stride=1
@@ -1195,189 +1486,90 @@ freegetvara(Getvara* vara)
     nullfree(vara);
 }
 
-#ifdef EXTERN_UNUSED
-int
+/*
+Mapped reads. The default varm code issues one get_vara per row of
+the map, or per element when the map or the stride is not unity in
+the fastest dimension, and for DAP2 each of those may be a separate
+server request. Instead, fetch the whole strided slab with a single
+nc3d_getvarx call, so that the stride goes to the server in one
+constraint, and then scatter the values through the map locally.
+*/
+NCerror
 nc3d_getvarmx(int ncid, int varid,
-	    const size_t *start,
-	    const size_t *edges,
-	    const ptrdiff_t* stride,
- 	    const ptrdiff_t* map,
+	    const size_t *startp,
+	    const size_t *countp,
+	    const ptrdiff_t* stridep,
+ 	    const ptrdiff_t* imapp,
 	    void* data,
 	    nc_type dsttype0)
 {
     NCerror ncstat = NC_NOERR;
-    int i;
-    NC* drno;
-    NC* substrate;
-    NC3_INFO* substrate3;
-    NCDAPCOMMON* dapcomm;
-    NC_var* var;
-    CDFnode* cdfvar; /* cdf node mapping to var*/
-    NClist* varnodes;
-    nc_type dsttype;
-    size_t externsize;
-    size_t dimsizes[NC_MAX_VAR_DIMS];
+    int i,ncrank;
+    nc_type dsttype = dsttype0;
+    size_t externsize, nelems, offset;
+    size_t counts[NC_MAX_VAR_DIMS];
+    char* localcopy = NULL;
+    char* localpos;
     Dapodometer* odom = NULL;
-    unsigned int ncrank;
-    NClist* ncdims = NULL;
-    size_t nelems;
-#ifdef NEWVARM
-    char* localcopy; /* of whole variable */
-#endif
-
-    ncstat = NC_check_id(ncid, (NC**)&drno);
-    if(ncstat != NC_NOERR) goto done;
-    dapcomm = (NCDAPCOMMON*)drno->dispatchdata;
 
-    ncstat = NC_check_id(drno->substrate, &substrate);
+    ncstat = nc_inq_varndims(ncid,varid,&ncrank);
     if(ncstat != NC_NOERR) goto done;
-    substrate3 = (NC3_INFO*)drno->dispatchdata;
 
-    var = NC_lookupvar(substrate3,varid);
-    if(var == NULL) {ncstat = NC_ENOTVAR; goto done;}
-
-    /* Locate var node via varid */
-    varnodes = dapcomm->cdf.ddsroot->tree->varnodes;
-    for(i=0;i<nclistlength(varnodes);i++) {
-	CDFnode* node = (CDFnode*)nclistget(varnodes,i);
-	if(node->array.basevar == NULL
-           && node->nctype == NC_Atomic
-           && node->ncid == varid) {
-	    cdfvar = node;
-	    break;
+    /* Keep the stride error of the default varm code */
+    if(stridep != NULL) {
+	for(i=0;i<ncrank;i++) {
+	    if(stridep[i] == 0 || (unsigned long)stridep[i] >= X_INT_MAX)
+		{ncstat = NC_ESTRIDE; goto done;}
 	}
     }
 
-    ASSERT((cdfvar != NULL));
-    ASSERT((strcmp(cdfvar->ncfullname,var->name->cp)==0));
-
-    if(nclistlength(cdfvar->array.dimsetplus) == 0) {
-       /* The variable is a scalar; consequently, there is only one
-          thing to get and only one place to put it. */
-	/* recurse with additional parameters */
-        return THROW(nc3d_getvarx(ncid,varid,
-		 NULL,NULL,NULL,
-		 data,dsttype0));
-    }
-
-    dsttype = (dsttype0);
+    if(imapp == NULL)
+	return THROW(nc3d_getvarx(ncid,varid,startp,countp,stridep,data,dsttype0));
+    if(ncrank == 0) /* only one thing to get and one place to put it */
+	return THROW(nc3d_getvarx(ncid,varid,NULL,NULL,NULL,data,dsttype0));
 
     /* Default to using the inquiry type for this var*/
-    if(dsttype == NC_NAT) dsttype = cdfvar->externaltype;
-
-    /* Validate any implied type conversion*/
-    if(cdfvar->etype != dsttype && dsttype == NC_CHAR) {
-	/* The only disallowed conversion is to/from char and non-byte
-           numeric types*/
-	switch (cdfvar->etype) {
-	case NC_STRING: case NC_URL:
-	case NC_CHAR: case NC_BYTE: case NC_UBYTE:
- 	    break;
-	default:
-	    return THROW(NC_ECHAR);
-	}
-    }
-
-    externsize = nctypesizeof(dsttype);
-
-    /* Accumulate the dimension sizes and the total # of elements */
-    ncdims = cdfvar->array.dimsetall;
-    ncrank = nclistlength(ncdims);
-
-    nelems = 1; /* also Compute the number of elements being retrieved */
-    for(i=0;i<ncrank;i++) {
-	CDFnode* dim = (CDFnode*)nclistget(ncdims,i);
-	dimsizes[i] = dim->dim.declsize;
-	nelems *= edges[i];
+    if(dsttype == NC_NAT) {
+	ncstat = nc_inq_vartype(ncid,varid,&dsttype);
+	if(ncstat != NC_NOERR) goto done;
     }
+    externsize = nctypelen(dsttype);
 
-    /* Originally, this code repeatedly extracted single values
-       using get_var1. In an attempt to improve performance,
-       I have converted to reading the whole variable at once
-       and walking it locally.
-    */
-
-#ifdef NEWVARM
-    localcopy = (char*)malloc(nelems*externsize);
-
-    /* We need to use the varieties of get_vars in order to
-       properly do conversion to the external type
-    */
-
-    switch (dsttype) {
-
-    case NC_CHAR:
-	ncstat = nc_get_vars_text(ncid,varid,start, edges, stride,
-				  (char*)localcopy);
-	break;
-    case NC_BYTE:
-	ncstat = nc_get_vars_schar(ncid,varid,start, edges, stride,
-				   (signed char*)localcopy);
-	break;
-    case NC_SHORT:
-	ncstat = nc_get_vars_short(ncid,varid, start, edges, stride,
-			  	   (short*)localcopy);
-	break;
-    case NC_INT:
-	ncstat = nc_get_vars_int(ncid,varid,start, edges, stride,
-				 (int*)localcopy);
-	break;
-    case NC_FLOAT:
-	ncstat = nc_get_vars_float(ncid,varid,start, edges, stride,
-				   (float*)localcopy);
-	break;
-    case NC_DOUBLE:
-	ncstat = nc_get_vars_double(ncid,varid,	start, edges, stride,
-		 		    (double*)localcopy);
-	break;
-    default: break;
-    }
-
-
-    odom = dapodom_new(ncrank,start,edges,stride,NULL);
-
-    /* Walk the local copy */
-    for(i=0;i<nelems;i++) {
-	size_t voffset = dapodom_varmcount(odom,map,dimsizes);
-	void* dataoffset = (void*)(((char*)data) + (externsize*voffset));
-	char* localpos = (localcopy + externsize*i);
-	/* extract the indexset'th value from local copy */
-	memcpy(dataoffset,(void*)localpos,externsize);
-/*
-fprintf(stderr,"new: %lu -> %lu  %f\n",
-	(unsigned long)(i),
-        (unsigned long)voffset,
-	*(float*)localpos);
-*/
-	dapodom_next(odom);
-    }
-#else
-    odom = dapodom_new(ncrank,start,edges,stride,NULL);
-    while(dapodom_more(odom)) {
-	size_t* indexset = odom->index;
-	size_t voffset = dapodom_varmcount(odom,map,dimsizes);
-	char internalmem[128];
-	char externalmem[128];
-	void* dataoffset = (void*)(((char*)data) + (externsize*voffset));
-
-	/* get the indexset'th value using variable's internal type */
-	ncstat = nc_get_var1(ncid,varid,indexset,(void*)&internalmem);
-        if(ncstat != NC_NOERR) goto done;
-	/* Convert to external type */
-	ncstat = dapconvert(cdfvar->etype,dsttype,externalmem,internalmem);
-        if(ncstat != NC_NOERR) goto done;
-	memcpy(dataoffset,(void*)externalmem,externsize);
-/*
-fprintf(stderr,"old: %lu -> %lu  %f\n",
-	(unsigned long)dapodom_count(odom),
-        (unsigned long)voffset,
-	*(float*)externalmem);
-*/
+    if(countp == NULL) {
+	/* The rest of each dimension */
+	ncstat = NC_getshape(ncid,varid,ncrank,counts);
+	if(ncstat != NC_NOERR) goto done;
+	for(i=0;i<ncrank;i++) {
+	    size_t start = (startp == NULL ? 0 : startp[i]);
+	    counts[i] = (start < counts[i] ? counts[i] - start : 0);
+	}
+    } else
+	memcpy(counts,countp,sizeof(size_t)*ncrank);
+    nelems = 1;
+    for(i=0;i<ncrank;i++)
+	nelems *= counts[i];
+
+    /* Let nc3d_getvarx validate the slab, even if it is empty */
+    localcopy = (char*)malloc(nelems == 0 ? 1 : nelems*externsize);
+    if(localcopy == NULL) {ncstat = NC_ENOMEM; goto done;}
+    ncstat = nc3d_getvarx(ncid,varid,startp,counts,stridep,localcopy,dsttype);
+    /* A range error still delivers (converted) values */
+    if(ncstat != NC_NOERR && ncstat != NC_ERANGE) goto done;
+    if(nelems == 0) goto done;
+
+    /* Walk the local copy in order, storing each value where the
+       map says; the odometer runs over [0,count) so that
+       dapodom_varmcount gives the map offset directly */
+    odom = dapodom_new(ncrank,NULL,counts,NULL,NULL);
+    if(odom == NULL) {ncstat = NC_ENOMEM; goto done;}
+    for(localpos=localcopy;dapodom_more(odom);localpos+=externsize) {
+	offset = dapodom_varmcount(odom,imapp,NULL);
+	memcpy(((char*)data) + (externsize*offset),localpos,externsize);
 	dapodom_next(odom);
     }
-#endif
 
 done:
-    return ncstat;
+    dapodom_free(odom);
+    nullfree(localcopy);
+    return THROW(ncstat);
 }
-#endif /*EXTERN_UNUSED*/
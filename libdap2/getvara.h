@@ -17,8 +17,9 @@ and the per-retrieval maximum size
 
 /* The cache limit is in terms of bytes */
 #define DFALTCACHELIMIT (100*MEGBYTE)
-/* The fetch limit is in terms of bytes */
-#define DFALTFETCHLIMIT (100*KILOBYTE)
+/* The fetch limit is in terms of bytes; larger partial variable
+   reads are streamed into memory instead of going through the cache */
+#define DFALTFETCHLIMIT (10*MEGBYTE)
 
 /* WARNING: The small limit is in terms of the # of vector elements */
 #define DFALTSMALLLIMIT (4096)
@@ -26,6 +27,9 @@ and the per-retrieval maximum size
 /* Max number of cache nodes */
 #define DFALTCACHECOUNT (100)
 
+/* Number of past get_vara requests kept to spot access patterns */
+#define DFALTHISTORY (32)
+
 typedef struct Getvara {
     void* memory; /* where result is put*/
     struct NCcachenode* cache;
@@ -34,6 +38,7 @@ typedef struct Getvara {
     nc_type dsttype;
     CDFnode* target;
     int wholevariable;
+    int subset; /* varaprojection indexes into a larger cached slab */
 } Getvara;
 
 #endif /*GETVARA_H*/
@@ -77,16 +77,38 @@ typedef struct NCcachenode {
     struct CDFnode* datadds;
     OCddsnode ocroot;
     OCdatanode content;
+    time_t fetchtime; /* when the data were fetched */
 } NCcachenode;
 
 
+/* One past get_vara request; see dapaccessrecord */
+typedef struct NCaccess {
+    struct CDFnode* var;
+    size_t rank;
+    size_t* slab; /* start, count and stride; 3*rank values */
+} NCaccess;
+
 /* All cache info */
 typedef struct NCcache {
     size_t cachelimit; /* max total size for all cached entries */
     size_t cachesize; /* current size */
     size_t cachecount; /* max # nodes in cache */
+    long cacheage; /* max age of a node in seconds; 0 => no limit */
     NCcachenode* prefetch;
     NClist* nodes; /* cache nodes other than prefetch */
+    NClist* history; /* recent NCaccess*, oldest first */
+    struct { /* constraint being read ahead by oc, if any */
+        DCEconstraint* constraint;
+        NClist* vars;
+    } readahead;
+    struct { /* logged when the cache is freed */
+        unsigned long hits; /* get_vara requests served from the cache */
+        unsigned long subsethits; /* ... from within a larger cached slab */
+        unsigned long misses; /* get_vara requests sent to the server */
+        unsigned long evictions; /* nodes purged for size or count */
+        unsigned long expirations; /* nodes purged for age */
+        off_t fetched; /* bytes of data received for cache nodes */
+    } stats;
 } NCcache;
 
 /**************************************************/
@@ -298,6 +320,18 @@ extern NCcachenode* createnccachenode(void);
 extern void freenccachenode(NCDAPCOMMON*, NCcachenode* node);
 extern NCcache* createnccache(void);
 extern void freenccache(NCDAPCOMMON*, NCcache* cache);
+extern int iscachedpart(NCDAPCOMMON*, DCEprojection* fetchprojection,
+			int allowsubset, NCcachenode** cachenodep,
+			DCEprojection** walkprojectionp);
+extern void dapaccessrecord(NCcache*, CDFnode* var, size_t rank,
+			    const size_t* start, const size_t* count,
+			    const ptrdiff_t* stride);
+extern NClist* dapaccesscompanions(NCcache*, CDFnode* var, size_t rank,
+			    const size_t* count, const ptrdiff_t* stride);
+extern int dapaccesspredict(NCcache*, CDFnode* var, size_t rank,
+			    const size_t* start, const size_t* count,
+			    const ptrdiff_t* stride, size_t* nextstart);
+extern void clearreadahead(NCcache*);
 
 /* Add an extra function whose sole purpose is to allow
    configure(.ac) to test for the presence of thiscode.
@@ -7,6 +7,7 @@
 #include "ncd2dispatch.h"
 #include "ncrc.h"
 #include "ncoffsets.h"
+#include "nchashmap.h"
 #ifdef DEBUG2
 #include "dapdump.h"
 #endif
@@ -46,6 +47,7 @@ static NCerror showprojection(NCDAPCOMMON*, CDFnode* var);
 static NCerror getseqdimsize(NCDAPCOMMON*, CDFnode* seq, size_t* sizep);
 static NCerror makeseqdim(NCDAPCOMMON*, CDFnode* seq, size_t count, CDFnode** sqdimp);
 static NCerror countsequence(NCDAPCOMMON*, CDFnode* xseq, size_t* sizep);
+static OCerror countrecords(void*, OCdatanode*, size_t, size_t);
 static NCerror freeNCDAPCOMMON(NCDAPCOMMON*);
 static NCerror fetchpatternmetadata(NCDAPCOMMON*);
 static size_t fieldindex(CDFnode* parent, CDFnode* child);
@@ -88,6 +90,10 @@ static int NCD2_get_vars(int ncid, int varid,
 	    const size_t *start, const size_t *edges, const ptrdiff_t* stride,
             void *value, nc_type memtype);
 
+static int NCD2_get_varm(int ncid, int varid,
+	    const size_t *start, const size_t *edges, const ptrdiff_t* stride,
+	    const ptrdiff_t* imap, void *value, nc_type memtype);
+
 static const NC_Dispatch NCD2_dispatch_base = {
 
 NC_FORMATX_DAP2,
@@ -128,7 +134,7 @@ NCD2_get_vara,
 NCD2_put_vara,
 NCD2_get_vars,
 NCD2_put_vars,
-NCDEFAULT_get_varm,
+NCD2_get_varm,
 NCDEFAULT_put_varm,
 
 NCD2_inq_var_all,
@@ -173,6 +179,15 @@ NCD2_def_var_endian,
 NCD2_def_var_filter,
 NCD2_set_var_chunk_cache,
 NCD2_get_var_chunk_cache,
+NC_NOTNC4_def_var_chunk_intent,
+NC_NOTNC4_inq_var_chunk_intent,
+NC_NOTNC4_read_chunk,
+NC_NOTNC4_write_chunk,
+NC_NOTNC4_inq_var_chunk_info,
+NC_NOTNC4_inq_var_filter_ids,
+NC_NOTNC4_inq_var_filter_info,
+NC_NOTNC4_def_var_quantize,
+NC_NOTNC4_inq_var_quantize,
 
 };
 
@@ -266,6 +281,15 @@ NCD2_get_vars(int ncid, int varid,
     return stat;
 }
 
+static int
+NCD2_get_varm(int ncid, int varid,
+	    const size_t *start, const size_t *edges, const ptrdiff_t* stride,
+	    const ptrdiff_t* imap, void *value, nc_type memtype)
+{
+    int stat = nc3d_getvarmx(ncid, varid, start, edges, stride, imap, value, memtype);
+    return stat;
+}
+
 /* See ncd2dispatch.c for other version */
 int
 NCD2_open(const char* path, int mode, int basepe, size_t *chunksizehintp,
@@ -1252,6 +1276,10 @@ applyclientparams(NCDAPCOMMON* nccomm)
     limit = getlimitnumber(value);
     if(limit > 0) nccomm->cdf.cache->cachelimit = limit;
 
+    value = paramlookup(nccomm,"cacheage");
+    limit = getlimitnumber(value);
+    if(limit > 0) nccomm->cdf.cache->cacheage = (long)limit;
+
     nccomm->cdf.fetchlimit = DFALTFETCHLIMIT;
     value = paramlookup(nccomm,"fetchlimit");
     limit = getlimitnumber(value);
@@ -1401,16 +1429,17 @@ equivalentdim(CDFnode* basedim, CDFnode* dupdim)
 }
 
 static void
-getalldimsa(NClist* dimset, NClist* alldims)
+getalldimsa(NClist* dimset, NClist* alldims, NC_hashmap* seen)
 {
     int i;
     for(i=0;i<nclistlength(dimset);i++) {
 	CDFnode* dim = (CDFnode*)nclistget(dimset,i);
-	if(!nclistcontains(alldims,(void*)dim)) {
+	if(!NC_hashmapget(seen,(const char*)&dim,sizeof(dim),NULL)) {
 #ifdef DEBUG3
 fprintf(stderr,"getalldims: %s[%lu]\n",
 			dim->ncfullname,(unsigned long)dim->dim.declsize);
 #endif
+	    NC_hashmapadd(seen,(uintptr_t)dim,(const char*)&dim,sizeof(dim));
 	    nclistpush(alldims,(void*)dim);
 	}
     }
@@ -1425,14 +1454,17 @@ getalldims(NCDAPCOMMON* nccomm, int visibleonly)
     int i;
     NClist* alldims = nclistnew();
     NClist* varnodes = nccomm->cdf.ddsroot->tree->varnodes;
+    /* dims already in alldims, by address */
+    NC_hashmap* seen = NC_hashmapnew(0);
 
     /* get bag of all dimensions */
     for(i=0;i<nclistlength(varnodes);i++) {
 	CDFnode* node = (CDFnode*)nclistget(varnodes,i);
 	if(!visibleonly || !node->invisible) {
-	    getalldimsa(node->array.dimsetall,alldims);
+	    getalldimsa(node->array.dimsetall,alldims,seen);
 	}
     }
+    NC_hashmapfree(seen);
     return alldims;
 }
 
@@ -1639,6 +1671,19 @@ getseqdimsize(NCDAPCOMMON* dapcomm, CDFnode* seq, size_t* sizep)
 fprintf(stderr,"seqcountconstraints: %s\n",ncbytescontents(seqcountconstraints));
 #endif
 
+    /* A top-level sequence can be counted as its records arrive,
+       without keeping them all */
+    if(seq->container != NULL && seq->container->nctype == NC_Dataset) {
+	const char* ce = ncbytescontents(seqcountconstraints);
+	if(FLAGSET(dapcomm->controls,NCF_UNCONSTRAINABLE) || strlen(ce) == 0)
+	    ce = NULL;
+	if(FLAGSET(dapcomm->controls,NCF_SHOWFETCH))
+	    LOG1(NCLOGNOTE,"stream: %s",(ce == NULL ? "" : ce));
+	ocstat = oc_stream_records(conn,ce,seq->ocname,0,countrecords,&seqsize);
+	if(ocstat == OC_NOERR && sizep) *sizep = seqsize;
+	goto fail;
+    }
+
     /* Fetch the minimal data */
     if(FLAGSET(dapcomm->controls,NCF_UNCONSTRAINABLE))
         ncstat = dap_fetch(dapcomm,conn,NULL,OCDATADDS,&ocroot);
@@ -1711,6 +1756,14 @@ makeseqdim(NCDAPCOMMON* dapcomm, CDFnode* seq, size_t count, CDFnode** sqdimp)
     return NC_NOERR;
 }
 
+/* The records go by; only their number matters */
+static OCerror
+countrecords(void* userdata, OCdatanode* records, size_t start, size_t count)
+{
+    *(size_t*)userdata = start + count;
+    return OC_NOERR;
+}
+
 static NCerror
 countsequence(NCDAPCOMMON* dapcomm, CDFnode* xseq, size_t* sizep)
 {
@@ -2208,6 +2261,8 @@ applyclientparamcontrols(NCDAPCOMMON* dapcomm)
     CLRFLAG(dapcomm->controls,NCF_NCDAP);
     CLRFLAG(dapcomm->controls,NCF_PREFETCH);
     CLRFLAG(dapcomm->controls,NCF_PREFETCH_EAGER);
+    CLRFLAG(dapcomm->controls,NCF_AGGREGATE);
+    CLRFLAG(dapcomm->controls,NCF_READAHEAD);
 
     /* Turn on any default on flags */
     SETFLAG(dapcomm->controls,DFALT_ON_FLAGS);
@@ -2230,6 +2285,18 @@ applyclientparamcontrols(NCDAPCOMMON* dapcomm)
     } else if(dapparamcheck(dapcomm,"noprefetch",NULL))
         CLRFLAG(dapcomm->controls,NCF_PREFETCH);
 
+    /* enable/disable fetching co-read variables together */
+    if(dapparamcheck(dapcomm,"aggregate",NULL))
+        SETFLAG(dapcomm->controls,NCF_AGGREGATE);
+    else if(dapparamcheck(dapcomm,"noaggregate",NULL))
+        CLRFLAG(dapcomm->controls,NCF_AGGREGATE);
+
+    /* enable/disable reading the predicted next slab ahead */
+    if(dapparamcheck(dapcomm,"readahead",NULL))
+        SETFLAG(dapcomm->controls,NCF_READAHEAD);
+    else if(dapparamcheck(dapcomm,"noreadahead",NULL))
+        CLRFLAG(dapcomm->controls,NCF_READAHEAD);
+
     if(FLAGSET(dapcomm->controls,NCF_UNCONSTRAINABLE))
 	SETFLAG(dapcomm->controls,NCF_CACHE);
 
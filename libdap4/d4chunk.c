@@ -16,6 +16,12 @@
 
 #define ALL_CHUNK_FLAGS (LAST_CHUNK|ERR_CHUNK|LITTLE_ENDIAN_CHUNK|NOCHECKSUM_CHUNK)
 
+/* Stream states */
+#define STREAM_HDR  0 /* reading a chunk header */
+#define STREAM_BODY 1 /* reading the body of a chunk */
+#define STREAM_RAW  2 /* the response is not chunked; keep it as is */
+#define STREAM_END  3 /* the last chunk has been read */
+
 /**************************************************/
 
 /*
@@ -33,6 +39,9 @@ struct HDR {unsigned int flags;	unsigned int count;};
 /* Forward */
 static void* getheader(void* p, struct HDR* hdr, int hostlittleendian);
 static int processerrchunk(NCD4meta* metadata, void* errchunk, unsigned int count);
+static int streamchunkdone(NCD4stream*);
+static int streamdmr(NCD4stream*);
+static int streamvars(NCD4stream*);
 
 /**************************************************/
 
@@ -126,6 +135,220 @@ NCD4_dechunk(NCD4meta* metadata)
     return THROW(NC_NOERR);    
 }
 
+/**************************************************/
+/* Streaming */
+
+/*
+Dechunk a DAP response as curl delivers it, instead of all at once
+after it has been read: the chunk headers are dropped as they go by,
+so only the data is kept, in dap. Once the dmr chunk is complete it
+is parsed, and from then on the data of each top-level variable of
+fixed size is verified and swapped as soon as all of its bytes, and
+its checksum, are in (see NCD4_processarrived), overlapping that work
+with the transfer. The dmr also gives the total size of the data when
+all the variables are of fixed size, so dap can be allocated once.
+Whatever is left is processed by NCD4_processdata as usual.
+*/
+
+void
+NCD4_streaminit(NCD4stream* stream, NCD4meta* meta, NCbytes* dap)
+{
+    memset((void*)stream,0,sizeof(NCD4stream));
+    stream->meta = meta;
+    stream->dap = dap;
+    stream->dmr = ncbytesnew();
+    stream->state = STREAM_HDR;
+    meta->serial.hostlittleendian = NCD4_isLittleEndian();
+}
+
+void
+NCD4_streamclear(NCD4stream* stream)
+{
+    ncbytesfree(stream->dmr);
+    ncbytesfree(stream->errdata);
+    nclistfree(stream->toplevel);
+    stream->dmr = NULL;
+    stream->errdata = NULL;
+    stream->toplevel = NULL;
+}
+
+/* Consume the next len bytes of the response */
+int
+NCD4_streamchunks(NCD4stream* stream, const void* bytes, size_t len)
+{
+    const unsigned char* p = (const unsigned char*)bytes;
+    size_t n;
+
+    while(len > 0 && stream->stat == NC_NOERR) {
+	switch (stream->state) {
+	case STREAM_HDR:
+	    if(stream->nchunks == 0 && stream->nhdr == 0 && p[0] >= ' ') {
+		/* Not a chunk; probably an html error page */
+		stream->state = STREAM_RAW;
+		continue;
+	    }
+	    n = 4 - stream->nhdr;
+	    if(n > len) n = len;
+	    memcpy(stream->hdr+stream->nhdr,p,n);
+	    stream->nhdr += n;
+	    if(stream->nhdr == 4) {
+		struct HDR hdr;
+		getheader(stream->hdr,&hdr,stream->meta->serial.hostlittleendian);
+		stream->nhdr = 0;
+		stream->flags = hdr.flags;
+		stream->remaining = hdr.count;
+		stream->state = STREAM_BODY;
+		if(hdr.flags & ERR_CHUNK)
+		    stream->errdata = ncbytesnew();
+		else if(stream->nchunks == 0 && hdr.count == 0)
+		    {stream->stat = THROW(NC_EDMR); break;}
+		if(stream->remaining == 0)
+		    stream->stat = streamchunkdone(stream);
+	    }
+	    break;
+	case STREAM_BODY:
+	    n = stream->remaining;
+	    if(n > len) n = len;
+	    if(stream->flags & ERR_CHUNK)
+		ncbytesappendn(stream->errdata,p,n);
+	    else if(stream->nchunks == 0)
+		ncbytesappendn(stream->dmr,p,n);
+	    else
+		ncbytesappendn(stream->dap,p,n);
+	    stream->remaining -= n;
+	    if(stream->remaining == 0)
+		stream->stat = streamchunkdone(stream);
+	    else if(stream->nchunks > 0 && !(stream->flags & ERR_CHUNK))
+		stream->stat = streamvars(stream);
+	    break;
+	case STREAM_RAW:
+	    n = len;
+	    ncbytesappendn(stream->dap,p,n);
+	    break;
+	default: /* STREAM_END: ignore anything after the last chunk */
+	    n = len;
+	    break;
+	}
+	p += n;
+	len -= n;
+    }
+    return stream->stat;
+}
+
+/* The response is complete; leave the results in stream->meta */
+int
+NCD4_streamend(NCD4stream* stream)
+{
+    NCD4meta* meta = stream->meta;
+
+    if(stream->stat != NC_NOERR)
+	return stream->stat;
+    if(stream->state == STREAM_RAW
+       || (stream->state == STREAM_HDR && stream->nchunks == 0 && stream->nhdr == 0))
+	return THROW(NC_NOERR); /* the caller decides what this is */
+    if(stream->state != STREAM_END) {
+	nclog(NCLOGERR,"Truncated DAP4 response");
+	return THROW(NC_EDAP);
+    }
+    meta->serial.dap = ncbytescontents(stream->dap);
+    meta->serial.dapsize = ncbyteslength(stream->dap);
+    meta->serial.dechunked = 1;
+    meta->serial.streamed = stream->nextvar;
+    if(FLAGSET(meta->controller->controls.flags,NCF_SHOWFETCH))
+	nclog(NCLOGDBG,"streamed: %d of %d top-level variables processed as they arrived",
+	      stream->nextvar,nclistlength(stream->toplevel));
+#ifdef D4DUMPDAP
+    NCD4_tagdump(meta->serial.dapsize,meta->serial.dap,0,"DAP");
+#endif
+    return THROW(NC_NOERR);
+}
+
+static int
+streamchunkdone(NCD4stream* stream)
+{
+    int ret = NC_NOERR;
+    NCD4meta* meta = stream->meta;
+    int first = (stream->nchunks == 0);
+
+    stream->nchunks++;
+    stream->state = STREAM_HDR;
+    if(stream->flags & ERR_CHUNK) {
+	ncbytesnull(stream->errdata);
+	meta->serial.errdata = ncbytesextract(stream->errdata);
+	nclog(NCLOGERR,"DAP4 error response: %s",meta->serial.errdata);
+	return THROW(NC_ENODATA); /* slight lie, as in NCD4_dechunk */
+    }
+    if(first) {
+	meta->mode = NCD4_DAP;
+	meta->serial.remotechecksumming = ((stream->flags & NOCHECKSUM_CHUNK) ? 0 : 1);
+	meta->localchecksumming = meta->serial.remotechecksumming;
+	meta->serial.remotelittleendian = ((stream->flags & LITTLE_ENDIAN_CHUNK) ? 1 : 0);
+	if((ret = streamdmr(stream))) return ret;
+	if(stream->flags & LAST_CHUNK)
+	    return THROW(NC_ENODATA);
+    } else
+	ret = streamvars(stream);
+    if(stream->flags & LAST_CHUNK)
+	stream->state = STREAM_END;
+    return THROW(ret);
+}
+
+/* The dmr chunk is complete: parse it and size the data */
+static int
+streamdmr(NCD4stream* stream)
+{
+    int ret = NC_NOERR;
+    NCD4meta* meta = stream->meta;
+    char* dmr = ncbytescontents(stream->dmr);
+    size_t len = ncbyteslength(stream->dmr);
+    d4size_t total = 0;
+    int i;
+
+    dmr[len-1] = '\0'; /* as in NCD4_dechunk */
+    if((meta->serial.dmr = strdup(dmr)) == NULL)
+	return THROW(NC_ENOMEM);
+#ifdef D4DUMPDMR
+    fprintf(stderr,"%s\n",meta->serial.dmr);
+    fflush(stderr);
+#endif
+    if((ret = NCD4_parse(meta))) return THROW(ret);
+    stream->toplevel = nclistnew();
+    NCD4_getToplevelVars(meta,meta->root,stream->toplevel);
+    for(i=0;i<nclistlength(stream->toplevel);i++) {
+	d4size_t size = NCD4_fixedvarsize((NCD4node*)nclistget(stream->toplevel,i));
+	if(size == 0) {total = 0; break;}
+	total += size + (meta->serial.remotechecksumming ? CHECKSUMSIZE : 0);
+    }
+    /* Room for all of the data, and the null that is always added */
+    if(total > 0 && !ncbytessetalloc(stream->dap,(unsigned long)(total+1)))
+	return THROW(NC_ENOMEM);
+    return THROW(ret);
+}
+
+/* Process the top-level vars whose data are now complete, stopping at
+   the first one that is not of fixed size */
+static int
+streamvars(NCD4stream* stream)
+{
+    int ret = NC_NOERR;
+    NCD4meta* meta = stream->meta;
+    d4size_t avail = ncbyteslength(stream->dap);
+    d4size_t checksum = (meta->serial.remotechecksumming ? CHECKSUMSIZE : 0);
+
+    while(stream->nextvar < nclistlength(stream->toplevel)) {
+	NCD4node* var = (NCD4node*)nclistget(stream->toplevel,stream->nextvar);
+	d4size_t size = NCD4_fixedvarsize(var);
+	if(size == 0 || avail - stream->nextoffset < size + checksum)
+	    break;
+	if((ret = NCD4_processarrived(meta,var,
+			ncbytescontents(stream->dap)+stream->nextoffset)))
+	    break;
+	stream->nextoffset += size + checksum;
+	stream->nextvar++;
+    }
+    return THROW(ret);
+}
+
 static int
 processerrchunk(NCD4meta* metadata, void* errchunk, unsigned int count)
 {
@@ -7,5 +7,35 @@
 #define D4CHUNK_H 1
 /**************************************************/
 
+/*
+State of a DAP response that is dechunked as it arrives from the
+server (see NCD4_fetchurl_stream), rather than after all of it has
+been read. The dmr is parsed as soon as its chunk is complete, and
+the data of each top-level variable of fixed size is verified and
+swapped as soon as all its bytes are in.
+*/
+struct NCD4stream {
+    NCD4meta* meta;
+    NCbytes* dap;	/* the data so far, without the chunk headers;
+			   all of the response if it is not chunked */
+    NCbytes* dmr;	/* the dmr chunk so far */
+    NCbytes* errdata;	/* an error chunk so far */
+    int state;
+    int nchunks;	/* number of chunks completed */
+    unsigned char hdr[4]; /* the chunk header so far */
+    size_t nhdr;
+    unsigned int flags;	/* of the current chunk */
+    size_t remaining;	/* bytes still to come in the current chunk */
+    NClist* toplevel;	/* the top-level vars, once the dmr is parsed */
+    int nextvar;	/* the first of them not yet processed */
+    d4size_t nextoffset; /* and the offset of its data in dap */
+    int stat;		/* the first error, if any */
+    d4size_t received;	/* bytes handed to NCD4_streamchunks */
+};
+
+extern void NCD4_streaminit(NCD4stream*, NCD4meta*, NCbytes* dap);
+extern int NCD4_streamchunks(NCD4stream*, const void* bytes, size_t len);
+extern int NCD4_streamend(NCD4stream*);
+extern void NCD4_streamclear(NCD4stream*);
 
 #endif /*D4CHUNK_H*/
@@ -104,11 +104,12 @@ set_curlflag(NCD4INFO* state, int flag)
 	CHECK(state, CURLOPT_ERRORBUFFER, state->curl->errdata.errorbuf);
 	break;
     case CURLOPT_ENCODING:
-#ifdef CURLOPT_ENCODING
+	/* "" offers every encoding this libcurl can decode (gzip,
+	   deflate and, if built in, br and zstd); curl inflates the
+	   response as it arrives, before the write callbacks see it */
 	if(state->auth.curlflags.compress) {
-	    CHECK(state, CURLOPT_ENCODING,"deflate, gzip");
+	    CHECK(state, CURLOPT_ENCODING,"");
         }
-#endif
 	break;
     case CURLOPT_PROXY:
 	if(state->auth.proxy.host != NULL) {
@@ -9,6 +9,7 @@
 #include "ezxml.h"
 #include "d4includes.h"
 #include "d4odom.h"
+#include "ncswap.h"
 
 /**
 This code serves two purposes
@@ -27,6 +28,9 @@ static int fillopfixed(NCD4meta*, d4size_t opaquesize, void** offsetp, void** ds
 static int fillopvar(NCD4meta*, NCD4node* type, void** offsetp, void** dstp, NClist* blobs);
 static int fillstruct(NCD4meta*, NCD4node* type, void** offsetp, void** dstp, NClist* blobs);
 static int fillseq(NCD4meta*, NCD4node* type, void** offsetp, void** dstp, NClist* blobs);
+static int processvars(NCD4meta*, NClist* toplevel, int ndone);
+static int checkswap(NCD4meta*, NCD4node* var, d4size_t count, void* data, unsigned int* csump);
+static void setserial(NCD4meta*, NCD4serial* serial);
 
 /***************************************************/
 /* Macro define procedures */
@@ -54,15 +58,159 @@ int
 NCD4_processdata(NCD4meta* meta)
 {
     int ret = NC_NOERR;
-    int i;
     NClist* toplevel = NULL;
     NCD4node* root = meta->root;
-    void* offset;
 
     /* Recursively walk the tree in prefix order 
        to get the top-level variables; also mark as unvisited */
     toplevel = nclistnew();
     NCD4_getToplevelVars(meta,root,toplevel);
+    ret = processvars(meta,toplevel,meta->serial.streamed);
+    nclistfree(toplevel);
+    return THROW(ret);
+}
+
+/*
+Process the data of a single top-level variable that was fetched by
+itself (lazy mode); serial describes the dechunked response, whose
+data must be exactly the data of var.
+*/
+int
+NCD4_processvardata(NCD4meta* meta, NCD4node* var, NCD4serial* serial)
+{
+    int ret = NC_NOERR;
+    NClist* toplevel = nclistnew();
+
+    setserial(meta,serial);
+    nclistpush(toplevel,var);
+    ret = processvars(meta,toplevel,0);
+    nclistfree(toplevel);
+    return THROW(ret);
+}
+
+/*
+Process a response holding count instances of a slab of the
+fixed size top-level variable var: verify the checksum and swap the
+values in place. Return a pointer to the first value.
+*/
+int
+NCD4_processslab(NCD4meta* meta, NCD4node* var, d4size_t count, NCD4serial* serial, void** datap)
+{
+    int ret = NC_NOERR;
+    NCD4node* basetype = var->basetype;
+    d4size_t size;
+
+    if(basetype->subsort == NC_ENUM)
+	basetype = basetype->basetype;
+    size = count * NCD4_typesize(basetype->subsort);
+    setserial(meta,serial);
+    meta->swap = (meta->serial.hostlittleendian != meta->serial.remotelittleendian);
+    if(serial->dapsize < size + (serial->remotechecksumming ? CHECKSUMSIZE : 0))
+	FAIL(NC_EDAP,"short slab response: %s",var->name);
+    if((ret = checkswap(meta,var,count,serial->dap,NULL))) goto done;
+    if(datap) *datap = serial->dap;
+done:
+    return THROW(ret);
+}
+
+/*
+Return the size of the data of a top-level variable of fixed size
+atomic (or enum) type, not counting its checksum; return 0 for any
+other variable, whose size can only be found by walking its data.
+*/
+d4size_t
+NCD4_fixedvarsize(NCD4node* var)
+{
+    NCD4node* basetype = var->basetype;
+
+    if(var->sort != NCD4_VAR || basetype == NULL)
+	return 0;
+    if(basetype->subsort == NC_ENUM)
+	basetype = basetype->basetype;
+    if(basetype->subsort <= NC_NAT || basetype->subsort > NC_UINT64)
+	return 0;
+    return NCD4_dimproduct(var) * NCD4_typesize(basetype->subsort);
+}
+
+/*
+The data of the top-level variable var, whose size is given by
+NCD4_fixedvarsize, have all arrived at data while the rest of the
+response is still being read (see d4chunk.c): verify the checksum and
+swap the values in place while they are still in the cache.
+NCD4_processdata then skips the variable.
+*/
+int
+NCD4_processarrived(NCD4meta* meta, NCD4node* var, void* data)
+{
+    int ret = NC_NOERR;
+    d4size_t count = NCD4_dimproduct(var);
+
+    meta->swap = (meta->serial.hostlittleendian != meta->serial.remotelittleendian);
+    ret = checkswap(meta,var,count,data,&var->data.localchecksum);
+    return THROW(ret);
+}
+
+/*
+Verify the checksum, if any, that follows the count atomic values of
+var at data, then swap the values in place if need be.
+*/
+static int
+checkswap(NCD4meta* meta, NCD4node* var, d4size_t count, void* data, unsigned int* csump)
+{
+    int ret = NC_NOERR;
+    NCD4node* basetype = var->basetype;
+    size_t typesize;
+    d4size_t size;
+
+    if(basetype->subsort == NC_ENUM)
+	basetype = basetype->basetype;
+    typesize = NCD4_typesize(basetype->subsort);
+    size = count * typesize;
+    if(meta->localchecksumming) {
+	union ATOMICS csum;
+	unsigned int local = CRC32(0,data,size);
+	memcpy(csum.u8,INCR(data,size),CHECKSUMSIZE);
+	if(meta->swap) swapinline32(csum.u32);
+	if(csump) *csump = local;
+	if(!meta->ignorechecksums && local != csum.u32[0]) {
+	    nclog(NCLOGERR,"Checksum mismatch: %s\n",var->name);
+	    ret = NC_EDAP;
+	    goto done;
+	}
+    }
+    if(meta->swap) {
+	switch (typesize) {
+	case 2: NC_swapn2(data,data,count); break;
+	case 4: NC_swapn4(data,data,count); break;
+	case 8: NC_swapn8(data,data,count); break;
+	default: break;
+	}
+    }
+done:
+    return THROW(ret);
+}
+
+/* Adopt the encoding of a separately fetched response */
+static void
+setserial(NCD4meta* meta, NCD4serial* serial)
+{
+    meta->serial.dap = serial->dap;
+    meta->serial.dapsize = serial->dapsize;
+    meta->serial.hostlittleendian = serial->hostlittleendian;
+    meta->serial.remotelittleendian = serial->remotelittleendian;
+    meta->serial.remotechecksumming = serial->remotechecksumming;
+    meta->localchecksumming = serial->remotechecksumming;
+}
+
+/* Process the data of the top-level vars, except for the first
+   ndone of them, which were processed as they arrived */
+static int
+processvars(NCD4meta* meta, NClist* toplevel, int ndone)
+{
+    int ret = NC_NOERR;
+    int i;
+    void* offset;
+    NClist* rest = NULL;
 
     /* If necessary, byte swap the serialized data */
     /* Do we need to swap the dap4 data? */
@@ -79,7 +227,7 @@ NCD4_processdata(NCD4meta* meta)
     /* Compute the checksums of the top variables */
     /* must occur before any byte swapping */
     if(meta->localchecksumming) {
-	for(i=0;i<nclistlength(toplevel);i++) {
+	for(i=ndone;i<nclistlength(toplevel);i++) {
 	    unsigned int csum = 0;
 	    NCD4node* var = (NCD4node*)nclistget(toplevel,i);
             csum = CRC32(csum,var->data.dap4data.memory,var->data.dap4data.size);
@@ -102,12 +250,15 @@ NCD4_processdata(NCD4meta* meta)
     /* Swap the data for each top level variable,
     */
     if(meta->swap) {
-        if((ret=NCD4_swapdata(meta,toplevel)))
+	rest = nclistnew();
+	for(i=ndone;i<nclistlength(toplevel);i++)
+	    nclistpush(rest,nclistget(toplevel,i));
+        if((ret=NCD4_swapdata(meta,rest)))
 	    FAIL(ret,"byte swapping failed");
     }
 
 done:
-    if(toplevel) nclistfree(toplevel);
+    nclistfree(rest);
     return THROW(ret);
 }
 
@@ -45,6 +45,7 @@ NCD4_open(const char * path, int mode,
     const char* value;
     NCD4meta* meta;
     NC* nc;
+    int dmronly = 0; /* only the dmr is read at open */
 
     if(path == NULL)
 	return THROW(NC_EDAPURL);
@@ -162,14 +163,36 @@ NCD4_open(const char * path, int mode,
     d4info->curl->packet = ncbytesnew();
     ncbytessetalloc(d4info->curl->packet,DFALTPACKETSIZE); /*initial reasonable size*/
 
-    /* fetch the dmr + data*/
-    {
+    /* Build the meta data; the packet is attached once it is read,
+       but a DAP response may be processed as it arrives */
+    if((d4info->substrate.metadata=NCD4_newmeta(0,NULL))==NULL)
+	{ret = NC_ENOMEM; goto done;}
+    meta = d4info->substrate.metadata;
+    meta->controller = d4info;
+    meta->ncid = getnc4id(nc); /* Transfer netcdf ncid */
+
+    /* process meta control parameters */
+    applyclientmetacontrols(meta);
+
+    /* A file holds the dmr only as part of the whole response */
+    dmronly = (d4info->controls.lazy
+	       && !FLAGSET(d4info->controls.flags,NCF_UNCONSTRAINABLE));
+    if(dmronly) {
+	/* fetch just the dmr; variables are fetched when first read */
+        if((ret = NCD4_readDMR(d4info))) goto done;
+	if(ncbyteslength(d4info->curl->packet) == 0) {
+	    nclog(NCLOGERR,"Empty DAP4 response");
+	    ret = NC_EDAPSVC;
+	    goto done;
+	}
+    } else {
+	/* fetch the dmr + data*/
 	int inmem = FLAGSET(d4info->controls.flags,NCF_ONDISK) ? 0 : 1;
         if((ret = NCD4_readDAP(d4info,inmem))) goto done;
     }
 
     /* if the url goes astray to a random web page, then try to just dump it */
-    {
+    if(!dmronly && !meta->serial.dechunked) {
 	char* response = ncbytescontents(d4info->curl->packet);
 	size_t responselen = ncbyteslength(d4info->curl->packet);
 
@@ -194,21 +217,15 @@ NCD4_open(const char * path, int mode,
 	}
     }
 
-    /* Build the meta data */
-    if((d4info->substrate.metadata=NCD4_newmeta(ncbyteslength(d4info->curl->packet),
-        ncbytescontents(d4info->curl->packet)))==NULL)
-	{ret = NC_ENOMEM; goto done;}
-    meta = d4info->substrate.metadata;
-    meta->controller = d4info;
-    meta->ncid = getnc4id(nc); /* Transfer netcdf ncid */
+    meta->serial.rawsize = ncbyteslength(d4info->curl->packet);
+    meta->serial.rawdata = ncbytescontents(d4info->curl->packet);
 
-    /* process meta control parameters */
-    applyclientmetacontrols(meta);
-
-    /* Infer the mode */
-    if((ret=NCD4_infermode(meta))) goto done;
+    /* A DAP response from a server was dechunked and parsed as it arrived */
+    if(!meta->serial.dechunked) {
+        /* Infer the mode */
+        if((ret=NCD4_infermode(meta))) goto done;
 
-    if((ret=NCD4_dechunk(meta))) goto done;
+        if((ret=NCD4_dechunk(meta))) goto done;
 
 #ifdef D4DUMPDMR
   {
@@ -219,7 +236,8 @@ NCD4_open(const char * path, int mode,
   }
 #endif
 
-    if((ret = NCD4_parse(d4info->substrate.metadata))) goto done;
+        if((ret = NCD4_parse(d4info->substrate.metadata))) goto done;
+    }
 #ifdef D4DEBUGMETA
   {
     fprintf(stderr,"\n/////////////\n");
@@ -234,7 +252,9 @@ NCD4_open(const char * path, int mode,
 #endif
     if((ret = NCD4_metabuild(d4info->substrate.metadata,d4info->substrate.metadata->ncid))) goto done;
     if(ret != NC_NOERR && ret != NC_EVARSIZE) goto done;
-    if((ret = NCD4_processdata(d4info->substrate.metadata))) goto done;
+    if(!d4info->controls.lazy) {
+        if((ret = NCD4_processdata(d4info->substrate.metadata))) goto done;
+    }
 
     return THROW(ret);
 
@@ -320,6 +340,7 @@ freeInfo(NCD4INFO* d4info)
     NCD4_reclaimMeta(d4info->substrate.metadata);
     NC_authclear(&d4info->auth);
     nclistfree(d4info->blobs);
+    nclistfreeall(d4info->lazydata);
     free(d4info);
 }
 
@@ -474,6 +495,27 @@ NCD4_applyclientparamcontrols(NCD4INFO* info)
 	    info->controls.opaquesize = (size_t)len;
     }
 
+    /* Lazy fetching applies our own constraints, which cannot be
+       layered on those of the url. A file cannot apply constraints
+       at all, so there the whole response is read at open and only
+       its decoding is put off until the first read (see NCD4_readvar) */
+    info->controls.lazy = 0;
+    if(paramcheck(info,"lazy",NULL)) {
+	if(info->uri->query != NULL)
+	    nclog(NCLOGWARN,"[lazy] ignored for a constrained url");
+	else
+	    info->controls.lazy = 1;
+    }
+    info->controls.lazylimit = DFALTLAZYLIMIT;
+    value = getparam(info,"lazylimit");
+    if(value != NULL) {
+	long long limit = 0;
+	if(sscanf(value,"%lld",&limit) != 1 || limit <= 0)
+	    nclog(NCLOGWARN,"bad [lazylimit] tag: %s",value);
+	else
+	    info->controls.lazylimit = (d4size_t)limit;
+    }
+
     value = getparam(info,"fillmismatch");
     if(value != NULL)
 	SETFLAG(info->controls.flags,NCF_FILLMISMATCH);
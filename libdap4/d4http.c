@@ -5,9 +5,12 @@
 
 #include "d4includes.h"
 #include "d4curlfunctions.h"
+#include "nccurlpool.h"
 
 static size_t WriteFileCallback(void*, size_t, size_t, void*);
 static size_t WriteMemoryCallback(void*, size_t, size_t, void*);
+static size_t WriteStreamCallback(void*, size_t, size_t, void*);
+static int fetchurl(CURL* curl, const char* url, size_t (*writer)(void*,size_t,size_t,void*), void* data, long* filetime);
 static int curlerrtoncerr(CURLcode cstat);
 
 struct Fetchdata {
@@ -33,6 +36,23 @@ NCD4_fetchhttpcode(CURL* curl)
     return httpcode;
 }
 
+/* Number of body bytes of the last response as they came over the
+   wire, i.e. before curl undid any Content-Encoding */
+d4size_t
+NCD4_fetchwiresize(CURL* curl)
+{
+    CURLcode cstat = CURLE_OK;
+#if LIBCURL_VERSION_NUM >= 0x073700
+    curl_off_t size = 0;
+    cstat = curl_easy_getinfo(curl,CURLINFO_SIZE_DOWNLOAD_T,&size);
+#else
+    double size = 0;
+    cstat = curl_easy_getinfo(curl,CURLINFO_SIZE_DOWNLOAD,&size);
+#endif
+    if(cstat != CURLE_OK || size < 0) return 0;
+    return (d4size_t)size;
+}
+
 int
 NCD4_fetchurl_file(CURL* curl, const char* url, FILE* stream,
                 d4size_t* sizep, long* filetime)
@@ -90,17 +110,59 @@ int
 NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime)
 {
     int ret = NC_NOERR;
-    CURLcode cstat = CURLE_OK;
     size_t len;
+
+    if((ret = fetchurl(curl,url,WriteMemoryCallback,(void*)buf,filetime)))
+	return THROW(ret);
+
+    /* Null terminate the buffer*/
+    len = ncbyteslength(buf);
+    ncbytesappend(buf, '\0');
+    ncbytessetlength(buf, len); /* don't count null in buffer size*/
+#ifdef D4DEBUG
+    nclog(NCLOGNOTE,"buffersize: %lu bytes",(d4size_t)ncbyteslength(buf));
+#endif
+    return THROW(ret);
+}
+
+/*
+Fetch a DAP response, dechunking it as it arrives (see d4chunk.c);
+stream->dap receives the data.
+*/
+int
+NCD4_fetchurl_stream(CURL* curl, const char* url, NCD4stream* stream, long* filetime)
+{
+    int ret = NC_NOERR;
+    size_t len;
+
+    ret = fetchurl(curl,url,WriteStreamCallback,(void*)stream,filetime);
+    /* An error found in the response takes precedence over the
+       write error it caused curl to report */
+    if(stream->stat != NC_NOERR)
+	return THROW(stream->stat);
+    if(ret) return THROW(ret);
+
+    /* Null terminate the buffer*/
+    len = ncbyteslength(stream->dap);
+    ncbytesappend(stream->dap, '\0');
+    ncbytessetlength(stream->dap, len); /* don't count null in buffer size*/
+    return THROW(ret);
+}
+
+static int
+fetchurl(CURL* curl, const char* url, size_t (*writer)(void*,size_t,size_t,void*), void* data, long* filetime)
+{
+    int ret = NC_NOERR;
+    CURLcode cstat = CURLE_OK;
     long httpcode = 0;
 
     /* send all data to this function  */
-    cstat = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    cstat = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writer);
     if (cstat != CURLE_OK)
         goto fail;
 
     /* we pass our file to the callback function */
-    cstat = curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)buf);
+    cstat = curl_easy_setopt(curl, CURLOPT_WRITEDATA, data);
     if (cstat != CURLE_OK)
         goto fail;
 
@@ -129,14 +191,6 @@ NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime)
     if(filetime != NULL)
         cstat = curl_easy_getinfo(curl,CURLINFO_FILETIME,filetime);
     if(cstat != CURLE_OK) goto fail;
-
-    /* Null terminate the buffer*/
-    len = ncbyteslength(buf);
-    ncbytesappend(buf, '\0');
-    ncbytessetlength(buf, len); /* don't count null in buffer size*/
-#ifdef D4DEBUG
-    nclog(NCLOGNOTE,"buffersize: %lu bytes",(d4size_t)ncbyteslength(buf));
-#endif
     return THROW(ret);
 
 fail:
@@ -193,14 +247,31 @@ WriteMemoryCallback(void *ptr, size_t size, size_t nmemb, void *data)
     return realsize;
 }
 
+static size_t
+WriteStreamCallback(void *ptr, size_t size, size_t nmemb, void *data)
+{
+    size_t realsize = size * nmemb;
+    NCD4stream* stream = (NCD4stream*) data;
+    if(realsize == 0)
+        nclog(NCLOGWARN,"WriteStreamCallback: zero sized chunk");
+    /* Returning short makes curl stop the transfer */
+    if(NCD4_streamchunks(stream, ptr, realsize) != NC_NOERR)
+	return 0;
+    stream->received += realsize;
+#ifdef PROGRESS
+    nclog(NCLOGNOTE,"callback: %lu bytes",(d4size_t)realsize);
+#endif
+    return realsize;
+}
+
 int
 NCD4_curlopen(CURL** curlp)
 {
     int ret = NC_NOERR;
     CURLcode cstat = CURLE_OK;
     CURL* curl;
-    /* initialize curl*/
-    curl = curl_easy_init();
+    /* get a curl handle from the shared pool */
+    curl = NC_curl_acquire();
     if (curl == NULL)
         ret = NC_ECURL;
     else {
@@ -220,8 +291,7 @@ NCD4_curlopen(CURL** curlp)
 void
 NCD4_curlclose(CURL* curl)
 {
-    if (curl != NULL)
-        curl_easy_cleanup(curl);
+    NC_curl_release(curl);
 }
 
 int
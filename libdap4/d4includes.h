@@ -36,6 +36,7 @@
 #include "ncrc.h"
 #include "ncbytes.h"
 #include "nclist.h"
+#include "nchashmap.h"
 #include "ncuri.h"
 #include "nclog.h"
 #include "ncdap.h"
@@ -115,7 +115,8 @@ static int getValueStrings(NCD4parser*, NCD4node*, ezxml_t xattr, NClist*);
 static int isReserved(const char* name);
 static const KEYWORDINFO* keyword(const char* name);
 static NCD4node* lookupAtomictype(NCD4parser*, const char* name);
-static NCD4node* lookFor(NClist* elems, const char* name, NCD4sort sort);
+static void indexElement(NCD4parser*, NCD4node* group, NCD4node* node);
+static NCD4node* lookFor(NCD4parser*, NCD4node* group, const char* name, NCD4sort sort);
 static NCD4node* lookupFQN(NCD4parser*, const char* sfqn, NCD4sort);
 static int lookupFQNList(NCD4parser*, NClist* fqn, NCD4sort sort, NCD4node** result);
 static NCD4node* makeAnonDim(NCD4parser*, const char* sizestr);
@@ -167,6 +168,8 @@ NCD4_parse(NCD4meta* metadata)
     parser->types = nclistnew();
     parser->dims = nclistnew();
     parser->vars = nclistnew();
+    parser->elements = NC_hashmapnew(0);
+    parser->key = ncbytesnew();
 #ifdef D4DEBUG
     parser->debuglevel = 1;
 #endif
@@ -189,6 +192,8 @@ reclaimParser(NCD4parser* parser)
     nclistfree(parser->types);
     nclistfree(parser->dims);
     nclistfree(parser->vars);
+    if(parser->elements != NULL) NC_hashmapfree(parser->elements);
+    ncbytesfree(parser->key);
     /* Reclaim unused atomic type nodes */
     len = nclistlength(parser->atomictypes);    
     for(i=0;i<len;i++) {
@@ -1032,7 +1037,7 @@ lookupFQNList(NCD4parser* parser, NClist* fqn, NCD4sort sort, NCD4node** result)
 	assert(ISGROUP(current->sort));
 	name = (char*)nclistget(fqn,i);
         /* See if we can find a matching subgroup */
-	node = lookFor(current->group.elements,name,NCD4_GROUP);
+	node = lookFor(parser,current,name,NCD4_GROUP);
 	if(node == NULL)
 	    break; /* reached the end of the group part of the fqn */
 	current = node;
@@ -1049,13 +1054,13 @@ lookupFQNList(NCD4parser* parser, NClist* fqn, NCD4sort sort, NCD4node** result)
     }
     if(i == (nsteps - 1)) {
 	assert (node == NULL);
-        node = lookFor(current->group.elements,name,sort);
+        node = lookFor(parser,current,name,sort);
 	if(node == NULL) goto sortfail;
 	goto done;
     }
     assert (i < (nsteps - 1)); /* case 3 */
     /* We have steps to take, so node better be a compound var */
-    node = lookFor(current->group.elements,name,NCD4_VAR);
+    node = lookFor(parser,current,name,NCD4_VAR);
     if(node == NULL || !ISCMPD(node->basetype->subsort))
 	goto fail;
     /* So we are at a compound variable, so walk its fields recursively */
@@ -1091,11 +1096,52 @@ sortfail:
     goto done;
 }
 
+/*
+Dims, vars and groups are named when they are made and never renamed,
+so they are indexed by group and name as they are made; the lookups of
+dimension references and maps would otherwise be quadratic in the
+number of variables. Types can be renamed after they are made (see
+parseStructure), so they are still looked for linearly.
+*/
+#define INDEXED(sort) ((sort) == NCD4_DIM || (sort) == NCD4_VAR || (sort) == NCD4_GROUP)
+
+static void
+elementKey(NCD4parser* parser, NCD4node* group, NCD4sort sort, const char* name)
+{
+    ncbytesclear(parser->key);
+    ncbytesappendn(parser->key,(char*)&group,sizeof(group));
+    ncbytesappendn(parser->key,(char*)&sort,sizeof(sort));
+    ncbytescat(parser->key,name);
+}
+
+static void
+indexElement(NCD4parser* parser, NCD4node* group, NCD4node* node)
+{
+    const char* key;
+    size_t keysize;
+    if(node->name == NULL || !INDEXED(node->sort)) return;
+    elementKey(parser,group,node->sort,node->name);
+    key = ncbytescontents(parser->key);
+    keysize = ncbyteslength(parser->key);
+    /* First one wins, as with a linear search */
+    if(!NC_hashmapget(parser->elements,key,keysize,NULL))
+        NC_hashmapadd(parser->elements,(uintptr_t)node,key,keysize);
+}
+
 static NCD4node*
-lookFor(NClist* elems, const char* name, NCD4sort sort)
+lookFor(NCD4parser* parser, NCD4node* group, const char* name, NCD4sort sort)
 {
     int n,i;
+    NClist* elems = group->group.elements;
     if(elems == NULL || nclistlength(elems) == 0) return NULL;
+    if(INDEXED(sort)) {
+        uintptr_t data = 0;
+        elementKey(parser,group,sort,name);
+        if(!NC_hashmapget(parser->elements,ncbytescontents(parser->key),
+                          ncbyteslength(parser->key),&data))
+            return NULL;
+        return (NCD4node*)data;
+    }
     n = nclistlength(elems);
     for(i=0;i<n;i++) {
 	NCD4node* node = (NCD4node*)nclistget(elems,i);
@@ -1256,8 +1302,10 @@ makeNode(NCD4parser* parser, NCD4node* parent, ezxml_t xml, NCD4sort sort, nc_ty
 	}
     }
     if(parent != NULL) {
-	if(parent->sort == NCD4_GROUP)
+	if(parent->sort == NCD4_GROUP) {
 	    PUSH(parent->group.elements,node);
+	    indexElement(parser,parent,node);
+	}
     }
     track(parser,node);
     if(nodep) *nodep = node;
@@ -1281,6 +1329,7 @@ makeAnonDim(NCD4parser* parser, const char* sizestr)
     if(dim == NULL) {/* create it */
 	if((ret=makeNode(parser,root,NULL,NCD4_DIM,NC_NULL,&dim))) goto done;
 	SETNAME(dim,name+1); /* leave out the '/' separator */
+	indexElement(parser,root,dim);
 	dim->dim.size = (long long)size;
 	dim->dim.isanonymous = 1;
 	PUSH(root->dims,dim);
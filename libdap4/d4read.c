@@ -19,9 +19,11 @@ See \ref copyright file for more info.
 /* Do conversion if this code was compiled via Vis. Studio or Mingw */
 
 /*Forward*/
-static int readpacket(NCD4INFO* state, NCURI*, NCbytes*, NCD4mode, long*);
+static int readpacket(NCD4INFO* state, NCURI*, NCbytes*, NCD4mode, NCD4stream*, long*);
 static int readfile(NCD4INFO* state, const NCURI*, const char* suffix, NCbytes* packet);
 static int readfiletofile(NCD4INFO* state, const NCURI*, const char* suffix, FILE* stream, d4size_t*);
+static void transfer(NCD4INFO* state, d4size_t decoded);
+static char* buildvarce(NCD4node* var, const size_t* start, const size_t* count, const ptrdiff_t* stride);
 
 #ifdef HAVE_GETTIMEOFDAY
 static double
@@ -42,7 +44,7 @@ NCD4_readDMR(NCD4INFO* state)
     int stat = NC_NOERR;
     long lastmodified = -1;
 
-    stat = readpacket(state,state->uri,state->curl->packet,NCD4_DMR,&lastmodified);
+    stat = readpacket(state,state->uri,state->curl->packet,NCD4_DMR,NULL,&lastmodified);
     if(stat == NC_NOERR)
 	state->data.dmrlastmodified = lastmodified;
     return THROW(stat);
@@ -55,7 +57,13 @@ NCD4_readDAP(NCD4INFO* state, int flags)
     long lastmod = -1;
 
     if((flags & NCF_ONDISK) == 0) {
-        stat = readpacket(state,state->uri,state->curl->packet,NCD4_DAP,&lastmod);
+	/* Dechunk the response as it arrives, unless it is a file */
+	NCD4stream stream;
+	NCD4_streaminit(&stream,state->substrate.metadata,state->curl->packet);
+        stat = readpacket(state,state->uri,state->curl->packet,NCD4_DAP,&stream,&lastmod);
+	if(stat == NC_NOERR && strcmp(state->uri->protocol,"file") != 0)
+	    stat = NCD4_streamend(&stream);
+	NCD4_streamclear(&stream);
         if(stat == NC_NOERR)
             state->data.daplastmodified = lastmod;
     } else { /*((flags & NCF_ONDISK) != 0) */
@@ -75,8 +83,9 @@ NCD4_readDAP(NCD4INFO* state, int flags)
 	    readurl = ncuribuild(url,NULL,".dods",NCURISVC);
 	    if(readurl == NULL)
 		return THROW(NC_ENOMEM);
-            stat = NCD4_fetchurl_file(state->curl, readurl, state->data.ondiskfile,
+            stat = NCD4_fetchurl_file(state->curl->curl, readurl, state->data.ondiskfile,
                                    &state->data.datasize, &lastmod);
+            transfer(state,state->data.datasize);
             nullfree(readurl);
             if(stat == NC_NOERR)
                 state->data.daplastmodified = lastmod;
@@ -85,6 +94,116 @@ NCD4_readDAP(NCD4INFO* state, int flags)
     return THROW(stat);
 }
 
+/*
+Lazy mode: fetch the data of a single top-level variable with a
+constrained DAP4 request. If start is NULL, the whole variable is
+fetched and its data is attached to var so that later reads need no
+fetch. Otherwise only the given slab of a fixed size variable is
+fetched and *datap receives a malloc'd copy of its values in
+netcdf-4 memory order; the caller must free it.
+A file cannot apply the constraint, but its whole response was read
+at open: the data of every variable is decoded from it instead, and
+lazy mode ends.
+*/
+int
+NCD4_readvar(NCD4INFO* state, NCD4node* var, const size_t* start,
+             const size_t* count, const ptrdiff_t* stride, void** datap)
+{
+    int stat = NC_NOERR;
+    long lastmod = -1;
+    char* ce = NULL;
+    NCbytes* packet = NULL;
+    NCD4meta* response = NULL;
+    NCD4meta* meta = state->substrate.metadata;
+    void* raw = NULL;
+    void* data = NULL;
+
+    if(FLAGSET(state->controls.flags,NCF_UNCONSTRAINABLE)) {
+	if(start != NULL) return THROW(NC_EINTERNAL);
+        if((stat = NCD4_processdata(meta))) return THROW(stat);
+	state->controls.lazy = 0;
+	if(FLAGSET(state->controls.flags,NCF_SHOWFETCH))
+	    nclog(NCLOGDBG,"lazy fetch: %s",state->uri->path);
+	return THROW(stat);
+    }
+
+    if((ce = buildvarce(var,start,count,stride)) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    packet = ncbytesnew();
+    ncurisetquery(state->uri,ce);
+    stat = readpacket(state,state->uri,packet,NCD4_DAP,NULL,&lastmod);
+    ncurisetquery(state->uri,NULL);
+    if(stat) goto done;
+
+    /* Dechunk the response on its own; only its data is used */
+    if((response = NCD4_newmeta(ncbyteslength(packet),ncbytescontents(packet)))==NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((stat = NCD4_infermode(response))) goto done;
+    if(response->mode != NCD4_DAP) {stat = NC_EDAPSVC; goto done;}
+    if((stat = NCD4_dechunk(response))) {
+	if(response->serial.errdata != NULL)
+	    nclog(NCLOGERR,"DAP4 error response: %s",response->serial.errdata);
+	goto done;
+    }
+    raw = ncbytesextract(packet);
+    if(start == NULL) {
+        if((stat = NCD4_processvardata(meta,var,&response->serial))) goto done;
+	/* var now points into the response */
+	PUSH(state->lazydata,raw);
+	raw = NULL;
+    } else {
+	int i;
+	d4size_t product = 1;
+	for(i=0;i<nclistlength(var->dims);i++)
+	    product *= count[i];
+        if((stat = NCD4_processslab(meta,var,product,&response->serial,&data)))
+	    goto done;
+	/* Move the values to the front so the caller can free them */
+	d4memmove(raw,data,(size_t)(product*var->basetype->meta.memsize));
+	if(datap) {*datap = raw; raw = NULL;}
+    }
+    if(FLAGSET(state->controls.flags,NCF_SHOWFETCH))
+	nclog(NCLOGDBG,"lazy fetch: %s",ce);
+
+done:
+    nullfree(raw);
+    nullfree(ce);
+    ncbytesfree(packet);
+    NCD4_reclaimMeta(response);
+    return THROW(stat);
+}
+
+/* Build the DAP4 constraint for a variable or a slab of it */
+static char*
+buildvarce(NCD4node* var, const size_t* start, const size_t* count, const ptrdiff_t* stride)
+{
+    int i;
+    char* fqn = NULL;
+    char tmp[3*64];
+    NCbytes* ce = ncbytesnew();
+
+    if((fqn = NCD4_makeFQN(var)) == NULL) goto fail;
+    ncbytescat(ce,"dap4.ce=");
+    ncbytescat(ce,fqn);
+    free(fqn);
+    if(start != NULL) {
+	for(i=0;i<nclistlength(var->dims);i++) {
+	    size_t last = start[i] + (size_t)stride[i]*(count[i]-1);
+	    snprintf(tmp,sizeof(tmp),"[%lu:%lu:%lu]",
+		     (unsigned long)start[i],(unsigned long)stride[i],
+		     (unsigned long)last);
+	    ncbytescat(ce,tmp);
+	}
+    }
+    ncbytesnull(ce);
+    fqn = ncbytesextract(ce);
+    ncbytesfree(ce);
+    return fqn;
+fail:
+    ncbytesfree(ce);
+    return NULL;
+}
+
 static const char*
 dxxextension(int dxx)
 {
@@ -96,13 +215,17 @@ dxxextension(int dxx)
     return NULL;
 }
 
+/* If stream is not NULL, a DAP response from a server is dechunked
+   into packet as it arrives (see d4chunk.c) */
 static int
-readpacket(NCD4INFO* state, NCURI* url, NCbytes* packet, NCD4mode dxx, long* lastmodified)
+readpacket(NCD4INFO* state, NCURI* url, NCbytes* packet, NCD4mode dxx,
+           NCD4stream* stream, long* lastmodified)
 {
     int stat = NC_NOERR;
     int fileprotocol = 0;
     const char* suffix = dxxextension(dxx);
     CURL* curl = state->curl->curl;
+    size_t len0 = ncbyteslength(packet);
 #ifdef HAVE_GETTIMEOFDAY
     struct timeval time0;
     struct timeval time1;
@@ -127,8 +250,13 @@ readpacket(NCD4INFO* state, NCURI* url, NCbytes* packet, NCD4mode dxx, long* las
    	    gettimeofday(&time0,NULL);
 #endif
 	}
-        stat = NCD4_fetchurl(curl,fetchurl,packet,lastmodified);
+	if(stream != NULL)
+            stat = NCD4_fetchurl_stream(curl,fetchurl,stream,lastmodified);
+	else
+            stat = NCD4_fetchurl(curl,fetchurl,packet,lastmodified);
         nullfree(fetchurl);
+	transfer(state,(stream != NULL ? stream->received
+			 : (d4size_t)(ncbyteslength(packet)-len0)));
 	if(stat) goto fail;
 	if(FLAGSET(state->controls.flags,NCF_SHOWFETCH)) {
             double secs = 0;
@@ -137,6 +265,9 @@ readpacket(NCD4INFO* state, NCURI* url, NCbytes* packet, NCD4mode dxx, long* las
 	    secs = deltatime(time0,time1);
 #endif
             nclog(NCLOGDBG,"fetch complete: %0.3f",secs);
+	    /* The two differ when the server compressed the response */
+            nclog(NCLOGDBG,"transfer so far: %llu bytes received, %llu decoded",
+		  state->curl->transfer.wire,state->curl->transfer.decoded);
 	}
     }
 #ifdef D4DEBUG
@@ -149,6 +280,15 @@ fail:
     return THROW(stat);
 }
 
+/* Account for the response just fetched on state->curl, of which
+   decoded bytes reached the reader */
+static void
+transfer(NCD4INFO* state, d4size_t decoded)
+{
+    state->curl->transfer.wire += NCD4_fetchwiresize(state->curl->curl);
+    state->curl->transfer.decoded += decoded;
+}
+
 static int
 readfiletofile(NCD4INFO* state, const NCURI* uri, const char* suffix, FILE* stream, d4size_t* sizep)
 {
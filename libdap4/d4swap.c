@@ -7,6 +7,7 @@
 #include <stdarg.h>
 #include "d4includes.h"
 #include "ezxml.h"
+#include "ncswap.h"
 
 /*
 The primary purpose of this code is to recursively traverse
@@ -35,7 +36,10 @@ NCD4_swapdata(NCD4meta* compiler, NClist* topvars)
     int i;
     void* offset;
 
-    offset = compiler->serial.dap;
+    if(nclistlength(topvars) == 0) goto done;
+    /* Start at the first var, as found by NCD4_delimit; the vars
+       before it may have been swapped as they arrived */
+    offset = ((NCD4node*)nclistget(topvars,0))->data.dap4data.memory;
     for(i=0;i<nclistlength(topvars);i++) {
 	NCD4node* var = (NCD4node*)nclistget(topvars,i);
 	var->data.dap4data.memory = offset;
@@ -84,22 +88,16 @@ walkAtomicVar(NCD4meta* compiler, NCD4node* topvar, NCD4node* var, void** offset
     if(subsort != NC_STRING) {
         int typesize = NCD4_typesize(subsort);
 	d4size_t totalsize = typesize*dimproduct;
-	if(typesize == 1) {
-	    offset = INCR(offset,totalsize);
-	} else { /*(typesize > 1)*/
-	    for(i=0;i<dimproduct;i++) {
-	        char* sp = (char*)offset;
-	        if(compiler->swap) {
-	            switch (typesize) {
-	            case 2: swapinline16(sp); break;
-	            case 4: swapinline32(sp); break;
-	            case 8: swapinline64(sp); break;
-	            default: break;
-	            }
-		}
-	        offset = INCR(offset,typesize);
+	/* Swap the whole array in place at once, if at all */
+	if(compiler->swap) {
+	    switch (typesize) {
+	    case 2: NC_swapn2(offset,offset,dimproduct); break;
+	    case 4: NC_swapn4(offset,offset,dimproduct); break;
+	    case 8: NC_swapn8(offset,offset,dimproduct); break;
+	    default: break;
 	    }
 	}
+	offset = INCR(offset,totalsize);
     } else if(subsort == NC_STRING) { /* remaining case; just convert the counts */
 	COUNTERTYPE count;
 	for(i=0;i<dimproduct;i++) {
@@ -12,6 +12,7 @@
 
 /* Forward */
 static int getvarx(int ncid, int varid, NCD4INFO**, NCD4node** varp, nc_type* xtypep, size_t*, nc_type* nc4typep, size_t*);
+static int lazyslab(NCD4INFO*, NCD4node* var, const size_t* start, const size_t* edges, const ptrdiff_t* stride);
 
 int
 NCD4_get_vara(int ncid, int varid,
@@ -44,6 +45,8 @@ NCD4_get_vars(int ncid, int varid,
     size_t dimsizes[NC_MAX_VAR_DIMS];
     d4size_t dimproduct;
     size_t dstcount;
+    void* data = NULL; /* start of the var's data */
+    void* slab = NULL; /* lazily fetched slab, if any */
     
     if((ret=getvarx(ncid, varid, &info, &ncvar, &xtype, &xsize, &nc4type, &nc4size)))
 	{goto done;}
@@ -63,6 +66,33 @@ NCD4_get_vars(int ncid, int varid,
 	NCD4node* dim = nclistget(ncvar->dims,i);
 	dimsizes[i] = (size_t)dim->dim.size;
     }
+
+    data = ncvar->data.dap4data.memory;
+    if(data == NULL && info->controls.lazy) {
+	if(lazyslab(info,ncvar,start,edges,stride)) {
+	    /* Validate here, since the server would refuse the slab */
+	    for(dimproduct=1,i=0;i<rank;i++) {
+		if(start[i] >= dimsizes[i] && edges[i] > 0)
+		    {ret = THROW(NC_EINVALCOORDS); goto done;}
+		if(edges[i] > 0
+		   && start[i] + (size_t)stride[i]*(edges[i]-1) >= dimsizes[i])
+		    {ret = THROW(NC_EEDGE); goto done;}
+		dimproduct *= edges[i];
+	    }
+	    if(dimproduct == 0) goto done;
+	    if((ret=NCD4_readvar(info,ncvar,start,edges,stride,&slab)))
+		goto done;
+	    /* Walk the slab as if it were the whole variable */
+	    data = slab;
+	    for(i=0;i<rank;i++) dimsizes[i] = edges[i];
+	    start = NC_coord_zero;
+	    stride = NC_stride_one;
+	} else {
+	    if((ret=NCD4_readvar(info,ncvar,NULL,NULL,NULL,NULL)))
+		goto done;
+	    data = ncvar->data.dap4data.memory;
+	}
+    }
 	
     /* Extract and desired subset of data */
     if(rank > 0)
@@ -86,9 +116,9 @@ NCD4_get_vars(int ncid, int varid,
 	   the variable size type
 	*/
 	if(nctype->meta.isfixedsize) {
-	    offset = INCR(ncvar->data.dap4data.memory,(nc4size * count));
+	    offset = INCR(data,(nc4size * count));
 	} else {
-            offset = ncvar->data.dap4data.memory;
+            offset = data;
 	    /* We have to walk to the count'th location in the data */
 	    if((ret=NCD4_moveto(meta,ncvar,count,&offset)))
 	        {goto done;}		    
@@ -111,6 +141,7 @@ done:
 	d4odom_free(odom);
     if(instance != NULL)
 	free(instance);
+    nullfree(slab);
     if(ret != NC_NOERR) { /* reclaim all malloc'd data if there is an error*/
 	for(i=0;i<nclistlength(blobs);i++) {
 	    nullfree(nclistget(blobs,i));
@@ -120,6 +151,34 @@ done:
     return (ret);
 }
 
+/* In lazy mode, decide whether to fetch just the requested slab of
+   a variable rather than the whole variable: only for a strict part
+   of a large variable of fixed size atomic type, and never from a
+   file, which cannot apply the constraint */
+static int
+lazyslab(NCD4INFO* info, NCD4node* var, const size_t* start,
+	 const size_t* edges, const ptrdiff_t* stride)
+{
+    int i;
+    NCD4node* basetype = var->basetype;
+    int whole = 1;
+
+    if(FLAGSET(info->controls.flags,NCF_UNCONSTRAINABLE))
+	return 0;
+    if(basetype->subsort == NC_ENUM)
+	basetype = basetype->basetype;
+    if(basetype->subsort > NC_UINT64 || nclistlength(var->dims) == 0)
+	return 0;
+    if(NCD4_dimproduct(var) * basetype->meta.memsize <= info->controls.lazylimit)
+	return 0;
+    for(i=0;i<nclistlength(var->dims);i++) {
+	NCD4node* dim = nclistget(var->dims,i);
+	if(start[i] != 0 || stride[i] != 1 || edges[i] != (size_t)dim->dim.size)
+	    whole = 0;
+    }
+    return !whole;
+}
+
 static int
 getvarx(int ncid, int varid, NCD4INFO** infop, NCD4node** varp,
 	nc_type* xtypep, size_t* xsizep, nc_type* nc4typep, size_t* nc4sizep)
@@ -224,7 +224,7 @@ void ezxml_open_tag(ezxml_root_t root, char *name, char **attr)
 {
     ezxml_t xml = root->cur;
 
-    if (xml->name) xml = ezxml_add_child(xml, name, strlen(xml->txt));
+    if (xml->name) xml = ezxml_add_child(xml, name, xml->ntxt);
     else xml->name = name; /* first open tag*/
 
     xml->attr = attr;
@@ -243,12 +243,18 @@ void ezxml_char_content(ezxml_root_t root, char *s, size_t len, char t)
     s[len] = '\0'; /* null terminate text (calling functions anticipate this)*/
     len = strlen(s = ezxml_decode(s, root->ent, t)) + 1;
 
-    if (! *(xml->txt)) xml->txt = s; /* initial character content*/
-    else { /* allocate our own memory and make a copy*/
-        xml->txt = (xml->flags & EZXML_TXTM) /* allocate some space*/
-                   ? realloc(xml->txt, (l = strlen(xml->txt)) + len)
-                   : strcpy(malloc((l = strlen(xml->txt)) + len), xml->txt);
+    if (! *(xml->txt)) { /* initial character content*/
+        xml->txt = s;
+        xml->ntxt = len - 1;
+    }
+    else { /* allocate our own memory and make a copy; grow it geometrically*/
+        l = xml->ntxt; /* so that long runs of content are not quadratic*/
+        if (! (xml->flags & EZXML_TXTM))
+            xml->txt = strcpy(malloc(xml->mtxt = 2 * (l + len)), xml->txt);
+        else if (l + len > xml->mtxt)
+            xml->txt = realloc(xml->txt, xml->mtxt = 2 * (l + len));
         strcpy(xml->txt + l, s); /* add new char content*/
+        xml->ntxt = l + len - 1;
         if (s != m) free(s); /* free s if it was malloced by ezxml_decode()*/
     }
 
@@ -807,16 +813,47 @@ ezxml_t ezxml_new(const char *name)
     return &root->xml;
 }
 
+/* forgets the cached last sub tag and name tails of the given tag*/
+static void ezxml_unindex(ezxml_t xml)
+{
+    ezxml_t cur;
+
+    xml->last = NULL;
+    for (cur = xml->child; cur; cur = cur->sibling) cur->tail = NULL;
+}
+
 /* inserts an existing tag into an ezxml structure*/
 ezxml_t ezxml_insert(ezxml_t xml, ezxml_t dest, size_t off)
 {
     ezxml_t cur, prev, head;
 
-    xml->next = xml->sibling = xml->ordered = NULL;
+    xml->next = xml->sibling = xml->ordered = xml->tail = NULL;
     xml->off = off;
     xml->parent = dest;
 
     if ((head = dest->child)) { /* already have sub tags*/
+        if (! dest->last)
+            for (dest->last = head; dest->last->ordered;
+                 dest->last = dest->last->ordered);
+        if (dest->last->off <= off) { /* append, as the parser always does*/
+            dest->last->ordered = xml;
+            dest->last = xml;
+            for (cur = head, prev = NULL; cur && strcmp(cur->name, xml->name);
+                 prev = cur, cur = cur->sibling); /* find tag type*/
+            if (cur) { /* not first of type*/
+                if (! cur->tail)
+                    for (cur->tail = cur; cur->tail->next;
+                         cur->tail = cur->tail->next);
+                cur->tail->next = xml;
+                cur->tail = xml;
+            }
+            else { /* first tag of this type*/
+                prev->sibling = xml;
+                xml->tail = xml;
+            }
+            return xml;
+        }
+
         if (head->off <= off) { /* not first subtag*/
             for (cur = head; cur->ordered && cur->ordered->off <= off;
                  cur = cur->ordered);
@@ -843,8 +880,12 @@ ezxml_t ezxml_insert(ezxml_t xml, ezxml_t dest, size_t off)
             xml->sibling = cur;
             if (prev) prev->sibling = xml;
         }
+        ezxml_unindex(dest);
+    }
+    else { /* only sub tag*/
+        dest->child = dest->last = xml;
+        xml->tail = xml;
     }
-    else dest->child = xml; /* only sub tag*/
 
     return xml;
 }
@@ -872,6 +913,8 @@ ezxml_t ezxml_set_txt(ezxml_t xml, const char *txt)
     if (xml->flags & EZXML_TXTM) free(xml->txt); /* existing txt was malloced*/
     xml->flags &= ~EZXML_TXTM;
     xml->txt = (char *)txt;
+    xml->ntxt = strlen(txt);
+    xml->mtxt = 0;
     return xml;
 }
 
@@ -953,8 +996,9 @@ ezxml_t ezxml_cut(ezxml_t xml)
             while (cur->next && cur->next != xml) cur = cur->next;
             if (cur->next) cur->next = cur->next->next; /* patch next list*/
         }
+        ezxml_unindex(xml->parent);
     }
-    xml->ordered = xml->sibling = xml->next = NULL;
+    xml->ordered = xml->sibling = xml->next = xml->tail = NULL;
     return xml;
 }
 
@@ -51,6 +51,11 @@ struct ezxml {
     ezxml_t child;   /* head of sub tag list, NULL if none*/
     ezxml_t parent;  /* parent tag, NULL if current tag is root tag*/
     short flags;     /* additional information*/
+    /* Kept so that the parser appends in constant time; NULL means unknown*/
+    ezxml_t last;    /* last sub tag in original order*/
+    ezxml_t tail;    /* last tag of this name, kept on the first of the name*/
+    size_t ntxt;     /* length of txt*/
+    size_t mtxt;     /* allocated size of txt, 0 if unknown*/
 };
 
 /* Given a string of xml data and its length, parses it and creates an ezxml*/
@@ -15,6 +15,7 @@ defined here, including function-like #defines.
 #include "d4util.h"
 #include "d4debug.h"
 #include "nc4internal.h"
+#include "nccrc32.h"
 
 /**************************************************/
 /* Constants */
@@ -45,6 +46,10 @@ defined here, including function-like #defines.
 #define FIXEDOPAQUE
 #define DFALTOPAQUESIZE 16
 
+/* In lazy mode, variables with more data than this are fetched
+   one slab at a time rather than whole */
+#define DFALTLAZYLIMIT (1024*1024)
+
 /**************************************************/
 
 #undef nullfree
@@ -82,8 +87,10 @@ extern NCerror NCD4_getvarx(int ncid, int varid,
 
 /* From d4http.c */
 extern long NCD4_fetchhttpcode(CURL* curl);
+extern d4size_t NCD4_fetchwiresize(CURL* curl);
 extern int NCD4_fetchurl_file(CURL* curl, const char* url, FILE* stream, d4size_t* sizep, long* filetime);
 extern int NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime);
+extern int NCD4_fetchurl_stream(CURL* curl, const char* url, NCD4stream* stream, long* filetime);
 extern int NCD4_curlopen(CURL** curlp);
 extern void NCD4_curlclose(CURL* curl);
 extern int NCD4_fetchlastmodified(CURL* curl, char* url, long* filetime);
@@ -92,6 +99,7 @@ extern int NCD4_ping(const char* url);
 /* From d4read.c */
 extern int NCD4_readDMR(NCD4INFO* state);
 extern int NCD4_readDAP(NCD4INFO* state, int flags);
+extern int NCD4_readvar(NCD4INFO* state, NCD4node* var, const size_t* start, const size_t* count, const ptrdiff_t* stride, void** datap);
 
 /* From d4parser.c */
 extern int NCD4_parse(NCD4meta*);
@@ -123,6 +131,10 @@ extern int NCD4_toposort(NCD4meta*);
 
 /* From d4data.c */
 extern int NCD4_processdata(NCD4meta*);
+extern int NCD4_processvardata(NCD4meta*, NCD4node* var, NCD4serial* serial);
+extern int NCD4_processslab(NCD4meta*, NCD4node* var, d4size_t count, NCD4serial* serial, void** datap);
+extern d4size_t NCD4_fixedvarsize(NCD4node* var);
+extern int NCD4_processarrived(NCD4meta*, NCD4node* var, void* data);
 extern int NCD4_fillinstance(NCD4meta*, NCD4node* type, void** offsetp, void** dstp, NClist* blobs);
 extern int NCD4_getToplevelVars(NCD4meta* meta, NCD4node* group, NClist* toplevel);
 
@@ -155,8 +167,8 @@ extern int NCD4_rcdefault(NCD4INFO*);
 /* From d4cvt.c */
 extern int NCD4_convert(nc_type srctype, nc_type dsttype, char* memory0, char* value0, size_t count);
 
-/* From d4crc32.c */
-extern unsigned int NCD4_crc32(unsigned int crc, const void *buf, size_t size);
+/* The DAP4 checksum is the zlib CRC-32; see libdispatch/crc32.c */
+#define NCD4_crc32(crc,buf,size) NC_crc32(crc,buf,size)
 
 /* d4file.c */
 extern void NCD4_applyclientparamcontrols(NCD4INFO*);
@@ -44,6 +44,7 @@ typedef struct NCD4curl NCD4curl;
 typedef struct NCD4meta NCD4meta;
 typedef struct NCD4node NCD4node;
 typedef struct NCD4params NCD4params;
+typedef struct NCD4stream NCD4stream;
 
 /**************************************************/
 /* DMR Tree node sorts */
@@ -220,6 +221,8 @@ typedef struct NCD4serial {
     int hostlittleendian; /* 1 if the host is little endian */
     int remotelittleendian; /* 1 if the packet says data is little endian */
     int remotechecksumming; /* 1 if the packet says checksums are included */
+    int dechunked; /* 1 if the packet was dechunked as it arrived */
+    int streamed; /* # leading top-level vars verified and swapped as they arrived */
 } NCD4serial;
 
 /* This will be passed out of the parse */
@@ -260,6 +263,8 @@ typedef struct NCD4parser {
     NClist* atomictypes; /*list<NCD4node>*/
     char* used; /* mark indices in atomictypes that have been used */
     NCD4node* dapopaque; /* Single non-fixed-size opaque type */
+    struct NC_hashmap* elements; /* (group,sort,name) => dim, var or group */
+    NCbytes* key; /* scratch space for element keys */
 } NCD4parser;
 
 /**************************************************/
@@ -280,6 +285,10 @@ struct NCD4curl {
 	long interval; /* KEEPINTVL value */
     } keepalive; /* keepalive info */
     long buffersize; /* read buffer size */    
+    struct {/* response body bytes fetched so far */
+	d4size_t wire; /* as sent, possibly compressed */
+	d4size_t decoded; /* as handed to the readers */
+    } transfer;
 };
 
 /**************************************************/
@@ -312,12 +321,15 @@ struct NCD4INFO {
 	NCD4translation translation;
 	char substratename[NC_MAX_NAME];
 	size_t opaquesize; /* default opaque size */
+	int lazy; /* fetch each variable when it is first read */
+	d4size_t lazylimit; /* larger variables are fetched a slab at a time */
     } controls;
     NCauth auth;
     struct {
 	char* filename;
     } fileproto;
     NClist* blobs;
+    NClist* lazydata; /* NClist<void*> responses holding lazily fetched variables */
 };
 
 #endif /*D4TYPES_H*/
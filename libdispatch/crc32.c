@@ -68,8 +68,14 @@ UCAR
   DYNAMIC_CRC_TABLE and MAKECRCH can be #defined to write out crc32.h.
  */
 
-/* Prototype for the crc32 function
-extern unsigned int NC_crc32(unsigned int crc, const unsigned char* buf, unsigned int len);
+/*
+  Further modified for netCDF: the four-bytes-at-a-time code is replaced
+  by slicing-by-8 on byte order independent tables, and on x86 CPUs that
+  have PCLMULQDQ, buffers of 64 bytes or more are folded 64 bytes at a
+  time with carry-less multiplies (Intel, "Fast CRC Computation for
+  Generic Polynomials Using PCLMULQDQ Instruction", 2009). The kernel is
+  compiled for that instruction set on its own and only called if the
+  CPU has it. The prototypes are in include/nccrc32.h.
 */
 
 /* Define some of the macros used here */
@@ -81,11 +87,20 @@ extern unsigned int NC_crc32(unsigned int crc, const unsigned char* buf, unsigne
 #define uInt unsigned int
 #define z_off64_t long long
 #define z_off_t long
-#define z_crc_t unsigned long
+#define z_crc_t unsigned int
 #define z_size_t size_t
 #define Z_NULL NULL
 
+#include "config.h"
 #include <stdlib.h>
+#include "nccrc32.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (__GNUC__ >= 5 || defined(__clang__))
+#include <immintrin.h>
+#define NC_HAVE_PCLMUL 1
+#define NC_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
 
 #ifdef MAKECRCH
 #  include <stdio.h>
@@ -95,19 +110,8 @@ extern unsigned int NC_crc32(unsigned int crc, const unsigned char* buf, unsigne
 #endif /* MAKECRCH */
 
 
-/* Definitions for doing the crc four data bytes at a time. */
-#if !defined(NOBYFOUR) && defined(Z_U4)
-#  define BYFOUR
-#endif
-#ifdef BYFOUR
-   local unsigned long crc32_little OF((unsigned long,
-                        const unsigned char FAR *, z_size_t));
-   local unsigned long crc32_big OF((unsigned long,
-                        const unsigned char FAR *, z_size_t));
-#  define TBLS 8
-#else
-#  define TBLS 1
-#endif /* BYFOUR */
+/* Tables for doing the crc eight data bytes at a time. */
+#define TBLS 8
 
 #ifdef DYNAMIC_CRC_TABLE
 
@@ -139,9 +143,9 @@ local void make_crc_table OF((void));
 
   The first table is simply the CRC of all possible eight bit values.  This is
   all the information needed to generate CRCs on data a byte at a time for all
-  combinations of CRC register values and incoming bytes.  The remaining tables
-  allow for word-at-a-time CRC calculation for both big-endian and little-
-  endian machines, where a word is four bytes.
+  combinations of CRC register values and incoming bytes.  Table k is the CRC
+  of each value followed by k zero bytes, which allows eight bytes to be done
+  with eight independent lookups (slicing-by-8).
 */
 local void make_crc_table()
 {
@@ -171,19 +175,14 @@ local void make_crc_table()
             crc_table[0][n] = c;
         }
 
-#ifdef BYFOUR
-        /* generate crc for each value followed by one, two, and three zeros,
-           and then the byte reversal of those as well as the first table */
+        /* generate crc for each value followed by one to seven zeros */
         for (n = 0; n < 256; n++) {
             c = crc_table[0][n];
-            crc_table[4][n] = ZSWAP32(c);
-            for (k = 1; k < 4; k++) {
+            for (k = 1; k < TBLS; k++) {
                 c = crc_table[0][c & 0xff] ^ (c >> 8);
                 crc_table[k][n] = c;
-                crc_table[k + 4][n] = ZSWAP32(c);
             }
         }
-#endif /* BYFOUR */
 
         crc_table_empty = 0;
     }
@@ -205,14 +204,10 @@ local void make_crc_table()
         fprintf(out, "local const z_crc_t FAR ");
         fprintf(out, "crc_table[TBLS][256] =\n{\n  {\n");
         write_table(out, crc_table[0]);
-#  ifdef BYFOUR
-        fprintf(out, "#ifdef BYFOUR\n");
-        for (k = 1; k < 8; k++) {
+        for (k = 1; k < TBLS; k++) {
             fprintf(out, "  },\n  {\n");
             write_table(out, crc_table[k]);
         }
-        fprintf(out, "#endif\n");
-#  endif /* BYFOUR */
         fprintf(out, "  }\n};\n");
         fclose(out);
     }
@@ -255,34 +250,28 @@ local const z_crc_t FAR * ZEXPORT get_crc_table()
 #endif
 
 /* ========================================================================= */
-#define DO1 crc = crc_table[0][((int)crc ^ (*buf++)) & 0xff] ^ (crc >> 8)
-#define DO8 DO1; DO1; DO1; DO1; DO1; DO1; DO1; DO1
+#define DO1 c = crc_table[0][(c ^ *buf++) & 0xff] ^ (c >> 8)
+#define DO8 c ^= (z_crc_t)buf[0] | ((z_crc_t)buf[1] << 8) | \
+             ((z_crc_t)buf[2] << 16) | ((z_crc_t)buf[3] << 24); \
+        c = crc_table[7][c & 0xff] ^ crc_table[6][(c >> 8) & 0xff] ^ \
+            crc_table[5][(c >> 16) & 0xff] ^ crc_table[4][c >> 24] ^ \
+            crc_table[3][buf[4]] ^ crc_table[2][buf[5]] ^ \
+            crc_table[1][buf[6]] ^ crc_table[0][buf[7]]; \
+        buf += 8
 
 /* ========================================================================= */
-local unsigned long ZEXPORT crc32_z(crc, buf, len)
-    unsigned long crc;
+/* Slicing-by-8 on the (inverted) crc register c; the words are assembled a
+   byte at a time, so this works for either byte order and any alignment */
+local z_crc_t crc32_slice8(c, buf, len)
+    z_crc_t c;
     const unsigned char FAR *buf;
     z_size_t len;
 {
-    if (buf == Z_NULL) return 0UL;
-
 #ifdef DYNAMIC_CRC_TABLE
     if (crc_table_empty)
         make_crc_table();
 #endif /* DYNAMIC_CRC_TABLE */
 
-#ifdef BYFOUR
-    if (sizeof(void *) == sizeof(ptrdiff_t)) {
-        z_crc_t endian;
-
-        endian = 1;
-        if (*((unsigned char *)(&endian)))
-            return crc32_little(crc, buf, len);
-        else
-            return crc32_big(crc, buf, len);
-    }
-#endif /* BYFOUR */
-    crc = crc ^ 0xffffffffUL;
     while (len >= 8) {
         DO8;
         len -= 8;
@@ -290,112 +279,148 @@ local unsigned long ZEXPORT crc32_z(crc, buf, len)
     if (len) do {
         DO1;
     } while (--len);
-    return crc ^ 0xffffffffUL;
+    return c;
 }
 
-/* ========================================================================= */
-unsigned int ZEXPORT NC_crc32(unsigned int crc, const unsigned char* buf, unsigned int len)
+#ifdef NC_HAVE_PCLMUL
+/* -1 => not yet known */
+local int have_pclmul = -1;
+
+local void cpuinit(void)
 {
-    unsigned long value = (unsigned long)crc;
-    value = crc32_z(value, buf, len);
-    return (unsigned int)(value & 0xFFFFFFFF); /* in case |long| is 64 bits */
+    __builtin_cpu_init();
+    have_pclmul = (__builtin_cpu_supports("pclmul")
+                   && __builtin_cpu_supports("sse4.1")) ? 1 : 0;
 }
 
-#ifdef BYFOUR
-
+/* ========================================================================= */
 /*
-   This BYFOUR code accesses the passed unsigned char * buffer with a 32-bit
-   integer pointer type. This violates the strict aliasing rule, where a
-   compiler can assume, for optimization purposes, that two pointers to
-   fundamentally different types won't ever point to the same memory. This can
-   manifest as a problem only if one of the pointers is written to. This code
-   only reads from those pointers. So long as this code remains isolated in
-   this compilation unit, there won't be a problem. For this reason, this code
-   should not be copied and pasted into a compilation unit in which other code
-   writes to the buffer that is passed to these routines.
+  Fold len bytes, a multiple of 16 and at least 64, into the (inverted) crc
+  register c. The constants are x^(4*128+32), x^(4*128-32), x^(128+32),
+  x^(128-32) and x^64 mod P, and the Barrett constants floor(x^64/P) and P,
+  all bit reflected, from the paper cited at the top of this file.
  */
-
-/* ========================================================================= */
-#define DOLIT4 c ^= *buf4++; \
-        c = crc_table[3][c & 0xff] ^ crc_table[2][(c >> 8) & 0xff] ^ \
-            crc_table[1][(c >> 16) & 0xff] ^ crc_table[0][c >> 24]
-#define DOLIT32 DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4
-
-/* ========================================================================= */
-local unsigned long crc32_little(crc, buf, len)
-    unsigned long crc;
+NC_PCLMUL local z_crc_t crc32_pclmul(c, buf, len)
+    z_crc_t c;
     const unsigned char FAR *buf;
     z_size_t len;
 {
-    register z_crc_t c;
-    register const z_crc_t FAR *buf4;
-
-    c = (z_crc_t)crc;
-    c = ~c;
-    while (len && ((ptrdiff_t)buf & 3)) {
-        c = crc_table[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
-        len--;
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x1, x2, x3, x4, t1, t2, t3, t4;
+
+    /* Four lanes of 16 bytes, the crc going into the first */
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)c));
+    buf += 64;
+    len -= 64;
+
+    /* Fold each lane forward over the next 64 bytes */
+    while (len >= 64) {
+        t1 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        t2 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        t3 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        t4 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, t1),
+                           _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, t2),
+                           _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, t3),
+                           _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, t4),
+                           _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+        buf += 64;
+        len -= 64;
     }
 
-    buf4 = (const z_crc_t FAR *)(const void FAR *)buf;
-    while (len >= 32) {
-        DOLIT32;
-        len -= 32;
+    /* Fold the four lanes into one */
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), t1);
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), t1);
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), t1);
+
+    /* Then fold in any remaining 16 byte blocks */
+    while (len >= 16) {
+        t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, t1),
+                           _mm_loadu_si128((const __m128i *)buf));
+        buf += 16;
+        len -= 16;
     }
-    while (len >= 4) {
-        DOLIT4;
-        len -= 4;
-    }
-    buf = (const unsigned char FAR *)buf4;
 
-    if (len) do {
-        c = crc_table[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
-    } while (--len);
-    c = ~c;
-    return (unsigned long)c;
+    /* Reduce 128 bits to 64 */
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t1);
+    t1 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, t1);
+
+    /* Barrett reduction to 32 bits */
+    t1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+    t1 = _mm_clmulepi64_si128(_mm_and_si128(t1, mask32), poly, 0x00);
+    x1 = _mm_xor_si128(x1, t1);
+    return (z_crc_t)_mm_extract_epi32(x1, 1);
 }
+#endif /* NC_HAVE_PCLMUL */
 
 /* ========================================================================= */
-#define DOBIG4 c ^= *buf4++; \
-        c = crc_table[4][c & 0xff] ^ crc_table[5][(c >> 8) & 0xff] ^ \
-            crc_table[6][(c >> 16) & 0xff] ^ crc_table[7][c >> 24]
-#define DOBIG32 DOBIG4; DOBIG4; DOBIG4; DOBIG4; DOBIG4; DOBIG4; DOBIG4; DOBIG4
-
-/* ========================================================================= */
-local unsigned long crc32_big(crc, buf, len)
+local unsigned long ZEXPORT crc32_z(crc, buf, len)
     unsigned long crc;
     const unsigned char FAR *buf;
     z_size_t len;
 {
-    register z_crc_t c;
-    register const z_crc_t FAR *buf4;
-
-    c = ZSWAP32((z_crc_t)crc);
-    c = ~c;
-    while (len && ((ptrdiff_t)buf & 3)) {
-        c = crc_table[4][(c >> 24) ^ *buf++] ^ (c << 8);
-        len--;
-    }
+    z_crc_t c;
 
-    buf4 = (const z_crc_t FAR *)(const void FAR *)buf;
-    while (len >= 32) {
-        DOBIG32;
-        len -= 32;
-    }
-    while (len >= 4) {
-        DOBIG4;
-        len -= 4;
+    if (buf == Z_NULL) return 0UL;
+
+    c = (z_crc_t)crc ^ 0xffffffffU;
+#ifdef NC_HAVE_PCLMUL
+    if (len >= 64) {
+        if (have_pclmul < 0) cpuinit();
+        if (have_pclmul) {
+            z_size_t n = len & ~(z_size_t)15;
+            c = crc32_pclmul(c, buf, n);
+            buf += n;
+            len -= n;
+        }
     }
-    buf = (const unsigned char FAR *)buf4;
+#endif /* NC_HAVE_PCLMUL */
+    c = crc32_slice8(c, buf, len);
+    return (unsigned long)(c ^ 0xffffffffU);
+}
 
-    if (len) do {
-        c = crc_table[4][(c >> 24) ^ *buf++] ^ (c << 8);
-    } while (--len);
-    c = ~c;
-    return (unsigned long)(ZSWAP32(c));
+/* ========================================================================= */
+unsigned int ZEXPORT NC_crc32(unsigned int crc, const void* buf, size_t len)
+{
+    unsigned long value = (unsigned long)crc;
+    value = crc32_z(value, (const unsigned char*)buf, len);
+    return (unsigned int)(value & 0xFFFFFFFF); /* in case |long| is 64 bits */
 }
 
-#endif /* BYFOUR */
+/* ========================================================================= */
+unsigned int ZEXPORT NC_crc32_portable(unsigned int crc, const void* buf, size_t len)
+{
+    z_crc_t c = (z_crc_t)crc ^ 0xffffffffU;
+    if (buf == Z_NULL) return 0U;
+    c = crc32_slice8(c, (const unsigned char*)buf, len);
+    return (unsigned int)(c ^ 0xffffffffU);
+}
 
 #define GF2_DIM 32      /* dimension of GF(2) vectors (length of CRC) */
 
@@ -31,6 +31,7 @@ See COPYRIGHT for license information.
 /* Define the curl flag defaults in envv style */
 static const char* AUTHDEFAULTS[] = {
 "HTTP.TIMEOUT","1800", /*seconds */ /* Long but not infinite */
+"HTTP.DEFLATE","1", /* ask for compressed responses; 0 turns it off */
 NULL
 };
 
@@ -202,7 +203,7 @@ setauthfield(NCauth* auth, const char* flag, const char* value)
     int ret = NC_NOERR;
     if(value == NULL) goto done;
     if(strcmp(flag,"HTTP.DEFLATE")==0) {
-        if(atoi(value)) auth->curlflags.compress = 1;
+        auth->curlflags.compress = (atoi(value) ? 1 : 0);
 #ifdef D4DEBUG
         nclog(NCLOGNOTE,"HTTP.DEFLATE: %ld", infoflags.compress);
 #endif
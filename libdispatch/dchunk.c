@@ -0,0 +1,369 @@
+/*
+ * Copyright 2019, University Corporation for Atmospheric Research
+ * See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ */
+/**
+ * @file
+ * Chunking utilities: access intents and the chunk-shape optimizer.
+ *
+ * The optimizer follows the approach described by Russ Rew in
+ * "Chunking Data: Choosing Shapes": given a target number of values
+ * per chunk, the leading ("time") dimension and the remaining
+ * ("spatial") dimensions are sized so that the number of chunks that
+ * must be read for the declared access pattern is minimized. For the
+ * balanced intent, the number of chunks touched by reading one
+ * full map equals the number touched by reading one full time series.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "ncdispatch.h"
+#include "netcdf_chunk.h"
+
+/**************************************************/
+/* Chunk shape computation */
+
+/**
+Compute a chunk shape for the given access intent.
+
+@param intent One of the NC_CHUNK_INTENT_XXX constants (other than
+NC_CHUNK_INTENT_DEFAULT).
+@param typesize Size in bytes of one value.
+@param chunkbytes Target size in bytes of one chunk.
+@param ndims Rank of the variable.
+@param dimlens Current length of each dimension.
+@param unlimited If non-NULL, non-zero entries mark unlimited dimensions.
+@param chunksizes Store the computed chunk sizes here.
+@return NC_NOERR if the shape was computed; NC_EINVAL otherwise.
+*/
+int
+NC_compute_chunk_shape(int intent, size_t typesize, size_t chunkbytes,
+                       int ndims, const size_t* dimlens, const int* unlimited,
+                       size_t* chunksizes)
+{
+    int d;
+    double nvalues; /* target number of values per chunk */
+    double tlen;    /* (effective) length of the leading dimension */
+    double slen;    /* number of values in one full map */
+    double tchunk;  /* chunk length along the leading dimension */
+    double budget;  /* values left for the spatial dimensions */
+    double scale;   /* fraction of each spatial dimension per chunk */
+
+    if(ndims <= 0 || dimlens == NULL || chunksizes == NULL)
+	return NC_EINVAL;
+    if(intent <= NC_CHUNK_INTENT_DEFAULT || intent > NC_CHUNK_INTENT_MAX)
+	return NC_EINVAL;
+    if(typesize == 0) typesize = 1;
+
+    nvalues = (double)chunkbytes / (double)typesize;
+    if(nvalues < 1) nvalues = 1;
+
+    /* An unlimited leading dimension may still be empty; pretend it
+       has some reasonable extent. */
+    tlen = (double)dimlens[0];
+    if(unlimited != NULL && unlimited[0] && tlen < NC_CHUNK_UNLIM_EXTENT)
+	tlen = NC_CHUNK_UNLIM_EXTENT;
+    if(tlen < 1) tlen = 1;
+
+    if(ndims == 1) {
+	/* No map to speak of: one chunk should hold as much of the
+           series as possible. */
+	tchunk = (nvalues < tlen ? nvalues : tlen);
+	chunksizes[0] = (size_t)tchunk;
+	if(chunksizes[0] == 0) chunksizes[0] = 1;
+	return NC_NOERR;
+    }
+
+    slen = 1;
+    for(d = 1; d < ndims; d++)
+	slen *= (dimlens[d] > 0 ? (double)dimlens[d] : 1.0);
+
+    switch (intent) {
+    case NC_CHUNK_INTENT_SPATIAL:
+	/* A map read should touch as few chunks as possible, and should
+           not drag in other time steps. */
+	tchunk = 1;
+	break;
+    case NC_CHUNK_INTENT_TIMESERIES:
+	/* A time series read should touch as few chunks as possible. */
+	tchunk = (nvalues < tlen ? nvalues : tlen);
+	break;
+    case NC_CHUNK_INTENT_BALANCED:
+    default:
+	/* With tchunk*scale^(n-1)*slen == nvalues, a series read touches
+           tlen/tchunk chunks and a map read touches 1/scale^(n-1) chunks;
+           equating the two gives tchunk = sqrt(nvalues*tlen/slen). */
+	tchunk = sqrt(nvalues * tlen / slen);
+	break;
+    }
+    if(tchunk > tlen) tchunk = tlen;
+    if(tchunk < 1) tchunk = 1;
+    chunksizes[0] = (size_t)floor(tchunk);
+
+    /* Spread the remaining budget evenly (in relative terms) over the
+       spatial dimensions. */
+    budget = nvalues / (double)chunksizes[0];
+    scale = budget / slen;
+    if(scale > 1) scale = 1;
+    scale = pow(scale, 1.0 / (double)(ndims - 1));
+    for(d = 1; d < ndims; d++) {
+	double len = (dimlens[d] > 0 ? (double)dimlens[d] : 1.0);
+	double c = floor(len * scale);
+	if(c < 1) c = 1;
+	if(c > len) c = len;
+	chunksizes[d] = (size_t)c;
+    }
+    return NC_NOERR;
+}
+
+/**************************************************/
+/* Access intent API */
+
+/**
+\ingroup variables
+Declare how a variable will mostly be read, so that a suitable
+default chunk shape can be chosen for it.
+
+When a variable is defined, its default chunk sizes are computed from
+its access intent, which is inherited from the file-wide setting
+(see below). A variable with an intent other than
+::NC_CHUNK_INTENT_DEFAULT uses chunked storage. Calling this function
+on an existing variable recomputes its default chunk sizes, replacing
+any sizes set earlier with nc_def_var_chunking(). Chunk sizes set with
+nc_def_var_chunking() after this call take precedence.
+
+The leading dimension of the variable is taken to be its "time"
+dimension; the others are its "spatial" dimensions.
+
+@param ncid NetCDF or group ID.
+@param varid Variable ID, or NC_GLOBAL to set the intent used for all
+variables subsequently defined in the file.
+@param intent One of ::NC_CHUNK_INTENT_DEFAULT,
+::NC_CHUNK_INTENT_BALANCED, ::NC_CHUNK_INTENT_SPATIAL or
+::NC_CHUNK_INTENT_TIMESERIES.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ID.
+@return ::NC_ENOTNC4 Not a netCDF-4 file.
+@return ::NC_ENOTVAR Invalid variable ID.
+@return ::NC_EINVAL Unknown intent.
+@return ::NC_ELATEDEF Variable has already been created in the file.
+@return ::NC_EPERM File is read only.
+*/
+int
+nc_def_var_chunk_intent(int ncid, int varid, int intent)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    if(intent < NC_CHUNK_INTENT_DEFAULT || intent > NC_CHUNK_INTENT_MAX)
+	return NC_EINVAL;
+    return ncp->dispatch->def_var_chunk_intent(ncid,varid,intent);
+}
+
+/**
+\ingroup variables
+Learn the access intent of a variable, or the file-wide default if
+varid is NC_GLOBAL.
+
+The intent is not stored in the file; variables of an opened file
+report ::NC_CHUNK_INTENT_DEFAULT unless it has been changed.
+
+@param ncid NetCDF or group ID.
+@param varid Variable ID, or NC_GLOBAL.
+@param intentp Pointer that gets the intent. \ref ignored_if_null.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ID.
+@return ::NC_ENOTNC4 Not a netCDF-4 file.
+@return ::NC_ENOTVAR Invalid variable ID.
+*/
+int
+nc_inq_var_chunk_intent(int ncid, int varid, int* intentp)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    return ncp->dispatch->inq_var_chunk_intent(ncid,varid,intentp);
+}
+
+/**************************************************/
+/* Direct chunk I/O */
+
+/* Number of threads used by the direct chunk read path; 0 disables it. */
+static int NC_chunk_threads = 0;
+
+/**
+\ingroup variables
+Set the number of threads used to decode chunks when reading netCDF-4
+variables.
+
+When this is non-zero, reads that cover whole chunks of a chunked
+variable (with unit stride, and no type conversion) bypass the HDF5
+filter pipeline: the library fetches the stored chunks directly and
+undoes the shuffle and deflate filters itself, spreading the work over
+up to nthreads threads. Variables using any other filter are read
+through HDF5 as usual.
+
+@param nthreads Number of threads; 0 (the default) turns the direct
+path off, 1 uses it without extra threads.
+
+@return ::NC_NOERR No error.
+@return ::NC_EINVAL nthreads is negative.
+*/
+int
+nc_set_chunk_threads(int nthreads)
+{
+    if(nthreads < 0) return NC_EINVAL;
+    NC_chunk_threads = nthreads;
+    return NC_NOERR;
+}
+
+/**
+\ingroup variables
+Get the number of threads used to decode chunks.
+
+@param nthreadsp Pointer that gets the thread count. \ref ignored_if_null.
+
+@return ::NC_NOERR No error.
+*/
+int
+nc_get_chunk_threads(int* nthreadsp)
+{
+    if(nthreadsp) *nthreadsp = NC_chunk_threads;
+    return NC_NOERR;
+}
+
+/**
+\ingroup variables
+Read one chunk of a variable as it is stored in the file, without
+passing it through the filter pipeline.
+
+@param ncid NetCDF or group ID.
+@param varid Variable ID.
+@param offset Index of the first element of the chunk; each entry must
+be a multiple of the chunk size along that dimension.
+@param filtermaskp Pointer that gets the filter mask of the chunk: bit i
+is set if filter i of the variable was skipped when the chunk was
+written. \ref ignored_if_null.
+@param nbytesp Pointer that gets the stored size of the chunk in
+bytes; 0 if the chunk has never been written. \ref ignored_if_null.
+@param data Buffer that gets the stored bytes; it must be large enough
+to hold them. If NULL, only the size and filter mask are returned.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ID.
+@return ::NC_ENOTNC4 Not a netCDF-4 file.
+@return ::NC_ENOTVAR Invalid variable ID.
+@return ::NC_EINVAL Variable is not chunked, or offset is not at the
+start of a chunk.
+@return ::NC_EINVALCOORDS Offset is out of bounds.
+@return ::NC_ENOTBUILT The HDF5 library lacks direct chunk I/O.
+*/
+int
+nc_read_chunk(int ncid, int varid, const size_t* offset,
+              unsigned int* filtermaskp, size_t* nbytesp, void* data)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    if(offset == NULL) return NC_EINVAL;
+    return ncp->dispatch->read_chunk(ncid,varid,offset,filtermaskp,nbytesp,data);
+}
+
+/**
+\ingroup variables
+Write one chunk of a variable, bypassing the filter pipeline. The
+bytes must already have been filtered as the variable's filters (minus
+those flagged in filtermask) would have done.
+
+If the chunk lies beyond the current length of an unlimited dimension,
+the dimension is extended to cover the whole chunk.
+
+@param ncid NetCDF or group ID.
+@param varid Variable ID.
+@param offset Index of the first element of the chunk; each entry must
+be a multiple of the chunk size along that dimension.
+@param filtermask Bit i is set if filter i of the variable was not
+applied to the data.
+@param nbytes Size of data in bytes.
+@param data The stored form of the chunk.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ID.
+@return ::NC_ENOTNC4 Not a netCDF-4 file.
+@return ::NC_ENOTVAR Invalid variable ID.
+@return ::NC_EPERM File is read only.
+@return ::NC_EINVAL Variable is not chunked, or offset is not at the
+start of a chunk.
+@return ::NC_EINVALCOORDS Offset is out of bounds.
+@return ::NC_ENOTBUILT The HDF5 library lacks direct chunk I/O.
+*/
+int
+nc_write_chunk(int ncid, int varid, const size_t* offset,
+               unsigned int filtermask, size_t nbytes, const void* data)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    if(offset == NULL || data == NULL || nbytes == 0) return NC_EINVAL;
+    return ncp->dispatch->write_chunk(ncid,varid,offset,filtermask,nbytes,data);
+}
+
+/**
+\ingroup variables
+List the chunks of a variable that have storage in the file.
+
+Chunks that have never been written are not listed. For each chunk
+that is, the index of its first element, its byte address in the file,
+its stored (i.e. filtered) size and its filter mask are returned, in
+the order of the file's chunk index. Together with nc_read_chunk() this
+is enough to plan I/O, estimate compression ratios, or read chunks
+with an external byte-range reader.
+
+The arrays have room for maxchunks chunks; call this function once
+with them all NULL to get the number of chunks. If chunks are written
+in between, so that there are now more than maxchunks, nothing is
+stored in the arrays, NC_EINVAL is returned and *nchunksp gets the new
+number of chunks.
+
+@param ncid NetCDF or group ID.
+@param varid Variable ID.
+@param maxchunks Number of chunks the arrays have room for. Ignored
+if all of them are NULL.
+@param nchunksp Pointer that gets the number of allocated chunks.
+\ref ignored_if_null.
+@param offsets Gets ndims chunk offsets per chunk. \ref ignored_if_null.
+@param addrs Gets the file address of each chunk. \ref ignored_if_null.
+@param nbytes Gets the stored size of each chunk. \ref ignored_if_null.
+@param filtermasks Gets the filter mask of each chunk; bit i is set if
+filter i was skipped. \ref ignored_if_null.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ID.
+@return ::NC_ENOTNC4 Not a netCDF-4 file.
+@return ::NC_ENOTVAR Invalid variable ID.
+@return ::NC_EINVAL Variable is not chunked, or it has more than
+maxchunks chunks.
+@return ::NC_ENOTBUILT The HDF5 library lacks chunk queries.
+*/
+int
+nc_inq_var_chunk_info(int ncid, int varid, size_t maxchunks, size_t* nchunksp,
+                      size_t* offsets, unsigned long long* addrs,
+                      size_t* nbytes, unsigned int* filtermasks)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    return ncp->dispatch->inq_var_chunk_info(ncid,varid,maxchunks,nchunksp,
+					     offsets,addrs,nbytes,filtermasks);
+}
@@ -0,0 +1,188 @@
+/*********************************************************************
+ *   Copyright 2019, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+/**
+ * @file
+ * A process wide pool of curl handles, used by the DAP2 (oc2) and DAP4
+ * readers and by byte-range access.
+ *
+ * Every open used to create its own curl handle and throw it away at
+ * close, and with it the connection, the resolved address and the TLS
+ * session; opening many urls on one server paid for a TCP (and TLS)
+ * handshake each time. Handles from this pool are attached to a single
+ * curl share object holding the DNS cache, the TLS session cache and,
+ * with libcurl 7.57 or later, the connection cache, and released
+ * handles are kept (after curl_easy_reset) for the next open.
+ *
+ * The library is not thread safe, but the DAP2 read ahead performs a
+ * request on a background thread with a handle from
+ * NC_curl_duplicate(), which is attached to the same share, so the
+ * share is guarded by mutexes when pthreads are available.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#if defined(ENABLE_BYTERANGE) || defined(ENABLE_DAP) || defined(ENABLE_DAP4)
+
+#include "nccurlpool.h"
+
+/* Connection sharing appeared in libcurl 7.57.0 */
+#if LIBCURL_VERSION_NUM >= 0x073900
+#define SHARECONNECTIONS 1
+#endif
+
+static CURLSH* share = NULL;
+static int sharefailed = 0; /* curl_share_init failed; do without */
+static CURL* idle[NC_CURL_POOLMAX];
+static size_t nidle = 0;
+static size_t created = 0;
+static size_t reused = 0;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t poollock = PTHREAD_MUTEX_INITIALIZER;
+/* One lock per kind of shared data */
+static pthread_mutex_t sharelocks[CURL_LOCK_DATA_LAST];
+#define LOCKPOOL() pthread_mutex_lock(&poollock)
+#define UNLOCKPOOL() pthread_mutex_unlock(&poollock)
+
+static void
+sharelock(CURL* curl, curl_lock_data data, curl_lock_access access, void* userptr)
+{
+    (void)curl; (void)access; (void)userptr;
+    if((int)data >= 0 && data < CURL_LOCK_DATA_LAST)
+        pthread_mutex_lock(&sharelocks[data]);
+}
+
+static void
+shareunlock(CURL* curl, curl_lock_data data, void* userptr)
+{
+    (void)curl; (void)userptr;
+    if((int)data >= 0 && data < CURL_LOCK_DATA_LAST)
+        pthread_mutex_unlock(&sharelocks[data]);
+}
+#else
+#define LOCKPOOL()
+#define UNLOCKPOOL()
+#endif
+
+/* Create the share object; called with the pool locked */
+static void
+shareinit(void)
+{
+    CURLSH* sh;
+    if(share != NULL || sharefailed) return;
+    if((sh = curl_share_init()) == NULL) {sharefailed = 1; return;}
+#ifdef HAVE_PTHREAD_H
+    {
+        int i;
+        for(i=0;i<CURL_LOCK_DATA_LAST;i++)
+            pthread_mutex_init(&sharelocks[i],NULL);
+    }
+    curl_share_setopt(sh,CURLSHOPT_LOCKFUNC,sharelock);
+    curl_share_setopt(sh,CURLSHOPT_UNLOCKFUNC,shareunlock);
+#endif
+    curl_share_setopt(sh,CURLSHOPT_SHARE,CURL_LOCK_DATA_DNS);
+    curl_share_setopt(sh,CURLSHOPT_SHARE,CURL_LOCK_DATA_SSL_SESSION);
+#ifdef SHARECONNECTIONS
+    curl_share_setopt(sh,CURLSHOPT_SHARE,CURL_LOCK_DATA_CONNECT);
+#endif
+    share = sh;
+}
+
+CURL*
+NC_curl_acquire(void)
+{
+    CURL* curl = NULL;
+    CURLSH* sh;
+
+    LOCKPOOL();
+    shareinit();
+    sh = share;
+    if(nidle > 0) {
+        curl = idle[--nidle];
+        reused++;
+    }
+    UNLOCKPOOL();
+    if(curl == NULL) {
+        if((curl = curl_easy_init()) == NULL) return NULL;
+        LOCKPOOL();
+        created++;
+        UNLOCKPOOL();
+    }
+    /* curl_easy_reset (and curl_easy_duphandle) drop the share */
+    if(sh != NULL)
+        (void)curl_easy_setopt(curl,CURLOPT_SHARE,sh);
+    return curl;
+}
+
+CURL*
+NC_curl_duplicate(CURL* curl)
+{
+    CURL* dup;
+    CURLSH* sh;
+
+    if(curl == NULL || (dup = curl_easy_duphandle(curl)) == NULL)
+        return NULL;
+    LOCKPOOL();
+    sh = share;
+    created++;
+    UNLOCKPOOL();
+    if(sh != NULL)
+        (void)curl_easy_setopt(dup,CURLOPT_SHARE,sh);
+    return dup;
+}
+
+void
+NC_curl_release(CURL* curl)
+{
+    if(curl == NULL) return;
+    /* Forget every option, including pointers into the caller's
+       memory such as CURLOPT_ERRORBUFFER */
+    curl_easy_reset(curl);
+    LOCKPOOL();
+    if(nidle < NC_CURL_POOLMAX) {
+        idle[nidle++] = curl;
+        curl = NULL;
+    }
+    UNLOCKPOOL();
+    if(curl != NULL)
+        curl_easy_cleanup(curl);
+}
+
+void
+NC_curl_poolstats(size_t* createdp, size_t* reusedp)
+{
+    LOCKPOOL();
+    if(createdp) *createdp = created;
+    if(reusedp) *reusedp = reused;
+    UNLOCKPOOL();
+}
+
+void
+NC_curl_poolfinalize(void)
+{
+    LOCKPOOL();
+    while(nidle > 0)
+        curl_easy_cleanup(idle[--nidle]);
+    /* This fails if some handle still uses the share; leave it then */
+    if(share != NULL && curl_share_cleanup(share) == CURLSHE_OK) {
+        share = NULL;
+#ifdef HAVE_PTHREAD_H
+        {
+            int i;
+            for(i=0;i<CURL_LOCK_DATA_LAST;i++)
+                pthread_mutex_destroy(&sharelocks[i]);
+        }
+#endif
+    }
+    sharefailed = 0;
+    UNLOCKPOOL();
+}
+
+#endif /*ENABLE_BYTERANGE || ENABLE_DAP || ENABLE_DAP4*/
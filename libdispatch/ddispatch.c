@@ -24,6 +24,7 @@ See LICENSE.txt for license information.
 
 #if defined(ENABLE_BYTERANGE) || defined(ENABLE_DAP) || defined(ENABLE_DAP4)
 #include <curl/curl.h>
+#include "nccurlpool.h"
 #endif
 
 /* Define vectors of zeros and ones for use with various nc_get_varX functions */
@@ -137,6 +138,7 @@ NCDISPATCH_finalize(void)
     int status = NC_NOERR;
     ncrc_freeglobalstate();
 #if defined(ENABLE_BYTERANGE) || defined(ENABLE_DAP) || defined(ENABLE_DAP4)
+    NC_curl_poolfinalize();
     curl_global_cleanup();
 #endif
     return status;
@@ -13,7 +13,11 @@
 
 #include "netcdf.h"
 #include "netcdf_filter.h"
+#include "ncdispatch.h"
 
+#ifdef USE_HDF4
+#include "nc4internal.h"
+#endif
 #ifdef USE_HDF5
 #include "hdf5internal.h"
 #endif
@@ -325,3 +329,62 @@ nc_filter_inq(int fformat, int id, NC_FILTER_INFO* filter_info)
     }
     return stat;
 }
+
+/**************************************************/
+/* Filter chains */
+
+/**
+Learn the filter chain of a variable.
+
+Filters are listed in the order they are applied when the data is
+written; reading applies them in reverse. Shuffle always runs first
+and fletcher32 last, so they are not listed (see nc_inq_var_deflate()
+and nc_inq_var_fletcher32()); deflate is, since filters may be chained
+before or after it.
+
+@param ncid NetCDF or group ID.
+@param varid Variable ID.
+@param nfiltersp Store the number of filters here. Ignored if NULL.
+@param filterids Store the filter IDs here; the caller must allocate
+room for all of them. Ignored if NULL.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ncid.
+@return ::NC_ENOTVAR Invalid variable ID.
+@return ::NC_ENOTNC4 Not a netCDF-4 file.
+*/
+EXTERNL int
+nc_inq_var_filter_ids(int ncid, int varid, size_t* nfiltersp, unsigned int* filterids)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    return ncp->dispatch->inq_var_filter_ids(ncid,varid,nfiltersp,filterids);
+}
+
+/**
+Learn the parameters of one filter in the filter chain of a variable.
+
+@param ncid NetCDF or group ID.
+@param varid Variable ID.
+@param id Filter ID.
+@param nparamsp Store the number of parameters here. Ignored if NULL.
+@param params Store the parameters here; the caller must allocate
+room for all of them. Ignored if NULL.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ncid.
+@return ::NC_ENOTVAR Invalid variable ID.
+@return ::NC_EFILTER The variable does not use this filter.
+@return ::NC_ENOTNC4 Not a netCDF-4 file.
+*/
+EXTERNL int
+nc_inq_var_filter_info(int ncid, int varid, unsigned int id, size_t* nparamsp, unsigned int* params)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    return ncp->dispatch->inq_var_filter_info(ncid,varid,id,nparamsp,params);
+}
@@ -23,6 +23,7 @@
 #include "ncbytes.h"
 #include "nclist.h"
 #include "nchttp.h"
+#include "nccurlpool.h"
 
 #undef TRACE
 
@@ -74,8 +75,8 @@ nc_http_open(const char* objecturl, void** curlp, long long* filelenp)
 
     Trace("open");
 
-    /* initialize curl*/
-    curl = curl_easy_init();
+    /* get a curl handle from the shared pool */
+    curl = NC_curl_acquire();
     if (curl == NULL) stat = NC_ECURL;
     if(curlp && curl) *curlp = (void*)curl;
     if(filelenp) {
@@ -115,8 +116,7 @@ nc_http_close(void* curl0)
 
     Trace("close");
 
-    if(curl != NULL)
-	(void)curl_easy_cleanup(curl);
+    NC_curl_release(curl);
 dbgflush();
     return stat;
 }
@@ -263,6 +263,9 @@ setupconn(CURL* curl, const char* objecturl, NCbytes* buf)
     if (cstat != CURLE_OK) goto fail;
     cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1));
     if (cstat != CURLE_OK) goto fail;
+    /* No CURLOPT_ENCODING, unlike the DAP readers: a Range addresses
+       the encoded representation, so a compressed reply would not be
+       the bytes [start,start+count) of the file. */
 
     if(buf != NULL) {
 	/* send all data to this function  */
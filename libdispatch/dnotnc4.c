@@ -610,3 +610,161 @@ NC_NOTNC4_inq_typeid(int ncid, const char *name, nc_type *typeidp)
 {
     return NC_ENOTNC4;
 }
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param intent Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_def_var_chunk_intent(int ncid, int varid, int intent)
+{
+    return NC_ENOTNC4;
+}
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param intentp Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_inq_var_chunk_intent(int ncid, int varid, int *intentp)
+{
+    return NC_ENOTNC4;
+}
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param offset Ignored.
+ * @param filtermaskp Ignored.
+ * @param nbytesp Ignored.
+ * @param data Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_read_chunk(int ncid, int varid, const size_t *offset,
+                     unsigned int *filtermaskp, size_t *nbytesp, void *data)
+{
+    return NC_ENOTNC4;
+}
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param offset Ignored.
+ * @param filtermask Ignored.
+ * @param nbytes Ignored.
+ * @param data Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_write_chunk(int ncid, int varid, const size_t *offset,
+                      unsigned int filtermask, size_t nbytes, const void *data)
+{
+    return NC_ENOTNC4;
+}
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param maxchunks Ignored.
+ * @param nchunksp Ignored.
+ * @param offsets Ignored.
+ * @param addrs Ignored.
+ * @param nbytes Ignored.
+ * @param filtermasks Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_inq_var_chunk_info(int ncid, int varid, size_t maxchunks,
+                             size_t *nchunksp, size_t *offsets,
+                             unsigned long long *addrs, size_t *nbytes,
+                             unsigned int *filtermasks)
+{
+    return NC_ENOTNC4;
+}
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param nfiltersp Ignored.
+ * @param filterids Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_inq_var_filter_ids(int ncid, int varid, size_t *nfiltersp,
+                             unsigned int *filterids)
+{
+    return NC_ENOTNC4;
+}
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param id Ignored.
+ * @param nparamsp Ignored.
+ * @param params Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_inq_var_filter_info(int ncid, int varid, unsigned int id,
+                              size_t *nparamsp, unsigned int *params)
+{
+    return NC_ENOTNC4;
+}
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param quantize_mode Ignored.
+ * @param nsd Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_def_var_quantize(int ncid, int varid, int quantize_mode, int nsd)
+{
+    return NC_ENOTNC4;
+}
+
+/**
+ * @internal Not allowed for classic model.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param quantize_modep Ignored.
+ * @param nsdp Ignored.
+ *
+ * @return ::NC_ENOTNC4 Not allowed for classic model.
+ */
+int
+NC_NOTNC4_inq_var_quantize(int ncid, int varid, int *quantize_modep, int *nsdp)
+{
+    return NC_ENOTNC4;
+}
@@ -317,7 +317,10 @@ nc_inq_ncid().
 \returns ::NC_EBADID Invalid ncid passed.
 \returns ::NC_ENOTVAR Invalid varid passed.
 \returns ::NC_ENOPAR File was not opened with nc_open_par/nc_create_var.
-\returns ::NC_EINVAL Invalid par_access specified.
+\returns ::NC_EINVAL Invalid par_access specified, or NC_INDEPENDENT
+for a netCDF-4 variable with filters (deflate, shuffle, fletcher32 or
+nc_def_var_filter()) in a writable file, since HDF5 can only write
+filtered data collectively.
 
 <h1>Example</h1>
 
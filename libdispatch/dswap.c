@@ -0,0 +1,171 @@
+/*********************************************************************
+ *   Copyright 2019, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+/**
+ * @file
+ * Bulk byte swapping of arrays of 2, 4 and 8 byte values, shared by
+ * the classic format's external data conversions (libsrc/ncx.m4) and
+ * the DAP4 reader.
+ *
+ * On x86 the arrays are swapped 16 (SSSE3) or 32 (AVX2) bytes at a
+ * time with a byte shuffle; the kernels are compiled for those
+ * instruction sets individually and only called if the CPU has them,
+ * so the library as a whole does not require them.
+ */
+
+#include "config.h"
+#include <string.h>
+#include "ncswap.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (__GNUC__ >= 5 || defined(__clang__))
+#include <immintrin.h>
+#define NC_HAVE_SSSE3 1
+#define NC_HAVE_AVX2 1
+/* Compile one function for an instruction set; it is only called if
+   the CPU has it. */
+#define NC_SSSE3 __attribute__((target("ssse3")))
+#define NC_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef __GNUC__
+#define SWAP2(a) __builtin_bswap16(a)
+#define SWAP4(a) __builtin_bswap32(a)
+#define SWAP8(a) __builtin_bswap64(a)
+#else
+#define SWAP2(a) ((unsigned short)((((a) & 0xff) << 8) | (((a) >> 8) & 0xff)))
+#define SWAP4(a) ( ((a) << 24) | \
+                  (((a) <<  8) & 0x00ff0000) | \
+                  (((a) >>  8) & 0x0000ff00) | \
+                  (((a) >> 24) & 0x000000ff) )
+#define SWAP8(a) ( (((a) & 0x00000000000000FFULL) << 56) | \
+                   (((a) & 0x000000000000FF00ULL) << 40) | \
+                   (((a) & 0x0000000000FF0000ULL) << 24) | \
+                   (((a) & 0x00000000FF000000ULL) <<  8) | \
+                   (((a) & 0x000000FF00000000ULL) >>  8) | \
+                   (((a) & 0x0000FF0000000000ULL) >> 24) | \
+                   (((a) & 0x00FF000000000000ULL) >> 40) | \
+                   (((a) & 0xFF00000000000000ULL) >> 56) )
+#endif
+
+/* Byte order within each 16 bytes after swapping elements of size 2,
+   4 and 8 (index 1, 2, 3) */
+static const unsigned char swapmasks[4][16] = {
+{0},
+{1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14},
+{3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12},
+{7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8}
+};
+
+/* -1 => not yet known */
+static int have_ssse3 = -1;
+static int have_avx2 = -1;
+
+static void
+cpuinit(void)
+{
+#ifdef NC_HAVE_SSSE3
+    __builtin_cpu_init();
+    have_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    have_ssse3 = __builtin_cpu_supports("ssse3") ? 1 : 0;
+#else
+    have_avx2 = 0;
+    have_ssse3 = 0;
+#endif
+}
+
+#ifdef NC_HAVE_SSSE3
+/* Swap whole 16 byte blocks; return the number of bytes done */
+NC_SSSE3 static size_t
+swap_ssse3(unsigned char* dst, const unsigned char* src, size_t nbytes,
+           const unsigned char* mask, size_t done)
+{
+    __m128i m = _mm_loadu_si128((const __m128i*)mask);
+    for(;done + 16 <= nbytes;done += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src+done));
+        _mm_storeu_si128((__m128i*)(dst+done),_mm_shuffle_epi8(x,m));
+    }
+    return done;
+}
+#endif
+
+#ifdef NC_HAVE_AVX2
+/* Swap whole 64 byte blocks; the shuffle works within each 16 byte
+   lane, so the 16 byte mask is simply repeated */
+NC_AVX2 static size_t
+swap_avx2(unsigned char* dst, const unsigned char* src, size_t nbytes,
+          const unsigned char* mask)
+{
+    size_t done = 0;
+    __m128i m1 = _mm_loadu_si128((const __m128i*)mask);
+    __m256i m = _mm256_broadcastsi128_si256(m1);
+    for(;done + 64 <= nbytes;done += 64) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src+done));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(src+done+32));
+        _mm256_storeu_si256((__m256i*)(dst+done),_mm256_shuffle_epi8(x,m));
+        _mm256_storeu_si256((__m256i*)(dst+done+32),_mm256_shuffle_epi8(y,m));
+    }
+    return done;
+}
+#endif
+
+/* Swap with the vector kernels as far as they go; return the number
+   of bytes done */
+static size_t
+swapvector(unsigned char* dst, const unsigned char* src, size_t nbytes, int log2size)
+{
+    size_t done = 0;
+    if(have_ssse3 < 0) cpuinit();
+#ifdef NC_HAVE_AVX2
+    if(have_avx2)
+        done = swap_avx2(dst,src,nbytes,swapmasks[log2size]);
+#endif
+#ifdef NC_HAVE_SSSE3
+    if(have_ssse3)
+        done = swap_ssse3(dst,src,nbytes,swapmasks[log2size],done);
+#endif
+    return done;
+}
+
+void
+NC_swapn2(void* dst, const void* src, size_t n)
+{
+    unsigned char* op = (unsigned char*)dst;
+    const unsigned char* ip = (const unsigned char*)src;
+    size_t i = swapvector(op,ip,n*2,1);
+    for(;i<n*2;i+=2) {
+        unsigned short x;
+        memcpy(&x,ip+i,2);
+        x = SWAP2(x);
+        memcpy(op+i,&x,2);
+    }
+}
+
+void
+NC_swapn4(void* dst, const void* src, size_t n)
+{
+    unsigned char* op = (unsigned char*)dst;
+    const unsigned char* ip = (const unsigned char*)src;
+    size_t i = swapvector(op,ip,n*4,2);
+    for(;i<n*4;i+=4) {
+        unsigned int x;
+        memcpy(&x,ip+i,4);
+        x = SWAP4(x);
+        memcpy(op+i,&x,4);
+    }
+}
+
+void
+NC_swapn8(void* dst, const void* src, size_t n)
+{
+    unsigned char* op = (unsigned char*)dst;
+    const unsigned char* ip = (const unsigned char*)src;
+    size_t i = swapvector(op,ip,n*8,3);
+    for(;i<n*8;i+=8) {
+        unsigned long long x;
+        memcpy(&x,ip+i,8);
+        x = SWAP8(x);
+        memcpy(op+i,&x,8);
+    }
+}
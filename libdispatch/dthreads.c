@@ -0,0 +1,200 @@
+/*********************************************************************
+ *   Copyright 2019, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+/**
+ * @file
+ * A minimal fork-join task runner, and single background tasks.
+ *
+ * The library itself is not thread safe; this is only used internally
+ * to spread pure computation (such as decompressing chunks) over
+ * several cores. Task functions must not call back into the netCDF or
+ * HDF5 APIs, with one exception: nccopy -T reads a netCDF-3 file and
+ * writes a netCDF-4 one (or the reverse) in two tasks at once, which is
+ * safe only because the two share no library state but the locked list
+ * of open files; see copy_slabs_overlapped() in ncdump/nccopy.c.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "netcdf.h"
+#include "ncthreads.h"
+
+#ifdef HAVE_PTHREAD_H
+
+typedef struct NCtaskrun {
+    pthread_mutex_t lock;
+    size_t next;    /* next task to hand out */
+    size_t ntasks;
+    NCtaskfcn fcn;
+    void* state;
+    int stat;       /* error of lowest-numbered failing task */
+    size_t failed;  /* index of that task */
+} NCtaskrun;
+
+static void*
+worker(void* arg)
+{
+    NCtaskrun* run = (NCtaskrun*)arg;
+    for(;;) {
+	size_t task;
+	int stat;
+	pthread_mutex_lock(&run->lock);
+	/* Stop handing out work once something has gone wrong */
+	if(run->next >= run->ntasks || run->stat != NC_NOERR) {
+	    pthread_mutex_unlock(&run->lock);
+	    break;
+	}
+	task = run->next++;
+	pthread_mutex_unlock(&run->lock);
+	stat = run->fcn(run->state,task);
+	if(stat != NC_NOERR) {
+	    pthread_mutex_lock(&run->lock);
+	    if(run->stat == NC_NOERR || task < run->failed) {
+		run->stat = stat;
+		run->failed = task;
+	    }
+	    pthread_mutex_unlock(&run->lock);
+	}
+    }
+    return NULL;
+}
+
+int
+NC_run_tasks(int nthreads, size_t ntasks, NCtaskfcn fcn, void* state)
+{
+    NCtaskrun run;
+    pthread_t tids[NC_MAX_THREADS];
+    int i, started;
+
+    if(fcn == NULL) return NC_EINVAL;
+    if(ntasks == 0) return NC_NOERR;
+    if(nthreads > NC_MAX_THREADS) nthreads = NC_MAX_THREADS;
+    if((size_t)nthreads > ntasks) nthreads = (int)ntasks;
+    if(nthreads <= 1) {
+	size_t task;
+	int stat;
+	for(task=0;task<ntasks;task++)
+	    if((stat = fcn(state,task))) return stat;
+	return NC_NOERR;
+    }
+
+    run.next = 0;
+    run.ntasks = ntasks;
+    run.fcn = fcn;
+    run.state = state;
+    run.stat = NC_NOERR;
+    run.failed = 0;
+    if(pthread_mutex_init(&run.lock,NULL)) return NC_ENOMEM;
+
+    /* The calling thread does its share of the work too */
+    for(started=0,i=0;i<nthreads-1;i++) {
+	if(pthread_create(&tids[i],NULL,worker,&run)) break;
+	started++;
+    }
+    worker(&run);
+    for(i=0;i<started;i++)
+	pthread_join(tids[i],NULL);
+    pthread_mutex_destroy(&run.lock);
+    return run.stat;
+}
+
+int
+NC_threads_available(void)
+{
+    return 1;
+}
+
+struct NCbgtask {
+    pthread_t tid;
+    int started; /* 0 => ran in the calling thread */
+    NCtaskfcn fcn;
+    void* state;
+    int stat;
+};
+
+static void*
+bgworker(void* arg)
+{
+    NCbgtask* task = (NCbgtask*)arg;
+    task->stat = task->fcn(task->state,0);
+    return NULL;
+}
+
+int
+NC_start_task(NCtaskfcn fcn, void* state, NCbgtask** taskp)
+{
+    NCbgtask* task;
+    if(fcn == NULL || taskp == NULL) return NC_EINVAL;
+    if((task = (NCbgtask*)calloc(1,sizeof(NCbgtask))) == NULL) return NC_ENOMEM;
+    task->fcn = fcn;
+    task->state = state;
+    if(pthread_create(&task->tid,NULL,bgworker,task) == 0)
+	task->started = 1;
+    else
+	bgworker(task);
+    *taskp = task;
+    return NC_NOERR;
+}
+
+int
+NC_join_task(NCbgtask* task)
+{
+    int stat;
+    if(task == NULL) return NC_NOERR;
+    if(task->started)
+	pthread_join(task->tid,NULL);
+    stat = task->stat;
+    free(task);
+    return stat;
+}
+
+#else /*!HAVE_PTHREAD_H*/
+
+int
+NC_run_tasks(int nthreads, size_t ntasks, NCtaskfcn fcn, void* state)
+{
+    size_t task;
+    int stat;
+    if(fcn == NULL) return NC_EINVAL;
+    for(task=0;task<ntasks;task++)
+	if((stat = fcn(state,task))) return stat;
+    return NC_NOERR;
+}
+
+int
+NC_threads_available(void)
+{
+    return 0;
+}
+
+struct NCbgtask {
+    int stat;
+};
+
+int
+NC_start_task(NCtaskfcn fcn, void* state, NCbgtask** taskp)
+{
+    NCbgtask* task;
+    if(fcn == NULL || taskp == NULL) return NC_EINVAL;
+    if((task = (NCbgtask*)calloc(1,sizeof(NCbgtask))) == NULL) return NC_ENOMEM;
+    task->stat = fcn(state,0);
+    *taskp = task;
+    return NC_NOERR;
+}
+
+int
+NC_join_task(NCbgtask* task)
+{
+    int stat;
+    if(task == NULL) return NC_NOERR;
+    stat = task->stat;
+    free(task);
+    return stat;
+}
+
+#endif /*HAVE_PTHREAD_H*/
@@ -354,7 +354,13 @@ nc_def_var_fill(int ncid, int varid, int no_fill, const void *fill_value)
    @return ::NC_ENOMEM Out of memory.
    @return ::NC_EHDFERR Error returned by HDF5 layer.
    @return ::NC_EINVAL Invalid input. Deflate can't be set unless
-   variable storage is NC_CHUNK.
+   variable storage is NC_CHUNK, or, in a file opened for parallel
+   I/O, unless HDF5 is 1.10.2 or later.
+
+   In a file opened for parallel I/O, a variable with deflate or
+   shuffle is switched to collective access, which HDF5 needs to
+   write filtered data; nc_var_par_access() can't set it back to
+   independent.
 
    @section nc_def_var_deflate_example Example
 
@@ -449,6 +455,58 @@ nc_def_var_fletcher32(int ncid, int varid, int fletcher32)
     return ncp->dispatch->def_var_fletcher32(ncid,varid,fletcher32);
 }
 
+/**
+   Set quantization for a variable.
+
+   Quantization trims the precision of float and double data to a
+   number of significant decimal digits as it is written, so that
+   lossless filters such as deflate can compress it much better. The
+   bits below the requested precision are alternately shaved (set to
+   zero) and set (to one) in successive values, so that the error is
+   unbiased on average ("bit grooming"). Values equal to the fill
+   value, zeros, infinities and NaNs are left alone.
+
+   The setting is recorded in the attribute
+   ::NC_QUANTIZE_BITGROOM_ATT_NAME of the variable, so that readers
+   know the precision of the data, and writes to the variable after
+   the file is reopened are quantized in the same way.
+
+   This function must be called after nc_def_var and before nc_enddef
+   or any functions which writes data to the file.
+
+   @param ncid NetCDF or group ID, from a previous call to nc_open(),
+   nc_create(), nc_def_grp(), or associated inquiry functions such as
+   nc_inq_ncid().
+   @param varid Variable ID
+   @param quantize_mode ::NC_QUANTIZE_BITGROOM to turn on quantization
+   for this variable, ::NC_NOQUANTIZE to turn it off.
+   @param nsd Number of significant decimal digits to keep, from 1 to
+   ::NC_QUANTIZE_MAX_FLOAT_NSD for floats, or to
+   ::NC_QUANTIZE_MAX_DOUBLE_NSD for doubles. Ignored for
+   ::NC_NOQUANTIZE.
+
+   @return ::NC_NOERR No error.
+   @return ::NC_EBADID Bad ncid.
+   @return ::NC_ENOTVAR Invalid variable ID.
+   @return ::NC_ENOTNC4 Attempting netcdf-4 operation on file that is
+   not netCDF-4/HDF5.
+   @return ::NC_ELATEDEF Too late to change settings for this variable.
+   @return ::NC_EINVAL Invalid mode or number of digits, or the
+   variable is not of type float or double.
+   @return ::NC_EPERM File is read only.
+*/
+int
+nc_def_var_quantize(int ncid, int varid, int quantize_mode, int nsd)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    if(quantize_mode < NC_NOQUANTIZE || quantize_mode > NC_QUANTIZE_MAX)
+	return NC_EINVAL;
+    return ncp->dispatch->def_var_quantize(ncid,varid,quantize_mode,nsd);
+}
+
 /**
    Define chunking parameters for a variable
 
@@ -631,9 +689,19 @@ nc_def_var_endian(int ncid, int varid, int endian)
 /**
    Define a new variable filter.
 
+   Filters are chained: each call adds a filter to the end of the
+   variable's chain, so that on write the data passes through the
+   filters in the order they were defined (after shuffle, and before
+   fletcher32). Defining a filter that is already in the chain replaces
+   its parameters without moving it. Use nc_inq_var_filter_ids() and
+   nc_inq_var_filter_info() to learn the whole chain.
+
+   As with nc_def_var_deflate(), a variable of a file opened for
+   parallel I/O is switched to collective access.
+
    @param ncid File and group ID.
    @param varid Variable ID.
-   @param id
+   @param id Filter ID.
    @param nparams Number of filter parameters.
    @param parms Filter parameters.
 
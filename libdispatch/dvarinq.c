@@ -358,6 +358,40 @@ nc_inq_var_fletcher32(int ncid, int varid, int *fletcher32p)
       );
 }
 
+/** \ingroup variables
+Learn the quantization settings for a variable.
+
+Variables of files that are reopened get the setting recorded in their
+::NC_QUANTIZE_BITGROOM_ATT_NAME attribute.
+
+\param ncid NetCDF or group ID, from a previous call to nc_open(),
+nc_create(), nc_def_grp(), or associated inquiry functions such as
+nc_inq_ncid().
+
+\param varid Variable ID
+
+\param quantize_modep Will be set to ::NC_QUANTIZE_BITGROOM if
+quantization is turned on for this variable, and ::NC_NOQUANTIZE if it
+is not. \ref ignored_if_null.
+
+\param nsdp Will be set to the number of significant digits kept, or 0
+if quantization is off. \ref ignored_if_null.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EBADID Bad ncid.
+\returns ::NC_ENOTNC4 Not a netCDF-4 file.
+\returns ::NC_ENOTVAR Invalid variable ID.
+*/
+int
+nc_inq_var_quantize(int ncid, int varid, int *quantize_modep, int *nsdp)
+{
+    int stat = NC_NOERR;
+    NC* ncp;
+
+    if((stat = NC_check_id(ncid,&ncp))) return stat;
+    return ncp->dispatch->inq_var_quantize(ncid,varid,quantize_modep,nsdp);
+}
+
 /** \ingroup variables
 
 This is a wrapper for nc_inq_var_all().
@@ -618,7 +652,9 @@ nc_inq_ncid().
 
 \param varid Variable ID
 
-\param idp Storage which will get the filter id; a return value of zero means no filter
+\param idp Storage which will get the filter id; a return value of
+zero means no filter. If the variable has a chain of filters, this is
+the first one other than deflate; see nc_inq_var_filter_ids().
 
 \param nparamsp Storage which will get the number of parameters to the
 filter
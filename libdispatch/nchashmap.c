@@ -14,6 +14,7 @@ See LICENSE.txt for license information.
 #include "ncdispatch.h"
 
 #include "nchashmap.h"
+#include "nccrc32.h"
 #include "nc3internal.h"
 
 #undef DEBUG
@@ -32,9 +33,6 @@ entry. Since we also keep the hashkey, the probability is high that
 we will only do string comparisons when they will match.
 */
 
-/* Prototype for the crc32 function */
-extern unsigned int NC_crc32(unsigned int crc, const unsigned char* buf, unsigned int len);
-
 #undef SMALLTABLE
 
 #ifdef ASSERTIONS
@@ -159,7 +157,7 @@ locate(NC_hashmap* hash, unsigned int hashkey, const char* key, size_t keysize,
 unsigned int
 NC_hashmapkey(const char* key, size_t size)
 {
-    return NC_crc32(0,(unsigned char*)key,(unsigned int)size);
+    return NC_crc32(0,key,size);
 }
 
 NC_hashmap*
@@ -194,7 +192,7 @@ NC_hashmapadd(NC_hashmap* hash, uintptr_t data, const char* key, size_t keysize)
 
     if(key == NULL || keysize == 0)
       return 0;
-    hashkey = NC_crc32(0,(unsigned char*)key,(unsigned int)keysize);
+    hashkey = NC_crc32(0,key,keysize);
 
     if(hash->alloc*3/4 <= hash->active)
 	rehash(hash);
@@ -238,7 +236,7 @@ NC_hashmapremove(NC_hashmap* hash, const char* key, size_t keysize, uintptr_t* d
     if(key == NULL || keysize == 0)
 	return 0;
 
-    hashkey = NC_crc32(0,(unsigned char*)key,(unsigned int)keysize);
+    hashkey = NC_crc32(0,key,keysize);
     if(!locate(hash,hashkey,key,keysize,&index,0))
 	return 0; /* not present */
     h = &hash->table[index];
@@ -263,7 +261,7 @@ NC_hashmapget(NC_hashmap* hash, const char* key, size_t keysize, uintptr_t* data
 
     if(key == NULL || keysize == 0)
 	return 0;
-    hashkey = NC_crc32(0,(unsigned char*)key,(unsigned int)keysize);
+    hashkey = NC_crc32(0,key,keysize);
     if(hash->active) {
       size_t index;
       NC_hentry* h;
@@ -293,7 +291,7 @@ NC_hashmapsetdata(NC_hashmap* hash, const char* key, size_t keysize, uintptr_t n
 
     if(key == NULL || keysize == 0)
 	return 0;
-    hashkey = NC_crc32(0,(unsigned char*)key,(unsigned int)keysize);
+    hashkey = NC_crc32(0,key,keysize);
     if(hash == NULL || hash->active == 0)
 	return 0; /* no such entry */
     if(!locate(hash,hashkey,key,keysize,&index,0))
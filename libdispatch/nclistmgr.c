@@ -15,6 +15,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 #include "ncdispatch.h"
 
 /** This shift is applied to the ext_ncid in order to get the index in
@@ -33,6 +36,20 @@ static NC** nc_filelist = NULL;
 /** The number of files currently open. */
 static int numfiles = 0;
 
+/* The list is shared by every thread that calls the library, so a
+ * file may be looked up on one thread while another file is opened or
+ * closed on another (see copy_slabs_overlapped() in nccopy). */
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t nc_filelist_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK() pthread_mutex_lock(&nc_filelist_lock)
+#define UNLOCK() pthread_mutex_unlock(&nc_filelist_lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+static void freelist(void);
+
 /**
  * How many files are currently open?
  *
@@ -42,7 +59,11 @@ static int numfiles = 0;
 int
 count_NCList(void)
 {
-    return numfiles;
+    int n;
+    LOCK();
+    n = numfiles;
+    UNLOCK();
+    return n;
 }
 
 /**
@@ -53,6 +74,15 @@ count_NCList(void)
  */
 void
 free_NCList(void)
+{
+    LOCK();
+    freelist();
+    UNLOCK();
+}
+
+/* Free the list if it is empty; the caller holds the lock */
+static void
+freelist(void)
 {
     if(numfiles > 0) return; /* not empty */
     if(nc_filelist != NULL) free(nc_filelist);
@@ -83,9 +113,12 @@ add_to_NCList(NC* ncp)
 {
     int i;
     int new_id;
+    LOCK();
     if(nc_filelist == NULL) {
-        if (!(nc_filelist = calloc(1, sizeof(NC*)*NCFILELISTLENGTH)))
+        if (!(nc_filelist = calloc(1, sizeof(NC*)*NCFILELISTLENGTH))) {
+            UNLOCK();
             return NC_ENOMEM;
+        }
         numfiles = 0;
     }
 
@@ -93,10 +126,11 @@ add_to_NCList(NC* ncp)
     for(i=1; i < NCFILELISTLENGTH; i++) {
         if(nc_filelist[i] == NULL) {new_id = i; break;}
     }
-    if(new_id == 0) return NC_ENOMEM; /* no more slots */
+    if(new_id == 0) {UNLOCK(); return NC_ENOMEM;} /* no more slots */
     nc_filelist[new_id] = ncp;
     numfiles++;
     ncp->ext_ncid = (new_id << ID_SHIFT);
+    UNLOCK();
     return NC_NOERR;
 }
 
@@ -113,20 +147,22 @@ add_to_NCList(NC* ncp)
 int
 move_in_NCList(NC *ncp, int new_id)
 {
-    /* If no files in list, error. */
-    if (!nc_filelist)
-        return NC_EINVAL;
+    int stat = NC_NOERR;
 
-    /* If new slot is already taken, error. */
-    if (nc_filelist[new_id])
-        return NC_EINVAL;
-
-    /* Move the file. */
-    nc_filelist[ncp->ext_ncid >> ID_SHIFT] = NULL;
-    nc_filelist[new_id] = ncp;
-    ncp->ext_ncid = (new_id << ID_SHIFT);
+    LOCK();
+    /* If no files in list, or new slot is already taken, error. */
+    if (!nc_filelist || nc_filelist[new_id])
+        stat = NC_EINVAL;
+    else
+    {
+        /* Move the file. */
+        nc_filelist[ncp->ext_ncid >> ID_SHIFT] = NULL;
+        nc_filelist[new_id] = ncp;
+        ncp->ext_ncid = (new_id << ID_SHIFT);
+    }
+    UNLOCK();
 
-    return NC_NOERR;
+    return stat;
 }
 
 /**
@@ -145,15 +181,20 @@ void
 del_from_NCList(NC* ncp)
 {
     unsigned int ncid = ((unsigned int)ncp->ext_ncid) >> ID_SHIFT;
-    if(numfiles == 0 || ncid == 0 || nc_filelist == NULL) return;
-    if(nc_filelist[ncid] != ncp) return;
+    LOCK();
+    if(numfiles == 0 || ncid == 0 || nc_filelist == NULL
+       || nc_filelist[ncid] != ncp) {
+        UNLOCK();
+        return;
+    }
 
     nc_filelist[ncid] = NULL;
     numfiles--;
 
     /* If all files have been closed, release the filelist memory. */
     if (numfiles == 0)
-        free_NCList();
+        freelist();
+    UNLOCK();
 }
 
 /**
@@ -176,11 +217,13 @@ find_in_NCList(int ext_ncid)
 
     /* If we have a filelist, there will be an entry, possibly NULL,
      * for this ncid. */
+    LOCK();
     if (nc_filelist)
     {
         assert(numfiles);
         f = nc_filelist[ncid];
     }
+    UNLOCK();
 
     /* For classic files, ext_ncid must be a multiple of
      * (1<<ID_SHIFT). That is, the group part of the ext_ncid (the
@@ -207,9 +250,8 @@ find_in_NCList_by_name(const char* path)
 {
     int i;
     NC* f = NULL;
-    if(nc_filelist == NULL)
-        return NULL;
-    for(i=1; i < NCFILELISTLENGTH; i++) {
+    LOCK();
+    for(i=1; nc_filelist != NULL && i < NCFILELISTLENGTH; i++) {
         if(nc_filelist[i] != NULL) {
             if(strcmp(nc_filelist[i]->path,path)==0) {
                 f = nc_filelist[i];
@@ -217,6 +259,7 @@ find_in_NCList_by_name(const char* path)
             }
         }
     }
+    UNLOCK();
     return f;
 }
 
@@ -240,6 +283,8 @@ iterate_NCList(int index, NC** ncp)
     /* Walk from 0 ...; 0 return => stop */
     if(index < 0 || index >= NCFILELISTLENGTH)
         return NC_ERANGE;
-    if(ncp) *ncp = nc_filelist[index];
+    LOCK();
+    if(ncp) *ncp = (nc_filelist != NULL ? nc_filelist[index] : NULL);
+    UNLOCK();
     return NC_NOERR;
 }
@@ -100,7 +100,16 @@ static const NC_Dispatch HDF4_dispatcher = {
     NC_NOTNC4_def_var_endian,
     NC_NOTNC4_def_var_filter,
     NC_NOTNC4_set_var_chunk_cache,
-    NC_NOTNC4_get_var_chunk_cache
+    NC_NOTNC4_get_var_chunk_cache,
+    NC_NOTNC4_def_var_chunk_intent,
+    NC_NOTNC4_inq_var_chunk_intent,
+    NC_NOTNC4_read_chunk,
+    NC_NOTNC4_write_chunk,
+    NC_NOTNC4_inq_var_chunk_info,
+    NC4_inq_var_filter_ids,
+    NC4_inq_var_filter_info,
+    NC_NOTNC4_def_var_quantize,
+    NC4_inq_var_quantize
 };
 
 const NC_Dispatch *HDF4_dispatch_table = NULL;
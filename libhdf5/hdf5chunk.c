@@ -0,0 +1,1245 @@
+/* Copyright 2019, University Corporation for Atmospheric
+ * Research. See COPYRIGHT file for copying and redistribution
+ * conditions. */
+/**
+ * @file @internal Direct chunk I/O for netCDF-4 variables.
+ *
+ * HDF5 runs its filter pipeline on one chunk at a time, on the
+ * calling thread. For reads and writes that cover whole chunks this
+ * file offers a way around that: the library itself runs the shuffle,
+ * bitshuffle, fletcher32, deflate and bzip2 filters (see also
+ * hdf5filter.c) over a batch of chunks concurrently (see
+ * ncthreads.h), and moves the stored bytes in and out of the file with
+ * H5Dread_chunk() and H5Dwrite_chunk().
+ *
+ * Chunks are encoded exactly as the HDF5 filters would encode them, so
+ * the stored chunks do not depend on which path wrote them.
+ *
+ * The raw chunk API (nc_read_chunk()/nc_write_chunk()) and the chunk
+ * index query (nc_inq_var_chunk_info()) are also implemented here.
+ */
+
+#include "config.h"
+#include "hdf5internal.h"
+#include "ncthreads.h"
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif
+#ifdef HAVE_BZLIB_H
+#include <bzlib.h>
+#endif
+
+#ifdef H5_VERSION_GE
+#if H5_VERSION_GE(1,10,5)
+#define HDF5_HAS_DIRECT_CHUNK 1
+#endif
+#endif
+
+/** Id registered for the bzip2 filter (see plugins/h5bzip2.h). */
+#ifndef H5Z_FILTER_BZIP2
+#define H5Z_FILTER_BZIP2 307
+#endif
+
+#ifdef HDF5_HAS_DIRECT_CHUNK
+
+/** Longest filter pipeline the direct path will run. */
+#define NC_DIRECT_MAX_FILTERS 8
+
+/** Number of chunks handled per thread in each round. */
+#define NC_DIRECT_BATCH 4
+
+/** The filter pipeline of a variable, as the direct path sees it. */
+typedef struct NCpipeline {
+    size_t nfilters;
+    H5Z_filter_t id[NC_DIRECT_MAX_FILTERS];
+    unsigned int flags[NC_DIRECT_MAX_FILTERS];
+    unsigned int param[NC_DIRECT_MAX_FILTERS]; /**< shuffle, bitshuffle:
+                                                * element size; deflate:
+                                                * level; bzip2: block
+                                                * size */
+    unsigned int block[NC_DIRECT_MAX_FILTERS]; /**< bitshuffle: block size */
+} NCpipeline;
+
+/** One chunk in a round of a direct read or write. */
+typedef struct NCdirectchunk {
+    hsize_t offset[NC_MAX_VAR_DIMS]; /**< index of first element */
+    unsigned int mask;  /**< filters skipped when it was written */
+    size_t nbytes;      /**< stored size; 0 if never written */
+    size_t alloc;       /**< allocated size of raw */
+    void *raw;          /**< stored bytes, when reading */
+    void *work[2];      /**< filter buffers, work_nbytes each */
+    void *out;          /**< result of running the filters */
+} NCdirectchunk;
+
+/** State shared by the tasks of a direct read or write. */
+typedef struct NCdirectio {
+    NCpipeline pipe;
+    int ndims;
+    size_t typesize;
+    size_t chunk_nbytes; /**< size of an unfiltered chunk */
+    size_t work_nbytes;  /**< largest size of a chunk within the pipeline */
+    hsize_t chunksizes[NC_MAX_VAR_DIMS];
+    hsize_t start[NC_MAX_VAR_DIMS];
+    hsize_t count[NC_MAX_VAR_DIMS];
+    const void *fillvalue; /**< NULL: zeros when writing, untouched when reading */
+    void *data;
+    NCdirectchunk *chunks;
+} NCdirectio;
+
+/**
+ * @internal Find out whether the filter pipeline of a dataset can be
+ * run by the direct path.
+ *
+ * @param datasetid HDF5 dataset.
+ * @param pipe Gets the pipeline.
+ * @param supportedp Gets 1 if every filter is one we can run.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EHDFERR HDF5 error.
+ */
+static int
+get_pipeline(hid_t datasetid, NCpipeline *pipe, int *supportedp)
+{
+    hid_t plistid;
+    int nfilters, f;
+    int retval = NC_NOERR;
+
+    *supportedp = 0;
+    memset(pipe, 0, sizeof(NCpipeline));
+    if ((plistid = H5Dget_create_plist(datasetid)) < 0)
+        return NC_EHDFERR;
+    if ((nfilters = H5Pget_nfilters(plistid)) < 0)
+        BAIL(NC_EHDFERR);
+    if (nfilters > NC_DIRECT_MAX_FILTERS)
+        goto exit;
+    for (f = 0; f < nfilters; f++)
+    {
+        unsigned int flags, cd_values[8];
+        size_t cd_nelems = 8;
+        H5Z_filter_t filter;
+
+        if ((filter = H5Pget_filter2(plistid, (unsigned)f, &flags, &cd_nelems,
+                                     cd_values, 0, NULL, NULL)) < 0)
+            BAIL(NC_EHDFERR);
+        switch (filter)
+        {
+        case H5Z_FILTER_SHUFFLE:
+            /* The element size is filled in when the dataset is
+             * created. */
+            if (cd_nelems < 1 || cd_values[0] == 0)
+                goto exit;
+            pipe->param[f] = cd_values[0];
+            break;
+        case H5Z_FILTER_FLETCHER32:
+            break;
+        case H5Z_FILTER_BITSHUFFLE:
+            /* Element size, block size, compression; compressed
+             * bitshuffle is left to the plugin. */
+            if (cd_nelems < 3 || cd_values[2] == 0 ||
+                (cd_nelems > 4 && cd_values[4]))
+                goto exit;
+            pipe->param[f] = cd_values[2];
+            pipe->block[f] = cd_nelems > 3 ? cd_values[3] : 0;
+            break;
+#ifdef HAVE_ZLIB_H
+        case H5Z_FILTER_DEFLATE:
+            if (cd_nelems < 1 || cd_values[0] > 9)
+                goto exit;
+            pipe->param[f] = cd_values[0];
+            break;
+#endif
+#ifdef HAVE_BZLIB_H
+        case H5Z_FILTER_BZIP2:
+            /* Same default as the plugin. */
+            pipe->param[f] = cd_nelems > 0 ? cd_values[0] : 9;
+            if (pipe->param[f] < 1 || pipe->param[f] > 9)
+                goto exit;
+            break;
+#endif
+        default:
+            goto exit;
+        }
+        pipe->id[f] = filter;
+        pipe->flags[f] = flags;
+    }
+    pipe->nfilters = (size_t)nfilters;
+    *supportedp = 1;
+
+exit:
+    if (H5Pclose(plistid) < 0)
+        BAIL2(NC_EHDFERR);
+    return retval;
+}
+
+/**
+ * @internal Largest size a chunk can reach while passing through a
+ * pipeline.
+ *
+ * @param pipe The pipeline.
+ * @param nbytes Size of the unfiltered chunk.
+ *
+ * @return Worst-case size in bytes.
+ */
+static size_t
+pipeline_bound(const NCpipeline *pipe, size_t nbytes)
+{
+    size_t bound = nbytes;
+    size_t i;
+
+    for (i = 0; i < pipe->nfilters; i++)
+    {
+        switch (pipe->id[i])
+        {
+        case H5Z_FILTER_FLETCHER32:
+            bound += 4;
+            break;
+#ifdef HAVE_ZLIB_H
+        case H5Z_FILTER_DEFLATE:
+            bound = (size_t)compressBound((uLong)bound);
+            break;
+#endif
+#ifdef HAVE_BZLIB_H
+        case H5Z_FILTER_BZIP2:
+            /* Worst case, from the bzip2 documentation. */
+            bound = bound + bound / 100 + 600;
+            break;
+#endif
+        default:
+            break;
+        }
+    }
+    return bound;
+}
+
+/**
+ * @internal Run one filter of a pipeline over a buffer.
+ *
+ * @param pipe The pipeline.
+ * @param i Index of the filter in the pipeline.
+ * @param reverse Non-zero to undo the filter.
+ * @param src Input bytes.
+ * @param srclen Number of input bytes.
+ * @param dst Gets the output.
+ * @param dstcap Size of dst.
+ * @param dstlenp Gets number of output bytes.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EFILTER The filter failed.
+ */
+static int
+run_filter(const NCpipeline *pipe, size_t i, int reverse, const void *src,
+           size_t srclen, void *dst, size_t dstcap, size_t *dstlenp)
+{
+    switch (pipe->id[i])
+    {
+    case H5Z_FILTER_SHUFFLE:
+        if (srclen > dstcap)
+            return NC_EFILTER;
+        nc4_shuffle(src, dst, srclen, pipe->param[i], reverse);
+        *dstlenp = srclen;
+        break;
+    case H5Z_FILTER_BITSHUFFLE:
+        if (srclen > dstcap ||
+            nc4_bitshuffle(src, dst, srclen, pipe->param[i], pipe->block[i],
+                           reverse))
+            return NC_EFILTER;
+        *dstlenp = srclen;
+        break;
+    case H5Z_FILTER_FLETCHER32:
+        if (reverse)
+        {
+            if (!nc4_fletcher32_check(src, srclen))
+                return NC_EFILTER;
+            srclen -= 4;
+            memcpy(dst, src, srclen);
+            *dstlenp = srclen;
+        }
+        else
+        {
+            if (srclen + 4 > dstcap)
+                return NC_EFILTER;
+            memcpy(dst, src, srclen);
+            nc4_fletcher32_append(dst, srclen);
+            *dstlenp = srclen + 4;
+        }
+        break;
+#ifdef HAVE_ZLIB_H
+    case H5Z_FILTER_DEFLATE:
+    {
+        uLongf dstlen = (uLongf)dstcap;
+        int stat;
+
+        if (reverse)
+            stat = uncompress(dst, &dstlen, src, (uLong)srclen);
+        else
+            stat = compress2(dst, &dstlen, src, (uLong)srclen,
+                             (int)pipe->param[i]);
+        if (stat != Z_OK)
+            return NC_EFILTER;
+        *dstlenp = (size_t)dstlen;
+        break;
+    }
+#endif
+#ifdef HAVE_BZLIB_H
+    case H5Z_FILTER_BZIP2:
+    {
+        unsigned int dstlen = (unsigned int)dstcap;
+        int stat;
+
+        if (reverse)
+            stat = BZ2_bzBuffToBuffDecompress(dst, &dstlen, (char *)src,
+                                              (unsigned int)srclen, 0, 0);
+        else
+            stat = BZ2_bzBuffToBuffCompress(dst, &dstlen, (char *)src,
+                                            (unsigned int)srclen,
+                                            (int)pipe->param[i], 0, 0);
+        if (stat != BZ_OK)
+            return NC_EFILTER;
+        *dstlenp = dstlen;
+        break;
+    }
+#endif
+    default:
+        return NC_EFILTER;
+    }
+    return NC_NOERR;
+}
+
+/**
+ * @internal Run the filter pipeline backwards over one chunk; the
+ * result is left in chunk->out.
+ *
+ * @param io The read.
+ * @param chunk The chunk; its work buffers must be allocated.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EHDFERR Chunk could not be decoded.
+ */
+static int
+decode_chunk(const NCdirectio *io, NCdirectchunk *chunk)
+{
+    void *cur = chunk->raw;
+    size_t curlen = chunk->nbytes;
+    int next = 0;
+    size_t i;
+
+    for (i = io->pipe.nfilters; i-- > 0;)
+    {
+        /* Skipped when the chunk was written? */
+        if (chunk->mask & (1u << i))
+            continue;
+        if (run_filter(&io->pipe, i, 1, cur, curlen, chunk->work[next],
+                       io->work_nbytes, &curlen))
+            return NC_EHDFERR;
+        cur = chunk->work[next];
+        next = !next;
+    }
+    if (curlen != io->chunk_nbytes)
+        return NC_EHDFERR;
+    chunk->out = cur;
+    return NC_NOERR;
+}
+
+/**
+ * @internal Run the filter pipeline over one chunk, which must be in
+ * chunk->work[0]. The result is left in chunk->out, with its size and
+ * filter mask. As in HDF5, an optional filter that fails is skipped and
+ * flagged in the mask.
+ *
+ * @param io The write.
+ * @param chunk The chunk.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EFILTER A mandatory filter failed.
+ */
+static int
+encode_chunk(const NCdirectio *io, NCdirectchunk *chunk)
+{
+    void *cur = chunk->work[0];
+    size_t curlen = io->chunk_nbytes;
+    int next = 1;
+    size_t i;
+
+    chunk->mask = 0;
+    for (i = 0; i < io->pipe.nfilters; i++)
+    {
+        size_t dstlen;
+
+        if (run_filter(&io->pipe, i, 0, cur, curlen, chunk->work[next],
+                       io->work_nbytes, &dstlen))
+        {
+            if (!(io->pipe.flags[i] & H5Z_FLAG_OPTIONAL))
+                return NC_EFILTER;
+            chunk->mask |= 1u << i;
+            continue;
+        }
+        cur = chunk->work[next];
+        curlen = dstlen;
+        next = !next;
+    }
+    chunk->out = cur;
+    chunk->nbytes = curlen;
+    return NC_NOERR;
+}
+
+/**
+ * @internal Copy the part of a chunk that lies in the requested
+ * hyperslab between the chunk and the caller's buffer. When reading, a
+ * NULL chunk buffer means the chunk was never written, and the fill
+ * value is used instead; with no_fill (no fill value) the caller's
+ * buffer is left alone, as H5Dread does with H5D_FILL_TIME_NEVER.
+ *
+ * @param io The read or write.
+ * @param offset Index of the first element of the chunk.
+ * @param buf Unfiltered chunk, or NULL.
+ * @param put Non-zero to copy from the caller's buffer into the chunk.
+ */
+static void
+copy_chunk(const NCdirectio *io, const hsize_t *offset, char *buf, int put)
+{
+    hsize_t lo[NC_MAX_VAR_DIMS], hi[NC_MAX_VAR_DIMS], idx[NC_MAX_VAR_DIMS];
+    size_t row, k;
+    int last = io->ndims - 1;
+    int d;
+
+    for (d = 0; d < io->ndims; d++)
+    {
+        lo[d] = offset[d] > io->start[d] ? offset[d] : io->start[d];
+        hi[d] = offset[d] + io->chunksizes[d];
+        if (hi[d] > io->start[d] + io->count[d])
+            hi[d] = io->start[d] + io->count[d];
+        idx[d] = lo[d];
+    }
+    row = (size_t)(hi[last] - lo[last]) * io->typesize;
+
+    for (;;)
+    {
+        size_t coff = 0, uoff = 0;
+        char *user;
+
+        for (d = 0; d < io->ndims; d++)
+        {
+            coff = coff * io->chunksizes[d] + (idx[d] - offset[d]);
+            uoff = uoff * io->count[d] + (idx[d] - io->start[d]);
+        }
+        user = (char *)io->data + uoff * io->typesize;
+        if (put)
+            memcpy(buf + coff * io->typesize, user, row);
+        else if (buf)
+            memcpy(user, buf + coff * io->typesize, row);
+        else if (io->fillvalue)
+            for (k = 0; k < row; k += io->typesize)
+                memcpy(user + k, io->fillvalue, io->typesize);
+
+        /* Move on to the next row. */
+        for (d = last - 1; d >= 0; d--)
+        {
+            if (++idx[d] < hi[d])
+                break;
+            idx[d] = lo[d];
+        }
+        if (d < 0)
+            break;
+    }
+}
+
+/**
+ * @internal Is a chunk only partly covered by the requested
+ * hyperslab?
+ *
+ * @param io The read or write.
+ * @param offset Index of the first element of the chunk.
+ *
+ * @return 1 if partly covered, 0 if wholly covered.
+ */
+static int
+partial_chunk(const NCdirectio *io, const hsize_t *offset)
+{
+    int d;
+
+    for (d = 0; d < io->ndims; d++)
+        if (offset[d] + io->chunksizes[d] > io->start[d] + io->count[d])
+            return 1;
+    return 0;
+}
+
+/**
+ * @internal Make sure the work buffers of a chunk are allocated.
+ *
+ * @param io The read or write.
+ * @param chunk The chunk.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ */
+static int
+alloc_work(const NCdirectio *io, NCdirectchunk *chunk)
+{
+    if (!chunk->work[0])
+    {
+        if (!(chunk->work[0] = malloc(io->work_nbytes)) ||
+            !(chunk->work[1] = malloc(io->work_nbytes)))
+            return NC_ENOMEM;
+    }
+    return NC_NOERR;
+}
+
+/**
+ * @internal Decode task: decode one chunk of the current round and
+ * scatter it. Runs on a worker thread; must not call HDF5.
+ *
+ * @param state The NCdirectio.
+ * @param task Index of the chunk in the round.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ * @return ::NC_EHDFERR Chunk could not be decoded.
+ */
+static int
+decode_task(void *state, size_t task)
+{
+    NCdirectio *io = (NCdirectio *)state;
+    NCdirectchunk *chunk = &io->chunks[task];
+    int retval;
+
+    if (chunk->nbytes == 0)
+    {
+        copy_chunk(io, chunk->offset, NULL, 0);
+        return NC_NOERR;
+    }
+    if ((retval = alloc_work(io, chunk)))
+        return retval;
+    if ((retval = decode_chunk(io, chunk)))
+        return retval;
+    copy_chunk(io, chunk->offset, chunk->out, 0);
+    return NC_NOERR;
+}
+
+/**
+ * @internal Encode task: gather one chunk of the current round and
+ * encode it. Runs on a worker thread; must not call HDF5.
+ *
+ * @param state The NCdirectio.
+ * @param task Index of the chunk in the round.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ * @return ::NC_EFILTER A mandatory filter failed.
+ */
+static int
+encode_task(void *state, size_t task)
+{
+    NCdirectio *io = (NCdirectio *)state;
+    NCdirectchunk *chunk = &io->chunks[task];
+    char *buf;
+    size_t k;
+    int retval;
+
+    if ((retval = alloc_work(io, chunk)))
+        return retval;
+    buf = chunk->work[0];
+
+    /* The part of an edge chunk beyond the dataset holds what HDF5
+     * would have put there: the fill value, or zeros. */
+    if (partial_chunk(io, chunk->offset))
+    {
+        if (io->fillvalue)
+            for (k = 0; k < io->chunk_nbytes; k += io->typesize)
+                memcpy(buf + k, io->fillvalue, io->typesize);
+        else
+            memset(buf, 0, io->chunk_nbytes);
+    }
+    copy_chunk(io, chunk->offset, buf, 1);
+    return encode_chunk(io, chunk);
+}
+
+/**
+ * @internal Fetch the stored bytes of one chunk.
+ *
+ * @param datasetid HDF5 dataset.
+ * @param chunk The chunk; offset must be set. Its raw buffer is grown
+ * as needed.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ * @return ::NC_EHDFERR HDF5 error.
+ */
+static int
+fetch_chunk(hid_t datasetid, NCdirectchunk *chunk)
+{
+    haddr_t addr;
+    hsize_t size;
+    unsigned int mask;
+
+    if (H5Dget_chunk_info_by_coord(datasetid, chunk->offset, &mask, &addr,
+                                   &size) < 0)
+        return NC_EHDFERR;
+    if (addr == HADDR_UNDEF || size == 0)
+    {
+        chunk->nbytes = 0;
+        return NC_NOERR;
+    }
+    if (chunk->alloc < size)
+    {
+        void *raw;
+        if (!(raw = realloc(chunk->raw, (size_t)size)))
+            return NC_ENOMEM;
+        chunk->raw = raw;
+        chunk->alloc = (size_t)size;
+    }
+    if (H5Dread_chunk(datasetid, H5P_DEFAULT, chunk->offset, &chunk->mask,
+                      chunk->raw) < 0)
+        return NC_EHDFERR;
+    chunk->nbytes = (size_t)size;
+    return NC_NOERR;
+}
+
+/**
+ * @internal Check whether a hyperslab of a variable can go through the
+ * direct path, and set up the state for it.
+ *
+ * @param h5 File info.
+ * @param var Variable info.
+ * @param start Start of the hyperslab.
+ * @param count Count of the hyperslab.
+ * @param stride Stride of the hyperslab.
+ * @param fdims Current extent of the dataset.
+ * @param io Gets the state.
+ * @param nthreadsp Gets the number of threads to use.
+ * @param okp Gets 1 if the direct path can be used.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EHDFERR HDF5 error.
+ */
+static int
+direct_setup(NC_FILE_INFO_T *h5, NC_VAR_INFO_T *var, const hsize_t *start,
+             const hsize_t *count, const hsize_t *stride,
+             const hsize_t *fdims, NCdirectio *io, int *nthreadsp, int *okp)
+{
+    NC_HDF5_VAR_INFO_T *hdf5_var;
+    NC_HDF5_TYPE_INFO_T *hdf5_type;
+    hid_t typeid;
+    int supported, native;
+    int retval;
+    int d;
+
+    *okp = 0;
+    nc_get_chunk_threads(nthreadsp);
+    if (*nthreadsp <= 0 || h5->parallel)
+        return NC_NOERR;
+    if (var->ndims < 1 || var->contiguous || !var->chunksizes)
+        return NC_NOERR;
+    if (var->type_info->hdr.id > NC_MAX_ATOMIC_TYPE ||
+        var->type_info->hdr.id == NC_STRING)
+        return NC_NOERR;
+    for (d = 0; d < var->ndims; d++)
+    {
+        hsize_t cs = var->chunksizes[d];
+        if (stride[d] != 1 || !cs || start[d] % cs)
+            return NC_NOERR;
+        if (count[d] % cs && start[d] + count[d] != fdims[d])
+            return NC_NOERR;
+    }
+
+    hdf5_var = (NC_HDF5_VAR_INFO_T *)var->format_var_info;
+    hdf5_type = (NC_HDF5_TYPE_INFO_T *)var->type_info->format_type_info;
+
+    /* We move the stored bytes as they are, so they had better be in
+     * native order already. */
+    if ((typeid = H5Dget_type(hdf5_var->hdf_datasetid)) < 0)
+        return NC_EHDFERR;
+    native = H5Tequal(typeid, hdf5_type->native_hdf_typeid);
+    if (H5Tclose(typeid) < 0 || native < 0)
+        return NC_EHDFERR;
+    if (!native)
+        return NC_NOERR;
+    if ((retval = get_pipeline(hdf5_var->hdf_datasetid, &io->pipe, &supported)))
+        return retval;
+    if (!supported)
+        return NC_NOERR;
+
+    io->ndims = (int)var->ndims;
+    io->typesize = var->type_info->size;
+    io->chunk_nbytes = io->typesize;
+    io->fillvalue = NULL;
+    io->chunks = NULL;
+    for (d = 0; d < var->ndims; d++)
+    {
+        io->chunksizes[d] = var->chunksizes[d];
+        io->start[d] = start[d];
+        io->count[d] = count[d];
+        io->chunk_nbytes *= var->chunksizes[d];
+    }
+    io->work_nbytes = pipeline_bound(&io->pipe, io->chunk_nbytes);
+    *okp = 1;
+    return NC_NOERR;
+}
+
+/**
+ * @internal Step through the chunks covered by a hyperslab, in
+ * row-major order.
+ *
+ * @param io The read or write.
+ * @param idx Chunk coordinates, updated in place.
+ * @param first Coordinates of the first chunk.
+ * @param last Coordinates of the last chunk.
+ * @param offset Gets the index of the first element of the chunk at
+ * idx, before it is advanced.
+ */
+static void
+next_chunk(const NCdirectio *io, hsize_t *idx, const hsize_t *first,
+           const hsize_t *last, hsize_t *offset)
+{
+    int d;
+
+    for (d = 0; d < io->ndims; d++)
+        offset[d] = idx[d] * io->chunksizes[d];
+    for (d = io->ndims - 1; d >= 0; d--)
+    {
+        if (++idx[d] <= last[d])
+            break;
+        idx[d] = first[d];
+    }
+}
+
+/**
+ * @internal Free the chunks of a direct read or write.
+ *
+ * @param io The read or write.
+ * @param nchunks Number of chunks.
+ */
+static void
+free_chunks(NCdirectio *io, size_t nchunks)
+{
+    size_t k;
+
+    if (!io->chunks)
+        return;
+    for (k = 0; k < nchunks; k++)
+    {
+        free(io->chunks[k].raw);
+        free(io->chunks[k].work[0]);
+        free(io->chunks[k].work[1]);
+    }
+    free(io->chunks);
+    io->chunks = NULL;
+}
+
+#endif /* HDF5_HAS_DIRECT_CHUNK */
+
+/**
+ * @internal Read a hyperslab through the direct chunk path, if the
+ * request allows it. The caller has already validated start and count
+ * against the extent of the dataset.
+ *
+ * The path is taken only if nc_set_chunk_threads() has enabled it, the
+ * file is not opened for parallel I/O, the variable is chunked, has an
+ * atomic type stored in native byte order, and uses no filters other
+ * than shuffle, deflate and bzip2, no conversion is requested, the
+ * stride is one, and the hyperslab starts on chunk boundaries and ends
+ * on chunk boundaries or at the end of each dimension.
+ *
+ * @param h5 File info.
+ * @param var Variable info.
+ * @param start Start of the hyperslab.
+ * @param count Count of the hyperslab.
+ * @param stride Stride of the hyperslab.
+ * @param fdims Current extent of the dataset.
+ * @param mem_nc_type Type of data in memory.
+ * @param data Gets the data.
+ * @param donep Gets 1 if the data was read, 0 if the caller must
+ * read it the usual way.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ * @return ::NC_EHDFERR HDF5 error.
+ */
+int
+nc4_direct_get_vars(NC_FILE_INFO_T *h5, NC_VAR_INFO_T *var,
+                    const hsize_t *start, const hsize_t *count,
+                    const hsize_t *stride, const hsize_t *fdims,
+                    nc_type mem_nc_type, void *data, int *donep)
+{
+#ifdef HDF5_HAS_DIRECT_CHUNK
+    NC_HDF5_VAR_INFO_T *hdf5_var;
+    NCdirectio io;
+    hsize_t first[NC_MAX_VAR_DIMS], last[NC_MAX_VAR_DIMS];
+    hsize_t idx[NC_MAX_VAR_DIMS];
+    size_t nchunks, nbatch, done, n, k;
+    void *fillvalue = NULL;
+    int nthreads, ok;
+    int retval = NC_NOERR;
+    int d;
+#endif
+
+    *donep = 0;
+#ifdef HDF5_HAS_DIRECT_CHUNK
+    if (mem_nc_type != var->type_info->hdr.id)
+        return NC_NOERR;
+    if ((retval = direct_setup(h5, var, start, count, stride, fdims, &io,
+                               &nthreads, &ok)))
+        return retval;
+    if (!ok)
+        return NC_NOERR;
+    hdf5_var = (NC_HDF5_VAR_INFO_T *)var->format_var_info;
+
+    LOG((3, "%s: direct read of var %s on %d threads", __func__,
+         var->hdr.name, nthreads));
+
+    /* Chunks still sitting dirty in the HDF5 cache must reach the file
+     * before we can fetch them. */
+    if (!h5->no_write && H5Dflush(hdf5_var->hdf_datasetid) < 0)
+        return NC_EHDFERR;
+
+    io.data = data;
+    nchunks = 1;
+    for (d = 0; d < io.ndims; d++)
+    {
+        first[d] = start[d] / io.chunksizes[d];
+        last[d] = (start[d] + count[d] - 1) / io.chunksizes[d];
+        nchunks *= (size_t)(last[d] - first[d] + 1);
+        idx[d] = first[d];
+    }
+
+    nbatch = (size_t)nthreads * NC_DIRECT_BATCH;
+    if (nbatch > nchunks)
+        nbatch = nchunks;
+    if (!(io.chunks = calloc(nbatch, sizeof(NCdirectchunk))))
+        return NC_ENOMEM;
+
+    /* Fetch a round of chunks on this thread (HDF5 is not thread
+     * safe), then decode them all at once. */
+    for (done = 0; done < nchunks; done += n)
+    {
+        int needfill = 0;
+
+        n = nchunks - done < nbatch ? nchunks - done : nbatch;
+        for (k = 0; k < n; k++)
+        {
+            NCdirectchunk *chunk = &io.chunks[k];
+
+            next_chunk(&io, idx, first, last, chunk->offset);
+            if ((retval = fetch_chunk(hdf5_var->hdf_datasetid, chunk)))
+                goto exit;
+            if (chunk->nbytes == 0)
+                needfill++;
+        }
+        if (needfill && !fillvalue && !var->no_fill)
+        {
+            if ((retval = nc4_get_fill_value(h5, var, &fillvalue)))
+                goto exit;
+            io.fillvalue = fillvalue;
+        }
+        if ((retval = NC_run_tasks(nthreads, n, decode_task, &io)))
+            goto exit;
+    }
+    *donep = 1;
+
+exit:
+    free_chunks(&io, nbatch);
+    free(fillvalue);
+    return retval;
+#else
+    return NC_NOERR;
+#endif /* HDF5_HAS_DIRECT_CHUNK */
+}
+
+/**
+ * @internal Write a hyperslab through the direct chunk path, if the
+ * request allows it. The caller has already validated start and count,
+ * and extended the dataset as needed.
+ *
+ * The conditions are those of nc4_direct_get_vars(), except that the
+ * data is already in the type of the variable. In addition, a chunk
+ * only partly covered by the hyperslab (at the end of a dimension) must
+ * not have been written before, since HDF5 would merge the new data
+ * into it.
+ *
+ * Chunks are filtered a round at a time on several threads, and then
+ * written in order. The stored chunks are the same as HDF5 would have
+ * produced.
+ *
+ * @param h5 File info.
+ * @param var Variable info.
+ * @param start Start of the hyperslab.
+ * @param count Count of the hyperslab.
+ * @param stride Stride of the hyperslab.
+ * @param fdims Extent of the dataset.
+ * @param data The data, in the type of the variable.
+ * @param donep Gets 1 if the data was written, 0 if the caller must
+ * write it the usual way.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ * @return ::NC_EFILTER A filter failed.
+ * @return ::NC_EHDFERR HDF5 error.
+ */
+int
+nc4_direct_put_vars(NC_FILE_INFO_T *h5, NC_VAR_INFO_T *var,
+                    const hsize_t *start, const hsize_t *count,
+                    const hsize_t *stride, const hsize_t *fdims,
+                    const void *data, int *donep)
+{
+#ifdef HDF5_HAS_DIRECT_CHUNK
+    NC_HDF5_VAR_INFO_T *hdf5_var;
+    NCdirectio io;
+    hsize_t first[NC_MAX_VAR_DIMS], last[NC_MAX_VAR_DIMS];
+    hsize_t idx[NC_MAX_VAR_DIMS], offset[NC_MAX_VAR_DIMS];
+    size_t nchunks, nbatch, done, n, k;
+    void *fillvalue = NULL;
+    int nthreads, ok;
+    int retval = NC_NOERR;
+    int d;
+#endif
+
+    *donep = 0;
+#ifdef HDF5_HAS_DIRECT_CHUNK
+    if ((retval = direct_setup(h5, var, start, count, stride, fdims, &io,
+                               &nthreads, &ok)))
+        return retval;
+    if (!ok)
+        return NC_NOERR;
+    hdf5_var = (NC_HDF5_VAR_INFO_T *)var->format_var_info;
+
+    io.data = (void *)data;
+    nchunks = 1;
+    for (d = 0; d < io.ndims; d++)
+    {
+        first[d] = start[d] / io.chunksizes[d];
+        last[d] = (start[d] + count[d] - 1) / io.chunksizes[d];
+        nchunks *= (size_t)(last[d] - first[d] + 1);
+        idx[d] = first[d];
+    }
+
+    /* Leave partly covered chunks that already exist to HDF5. */
+    for (k = 0; k < nchunks; k++)
+    {
+        haddr_t addr;
+        hsize_t size;
+        unsigned int mask;
+
+        next_chunk(&io, idx, first, last, offset);
+        if (!partial_chunk(&io, offset))
+            continue;
+        if (H5Dget_chunk_info_by_coord(hdf5_var->hdf_datasetid, offset, &mask,
+                                       &addr, &size) < 0)
+            return NC_EHDFERR;
+        if (addr != HADDR_UNDEF)
+            return NC_NOERR;
+    }
+
+    LOG((3, "%s: direct write of var %s on %d threads", __func__,
+         var->hdr.name, nthreads));
+
+    /* New chunks start out as HDF5 would start them. */
+    if (!var->no_fill)
+    {
+        if ((retval = nc4_get_fill_value(h5, var, &fillvalue)))
+            return retval;
+        io.fillvalue = fillvalue;
+    }
+
+    nbatch = (size_t)nthreads * NC_DIRECT_BATCH;
+    if (nbatch > nchunks)
+        nbatch = nchunks;
+    if (!(io.chunks = calloc(nbatch, sizeof(NCdirectchunk))))
+        BAIL(NC_ENOMEM);
+
+    /* Encode a round of chunks at once, then write them in order on
+     * this thread (HDF5 is not thread safe). */
+    for (done = 0; done < nchunks; done += n)
+    {
+        n = nchunks - done < nbatch ? nchunks - done : nbatch;
+        for (k = 0; k < n; k++)
+            next_chunk(&io, idx, first, last, io.chunks[k].offset);
+        if ((retval = NC_run_tasks(nthreads, n, encode_task, &io)))
+            goto exit;
+        for (k = 0; k < n; k++)
+        {
+            NCdirectchunk *chunk = &io.chunks[k];
+
+            if (H5Dwrite_chunk(hdf5_var->hdf_datasetid, H5P_DEFAULT,
+                               chunk->mask, chunk->offset, chunk->nbytes,
+                               chunk->out) < 0)
+                BAIL(NC_EHDFERR);
+        }
+    }
+    *donep = 1;
+
+exit:
+    free_chunks(&io, nbatch);
+    free(fillvalue);
+    return retval;
+#else
+    return NC_NOERR;
+#endif /* HDF5_HAS_DIRECT_CHUNK */
+}
+
+/**
+ * @internal Find a chunked variable for the raw chunk API, leaving
+ * define mode if needed, and check a chunk offset.
+ *
+ * @param ncid File or group ID.
+ * @param varid Variable ID.
+ * @param offset Chunk offset.
+ * @param writing Non-zero for a write; unlimited dimensions may then
+ * be extended.
+ * @param h5p Gets file info.
+ * @param varp Gets variable info.
+ * @param fdims Gets the current extent of the dataset.
+ *
+ * @return ::NC_NOERR No error.
+ */
+static int
+find_chunked_var(int ncid, int varid, const size_t *offset, int writing,
+                 NC_FILE_INFO_T **h5p, NC_VAR_INFO_T **varp, hsize_t *fdims)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NC_HDF5_VAR_INFO_T *hdf5_var;
+    hid_t spaceid;
+    int retval, d;
+
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+        return retval;
+    if (writing && h5->no_write)
+        return NC_EPERM;
+
+    /* The dataset does not exist until define mode is left. */
+    if (h5->flags & NC_INDEF)
+    {
+        if (h5->cmode & NC_CLASSIC_MODEL)
+            return NC_EINDEFINE;
+        if ((retval = nc4_enddef_netcdf4_file(h5)))
+            return retval;
+    }
+    if (var->ndims < 1 || var->contiguous || !var->chunksizes)
+        return NC_EINVAL;
+
+    hdf5_var = (NC_HDF5_VAR_INFO_T *)var->format_var_info;
+    if ((spaceid = H5Dget_space(hdf5_var->hdf_datasetid)) < 0)
+        return NC_EHDFERR;
+    if (H5Sget_simple_extent_dims(spaceid, fdims, NULL) < 0)
+        retval = NC_EHDFERR;
+    if (H5Sclose(spaceid) < 0)
+        retval = NC_EHDFERR;
+    if (retval)
+        return retval;
+
+    for (d = 0; d < var->ndims; d++)
+    {
+        if (offset[d] % var->chunksizes[d])
+            return NC_EINVAL;
+        if (offset[d] >= fdims[d] && !(writing && var->dim[d]->unlimited))
+            return NC_EINVALCOORDS;
+    }
+    *h5p = h5;
+    *varp = var;
+    return NC_NOERR;
+}
+
+/**
+ * @internal Read one chunk as stored. See nc_read_chunk().
+ *
+ * @param ncid File or group ID.
+ * @param varid Variable ID.
+ * @param offset Index of the first element of the chunk.
+ * @param filtermaskp Gets the filter mask. Ignored if NULL.
+ * @param nbytesp Gets the stored size. Ignored if NULL.
+ * @param data Gets the stored bytes. Ignored if NULL.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOTBUILT HDF5 lacks direct chunk I/O.
+ */
+int
+NC4_hdf5_read_chunk(int ncid, int varid, const size_t *offset,
+                    unsigned int *filtermaskp, size_t *nbytesp, void *data)
+{
+#ifdef HDF5_HAS_DIRECT_CHUNK
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NC_HDF5_VAR_INFO_T *hdf5_var;
+    hsize_t fdims[NC_MAX_VAR_DIMS], hoffset[NC_MAX_VAR_DIMS];
+    haddr_t addr;
+    hsize_t size;
+    unsigned int mask = 0;
+    int retval, d;
+
+    if ((retval = find_chunked_var(ncid, varid, offset, 0, &h5, &var, fdims)))
+        return retval;
+    hdf5_var = (NC_HDF5_VAR_INFO_T *)var->format_var_info;
+    for (d = 0; d < var->ndims; d++)
+        hoffset[d] = offset[d];
+
+    if (!h5->no_write && H5Dflush(hdf5_var->hdf_datasetid) < 0)
+        return NC_EHDFERR;
+    if (H5Dget_chunk_info_by_coord(hdf5_var->hdf_datasetid, hoffset, &mask,
+                                   &addr, &size) < 0)
+        return NC_EHDFERR;
+    if (addr == HADDR_UNDEF)
+        size = 0;
+    if (size && data)
+        if (H5Dread_chunk(hdf5_var->hdf_datasetid, H5P_DEFAULT, hoffset, &mask,
+                          data) < 0)
+            return NC_EHDFERR;
+    if (filtermaskp)
+        *filtermaskp = mask;
+    if (nbytesp)
+        *nbytesp = (size_t)size;
+    return NC_NOERR;
+#else
+    return NC_ENOTBUILT;
+#endif
+}
+
+/**
+ * @internal Write one chunk as stored. See nc_write_chunk().
+ *
+ * @param ncid File or group ID.
+ * @param varid Variable ID.
+ * @param offset Index of the first element of the chunk.
+ * @param filtermask Filters not applied to the data.
+ * @param nbytes Size of data.
+ * @param data The stored bytes.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOTBUILT HDF5 lacks direct chunk I/O.
+ */
+int
+NC4_hdf5_write_chunk(int ncid, int varid, const size_t *offset,
+                     unsigned int filtermask, size_t nbytes, const void *data)
+{
+#ifdef HDF5_HAS_DIRECT_CHUNK
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NC_HDF5_VAR_INFO_T *hdf5_var;
+    hsize_t fdims[NC_MAX_VAR_DIMS], hoffset[NC_MAX_VAR_DIMS];
+    int need_to_extend = 0;
+    int retval, d;
+
+    if ((retval = find_chunked_var(ncid, varid, offset, 1, &h5, &var, fdims)))
+        return retval;
+    hdf5_var = (NC_HDF5_VAR_INFO_T *)var->format_var_info;
+
+    for (d = 0; d < var->ndims; d++)
+    {
+        NC_DIM_INFO_T *dim = var->dim[d];
+
+        hoffset[d] = offset[d];
+        if (dim->unlimited && offset[d] >= fdims[d])
+        {
+            fdims[d] = offset[d] + var->chunksizes[d];
+            need_to_extend++;
+            if (fdims[d] > dim->len)
+            {
+                dim->len = fdims[d];
+                dim->extended = NC_TRUE;
+            }
+        }
+    }
+    if (need_to_extend &&
+        H5Dset_extent(hdf5_var->hdf_datasetid, fdims) < 0)
+        return NC_EHDFERR;
+
+    if (H5Dwrite_chunk(hdf5_var->hdf_datasetid, H5P_DEFAULT, filtermask,
+                       hoffset, nbytes, data) < 0)
+        return NC_EHDFERR;
+    var->written_to = NC_TRUE;
+    return NC_NOERR;
+#else
+    return NC_ENOTBUILT;
+#endif
+}
+
+/**
+ * @internal List the allocated chunks of a variable. See
+ * nc_inq_var_chunk_info().
+ *
+ * @param ncid File or group ID.
+ * @param varid Variable ID.
+ * @param maxchunks Number of chunks the arrays have room for.
+ * @param nchunksp Gets the number of chunks. Ignored if NULL.
+ * @param offsets Gets the chunk offsets. Ignored if NULL.
+ * @param addrs Gets the file addresses. Ignored if NULL.
+ * @param nbytes Gets the stored sizes. Ignored if NULL.
+ * @param filtermasks Gets the filter masks. Ignored if NULL.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EINVAL Variable is not chunked, or has more than
+ * maxchunks chunks and an array was given.
+ * @return ::NC_ENOTBUILT HDF5 lacks chunk queries.
+ */
+int
+NC4_hdf5_inq_var_chunk_info(int ncid, int varid, size_t maxchunks,
+                            size_t *nchunksp, size_t *offsets,
+                            unsigned long long *addrs, size_t *nbytes,
+                            unsigned int *filtermasks)
+{
+#ifdef HDF5_HAS_DIRECT_CHUNK
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NC_HDF5_VAR_INFO_T *hdf5_var;
+    hsize_t hoffset[NC_MAX_VAR_DIMS];
+    hsize_t nchunks = 0, i, size;
+    haddr_t addr;
+    unsigned int mask;
+    hid_t spaceid;
+    int retval = NC_NOERR, d;
+
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+        return retval;
+    if (var->ndims < 1 || var->contiguous || !var->chunksizes)
+        return NC_EINVAL;
+
+    /* A variable defined in this define mode has no dataset yet, and
+     * so no chunks. */
+    hdf5_var = (NC_HDF5_VAR_INFO_T *)var->format_var_info;
+    if (!hdf5_var->hdf_datasetid)
+    {
+        if (nchunksp)
+            *nchunksp = 0;
+        return NC_NOERR;
+    }
+
+    if (!h5->no_write && H5Dflush(hdf5_var->hdf_datasetid) < 0)
+        return NC_EHDFERR;
+    if ((spaceid = H5Dget_space(hdf5_var->hdf_datasetid)) < 0)
+        return NC_EHDFERR;
+    if (H5Dget_num_chunks(hdf5_var->hdf_datasetid, spaceid, &nchunks) < 0)
+        BAIL(NC_EHDFERR);
+    if (nchunksp)
+        *nchunksp = (size_t)nchunks;
+
+    if (offsets || addrs || nbytes || filtermasks)
+    {
+        /* Chunks may have been written since the caller counted
+         * them. */
+        if (nchunks > (hsize_t)maxchunks)
+            BAIL(NC_EINVAL);
+        for (i = 0; i < nchunks; i++)
+        {
+            if (H5Dget_chunk_info(hdf5_var->hdf_datasetid, spaceid, i, hoffset,
+                                  &mask, &addr, &size) < 0)
+                BAIL(NC_EHDFERR);
+            if (offsets)
+                for (d = 0; d < var->ndims; d++)
+                    offsets[(size_t)i * var->ndims + (size_t)d] = (size_t)hoffset[d];
+            if (addrs)
+                addrs[i] = (unsigned long long)addr;
+            if (nbytes)
+                nbytes[i] = (size_t)size;
+            if (filtermasks)
+                filtermasks[i] = mask;
+        }
+    }
+
+exit:
+    if (H5Sclose(spaceid) < 0 && !retval)
+        retval = NC_EHDFERR;
+    return retval;
+#else
+    return NC_ENOTBUILT;
+#endif
+}
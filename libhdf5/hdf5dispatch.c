@@ -60,7 +60,7 @@ static const NC_Dispatch HDF5_dispatcher = {
 
     NC4_HDF5_inq_var_all,
 
-    NC4_var_par_access,
+    NC4_HDF5_var_par_access,
     NC4_def_var_fill,
 
     NC4_show_metadata,
@@ -101,6 +101,15 @@ static const NC_Dispatch HDF5_dispatcher = {
     NC4_def_var_filter,
     NC4_HDF5_set_var_chunk_cache,
     NC4_get_var_chunk_cache,
+    NC4_hdf5_def_var_chunk_intent,
+    NC4_hdf5_inq_var_chunk_intent,
+    NC4_hdf5_read_chunk,
+    NC4_hdf5_write_chunk,
+    NC4_hdf5_inq_var_chunk_info,
+    NC4_hdf5_inq_var_filter_ids,
+    NC4_hdf5_inq_var_filter_info,
+    NC4_hdf5_def_var_quantize,
+    NC4_hdf5_inq_var_quantize,
 
 };
 
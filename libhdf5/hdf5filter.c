@@ -0,0 +1,807 @@
+/* Copyright 2019, University Corporation for Atmospheric
+ * Research. See COPYRIGHT file for copying and redistribution
+ * conditions. */
+/**
+ * @file @internal In-library versions of the shuffle, bitshuffle and
+ * fletcher32 filters.
+ *
+ * HDF5's own shuffle and fletcher32 filters work a byte (or a 16-bit
+ * word) at a time. The kernels here produce exactly the same bytes,
+ * but use SSE2 (and, where the CPU has it, AVX2). HDF5 does not let
+ * its predefined filters be replaced, so they are used where this
+ * library runs the filter pipeline itself: the direct chunk I/O path
+ * of hdf5chunk.c.
+ *
+ * Bitshuffle is registered with HDF5 (through nc_filter_register()'s
+ * table) under the id of the bitshuffle plugin, 32008, with the
+ * plugin's parameters and stored format, but without its LZ4/Zstd
+ * compression; pair it with deflate instead. It is only registered
+ * when no plugin supplies the filter (see nc4_filter_provide()).
+ */
+
+#include "config.h"
+#include "hdf5internal.h"
+#include "netcdf_filter.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NC_HAVE_SSE2 1
+#endif
+
+#if defined(NC_HAVE_SSE2) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (__GNUC__ >= 5 || defined(__clang__))
+#include <immintrin.h>
+#define NC_HAVE_AVX2 1
+/** Compile one function for AVX2; it is only called if the CPU has it. */
+#define NC_AVX2 __attribute__((target("avx2")))
+#endif
+
+/** Element sizes up to this (a power of 2) get the vector kernels. */
+#define NC_SIMD_MAX_SIZE 8
+
+/** Number of 16-bit words summed between fletcher32 reductions; this
+ * must match HDF5. */
+#define NC_FLETCHER32_BLOCK 360
+
+/** Size of the fletcher32 checksum appended to each chunk. */
+#define NC_FLETCHER32_LEN 4
+
+/** Bitshuffle works on blocks of a multiple of this many elements. */
+#define NC_BSHUF_BLOCKED_MULT 8
+
+/** Bitshuffle's default block size, in bytes. */
+#define NC_BSHUF_TARGET_BLOCK 8192
+
+/** Bitshuffle's smallest default block, in elements. */
+#define NC_BSHUF_MIN_BLOCK 128
+
+/** Version of the bitshuffle format recorded in the filter parameters. */
+#define NC_BSHUF_VERSION_MAJOR 0
+#define NC_BSHUF_VERSION_MINOR 3
+
+/* Filter parameters of the bitshuffle plugin. */
+#define NC_BSHUF_PARM_ELEMSIZE 2
+#define NC_BSHUF_PARM_BLOCKSIZE 3
+#define NC_BSHUF_PARM_COMPRESS 4
+#define NC_BSHUF_MAX_PARMS 8
+
+/** Non-zero if the CPU can run the AVX2 kernels; set by
+ * nc4_hdf5_filter_initialize(). */
+static int nc4_have_avx2 = 0;
+
+/**************************************************/
+/* Shuffle */
+
+/** Unshuffle loop for one element size; writes dst sequentially, which
+ * lets the compiler unroll the inner loop for the common sizes. */
+#define UNSHUFFLE_LOOP(SIZE)                                    \
+    for (i = first; i < nelems; i++)                            \
+        for (j = 0; j < (SIZE); j++)                            \
+            *d++ = src[j * nelems + i]
+
+/**
+ * @internal Shuffle or unshuffle elements first to nelems-1 one byte
+ * at a time.
+ *
+ * @param src Input bytes.
+ * @param dst Gets the output bytes.
+ * @param nelems Number of elements.
+ * @param size Element size.
+ * @param first First element to do.
+ * @param reverse Non-zero to unshuffle.
+ */
+static void
+shuffle_scalar(const unsigned char *src, unsigned char *dst, size_t nelems,
+               size_t size, size_t first, int reverse)
+{
+    unsigned char *d;
+    size_t i, j;
+
+    if (reverse)
+    {
+        d = dst + first * size;
+        switch (size)
+        {
+        case 2: UNSHUFFLE_LOOP(2); break;
+        case 4: UNSHUFFLE_LOOP(4); break;
+        case 8: UNSHUFFLE_LOOP(8); break;
+        default: UNSHUFFLE_LOOP(size); break;
+        }
+    }
+    else
+    {
+        /* Byte j of every element goes to plane j. */
+        for (j = 0; j < size; j++)
+        {
+            d = dst + j * nelems + first;
+            for (i = first; i < nelems; i++)
+                *d++ = src[i * size + j];
+        }
+    }
+}
+
+#ifdef NC_HAVE_SSE2
+/*
+ * The vector kernels treat a block of 16 elements of size 2^b as a
+ * 16 x 2^b byte matrix. Interleaving the bytes of its first and second
+ * halves (one round of unpacklo/unpackhi) rotates the bit index of
+ * every byte left by one; four rounds transpose the block (shuffle),
+ * and b rounds undo that (unshuffle).
+ */
+
+/**
+ * @internal One interleaving round over the registers of a block.
+ *
+ * @param x The block, nreg registers.
+ * @param nreg Number of registers (the element size).
+ */
+static void
+interleave_sse2(__m128i *x, size_t nreg)
+{
+    __m128i y[NC_SIMD_MAX_SIZE];
+    size_t half = nreg / 2, k;
+
+    for (k = 0; k < half; k++)
+    {
+        y[2 * k] = _mm_unpacklo_epi8(x[k], x[k + half]);
+        y[2 * k + 1] = _mm_unpackhi_epi8(x[k], x[k + half]);
+    }
+    for (k = 0; k < nreg; k++)
+        x[k] = y[k];
+}
+
+/**
+ * @internal Shuffle or unshuffle whole blocks of 16 elements with
+ * SSE2.
+ *
+ * @param src Input bytes.
+ * @param dst Gets the output bytes.
+ * @param nelems Number of elements.
+ * @param size Element size: 2, 4 or 8.
+ * @param first First element to do.
+ * @param reverse Non-zero to unshuffle.
+ *
+ * @return Index of the first element not done.
+ */
+static size_t
+shuffle_sse2(const unsigned char *src, unsigned char *dst, size_t nelems,
+             size_t size, size_t first, int reverse)
+{
+    __m128i x[NC_SIMD_MAX_SIZE];
+    size_t rounds = 4, i, k, r;
+
+    if (reverse)
+        for (rounds = 0; ((size_t)1 << rounds) < size; rounds++)
+            ;
+    for (i = first; i + 16 <= nelems; i += 16)
+    {
+        for (k = 0; k < size; k++)
+            x[k] = _mm_loadu_si128((const __m128i *)(reverse ?
+                                                     src + k * nelems + i :
+                                                     src + i * size + 16 * k));
+        for (r = 0; r < rounds; r++)
+            interleave_sse2(x, size);
+        for (k = 0; k < size; k++)
+            _mm_storeu_si128((__m128i *)(reverse ? dst + i * size + 16 * k :
+                                         dst + k * nelems + i), x[k]);
+    }
+    return i;
+}
+#endif /* NC_HAVE_SSE2 */
+
+#ifdef NC_HAVE_AVX2
+/**
+ * @internal One interleaving round over two blocks at once, one per
+ * 128-bit lane.
+ *
+ * @param x The blocks, nreg registers.
+ * @param nreg Number of registers (the element size).
+ */
+NC_AVX2 static void
+interleave_avx2(__m256i *x, size_t nreg)
+{
+    __m256i y[NC_SIMD_MAX_SIZE];
+    size_t half = nreg / 2, k;
+
+    for (k = 0; k < half; k++)
+    {
+        y[2 * k] = _mm256_unpacklo_epi8(x[k], x[k + half]);
+        y[2 * k + 1] = _mm256_unpackhi_epi8(x[k], x[k + half]);
+    }
+    for (k = 0; k < nreg; k++)
+        x[k] = y[k];
+}
+
+/**
+ * @internal Shuffle or unshuffle pairs of 16 element blocks with
+ * AVX2; the low lane holds the first block, the high lane the second.
+ *
+ * @param src Input bytes.
+ * @param dst Gets the output bytes.
+ * @param nelems Number of elements.
+ * @param size Element size: 2, 4 or 8.
+ * @param reverse Non-zero to unshuffle.
+ *
+ * @return Index of the first element not done.
+ */
+NC_AVX2 static size_t
+shuffle_avx2(const unsigned char *src, unsigned char *dst, size_t nelems,
+             size_t size, int reverse)
+{
+    __m256i x[NC_SIMD_MAX_SIZE];
+    size_t rounds = 4, i, k, r;
+
+    if (reverse)
+        for (rounds = 0; ((size_t)1 << rounds) < size; rounds++)
+            ;
+    for (i = 0; i + 32 <= nelems; i += 32)
+    {
+        if (reverse)
+        {
+            for (k = 0; k < size; k++)
+                x[k] = _mm256_loadu_si256((const __m256i *)(src + k * nelems + i));
+        }
+        else
+        {
+            const unsigned char *a = src + i * size;
+            const unsigned char *b = a + 16 * size;
+
+            for (k = 0; k < size; k++)
+                x[k] = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(a + 16 * k))),
+                    _mm_loadu_si128((const __m128i *)(b + 16 * k)), 1);
+        }
+        for (r = 0; r < rounds; r++)
+            interleave_avx2(x, size);
+        if (reverse)
+        {
+            unsigned char *a = dst + i * size;
+            unsigned char *b = a + 16 * size;
+
+            for (k = 0; k < size; k++)
+            {
+                _mm_storeu_si128((__m128i *)(a + 16 * k), _mm256_castsi256_si128(x[k]));
+                _mm_storeu_si128((__m128i *)(b + 16 * k), _mm256_extracti128_si256(x[k], 1));
+            }
+        }
+        else
+        {
+            for (k = 0; k < size; k++)
+                _mm256_storeu_si256((__m256i *)(dst + k * nelems + i), x[k]);
+        }
+    }
+    return i;
+}
+#endif /* NC_HAVE_AVX2 */
+
+/**
+ * @internal Apply or undo the HDF5 shuffle filter: byte j of element i
+ * goes to dst[j * nelems + i]. Bytes past the last whole element are
+ * copied as they are.
+ *
+ * @param src Input bytes.
+ * @param dst Gets the output bytes; must not overlap src.
+ * @param nbytes Number of bytes.
+ * @param size Element size.
+ * @param reverse Non-zero to unshuffle.
+ */
+void
+nc4_shuffle(const unsigned char *src, unsigned char *dst, size_t nbytes,
+            size_t size, int reverse)
+{
+    size_t nelems = size ? nbytes / size : 0;
+    size_t done = 0;
+
+    if (size <= 1 || nelems <= 1)
+    {
+        memcpy(dst, src, nbytes);
+        return;
+    }
+    if (size == 2 || size == 4 || size == 8)
+    {
+#ifdef NC_HAVE_AVX2
+        if (nc4_have_avx2)
+            done = shuffle_avx2(src, dst, nelems, size, reverse);
+#endif
+#ifdef NC_HAVE_SSE2
+        done = shuffle_sse2(src, dst, nelems, size, done, reverse);
+#endif
+    }
+    shuffle_scalar(src, dst, nelems, size, done, reverse);
+    if (nelems * size < nbytes)
+        memcpy(dst + nelems * size, src + nelems * size,
+               nbytes - nelems * size);
+}
+
+/**************************************************/
+/* Bitshuffle */
+
+/** Transpose the 8x8 bit matrix held in x: bit k of byte m swaps with
+ * bit m of byte k. */
+#define TRANSPOSE_BITS_8X8(x, t)                                \
+    do {                                                        \
+        t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;             \
+        x = x ^ t ^ (t << 7);                                   \
+        t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;            \
+        x = x ^ t ^ (t << 14);                                  \
+        t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;            \
+        x = x ^ t ^ (t << 28);                                  \
+    } while (0)
+
+/**
+ * @internal Spread the bits of one plane of byte-shuffled elements
+ * into 8 bit planes: bit k of in[i] becomes bit i%8 of
+ * out[k * nelems / 8 + i / 8].
+ *
+ * @param in One byte from each element.
+ * @param out Gets the bit planes.
+ * @param nelems Number of elements, a multiple of 8.
+ */
+static void
+bit_planes(const unsigned char *in, unsigned char *out, size_t nelems)
+{
+    size_t row = nelems / 8, i = 0;
+    unsigned long long x, t;
+    int k;
+
+#ifdef NC_HAVE_SSE2
+    /* The sign bits of 16 bytes at once; shifting left brings the
+     * next bit up. */
+    for (; i + 16 <= nelems; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+        for (k = 7; k >= 0; k--)
+        {
+            int bits = _mm_movemask_epi8(v);
+
+            out[(size_t)k * row + i / 8] = (unsigned char)bits;
+            out[(size_t)k * row + i / 8 + 1] = (unsigned char)(bits >> 8);
+            v = _mm_slli_epi16(v, 1);
+        }
+    }
+#endif
+    for (; i < nelems; i += 8)
+    {
+        x = 0;
+        for (k = 0; k < 8; k++)
+            x |= (unsigned long long)in[i + (size_t)k] << (8 * k);
+        TRANSPOSE_BITS_8X8(x, t);
+        for (k = 0; k < 8; k++)
+            out[(size_t)k * row + i / 8] = (unsigned char)(x >> (8 * k));
+    }
+}
+
+/**
+ * @internal Undo bit_planes().
+ *
+ * @param in The bit planes.
+ * @param out Gets one byte of each element.
+ * @param nelems Number of elements, a multiple of 8.
+ */
+static void
+unbit_planes(const unsigned char *in, unsigned char *out, size_t nelems)
+{
+    size_t row = nelems / 8, i;
+    unsigned long long x, t;
+    int k;
+
+    for (i = 0; i < nelems; i += 8)
+    {
+        x = 0;
+        for (k = 0; k < 8; k++)
+            x |= (unsigned long long)in[(size_t)k * row + i / 8] << (8 * k);
+        TRANSPOSE_BITS_8X8(x, t);
+        for (k = 0; k < 8; k++)
+            out[i + (size_t)k] = (unsigned char)(x >> (8 * k));
+    }
+}
+
+/**
+ * @internal Bitshuffle or unshuffle one block: bit b of element i goes
+ * to bit i of bit plane b, byte by byte. The byte shuffle is done by
+ * nc4_shuffle().
+ *
+ * @param src Input bytes.
+ * @param dst Gets the output.
+ * @param tmp Scratch space of the same size.
+ * @param nelems Number of elements, a multiple of 8.
+ * @param size Element size.
+ * @param reverse Non-zero to undo the bitshuffle.
+ */
+static void
+bitshuffle_block(const unsigned char *src, unsigned char *dst,
+                 unsigned char *tmp, size_t nelems, size_t size, int reverse)
+{
+    size_t nbytes = nelems * size, j;
+
+    if (reverse)
+    {
+        for (j = 0; j < size; j++)
+            unbit_planes(src + j * nelems, tmp + j * nelems, nelems);
+        nc4_shuffle(tmp, dst, nbytes, size, 1);
+    }
+    else
+    {
+        nc4_shuffle(src, tmp, nbytes, size, 0);
+        for (j = 0; j < size; j++)
+            bit_planes(tmp + j * nelems, dst + j * nelems, nelems);
+    }
+}
+
+/**
+ * @internal Default bitshuffle block size, in elements, as chosen by
+ * the bitshuffle plugin.
+ *
+ * @param size Element size.
+ *
+ * @return Block size.
+ */
+static size_t
+bitshuffle_block_size(size_t size)
+{
+    size_t block = NC_BSHUF_TARGET_BLOCK / size;
+
+    block = block / NC_BSHUF_BLOCKED_MULT * NC_BSHUF_BLOCKED_MULT;
+    return block > NC_BSHUF_MIN_BLOCK ? block : NC_BSHUF_MIN_BLOCK;
+}
+
+/**
+ * @internal Apply or undo the bitshuffle filter, in the format of the
+ * bitshuffle plugin without compression. Elements are taken in blocks
+ * of blocksize; the last block is cut down to a multiple of 8
+ * elements, and the elements left after that are copied as they are.
+ *
+ * @param src Input bytes.
+ * @param dst Gets the output; must not overlap src.
+ * @param nbytes Number of bytes, a multiple of size.
+ * @param size Element size.
+ * @param blocksize Elements per block, a multiple of 8; 0 for the
+ * default.
+ * @param reverse Non-zero to undo the bitshuffle.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EINVAL Bad size or block size.
+ * @return ::NC_ENOMEM Out of memory.
+ */
+int
+nc4_bitshuffle(const unsigned char *src, unsigned char *dst, size_t nbytes,
+               size_t size, size_t blocksize, int reverse)
+{
+    size_t nelems, done = 0, n;
+    unsigned char *tmp;
+
+    if (size == 0 || nbytes % size || blocksize % NC_BSHUF_BLOCKED_MULT)
+        return NC_EINVAL;
+    if (blocksize == 0)
+        blocksize = bitshuffle_block_size(size);
+    nelems = nbytes / size;
+    if (!(tmp = malloc(blocksize * size)))
+        return NC_ENOMEM;
+    while (done < nelems)
+    {
+        n = nelems - done;
+        if (n > blocksize)
+            n = blocksize;
+        n -= n % NC_BSHUF_BLOCKED_MULT;
+        if (n == 0)
+            break;
+        bitshuffle_block(src + done * size, dst + done * size, tmp, n, size,
+                         reverse);
+        done += n;
+    }
+    if (done < nelems)
+        memcpy(dst + done * size, src + done * size, (nelems - done) * size);
+    free(tmp);
+    return NC_NOERR;
+}
+
+/**************************************************/
+/* Fletcher32 */
+
+/**
+ * @internal Compute the fletcher32 checksum of a buffer, exactly as
+ * HDF5 does: the data are summed as big-endian 16-bit words (an odd
+ * last byte is the high byte of a word), and the sums are folded
+ * every 360 words.
+ *
+ * Within a run of 8n words, sum1 grows by the sum of the words, and
+ * sum2 by n times sum1 plus the sum of the words weighted by their
+ * distance from the end of the run; both are found 8 words at a time.
+ *
+ * @param data The bytes.
+ * @param len Number of bytes.
+ *
+ * @return The checksum.
+ */
+unsigned int
+nc4_fletcher32(const unsigned char *data, size_t len)
+{
+    size_t nwords = len / 2;
+    unsigned int sum1 = 0, sum2 = 0;
+
+    while (nwords)
+    {
+        size_t tlen = nwords > NC_FLETCHER32_BLOCK ? NC_FLETCHER32_BLOCK : nwords;
+        size_t i = 0;
+
+        nwords -= tlen;
+#ifdef NC_HAVE_SSE2
+        if (tlen >= 8)
+        {
+            __m128i zero = _mm_setzero_si128();
+            __m128i alo = zero, ahi = zero, blo = zero, bhi = zero;
+            unsigned int a[8], b[8];
+            unsigned int nvec = (unsigned int)(tlen / 8);
+            int l;
+
+            for (; i + 8 <= tlen; i += 8)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *)(data + 2 * i));
+
+                /* Byte swap each word, then widen to 32 bits. */
+                v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+                alo = _mm_add_epi32(alo, _mm_unpacklo_epi16(v, zero));
+                ahi = _mm_add_epi32(ahi, _mm_unpackhi_epi16(v, zero));
+                blo = _mm_add_epi32(blo, alo);
+                bhi = _mm_add_epi32(bhi, ahi);
+            }
+            _mm_storeu_si128((__m128i *)a, alo);
+            _mm_storeu_si128((__m128i *)(a + 4), ahi);
+            _mm_storeu_si128((__m128i *)b, blo);
+            _mm_storeu_si128((__m128i *)(b + 4), bhi);
+
+            /* Word l of vector j is word 8j+l of the run; its weight
+             * is 8(nvec-j)-l, and b[l] holds (nvec-j) times it. */
+            sum2 += 8 * nvec * sum1;
+            for (l = 0; l < 8; l++)
+            {
+                sum1 += a[l];
+                sum2 += 8 * b[l] - (unsigned int)l * a[l];
+            }
+        }
+#endif
+        data += 2 * i;
+        for (; i < tlen; i++)
+        {
+            sum1 += (unsigned int)((data[0] << 8) | data[1]);
+            data += 2;
+            sum2 += sum1;
+        }
+        sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+        sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+    }
+    if (len % 2)
+    {
+        sum1 += (unsigned int)(*data << 8);
+        sum2 += sum1;
+        sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+        sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+    }
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+    return (sum2 << 16) | sum1;
+}
+
+/**
+ * @internal Check the fletcher32 checksum at the end of a chunk. Like
+ * HDF5, a checksum with the bytes of each half swapped is also
+ * accepted, as written by old versions of HDF5.
+ *
+ * @param data The chunk, checksum included.
+ * @param nbytes Size of the chunk.
+ *
+ * @return 1 if the checksum matches, 0 if not.
+ */
+int
+nc4_fletcher32_check(const unsigned char *data, size_t nbytes)
+{
+    unsigned int sum, stored, reversed;
+    const unsigned char *p;
+
+    if (nbytes < NC_FLETCHER32_LEN)
+        return 0;
+    nbytes -= NC_FLETCHER32_LEN;
+    p = data + nbytes;
+    stored = (unsigned int)p[0] | (unsigned int)p[1] << 8 |
+        (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24;
+    sum = nc4_fletcher32(data, nbytes);
+    reversed = ((sum & 0x00ff00ffu) << 8) | ((sum >> 8) & 0x00ff00ffu);
+    return stored == sum || stored == reversed;
+}
+
+/**
+ * @internal Append the fletcher32 checksum of a buffer to it.
+ *
+ * @param data The bytes; must have room for 4 more.
+ * @param nbytes Number of bytes.
+ */
+void
+nc4_fletcher32_append(unsigned char *data, size_t nbytes)
+{
+    unsigned int sum = nc4_fletcher32(data, nbytes);
+
+    data[nbytes] = (unsigned char)sum;
+    data[nbytes + 1] = (unsigned char)(sum >> 8);
+    data[nbytes + 2] = (unsigned char)(sum >> 16);
+    data[nbytes + 3] = (unsigned char)(sum >> 24);
+}
+
+/**************************************************/
+/* HDF5 filter classes */
+
+/**
+ * @internal Allocate a buffer to hand back to HDF5. This is keyed on
+ * the same macro as filter_free() so a buffer is never allocated by
+ * one library and freed by the other.
+ *
+ * @param size Number of bytes.
+ *
+ * @return The buffer, or NULL.
+ */
+static void *
+filter_alloc(size_t size)
+{
+#ifdef HAVE_H5FREE_MEMORY
+    return H5allocate_memory(size, 0);
+#else
+    return malloc(size);
+#endif
+}
+
+/**
+ * @internal Free a buffer that HDF5 handed to a filter.
+ *
+ * @param buf The buffer.
+ */
+static void
+filter_free(void *buf)
+{
+#ifdef HAVE_H5FREE_MEMORY
+    H5free_memory(buf);
+#else
+    free(buf);
+#endif
+}
+
+/**
+ * @internal Fill in the bitshuffle parameters for a dataset, as the
+ * bitshuffle plugin does: format version, element size, and any block
+ * size and compression the user gave.
+ *
+ * @param dcpl_id Dataset creation property list.
+ * @param type_id Datatype of the dataset.
+ * @param space_id Dataspace of the dataset (ignored).
+ *
+ * @return Non-negative on success.
+ */
+static herr_t
+bitshuffle_set_local(hid_t dcpl_id, hid_t type_id, hid_t space_id)
+{
+    unsigned int flags, cd_values[NC_BSHUF_MAX_PARMS];
+    size_t cd_nelmts = NC_BSHUF_MAX_PARMS, size, i;
+
+    (void)space_id;
+    if ((size = H5Tget_size(type_id)) == 0)
+        return -1;
+    if (H5Pget_filter_by_id2(dcpl_id, H5Z_FILTER_BITSHUFFLE, &flags,
+                             &cd_nelmts, cd_values, 0, NULL, NULL) < 0)
+        return -1;
+    for (i = cd_nelmts; i < NC_BSHUF_PARM_BLOCKSIZE; i++)
+        cd_values[i] = 0;
+    if (cd_nelmts < NC_BSHUF_PARM_BLOCKSIZE)
+        cd_nelmts = NC_BSHUF_PARM_BLOCKSIZE;
+    cd_values[0] = NC_BSHUF_VERSION_MAJOR;
+    cd_values[1] = NC_BSHUF_VERSION_MINOR;
+    cd_values[NC_BSHUF_PARM_ELEMSIZE] = (unsigned int)size;
+    if (cd_nelmts > NC_BSHUF_PARM_BLOCKSIZE &&
+        cd_values[NC_BSHUF_PARM_BLOCKSIZE] % NC_BSHUF_BLOCKED_MULT)
+        return -1;
+    return H5Pmodify_filter(dcpl_id, H5Z_FILTER_BITSHUFFLE, flags, cd_nelmts,
+                            cd_values);
+}
+
+/**
+ * @internal The bitshuffle filter. Only uncompressed bitshuffle is
+ * supported; a chunk compressed by the plugin makes it fail.
+ *
+ * @param flags H5Z_FLAG_REVERSE when reading.
+ * @param cd_nelmts Number of parameters.
+ * @param cd_values Parameters, as set by bitshuffle_set_local().
+ * @param nbytes Number of bytes in the buffer.
+ * @param buf_size Size of the buffer.
+ * @param buf The buffer; replaced by the output.
+ *
+ * @return Number of output bytes, or 0 on failure.
+ */
+static size_t
+bitshuffle_filter(unsigned int flags, size_t cd_nelmts,
+                  const unsigned int cd_values[], size_t nbytes,
+                  size_t *buf_size, void **buf)
+{
+    size_t size, blocksize = 0;
+    unsigned char *out;
+
+    if (cd_nelmts <= NC_BSHUF_PARM_ELEMSIZE)
+        return 0;
+    size = cd_values[NC_BSHUF_PARM_ELEMSIZE];
+    if (cd_nelmts > NC_BSHUF_PARM_BLOCKSIZE)
+        blocksize = cd_values[NC_BSHUF_PARM_BLOCKSIZE];
+    if (cd_nelmts > NC_BSHUF_PARM_COMPRESS && cd_values[NC_BSHUF_PARM_COMPRESS])
+        return 0;
+    if (!(out = filter_alloc(nbytes)))
+        return 0;
+    if (nc4_bitshuffle(*buf, out, nbytes, size, blocksize,
+                       (flags & H5Z_FLAG_REVERSE) != 0))
+    {
+        filter_free(out);
+        return 0;
+    }
+    filter_free(*buf);
+    *buf = out;
+    *buf_size = nbytes;
+    return nbytes;
+}
+
+/** Bitshuffle, without compression. */
+static const H5Z_class2_t nc4_bitshuffle_class = {
+    H5Z_CLASS_T_VERS, H5Z_FILTER_BITSHUFFLE, 1, 1, "bitshuffle",
+    NULL, bitshuffle_set_local, bitshuffle_filter
+};
+
+/**
+ * @internal Register one filter class with nc_filter_register().
+ *
+ * @param cls The filter class.
+ *
+ * @return ::NC_NOERR No error (including if it already was).
+ */
+static int
+register_filter(const H5Z_class2_t *cls)
+{
+    NC_FILTER_INFO info;
+    int stat;
+
+    info.version = NC_FILTER_INFO_VERSION;
+    info.format = NC_FILTER_FORMAT_HDF5;
+    info.id = (int)cls->id;
+    info.info = (void *)cls;
+    stat = nc4_filter_action(FILTER_REG, NC_FILTER_FORMAT_HDF5, info.id, &info);
+    return stat == NC_ENAMEINUSE ? NC_NOERR : stat;
+}
+
+/**
+ * @internal Find out which vector kernels the CPU can run. Called when
+ * the HDF5 layer is initialized.
+ */
+void
+nc4_hdf5_filter_initialize(void)
+{
+#ifdef NC_HAVE_AVX2
+    __builtin_cpu_init();
+    nc4_have_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+}
+
+/**
+ * @internal Make sure HDF5 can run a filter that this library can
+ * supply itself (bitshuffle). A plugin for the filter on
+ * HDF5_PLUGIN_PATH is preferred, since it may support more of the
+ * filter's options; only if there is none is our own registered.
+ * Other filter ids are left alone.
+ *
+ * @param id Filter id.
+ *
+ * @return ::NC_NOERR No error.
+ */
+int
+nc4_filter_provide(unsigned int id)
+{
+    if (id != H5Z_FILTER_BITSHUFFLE)
+        return NC_NOERR;
+    /* This looks for a plugin, and loads it if there is one. */
+    if (H5Zfilter_avail(H5Z_FILTER_BITSHUFFLE) > 0)
+        return NC_NOERR;
+    return register_filter(&nc4_bitshuffle_class);
+}
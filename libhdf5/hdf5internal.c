@@ -78,6 +78,7 @@ nc4_hdf5_initialize(void)
     if (set_auto(NULL, NULL) < 0)
         LOG((0, "Couldn't turn off HDF5 error messages!"));
     LOG((1, "HDF5 error messages have been turned off."));
+    nc4_hdf5_filter_initialize();
     nc4_hdf5_initialized = 1;
 }
 
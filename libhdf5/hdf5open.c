@@ -914,9 +914,9 @@ NC4_open(const char *path, int mode, int basepe, size_t *chunksizehintp,
 }
 
 /**
- * @internal Find out what filters are applied to this HDF5 dataset,
- * fletcher32, deflate, and/or shuffle. All other filters are just
- * dumped The possible values of
+ * @internal Find out what filters are applied to this HDF5 dataset.
+ * Shuffle and fletcher32 set flags; deflate and all other filters are
+ * added to the var's filter chain in pipeline order.
  *
  * @param propid ID of HDF5 var creation properties list.
  * @param var Pointer to NC_VAR_INFO_T for this variable.
@@ -933,6 +933,7 @@ static int get_filter_info(hid_t propid, NC_VAR_INFO_T *var)
     unsigned int cd_values_zip[CD_NELEMS_ZLIB];
     size_t cd_nelems = CD_NELEMS_ZLIB;
     int f;
+    int retval;
 
     assert(var);
 
@@ -941,6 +942,9 @@ static int get_filter_info(hid_t propid, NC_VAR_INFO_T *var)
 
     for (f = 0; f < num_filters; f++)
     {
+        unsigned int *params = NULL;
+
+        cd_nelems = CD_NELEMS_ZLIB;
         if ((filter = H5Pget_filter2(propid, f, NULL, &cd_nelems, cd_values_zip,
                                      0, NULL, NULL)) < 0)
             return NC_EHDFERR;
@@ -959,43 +963,37 @@ static int get_filter_info(hid_t propid, NC_VAR_INFO_T *var)
             if (cd_nelems != CD_NELEMS_ZLIB ||
                 cd_values_zip[0] > NC_MAX_DEFLATE_LEVEL)
                 return NC_EHDFERR;
-            var->deflate_level = cd_values_zip[0];
-            break;
-
-        case H5Z_FILTER_SZIP:
-            /* Szip is tricky because the filter code expands the set of parameters from 2 to 4
-               and changes some of the parameter values */
-            var->filterid = filter;
-            if(cd_nelems == 0)
-                var->params = NULL;
-            else {
-                /* We have to re-read the parameters based on actual nparams,
-                   which in the case of szip, differs from users original nparams */
-                var->params = (unsigned int*)calloc(1,sizeof(unsigned int)*cd_nelems);
-                if(var->params == NULL)
-                    return NC_ENOMEM;
-                if((filter = H5Pget_filter2(propid, f, NULL, &cd_nelems,
-                                            var->params, 0, NULL, NULL)) < 0)
-                    return NC_EHDFERR;
-                /* fix up the parameters and the #params */
-                var->nparams = cd_nelems;
-            }
+            var->deflate_level = (int)cd_values_zip[0];
+            if ((retval = nc4_var_filter_add(var, H5Z_FILTER_DEFLATE,
+                                             CD_NELEMS_ZLIB, cd_values_zip)))
+                return retval;
             break;
 
         default:
-            var->filterid = filter;
-            var->nparams = cd_nelems;
-            if(cd_nelems == 0)
-                var->params = NULL;
-            else {
-                /* We have to re-read the parameters based on actual nparams */
-                var->params = (unsigned int*)calloc(1,sizeof(unsigned int)*var->nparams);
-                if(var->params == NULL)
+            /* Bitshuffle may have to come from this library. */
+            if (filter != H5Z_FILTER_SZIP &&
+                (retval = nc4_filter_provide((unsigned int)filter)))
+                return retval;
+            /* We have to re-read the parameters based on actual
+               nparams. (Szip expands its parameters from 2 to 4 and
+               changes some of the values.) */
+            if (cd_nelems)
+            {
+                if (!(params = calloc(cd_nelems, sizeof(unsigned int))))
                     return NC_ENOMEM;
-                if((filter = H5Pget_filter2(propid, f, NULL, &cd_nelems,
-                                            var->params, 0, NULL, NULL)) < 0)
+                if (H5Pget_filter2(propid, f, NULL, &cd_nelems, params, 0,
+                                   NULL, NULL) < 0)
+                {
+                    free(params);
                     return NC_EHDFERR;
+                }
             }
+            retval = nc4_var_filter_add(var, (unsigned int)filter, cd_nelems,
+                                        params);
+            if (params)
+                free(params);
+            if (retval)
+                return retval;
             break;
         }
     }
@@ -1057,6 +1055,53 @@ static int get_fill_info(hid_t propid, NC_VAR_INFO_T *var)
     return NC_NOERR;
 }
 
+/**
+ * @internal Learn the quantization setting of a var, from the
+ * attribute that records it.
+ *
+ * @param datasetid HDF5 dataset ID.
+ * @param var Pointer to NC_VAR_INFO_T for this variable.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EHDFERR HDF5 returned error.
+ */
+static int get_quantize_info(hid_t datasetid, NC_VAR_INFO_T *var)
+{
+    hid_t attid, spaceid;
+    htri_t exists;
+    hssize_t npoints;
+    int nsd = 0;
+    int retval = NC_NOERR;
+
+    if ((exists = H5Aexists(datasetid, NC_QUANTIZE_BITGROOM_ATT_NAME)) < 0)
+        return NC_EHDFERR;
+    if (!exists)
+        return NC_NOERR;
+
+    if ((attid = H5Aopen_name(datasetid, NC_QUANTIZE_BITGROOM_ATT_NAME)) < 0)
+        return NC_EHDFERR;
+    if ((spaceid = H5Aget_space(attid)) < 0)
+        retval = NC_EHDFERR;
+    else
+    {
+        npoints = H5Sget_simple_extent_npoints(spaceid);
+        /* Anything but a single number was not written by us. */
+        if (npoints == 1 && H5Aread(attid, H5T_NATIVE_INT, &nsd) < 0)
+            retval = NC_EHDFERR;
+        if (H5Sclose(spaceid) < 0)
+            retval = NC_EHDFERR;
+    }
+    if (!retval && nsd > 0)
+    {
+        var->quantize_mode = NC_QUANTIZE_BITGROOM;
+        var->nsd = nsd;
+    }
+    if (H5Aclose(attid) < 0)
+        return NC_EHDFERR;
+
+    return retval;
+}
+
 /**
  * @internal Learn the chunking settings of a var.
  *
@@ -1267,10 +1312,26 @@ nc4_get_var_meta(NC_VAR_INFO_T *var)
     if ((retval = get_filter_info(propid, var)))
         BAIL(retval);
 
+#ifdef USE_PARALLEL4
+    /* Parallel HDF5 can only write filtered data collectively, so
+     * in a writable file such a var starts out collective. */
+    {
+        NC_FILE_INFO_T *h5 = var->container->nc4_info;
+        if (h5->parallel && !h5->no_write &&
+            (var->deflate || var->shuffle || var->fletcher32 ||
+             nclistlength(var->filters)))
+            var->parallel_access = NC_COLLECTIVE;
+    }
+#endif
+
     /* Get fill value, if defined. */
     if ((retval = get_fill_info(propid, var)))
         BAIL(retval);
 
+    /* Get quantization setting, if any. */
+    if ((retval = get_quantize_info(hdf5_var->hdf_datasetid, var)))
+        BAIL(retval);
+
     /* Is this a deflated variable with a chunksize greater than the
      * current cache size? */
     if ((retval = nc4_adjust_var_cache(var->container, var)))
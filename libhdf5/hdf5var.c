@@ -134,6 +134,39 @@ check_chunksizes(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var, const size_t *chunksize
     return NC_NOERR;
 }
 
+/**
+ * @internal Determine chunksizes for a variable from its declared
+ * access intent. Only the leading dimension may be unlimited; other
+ * variables are left to the default algorithm.
+ *
+ * @param var Pointer to the var info.
+ * @param type_size Size of one value.
+ *
+ * @returns ::NC_NOERR Chunksizes were set.
+ * @returns ::NC_EINVAL Intent does not apply to this var.
+ */
+static int
+find_intent_chunksizes(NC_VAR_INFO_T *var, size_t type_size)
+{
+    size_t dimlens[NC_MAX_VAR_DIMS];
+    int unlimited[NC_MAX_VAR_DIMS];
+    int d;
+
+    if (var->chunk_intent == NC_CHUNK_INTENT_DEFAULT || !var->ndims ||
+        var->ndims > NC_MAX_VAR_DIMS)
+        return NC_EINVAL;
+    for (d = 0; d < var->ndims; d++)
+    {
+        assert(var->dim[d]);
+        if (d > 0 && var->dim[d]->unlimited)
+            return NC_EINVAL;
+        dimlens[d] = var->dim[d]->len;
+        unlimited[d] = var->dim[d]->unlimited;
+    }
+    return NC_compute_chunk_shape(var->chunk_intent, type_size, DEFAULT_CHUNK_SIZE,
+                                  var->ndims, dimlens, unlimited, var->chunksizes);
+}
+
 /**
  * @internal Determine some default chunksizes for a variable.
  *
@@ -168,6 +201,11 @@ nc4_find_default_chunksizes2(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var)
     total_chunk_size = (double) type_size;
 #endif
 
+    /* If the user declared how this var will be read, let the
+     * chunk-shape optimizer choose. */
+    if (!find_intent_chunksizes(var, type_size))
+        goto check;
+
     /* How many values in the variable (or one record, if there are
      * unlimited dimensions). */
     for (d = 0; d < var->ndims; d++)
@@ -218,6 +256,7 @@ nc4_find_default_chunksizes2(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var)
                  "chunksize %ld", __func__, var->hdr.name, d, DEFAULT_CHUNK_SIZE, num_values, type_size, var->chunksizes[d]));
         }
 
+check:
 #ifdef LOGGING
     /* Find total chunk size. */
     for (d = 0; d < var->ndims; d++)
@@ -548,6 +587,12 @@ NC4_def_var(int ncid, const char *name, nc_type xtype, int ndims,
         var->dim[d] = dim;
     }
 
+    /* Use the file's default access intent when picking
+     * chunksizes. Declaring an intent asks for chunked storage. */
+    var->chunk_intent = h5->chunk_intent;
+    if (var->chunk_intent != NC_CHUNK_INTENT_DEFAULT && var->ndims)
+        var->contiguous = NC_FALSE;
+
     /* Determine default chunksizes for this variable. (Even for
      * variables which may be contiguous.) */
     LOG((4, "allocating array of %d size_t to hold chunksizes for var %s",
@@ -658,10 +703,13 @@ nc_def_var_extra(int ncid, int varid, int *shuffle, int *deflate,
         return NC_ENOTVAR;
     assert(var && var->hdr.id == varid);
 
-    /* Can't turn on parallel and deflate/fletcher32/szip/shuffle (for now). */
+    /* Can't turn on parallel and deflate/fletcher32/szip/shuffle
+     * before HDF5 1.10.2. */
+#ifndef HDF5_SUPPORTS_PAR_FILTERS
     if (h5->parallel == NC_TRUE)
         if (deflate || fletcher32 || shuffle)
             return NC_EINVAL;
+#endif
 
     /* If the HDF5 dataset has already been created, then it is too
      * late to set all the extra stuff. */
@@ -689,7 +737,15 @@ nc_def_var_extra(int ncid, int varid, int *shuffle, int *deflate,
         var->contiguous = NC_FALSE;
         var->deflate = *deflate;
         if (*deflate)
+        {
+            unsigned int level = (unsigned int)*deflate_level;
+
             var->deflate_level = *deflate_level;
+            if ((retval = nc4_var_filter_add(var, H5Z_FILTER_DEFLATE, 1, &level)))
+                return retval;
+        }
+        else if ((retval = nc4_var_filter_remove(var, H5Z_FILTER_DEFLATE)))
+            return retval;
         LOG((3, "%s: *deflate_level %d", __func__, *deflate_level));
     }
 
@@ -707,12 +763,20 @@ nc_def_var_extra(int ncid, int varid, int *shuffle, int *deflate,
         var->contiguous = NC_FALSE;
     }
 
+#ifdef USE_PARALLEL4
+    /* Parallel HDF5 can only write filtered data collectively. */
+    if (h5->parallel == NC_TRUE &&
+        (var->deflate || var->fletcher32 || var->shuffle))
+        var->parallel_access = NC_COLLECTIVE;
+#endif
+
     /* Does the user want a contiguous dataset? Not so fast! Make sure
      * that there are no unlimited dimensions, and no filters in use
      * for this data. */
     if (contiguous && *contiguous)
     {
-        if (var->deflate || var->fletcher32 || var->shuffle)
+        if (var->deflate || var->fletcher32 || var->shuffle ||
+            nclistlength(var->filters))
             return NC_EINVAL;
 
         for (d = 0; d < var->ndims; d++)
@@ -962,6 +1026,219 @@ nc_def_var_chunking_ints(int ncid, int varid, int contiguous, int *chunksizesp)
     return retval;
 }
 
+/**
+ * @internal Set the access intent for a var, or the default intent
+ * for the file. This is called by nc_def_var_chunk_intent(). The
+ * default chunksizes of the var are recomputed for the new intent.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID, or NC_GLOBAL for the file default.
+ * @param intent Access intent.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ * @returns ::NC_EPERM File is read only.
+ * @returns ::NC_ELATEDEF Too late to change settings for this variable.
+ */
+int
+NC4_hdf5_def_var_chunk_intent(int ncid, int varid, int intent)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    int retval;
+
+    LOG((2, "%s: ncid 0x%x varid %d intent %d", __func__, ncid, varid,
+         intent));
+
+    /* Find info for this file and group, and set pointer to each. */
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        return retval;
+    assert(grp && h5);
+
+    /* Trying to write to a read-only file? */
+    if (h5->no_write)
+        return NC_EPERM;
+
+    /* Set the default for vars defined from now on. */
+    if (varid == NC_GLOBAL)
+    {
+        h5->chunk_intent = intent;
+        return NC_NOERR;
+    }
+
+    /* Find the var. */
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        return NC_ENOTVAR;
+    assert(var && var->hdr.id == varid);
+
+    /* Chunksizes can't change once the dataset exists. */
+    if (var->created)
+        return NC_ELATEDEF;
+
+    var->chunk_intent = intent;
+
+    /* Recompute default chunksizes (nothing to do for scalars). An
+     * explicit intent implies chunked storage. */
+    if (var->ndims)
+    {
+        if (intent != NC_CHUNK_INTENT_DEFAULT)
+            var->contiguous = NC_FALSE;
+        memset(var->chunksizes, 0, var->ndims * sizeof(size_t));
+        if ((retval = nc4_find_default_chunksizes2(grp, var)))
+            return retval;
+        if ((retval = nc4_adjust_var_cache(grp, var)))
+            return retval;
+    }
+
+    return NC_NOERR;
+}
+
+/**
+ * @internal Get the access intent for a var, or the default intent
+ * for the file. This is called by nc_inq_var_chunk_intent().
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID, or NC_GLOBAL for the file default.
+ * @param intentp Pointer that gets the intent. Ignored if NULL.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NC4_hdf5_inq_var_chunk_intent(int ncid, int varid, int *intentp)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    int retval;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        return retval;
+    assert(grp && h5);
+
+    if (varid == NC_GLOBAL)
+    {
+        if (intentp)
+            *intentp = h5->chunk_intent;
+        return NC_NOERR;
+    }
+
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        return NC_ENOTVAR;
+    if (intentp)
+        *intentp = var->chunk_intent;
+
+    return NC_NOERR;
+}
+
+/**
+ * @internal Set quantization for a var. This is called by
+ * nc_def_var_quantize(). The setting is recorded in the
+ * NC_QUANTIZE_BITGROOM_ATT_NAME attribute of the var.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param quantize_mode NC_QUANTIZE_BITGROOM or NC_NOQUANTIZE.
+ * @param nsd Number of significant digits to keep.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ * @returns ::NC_EPERM File is read only.
+ * @returns ::NC_ELATEDEF Too late to change settings for this variable.
+ * @returns ::NC_EINVAL Var is not float or double, or bad nsd.
+ */
+int
+NC4_hdf5_def_var_quantize(int ncid, int varid, int quantize_mode, int nsd)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    int max_nsd;
+    int retval;
+
+    LOG((2, "%s: ncid 0x%x varid %d quantize_mode %d nsd %d", __func__,
+         ncid, varid, quantize_mode, nsd));
+
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+        return retval;
+    assert(grp && h5 && var && var->hdr.id == varid);
+
+    /* Trying to write to a read-only file? */
+    if (h5->no_write)
+        return NC_EPERM;
+
+    /* Data written already can't be quantized. */
+    if (var->created)
+        return NC_ELATEDEF;
+
+    /* Only floating point data can be quantized. */
+    if (var->type_info->hdr.id == NC_FLOAT)
+        max_nsd = NC_QUANTIZE_MAX_FLOAT_NSD;
+    else if (var->type_info->hdr.id == NC_DOUBLE)
+        max_nsd = NC_QUANTIZE_MAX_DOUBLE_NSD;
+    else
+        return NC_EINVAL;
+
+    if (quantize_mode == NC_QUANTIZE_BITGROOM)
+    {
+        if (nsd < 1 || nsd > max_nsd)
+            return NC_EINVAL;
+        if ((retval = nc4_put_att(grp, varid, NC_QUANTIZE_BITGROOM_ATT_NAME,
+                                  NC_INT, 1, &nsd, NC_INT, 1)))
+            return retval;
+    }
+    else
+    {
+        nsd = 0;
+        if (ncindexlookup(var->att, NC_QUANTIZE_BITGROOM_ATT_NAME) &&
+            (retval = NC4_HDF5_del_att(ncid, varid, NC_QUANTIZE_BITGROOM_ATT_NAME)))
+            return retval;
+    }
+
+    var->quantize_mode = quantize_mode;
+    var->nsd = nsd;
+
+    return NC_NOERR;
+}
+
+/**
+ * @internal Get the quantization setting of a var. This is called by
+ * nc_inq_var_quantize().
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param quantize_modep Pointer that gets the mode. Ignored if NULL.
+ * @param nsdp Pointer that gets the number of significant
+ * digits. Ignored if NULL.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NC4_hdf5_inq_var_quantize(int ncid, int varid, int *quantize_modep, int *nsdp)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    int retval;
+
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+        return retval;
+    assert(grp && h5 && var && var->hdr.id == varid);
+
+    if (quantize_modep)
+        *quantize_modep = var->quantize_mode;
+    if (nsdp)
+        *nsdp = var->nsd;
+
+    return NC_NOERR;
+}
+
 /**
  * @internal This functions sets fill value and no_fill mode for a
  * netCDF-4 variable. It is called by nc_def_var_fill().
@@ -1024,6 +1301,11 @@ NC4_def_var_endian(int ncid, int varid, int endianness)
 /**
  * @internal Define filter settings. Called by nc_def_var_filter().
  *
+ * The filter is added to the end of the var's filter chain; if it is
+ * already in the chain, its parameters are replaced in place. Deflate,
+ * shuffle and fletcher32 given this way are the same as setting them
+ * with nc_def_var_deflate() and nc_def_var_fletcher32().
+ *
  * @param ncid File ID.
  * @param varid Variable ID.
  * @param id Filter ID
@@ -1069,9 +1351,11 @@ NC4_def_var_filter(int ncid, int varid, unsigned int id, size_t nparams,
     if (var->created)
         return NC_ELATEDEF;
 
-    /* Can't turn on parallel and filter (for now). */
+    /* Can't turn on parallel and filter before HDF5 1.10.2. */
+#ifndef HDF5_SUPPORTS_PAR_FILTERS
     if (h5->parallel == NC_TRUE)
         return NC_EINVAL;
+#endif
 
 #ifdef HAVE_H5Z_SZIP
     if(id == H5Z_FILTER_SZIP) {
@@ -1095,16 +1379,40 @@ NC4_def_var_filter(int ncid, int varid, unsigned int id, size_t nparams,
     }
 #endif /*0*/
 
-    var->filterid = id;
-    var->nparams = nparams;
-    var->params = NULL;
-    if(parms != NULL) {
-        var->params = (unsigned int*)calloc(nparams,sizeof(unsigned int));
-        if(var->params == NULL) return NC_ENOMEM;
-        memcpy(var->params,parms,sizeof(unsigned int)*var->nparams);
+    switch (id)
+    {
+    case H5Z_FILTER_SHUFFLE:
+        var->shuffle = NC_TRUE;
+        break;
+
+    case H5Z_FILTER_FLETCHER32:
+        var->fletcher32 = NC_TRUE;
+        break;
+
+    case H5Z_FILTER_DEFLATE:
+        if (nparams != 1 || !parms || parms[0] > NC_MAX_DEFLATE_LEVEL)
+            return NC_EINVAL;
+        if ((retval = nc4_var_filter_add(var, id, nparams, parms)))
+            return retval;
+        var->deflate = NC_TRUE;
+        var->deflate_level = (int)parms[0];
+        break;
+
+    default:
+        /* Bitshuffle may have to come from this library. */
+        if ((retval = nc4_filter_provide(id)))
+            return retval;
+        if ((retval = nc4_var_filter_add(var, id, nparams, parms)))
+            return retval;
+        break;
     }
     /* Filter => chunking */
     var->contiguous = NC_FALSE;
+#ifdef USE_PARALLEL4
+    /* Parallel HDF5 can only write filtered data collectively. */
+    if (h5->parallel == NC_TRUE)
+        var->parallel_access = NC_COLLECTIVE;
+#endif
     /* Determine default chunksizes for this variable unless already specified */
     if(var->chunksizes && !var->chunksizes[0]) {
         if((retval = nc4_find_default_chunksizes2(grp, var)))
@@ -1439,15 +1747,22 @@ log_dim_info(NC_VAR_INFO_T *var, hsize_t *fdims, hsize_t *fmaxdims,
  * @internal Set the parallel access for a var (collective
  * vs. independent).
  *
+ * HDF5 can only write through filters collectively, so writes to a
+ * filtered var must use collective access. Filtered data can still
+ * be read independently.
+ *
  * @param h5 Pointer to HDF5 file info struct.
  * @param var Pointer to var info struct.
  * @param xfer_plistid H5FD_MPIO_COLLECTIVE or H5FD_MPIO_INDEPENDENT.
+ * @param write True if the transfer is a write.
  *
  * @returns NC_NOERR No error.
+ * @returns NC_EINVAL Independent write to a filtered var.
  * @author Ed Hartnett
  */
 static int
-set_par_access(NC_FILE_INFO_T *h5, NC_VAR_INFO_T *var, hid_t xfer_plistid)
+set_par_access(NC_FILE_INFO_T *h5, NC_VAR_INFO_T *var, hid_t xfer_plistid,
+               nc_bool_t write)
 {
     /* If netcdf is built with parallel I/O, then parallel access can
      * be used, and, if this file was opened or created for parallel
@@ -1456,6 +1771,11 @@ set_par_access(NC_FILE_INFO_T *h5, NC_VAR_INFO_T *var, hid_t xfer_plistid)
     {
         H5FD_mpio_xfer_t hdf5_xfer_mode;
 
+        if (write && var->parallel_access == NC_INDEPENDENT &&
+            (var->deflate || var->shuffle || var->fletcher32 ||
+             nclistlength(var->filters)))
+            return NC_EINVAL;
+
         /* Decide on collective or independent. */
         hdf5_xfer_mode = (var->parallel_access != NC_INDEPENDENT) ?
             H5FD_MPIO_COLLECTIVE : H5FD_MPIO_INDEPENDENT;
@@ -1516,6 +1836,7 @@ NC4_put_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
     hsize_t start[NC_MAX_VAR_DIMS], count[NC_MAX_VAR_DIMS];
     hsize_t stride[NC_MAX_VAR_DIMS];
     int need_to_extend = 0;
+    int direct = 0;
 #ifdef USE_PARALLEL4
     int extend_possible = 0;
 #endif
@@ -1617,9 +1938,11 @@ NC4_put_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
     }
 
     /* Are we going to convert any data? (No converting of compound or
-     * opaque types.) */
-    if (mem_nc_type != var->type_info->hdr.id &&
-        mem_nc_type != NC_COMPOUND && mem_nc_type != NC_OPAQUE)
+     * opaque types.) Quantized data is always copied first, since the
+     * user's buffer can't be changed. */
+    if ((mem_nc_type != var->type_info->hdr.id &&
+         mem_nc_type != NC_COMPOUND && mem_nc_type != NC_OPAQUE) ||
+        var->quantize_mode != NC_NOQUANTIZE)
     {
         size_t file_type_size;
 
@@ -1652,7 +1975,7 @@ NC4_put_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
 
 #ifdef USE_PARALLEL4
     /* Set up parallel I/O, if needed. */
-    if ((retval = set_par_access(h5, var, xfer_plistid)))
+    if ((retval = set_par_access(h5, var, xfer_plistid, NC_TRUE)))
         BAIL(retval);
 #endif
 
@@ -1744,19 +2067,49 @@ NC4_put_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
     /* Do we need to convert the data? */
     if (need_to_convert)
     {
-        if ((retval = nc4_convert_type(data, bufr, mem_nc_type, var->type_info->hdr.id,
-                                       len, &range_error, var->fill_value,
-                                       (h5->cmode & NC_CLASSIC_MODEL))))
+        if (mem_nc_type == var->type_info->hdr.id)
+        {
+            if (len > 0)
+                memcpy(bufr, data, len * var->type_info->size);
+        }
+        else if ((retval = nc4_convert_type(data, bufr, mem_nc_type, var->type_info->hdr.id,
+                                            len, &range_error, var->fill_value,
+                                            (h5->cmode & NC_CLASSIC_MODEL))))
             BAIL(retval);
+
+        /* Trim the precision of the data, leaving fill values be. */
+        if (var->quantize_mode == NC_QUANTIZE_BITGROOM && len > 0)
+        {
+            float fill_float = NC_FILL_FLOAT;
+            double fill_double = NC_FILL_DOUBLE;
+            const void *fill = var->fill_value;
+
+            if (!fill)
+                fill = var->type_info->hdr.id == NC_FLOAT ?
+                    (const void *)&fill_float : (const void *)&fill_double;
+            if ((retval = nc4_quantize_data(bufr, var->type_info->hdr.id, len,
+                                            var->nsd, fill)))
+                BAIL(retval);
+        }
     }
 
+    /* Whole chunks may be compressed on several threads and written
+     * straight to the file, bypassing the HDF5 filter pipeline. */
+    if (!zero_count &&
+        (retval = nc4_direct_put_vars(h5, var, start, count, stride, fdims,
+                                      bufr, &direct)))
+        BAIL(retval);
+
     /* Write the data. At last! */
-    LOG((4, "about to H5Dwrite datasetid 0x%x mem_spaceid 0x%x "
-         "file_spaceid 0x%x", hdf5_var->hdf_datasetid, mem_spaceid, file_spaceid));
-    if (H5Dwrite(hdf5_var->hdf_datasetid,
-                 ((NC_HDF5_TYPE_INFO_T *)var->type_info->format_type_info)->hdf_typeid,
-                 mem_spaceid, file_spaceid, xfer_plistid, bufr) < 0)
-        BAIL(NC_EHDFERR);
+    if (!direct)
+    {
+        LOG((4, "about to H5Dwrite datasetid 0x%x mem_spaceid 0x%x "
+             "file_spaceid 0x%x", hdf5_var->hdf_datasetid, mem_spaceid, file_spaceid));
+        if (H5Dwrite(hdf5_var->hdf_datasetid,
+                     ((NC_HDF5_TYPE_INFO_T *)var->type_info->format_type_info)->hdf_typeid,
+                     mem_spaceid, file_spaceid, xfer_plistid, bufr) < 0)
+            BAIL(NC_EHDFERR);
+    }
 
     /* Remember that we have written to this var so that Fill Value
      * can't be set for it. */
@@ -1958,6 +2311,19 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
      * file. */
     file_type_size = var->type_info->size;
 
+    /* Reads of whole chunks may be able to bypass the HDF5 filter
+     * pipeline, and decode the chunks on several threads. */
+    if (!no_read && !provide_fill)
+    {
+        int done;
+
+        if ((retval = nc4_direct_get_vars(h5, var, start, count, stride,
+                                          fdims, mem_nc_type, data, &done)))
+            BAIL(retval);
+        if (done)
+            goto exit;
+    }
+
     if (!no_read)
     {
         /* Now you would think that no one would be crazy enough to write
@@ -2030,7 +2396,7 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
 
 #ifdef USE_PARALLEL4
         /* Set up parallel I/O, if needed. */
-        if ((retval = set_par_access(h5, var, xfer_plistid)))
+        if ((retval = set_par_access(h5, var, xfer_plistid, NC_FALSE)))
             BAIL(retval);
 #endif
 
@@ -2070,7 +2436,7 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
             if ((xfer_plistid = H5Pcreate(H5P_DATASET_XFER)) < 0)
                 BAIL(NC_EHDFERR);
 
-            if ((retval = set_par_access(h5, var, xfer_plistid)))
+            if ((retval = set_par_access(h5, var, xfer_plistid, NC_FALSE)))
                 BAIL(retval);
 
             if (H5Sselect_none(file_spaceid) < 0)
@@ -2238,6 +2604,91 @@ NC4_HDF5_inq_var_all(int ncid, int varid, char *name, nc_type *xtypep,
                            endiannessp, idp, nparamsp, params);
 }
 
+/**
+ * @internal Set the parallel access of a var. This reads the var's
+ * metadata first, if that has not been done, so that independent
+ * access can be refused for filtered data. This is called by
+ * nc_var_par_access().
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param par_access NC_COLLECTIVE or NC_INDEPENDENT.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Bad varid.
+ * @returns ::NC_ENOPAR File not opened for parallel I/O.
+ * @returns ::NC_EINVAL Invalid par_access, or independent access
+ * asked for a filtered var in a writable file.
+ */
+int
+NC4_HDF5_var_par_access(int ncid, int varid, int par_access)
+{
+#ifdef USE_PARALLEL4
+    int retval;
+
+    LOG((2, "%s: ncid 0x%x varid %d", __func__, ncid, varid));
+
+    /* Do lazy var metadata read if needed. */
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, NULL, NULL, NULL)))
+        return retval;
+#endif /* USE_PARALLEL4 */
+
+    /* Now the filters are known, use the libsrc4 function. */
+    return NC4_var_par_access(ncid, varid, par_access);
+}
+
+/**
+ * @internal Learn the filter chain of a var. This is called by
+ * nc_inq_var_filter_ids().
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param nfiltersp Gets number of filters. Ignored if NULL.
+ * @param filterids Gets filter IDs. Ignored if NULL.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NC4_hdf5_inq_var_filter_ids(int ncid, int varid, size_t *nfiltersp,
+                            unsigned int *filterids)
+{
+    int retval;
+
+    /* The filters are learned with the rest of the lazy metadata. */
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, NULL, NULL, NULL)))
+        return retval;
+    return NC4_inq_var_filter_ids(ncid, varid, nfiltersp, filterids);
+}
+
+/**
+ * @internal Learn the parameters of one filter of a var. This is
+ * called by nc_inq_var_filter_info().
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param id Filter ID.
+ * @param nparamsp Gets number of parameters. Ignored if NULL.
+ * @param params Gets parameters. Ignored if NULL.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ * @returns ::NC_EFILTER Variable does not use this filter.
+ */
+int
+NC4_hdf5_inq_var_filter_info(int ncid, int varid, unsigned int id,
+                             size_t *nparamsp, unsigned int *params)
+{
+    int retval;
+
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, NULL, NULL, NULL)))
+        return retval;
+    return NC4_inq_var_filter_info(ncid, varid, id, nparamsp, params);
+}
+
 /**
  * @internal Set chunk cache size for a variable. This is the internal
  * function called by nc_set_var_chunk_cache().
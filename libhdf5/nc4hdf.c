@@ -830,6 +830,7 @@ var_create_dataset(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var, nc_bool_t write_dimid
     hid_t plistid = 0, access_plistid = 0, typeid = 0, spaceid = 0;
     hsize_t chunksize[H5S_MAX_RANK], dimsize[H5S_MAX_RANK], maxdimsize[H5S_MAX_RANK];
     int d;
+    size_t f;
     void *fillp = NULL;
     NC_DIM_INFO_T *dim = NULL;
     char *name_to_use;
@@ -901,32 +902,35 @@ var_create_dataset(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var, nc_bool_t write_dimid
         }
     }
 
-    /* If the user wants to shuffle the data, set that up now. */
+    /* Shuffle always goes first, to prepare the data for the other
+     * filters, and fletcher32 last, so that it checksums what is
+     * stored. The rest of the chain, including deflate, runs in the
+     * order it was defined. */
     if (var->shuffle) {
         if (H5Pset_shuffle(plistid) < 0)
             BAIL(NC_EHDFERR);
     }
 
-    /* If the user wants to deflate the data, set that up now. */
-    if (var->deflate) {
-        if (H5Pset_deflate(plistid, var->deflate_level) < 0)
-            BAIL(NC_EHDFERR);
-    } else if(var->filterid) {
-        /* Handle szip case here */
-        if(var->filterid == H5Z_FILTER_SZIP) {
+    for (f = 0; f < nclistlength(var->filters); f++) {
+        NC_FILTER_SPEC_T *spec = nclistget(var->filters, f);
+
+        if (spec->filterid == H5Z_FILTER_DEFLATE) {
+            if (H5Pset_deflate(plistid, var->deflate_level) < 0)
+                BAIL(NC_EHDFERR);
+        } else if (spec->filterid == H5Z_FILTER_SZIP) {
+            /* Handle szip case here */
             int options_mask;
             int bits_per_pixel;
-            if(var->nparams != 2)
+            if (spec->nparams != 2)
                 BAIL(NC_EFILTER);
-            options_mask = (int)var->params[0];
-            bits_per_pixel = (int)var->params[1];
-            if(H5Pset_szip(plistid, options_mask, bits_per_pixel) < 0)
+            options_mask = (int)spec->params[0];
+            bits_per_pixel = (int)spec->params[1];
+            if (H5Pset_szip(plistid, options_mask, bits_per_pixel) < 0)
                 BAIL(NC_EFILTER);
         } else {
-            herr_t code = H5Pset_filter(plistid, var->filterid, H5Z_FLAG_MANDATORY, var->nparams, var->params);
-            if(code < 0) {
+            if (H5Pset_filter(plistid, spec->filterid, H5Z_FLAG_MANDATORY,
+                              spec->nparams, spec->params) < 0)
                 BAIL(NC_EFILTER);
-            }
         }
     }
 
@@ -955,6 +959,7 @@ var_create_dataset(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var, nc_bool_t write_dimid
          * has not specified chunksizes, use contiguous variable for
          * better performance. */
         if (!var->shuffle && !var->deflate && !var->fletcher32 &&
+            !nclistlength(var->filters) &&
             (var->chunksizes == NULL || !var->chunksizes[0]) && !unlimdim)
             var->contiguous = NC_TRUE;
 
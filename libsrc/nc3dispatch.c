@@ -163,6 +163,15 @@ NC3_def_var_endian,
 NC3_def_var_filter,
 NC3_set_var_chunk_cache,
 NC3_get_var_chunk_cache,
+NC_NOTNC4_def_var_chunk_intent,
+NC_NOTNC4_inq_var_chunk_intent,
+NC_NOTNC4_read_chunk,
+NC_NOTNC4_write_chunk,
+NC_NOTNC4_inq_var_chunk_info,
+NC_NOTNC4_inq_var_filter_ids,
+NC_NOTNC4_inq_var_filter_info,
+NC_NOTNC4_def_var_quantize,
+NC_NOTNC4_inq_var_quantize,
 
 };
 
@@ -50,7 +50,8 @@ ifdef(`PNETCDF',`
 `#'include "macro.h"',`
 `#'pragma GCC diagnostic ignored "-Wdeprecated"
 `#'include "ncx.h"
-`#'include "nc3dispatch.h"')
+`#'include "nc3dispatch.h"
+`#'include "ncswap.h"')
 
 define(`IntType',  `ifdef(`PNETCDF', `MPI_Offset', `size_t')')dnl
 define(`APIPrefix',`ifdef(`PNETCDF', `ncmpi', `nc')')dnl
@@ -307,6 +308,11 @@ swapn2b(void *dst, const void *src, IntType nn)
     int i;
     uint16_t *op = (uint16_t*) dst;
     uint16_t *ip = (uint16_t*) src;
+ifdef(`PNETCDF',,`    if (nn >= NC_SWAP_BULK) {
+        NC_swapn2(dst, src, (size_t)nn);
+        return;
+    }
+')dnl
     for (i=0; i<nn; i++) {
         op[i] = ip[i];
         op[i] = (uint16_t)SWAP2(op[i]);
@@ -396,6 +402,11 @@ swapn4b(void *dst, const void *src, IntType nn)
     int i;
     uint32_t *op = (uint32_t*) dst;
     uint32_t *ip = (uint32_t*) src;
+ifdef(`PNETCDF',,`    if (nn >= NC_SWAP_BULK) {
+        NC_swapn4(dst, src, (size_t)nn);
+        return;
+    }
+')dnl
     for (i=0; i<nn; i++) {
         /* copy over, make the below swap in-place */
         op[i] = ip[i];
@@ -521,6 +532,11 @@ swapn8b(void *dst, const void *src, IntType nn)
     int i;
     uint64_t *op = (uint64_t*) dst;
     uint64_t *ip = (uint64_t*) src;
+ifdef(`PNETCDF',,`    if (nn >= NC_SWAP_BULK) {
+        NC_swapn8(dst, src, (size_t)nn);
+        return;
+    }
+')dnl
     for (i=0; i<nn; i++) {
         /* copy over, make the below swap in-place */
         op[i] = ip[i];
@@ -1282,6 +1282,130 @@ att_free(NC_ATT_INFO_T *att)
     return NC_NOERR;
 }
 
+/**
+ * @internal Free one entry of a var's filter chain.
+ *
+ * @param spec Pointer to the filter spec, may be NULL.
+ */
+static void
+filter_spec_free(NC_FILTER_SPEC_T *spec)
+{
+    if (!spec)
+        return;
+    if (spec->params)
+        free(spec->params);
+    free(spec);
+}
+
+/**
+ * @internal Add a filter to the end of a var's filter chain. If the
+ * filter is already in the chain, its parameters are replaced and it
+ * keeps its place.
+ *
+ * @param var Pointer to the var info struct.
+ * @param id Filter ID.
+ * @param nparams Number of parameters.
+ * @param params Parameters; may be NULL if nparams is 0.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ */
+int
+nc4_var_filter_add(NC_VAR_INFO_T *var, unsigned int id, size_t nparams,
+                   const unsigned int *params)
+{
+    NC_FILTER_SPEC_T *spec;
+    unsigned int *newparams = NULL;
+
+    assert(var);
+
+    if (nparams)
+    {
+        if (!(newparams = malloc(nparams * sizeof(unsigned int))))
+            return NC_ENOMEM;
+        if (params)
+            memcpy(newparams, params, nparams * sizeof(unsigned int));
+        else
+            memset(newparams, 0, nparams * sizeof(unsigned int));
+    }
+
+    if ((spec = nc4_var_filter_find(var, id)))
+    {
+        if (spec->params)
+            free(spec->params);
+    }
+    else
+    {
+        if (!var->filters && !(var->filters = nclistnew()))
+        {
+            free(newparams);
+            return NC_ENOMEM;
+        }
+        if (!(spec = calloc(1, sizeof(NC_FILTER_SPEC_T))))
+        {
+            free(newparams);
+            return NC_ENOMEM;
+        }
+        spec->filterid = id;
+        nclistpush(var->filters, spec);
+    }
+    spec->nparams = nparams;
+    spec->params = newparams;
+
+    return NC_NOERR;
+}
+
+/**
+ * @internal Remove a filter from a var's filter chain, if it is there.
+ *
+ * @param var Pointer to the var info struct.
+ * @param id Filter ID.
+ *
+ * @return ::NC_NOERR No error.
+ */
+int
+nc4_var_filter_remove(NC_VAR_INFO_T *var, unsigned int id)
+{
+    size_t i;
+
+    assert(var);
+    for (i = 0; i < nclistlength(var->filters); i++)
+    {
+        NC_FILTER_SPEC_T *spec = nclistget(var->filters, i);
+        if (spec->filterid == id)
+        {
+            nclistremove(var->filters, i);
+            filter_spec_free(spec);
+            break;
+        }
+    }
+    return NC_NOERR;
+}
+
+/**
+ * @internal Find a filter in a var's filter chain.
+ *
+ * @param var Pointer to the var info struct.
+ * @param id Filter ID.
+ *
+ * @return Pointer to the filter spec, or NULL if the var does not
+ * use the filter.
+ */
+NC_FILTER_SPEC_T *
+nc4_var_filter_find(NC_VAR_INFO_T *var, unsigned int id)
+{
+    size_t i;
+
+    assert(var);
+    for (i = 0; i < nclistlength(var->filters); i++)
+    {
+        NC_FILTER_SPEC_T *spec = nclistget(var->filters, i);
+        if (spec->filterid == id)
+            return spec;
+    }
+    return NULL;
+}
+
 /**
  * @internal Delete a var, and free the memory. All HDF5 objects for
  * the var must be closed before this is called.
@@ -1294,6 +1418,7 @@ att_free(NC_ATT_INFO_T *att)
 static int
 var_free(NC_VAR_INFO_T *var)
 {
+    size_t f;
     int i;
     int retval;
 
@@ -1335,9 +1460,10 @@ var_free(NC_VAR_INFO_T *var)
     if (var->dimscale_attached)
         free(var->dimscale_attached);
 
-    /* Release parameter information. */
-    if (var->params)
-        free(var->params);
+    /* Release the filter chain. */
+    for (f = 0; f < nclistlength(var->filters); f++)
+        filter_spec_free((NC_FILTER_SPEC_T *)nclistget(var->filters, f));
+    nclistfree(var->filters);
 
     /* Delete any format-specific info. */
     if (var->format_var_info)
@@ -13,6 +13,7 @@
 #include "config.h"
 #include <nc4internal.h>
 #include "nc4dispatch.h"
+#include "netcdf_filter.h"
 #ifdef USE_HDF5
 #include "hdf5internal.h"
 #endif
@@ -208,12 +209,27 @@ NC4_inq_var_all(int ncid, int varid, char *name, nc_type *xtypep,
     if (fletcher32p)
         *fletcher32p = (int)var->fletcher32;
 
-    if (idp)
-        *idp = var->filterid;
-    if (nparamsp)
-        *nparamsp = (var->params == NULL ? 0 : var->nparams);
-    if (params && var->params != NULL)
-        memcpy(params,var->params,var->nparams*sizeof(unsigned int));
+    /* The first filter in the chain, other than deflate, which has
+     * its own inquiry function. */
+    if (idp || nparamsp || params)
+    {
+        NC_FILTER_SPEC_T *spec = NULL;
+        size_t f;
+
+        for (f = 0; f < nclistlength(var->filters); f++)
+        {
+            spec = nclistget(var->filters, f);
+            if (spec->filterid != H5Z_FILTER_DEFLATE)
+                break;
+            spec = NULL;
+        }
+        if (idp)
+            *idp = spec ? spec->filterid : 0;
+        if (nparamsp)
+            *nparamsp = spec ? spec->nparams : 0;
+        if (params && spec && spec->nparams)
+            memcpy(params, spec->params, spec->nparams * sizeof(unsigned int));
+    }
 
     /* Fill value stuff. */
     if (no_fill)
@@ -324,6 +340,110 @@ nc_inq_var_chunking_ints(int ncid, int varid, int *contiguousp, int *chunksizesp
     return retval;
 }
 
+/**
+ * @internal Learn the filter chain of a var. This is called by
+ * nc_inq_var_filter_ids().
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param nfiltersp Gets number of filters. Ignored if NULL.
+ * @param filterids Gets filter IDs, in the order they are applied
+ * when writing. Ignored if NULL.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NC4_inq_var_filter_ids(int ncid, int varid, size_t *nfiltersp,
+                       unsigned int *filterids)
+{
+    NC_VAR_INFO_T *var;
+    size_t f;
+    int retval;
+
+    if ((retval = nc4_find_grp_h5_var(ncid, varid, NULL, NULL, &var)))
+        return retval;
+    assert(var);
+
+    if (nfiltersp)
+        *nfiltersp = nclistlength(var->filters);
+    if (filterids)
+        for (f = 0; f < nclistlength(var->filters); f++)
+            filterids[f] = ((NC_FILTER_SPEC_T *)nclistget(var->filters, f))->filterid;
+
+    return NC_NOERR;
+}
+
+/**
+ * @internal Learn the parameters of one filter of a var. This is
+ * called by nc_inq_var_filter_info().
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param id Filter ID.
+ * @param nparamsp Gets number of parameters. Ignored if NULL.
+ * @param params Gets parameters. Ignored if NULL.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ * @returns ::NC_EFILTER Variable does not use this filter.
+ */
+int
+NC4_inq_var_filter_info(int ncid, int varid, unsigned int id,
+                        size_t *nparamsp, unsigned int *params)
+{
+    NC_VAR_INFO_T *var;
+    NC_FILTER_SPEC_T *spec;
+    int retval;
+
+    if ((retval = nc4_find_grp_h5_var(ncid, varid, NULL, NULL, &var)))
+        return retval;
+    assert(var);
+
+    if (!(spec = nc4_var_filter_find(var, id)))
+        return NC_EFILTER;
+    if (nparamsp)
+        *nparamsp = spec->nparams;
+    if (params && spec->nparams)
+        memcpy(params, spec->params, spec->nparams * sizeof(unsigned int));
+
+    return NC_NOERR;
+}
+
+/**
+ * @internal Learn the quantization settings of a var. This is called
+ * by nc_inq_var_quantize() for formats that keep all their metadata
+ * in memory.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param quantize_modep Gets the quantize mode. Ignored if NULL.
+ * @param nsdp Gets the number of significant digits. Ignored if NULL.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NC4_inq_var_quantize(int ncid, int varid, int *quantize_modep, int *nsdp)
+{
+    NC_VAR_INFO_T *var;
+    int retval;
+
+    if ((retval = nc4_find_grp_h5_var(ncid, varid, NULL, NULL, &var)))
+        return retval;
+    assert(var);
+
+    if (quantize_modep)
+        *quantize_modep = var->quantize_mode;
+    if (nsdp)
+        *nsdp = var->nsd;
+
+    return NC_NOERR;
+}
+
 /**
  * @internal Find the ID of a variable, from the name. This function
  * is called by nc_inq_varid().
@@ -384,7 +504,8 @@ NC4_inq_varid(int ncid, const char *name, int *varidp)
  * @returns ::NC_EBADID Invalid ncid passed.
  * @returns ::NC_ENOTVAR Invalid varid passed.
  * @returns ::NC_ENOPAR LFile was not opened with nc_open_par/nc_create_var.
- * @returns ::NC_EINVAL Invalid par_access specified.
+ * @returns ::NC_EINVAL Invalid par_access specified, or
+ * independent access asked for a filtered var in a writable file.
  * @returns ::NC_NOERR for success
  * @author Ed Hartnett, Dennis Heimbigner
  */
@@ -422,6 +543,12 @@ NC4_var_par_access(int ncid, int varid, int par_access)
     if (!var) return NC_ENOTVAR;
     assert(var->hdr.id == varid);
 
+    /* Filtered data can only be written collectively. */
+    if (par_access == NC_INDEPENDENT && !h5->no_write &&
+        (var->deflate || var->shuffle || var->fletcher32 ||
+         nclistlength(var->filters)))
+        return NC_EINVAL;
+
     if (par_access)
         var->parallel_access = NC_COLLECTIVE;
     else
@@ -1240,6 +1367,101 @@ nc4_convert_type(const void *src, void *dest, const nc_type src_type,
     return NC_NOERR;
 }
 
+/** @internal Number of bits explicitly stored in the significand of
+ * a float. */
+#define FLT_MANT_BITS 23
+/** @internal Number of bits explicitly stored in the significand of
+ * a double. */
+#define DBL_MANT_BITS 52
+/** @internal log2(10), the number of bits needed per decimal digit. */
+#define BITS_PER_DIGIT 3.32192809488736
+
+/**
+ * @internal Quantize float or double data in place, keeping nsd
+ * significant decimal digits (see nc_def_var_quantize()).
+ *
+ * Enough significand bits are kept to represent nsd digits, plus a
+ * guard bit. The rest are cleared in even-numbered values and set in
+ * odd-numbered ones, so that the error averages out. Values equal to
+ * the fill value, zeros, infinities and NaNs are left alone; for them
+ * the masks collapse to no-ops, so that the loops have no branches
+ * and compilers can vectorize them.
+ *
+ * @param data Pointer to the data, which is changed.
+ * @param type NC_FLOAT or NC_DOUBLE.
+ * @param len Number of values.
+ * @param nsd Number of significant digits to keep.
+ * @param fill_value Pointer to the fill value, of the same type.
+ *
+ * @returns NC_NOERR No error.
+ * @returns NC_EBADTYPE Type is not float or double.
+ */
+int
+nc4_quantize_data(void *data, nc_type type, size_t len, int nsd,
+                  const void *fill_value)
+{
+    int keep = (int)ceil(nsd * BITS_PER_DIGIT) + 1;
+    size_t i;
+
+    assert(data && fill_value && nsd > 0);
+
+    if (type == NC_FLOAT)
+    {
+        unsigned int *u = data;
+        unsigned int fill, shave, set;
+        const unsigned int expmask = 0x7f800000U, absmask = 0x7fffffffU;
+
+        if (keep >= FLT_MANT_BITS)
+            return NC_NOERR;
+        memcpy(&fill, fill_value, sizeof(fill));
+        set = (1U << (FLT_MANT_BITS - keep)) - 1;
+        shave = ~set;
+        for (i = 0; i + 1 < len; i += 2)
+        {
+            unsigned int a = u[i], b = u[i + 1];
+            unsigned int ka = (unsigned int)0 - (unsigned int)
+                (a == fill || !(a & absmask) || (a & expmask) == expmask);
+            unsigned int kb = (unsigned int)0 - (unsigned int)
+                (b == fill || !(b & absmask) || (b & expmask) == expmask);
+            u[i] = a & (shave | ka);
+            u[i + 1] = b | (set & ~kb);
+        }
+        if (i < len && u[i] != fill && (u[i] & absmask) &&
+            (u[i] & expmask) != expmask)
+            u[i] &= shave;
+    }
+    else if (type == NC_DOUBLE)
+    {
+        unsigned long long *u = data;
+        unsigned long long fill, shave, set;
+        const unsigned long long expmask = 0x7ff0000000000000ULL;
+        const unsigned long long absmask = 0x7fffffffffffffffULL;
+
+        if (keep >= DBL_MANT_BITS)
+            return NC_NOERR;
+        memcpy(&fill, fill_value, sizeof(fill));
+        set = (1ULL << (DBL_MANT_BITS - keep)) - 1;
+        shave = ~set;
+        for (i = 0; i + 1 < len; i += 2)
+        {
+            unsigned long long a = u[i], b = u[i + 1];
+            unsigned long long ka = 0ULL - (unsigned long long)
+                (a == fill || !(a & absmask) || (a & expmask) == expmask);
+            unsigned long long kb = 0ULL - (unsigned long long)
+                (b == fill || !(b & absmask) || (b & expmask) == expmask);
+            u[i] = a & (shave | ka);
+            u[i + 1] = b | (set & ~kb);
+        }
+        if (i < len && u[i] != fill && (u[i] & absmask) &&
+            (u[i] & expmask) != expmask)
+            u[i] &= shave;
+    }
+    else
+        return NC_EBADTYPE;
+
+    return NC_NOERR;
+}
+
 /**
  * @internal Get the default fill value for an atomic type. Memory for
  * fill_value must already be allocated, or you are DOOMED!
@@ -0,0 +1,147 @@
+/*
+Copyright 2019, UCAR/Unidata
+See COPYRIGHT file for conditions of use.
+
+This program benchmarks the CRC-32 used for the DAP4 checksums and
+for hashing names (libdispatch/crc32.c): the old byte at a time table
+loop, the portable slicing-by-8 code, and NC_crc32() itself, which
+uses PCLMULQDQ for long buffers when the CPU has it.
+
+For each buffer size the same total number of bytes is checksummed
+and the throughput of each method is printed. The results are checked
+against each other.
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "nccrc32.h"
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* Prototype from tst_utils.c. */
+int nc4_timeval_subtract(struct timeval *result, struct timeval *x,
+                         struct timeval *y);
+
+#define DEFAULT_TOTAL_MB 256
+#define MAX_BUF_SIZE (16 * MEGABYTE)
+#define NSIZES 5
+#define NMETHODS 3
+
+#define USAGE   "\
+  [-h]        Print output header\n\
+  [-m MB]     Megabytes to checksum for each size and method (default 256)\n"
+
+static const size_t sizes[NSIZES] = {64, 1024, 8192, 65536, MAX_BUF_SIZE};
+
+static unsigned int bytewise_table[256];
+
+/* The byte at a time loop formerly in libdap4/d4crc32.c. */
+static unsigned int
+crc32_bytewise(unsigned int crc, const void *buf, size_t size)
+{
+   const unsigned char *p = buf;
+
+   crc = crc ^ ~0U;
+   while (size--)
+      crc = bytewise_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+   return crc ^ ~0U;
+}
+
+typedef unsigned int (*crcfcn)(unsigned int, const void *, size_t);
+
+static const struct {
+   const char *name;
+   crcfcn fcn;
+} methods[NMETHODS] = {
+   {"bytewise", crc32_bytewise},
+   {"slice8", NC_crc32_portable},
+   {"NC_crc32", NC_crc32},
+};
+
+static void
+usage(void)
+{
+   fprintf(stderr, "bm_crc32 -h -m MB\n%s", USAGE);
+}
+
+/* Microseconds since start. */
+static double
+elapsed_us(struct timeval *start_time)
+{
+   struct timeval end_time, diff_time;
+
+   gettimeofday(&end_time, NULL);
+   nc4_timeval_subtract(&diff_time, &end_time, start_time);
+   return (double)diff_time.tv_sec * MILLION + (double)diff_time.tv_usec;
+}
+
+int
+main(int argc, char **argv)
+{
+   extern int optind;
+   extern char *optarg;
+   int c, header = 0, m, s;
+   size_t total_mb = DEFAULT_TOTAL_MB, i;
+   unsigned char *data;
+
+   while ((c = getopt(argc, argv, "hm:")) != EOF)
+      switch(c)
+      {
+      case 'h':
+         header++;
+         break;
+      case 'm':
+         sscanf(optarg, "%zu", &total_mb);
+         break;
+      case '?':
+         usage();
+         return 1;
+      }
+   if (total_mb < 1)
+   {
+      usage();
+      return 1;
+   }
+
+   for (i = 0; i < 256; i++)
+   {
+      unsigned int v = (unsigned int)i;
+      int k;
+      for (k = 0; k < 8; k++)
+         v = (v & 1) ? (v >> 1) ^ 0xedb88320U : v >> 1;
+      bytewise_table[i] = v;
+   }
+   if (!(data = malloc(MAX_BUF_SIZE))) ERR;
+   for (i = 0; i < MAX_BUF_SIZE; i++)
+      data[i] = (unsigned char)((i * 2654435761U) >> 13);
+
+   if (header)
+      printf("size\tmethod\tMB/s\n");
+   for (s = 0; s < NSIZES; s++)
+   {
+      size_t nreps = (total_mb * MEGABYTE + sizes[s] - 1) / sizes[s];
+      unsigned int expected = 0;
+
+      for (m = 0; m < NMETHODS; m++)
+      {
+         struct timeval start_time;
+         unsigned int crc = 0;
+         double us;
+         size_t r;
+
+         gettimeofday(&start_time, NULL);
+         for (r = 0; r < nreps; r++)
+            crc = methods[m].fcn(crc, data, sizes[s]);
+         us = elapsed_us(&start_time);
+         if (m == 0)
+            expected = crc;
+         else if (crc != expected) ERR;
+         printf("%zu\t%s\t%.1f\n", sizes[s], methods[m].name,
+                (double)(nreps * sizes[s]) / MEGABYTE / (us / MILLION));
+      }
+   }
+
+   free(data);
+   FINAL_RESULTS;
+}
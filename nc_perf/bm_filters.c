@@ -0,0 +1,252 @@
+/*
+Copyright 2019, UCAR/Unidata
+See COPYRIGHT file for conditions of use.
+
+This program benchmarks the shuffle, fletcher32 and bitshuffle
+filters, run by HDF5 and by the netCDF direct chunk path (see
+nc_set_chunk_threads()), and the deflate, bzip2, LZ4 and Zstandard
+codecs, on AR-4 precipitation data: the pr variable of the file read
+by tst_ar4, if one is given, or synthetic data of the same shape
+otherwise.
+
+For each filter combination the whole variable is written and read
+back both ways, and the encode (write) and decode (read) throughput
+and compression ratio are printed. The bzip2, LZ4 and Zstandard
+combinations need the plugins (see plugins/) on HDF5_PLUGIN_PATH, and
+are skipped if they are not found there.
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_chunk.h"
+#include "netcdf_filter.h"
+#include <hdf5.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* Prototype from tst_utils.c. */
+int nc4_timeval_subtract(struct timeval *result, struct timeval *x,
+                         struct timeval *y);
+
+#define FILE_NAME "bm_filters.nc"
+#define DATA_VAR_NAME "pr"
+#define NDIMS3 3
+#define LAT_LEN 128
+#define LON_LEN 256
+#define DEFAULT_TIME_LEN 120
+#define NCONFIGS 12
+#define MAXPARAMS 2
+
+/* Ids of the filters in plugins/. */
+#define H5Z_FILTER_BZIP2 307
+#define H5Z_FILTER_LZ4 32004
+#define H5Z_FILTER_ZSTD 32015
+
+#define USAGE   "\
+  [-h]        Print output header\n\
+  [-t NTIMES] Number of time steps to use (default 120)\n\
+  [-n NTHREADS] Threads for the direct chunk path (default 1)\n\
+  [file]      AR-4 file with a pr(time, lat, lon) variable\n"
+
+/* A filter combination. */
+typedef struct {
+   const char *name;
+   int shuffle;
+   int deflate_level;
+   int fletcher32;
+   int bitshuffle;
+   unsigned int filterid; /* A codec from plugins/, or 0. */
+   size_t nparams;
+   unsigned int params[MAXPARAMS];
+} Config;
+
+static Config config[NCONFIGS] = {
+   {"shuffle", 1, 0, 0, 0, 0, 0, {0}},
+   {"shuffle+fletcher32", 1, 0, 1, 0, 0, 0, {0}},
+   {"shuffle+deflate1", 1, 1, 0, 0, 0, 0, {0}},
+   {"shuffle+deflate5", 1, 5, 0, 0, 0, 0, {0}},
+   {"bitshuffle", 0, 0, 0, 1, 0, 0, {0}},
+   {"bitshuffle+deflate1", 0, 1, 0, 1, 0, 0, {0}},
+   {"shuffle+bzip2", 1, 0, 0, 0, H5Z_FILTER_BZIP2, 1, {9}},
+   {"shuffle+lz4", 1, 0, 0, 0, H5Z_FILTER_LZ4, 0, {0}},
+   {"shuffle+lz4fast8", 1, 0, 0, 0, H5Z_FILTER_LZ4, 2, {0, 8}},
+   {"bitshuffle+lz4", 0, 0, 0, 1, H5Z_FILTER_LZ4, 0, {0}},
+   {"shuffle+zstd1", 1, 0, 0, 0, H5Z_FILTER_ZSTD, 1, {1}},
+   {"shuffle+zstd9", 1, 0, 0, 0, H5Z_FILTER_ZSTD, 1, {9}},
+};
+
+static void
+usage(void)
+{
+   fprintf(stderr, "bm_filters -h -t NTIMES -n NTHREADS [file]\n%s", USAGE);
+}
+
+/* Microseconds since start. */
+static double
+elapsed_us(struct timeval *start_time)
+{
+   struct timeval end_time, diff_time;
+
+   gettimeofday(&end_time, NULL);
+   nc4_timeval_subtract(&diff_time, &end_time, start_time);
+   return (double)diff_time.tv_sec * MILLION + (double)diff_time.tv_usec;
+}
+
+/* Get the AR-4 data, from a file or made up. */
+static int
+get_data(const char *path, size_t ntimes, float *data)
+{
+   size_t i, j, t;
+
+   if (path)
+   {
+      size_t start[NDIMS3] = {0, 0, 0}, count[NDIMS3] = {0, LAT_LEN, LON_LEN};
+      int ncid, varid;
+
+      count[0] = ntimes;
+      if (nc_open(path, NC_NOWRITE, &ncid)) ERR_RET;
+      if (nc_inq_varid(ncid, DATA_VAR_NAME, &varid)) ERR_RET;
+      if (nc_get_vara_float(ncid, varid, start, count, data)) ERR_RET;
+      if (nc_close(ncid)) ERR_RET;
+      return 0;
+   }
+
+   /* Monthly mean precipitation flux, kg m-2 s-1: wet tropics, a
+    * seasonal cycle, and weather. */
+   for (t = 0; t < ntimes; t++)
+      for (i = 0; i < LAT_LEN; i++)
+         for (j = 0; j < LON_LEN; j++)
+         {
+            double lat = M_PI * ((double)i / LAT_LEN - 0.5);
+            double lon = 2 * M_PI * (double)j / LON_LEN;
+            double season = sin(2 * M_PI * (double)t / 12.0);
+            double v = 3e-5 * exp(-4 * (lat - 0.2 * season) * (lat - 0.2 * season)) +
+               1e-5 * (1 + sin(3 * lon + (double)t) * cos(5 * lat)) +
+               2e-6 * ((double)rand() / RAND_MAX);
+            data[(t * LAT_LEN + i) * LON_LEN + j] = (float)v;
+         }
+   return 0;
+}
+
+/* Write and read back the data with one filter combination. */
+static int
+run(const Config *cfg, int nthreads, size_t ntimes, const float *data,
+    float *back, double *write_us, double *read_us, double *ratio)
+{
+   size_t chunks[NDIMS3] = {1, LAT_LEN, LON_LEN};
+   size_t nvals = ntimes * LAT_LEN * LON_LEN;
+   size_t nchunks, stored = 0, i;
+   size_t *nbytes;
+   struct timeval start_time;
+   int ncid, dimids[NDIMS3], varid;
+
+   if (nc_set_chunk_threads(nthreads)) ERR_RET;
+   if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR_RET;
+   if (nc_def_dim(ncid, "time", ntimes, &dimids[0])) ERR_RET;
+   if (nc_def_dim(ncid, "lat", LAT_LEN, &dimids[1])) ERR_RET;
+   if (nc_def_dim(ncid, "lon", LON_LEN, &dimids[2])) ERR_RET;
+   if (nc_def_var(ncid, DATA_VAR_NAME, NC_FLOAT, NDIMS3, dimids, &varid)) ERR_RET;
+   if (nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks)) ERR_RET;
+   if (cfg->bitshuffle &&
+       nc_def_var_filter(ncid, varid, H5Z_FILTER_BITSHUFFLE, 0, NULL)) ERR_RET;
+   if (cfg->filterid &&
+       nc_def_var_filter(ncid, varid, cfg->filterid, cfg->nparams,
+                         cfg->params)) ERR_RET;
+   if ((cfg->shuffle || cfg->deflate_level) &&
+       nc_def_var_deflate(ncid, varid, cfg->shuffle, cfg->deflate_level != 0,
+                          cfg->deflate_level)) ERR_RET;
+   if (cfg->fletcher32 && nc_def_var_fletcher32(ncid, varid, NC_FLETCHER32)) ERR_RET;
+   if (nc_enddef(ncid)) ERR_RET;
+
+   gettimeofday(&start_time, NULL);
+   if (nc_put_var_float(ncid, varid, data)) ERR_RET;
+   if (nc_sync(ncid)) ERR_RET;
+   *write_us = elapsed_us(&start_time);
+
+   if (nc_inq_var_chunk_info(ncid, varid, 0, &nchunks, NULL, NULL, NULL, NULL)) ERR_RET;
+   if (!(nbytes = malloc(nchunks * sizeof(size_t)))) ERR_RET;
+   if (nc_inq_var_chunk_info(ncid, varid, nchunks, &nchunks, NULL, NULL, nbytes, NULL)) ERR_RET;
+   for (i = 0; i < nchunks; i++)
+      stored += nbytes[i];
+   free(nbytes);
+   *ratio = (double)(nvals * sizeof(float)) / (double)stored;
+   if (nc_close(ncid)) ERR_RET;
+
+   if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR_RET;
+   gettimeofday(&start_time, NULL);
+   if (nc_get_var_float(ncid, varid, back)) ERR_RET;
+   *read_us = elapsed_us(&start_time);
+   if (nc_close(ncid)) ERR_RET;
+   if (nc_set_chunk_threads(0)) ERR_RET;
+
+   if (memcmp(data, back, nvals * sizeof(float))) ERR_RET;
+   return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+   extern int optind;
+   extern char *optarg;
+   int c, header = 0, nthreads = 1, cfg, path;
+   size_t ntimes = DEFAULT_TIME_LEN;
+   float *data, *back;
+   double mb;
+
+   while ((c = getopt(argc, argv, "ht:n:")) != EOF)
+      switch(c)
+      {
+      case 'h':
+         header++;
+         break;
+      case 't':
+         sscanf(optarg, "%zu", &ntimes);
+         break;
+      case 'n':
+         sscanf(optarg, "%d", &nthreads);
+         break;
+      case '?':
+         usage();
+         return 1;
+      }
+   argc -= optind;
+   argv += optind;
+   if (ntimes < 1 || nthreads < 1)
+   {
+      usage();
+      return 1;
+   }
+
+   mb = (double)(ntimes * LAT_LEN * LON_LEN * sizeof(float)) / MEGABYTE;
+   if (!(data = malloc(ntimes * LAT_LEN * LON_LEN * sizeof(float)))) ERR;
+   if (!(back = malloc(ntimes * LAT_LEN * LON_LEN * sizeof(float)))) ERR;
+   if (get_data(argc > 0 ? argv[0] : NULL, ntimes, data)) ERR;
+
+   if (header)
+      printf("filters\tpath\tencode(MB/s)\tdecode(MB/s)\tratio\n");
+   for (cfg = 0; cfg < NCONFIGS; cfg++)
+   {
+      if (config[cfg].filterid && H5Zfilter_avail(config[cfg].filterid) <= 0)
+      {
+         printf("%s\tskipped: filter %u not found\n", config[cfg].name,
+                config[cfg].filterid);
+         continue;
+      }
+      for (path = 0; path < 2; path++)
+      {
+         double write_us, read_us, ratio;
+
+         if (run(&config[cfg], path ? nthreads : 0, ntimes, data, back,
+                 &write_us, &read_us, &ratio)) ERR;
+         printf("%s\t%s\t%.1f\t%.1f\t%.2f\n", config[cfg].name,
+                path ? "netcdf" : "hdf5", mb / (write_us / MILLION),
+                mb / (read_us / MILLION), ratio);
+      }
+   }
+
+   free(data);
+   free(back);
+   FINAL_RESULTS;
+}
@@ -0,0 +1,137 @@
+/* This is part of the netCDF package.
+   Copyright 2019 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the chunk index query, nc_inq_var_chunk_info().
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_chunk.h"
+
+#define FILE_NAME "tst_chunk_info.nc"
+#define FILE_NAME_CLASSIC "tst_chunk_info_classic.nc"
+#define NDIMS2 2
+#define D0 40
+#define D1 30
+#define C0 10
+#define C1 15
+#define NCHUNKS ((D0 / C0) * (D1 / C1))
+#define CHUNK_BYTES (C0 * C1 * sizeof(int))
+
+static int data[D0 * D1];
+
+int
+main(int argc, char **argv)
+{
+   int ncid, dimids[NDIMS2], varid, contig, later;
+   size_t chunks[NDIMS2] = {C0, C1};
+   size_t i;
+
+   for (i = 0; i < D0 * D1; i++)
+      data[i] = (int)(i % 97);
+
+   printf("\n*** Testing chunk index queries.\n");
+   printf("**** testing listing of allocated chunks...");
+   {
+      size_t start[NDIMS2] = {0, 0}, count[NDIMS2] = {D0 / 2, D1};
+      size_t offsets[NCHUNKS * NDIMS2], nbytes[NCHUNKS], nchunks, total = 0;
+      unsigned long long addrs[NCHUNKS];
+      unsigned int masks[NCHUNKS];
+      int seen[D0 / C0][D1 / C1];
+
+      if (nc_create(FILE_NAME, NC_NETCDF4, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "d1", D1, &dimids[1])) ERR;
+      if (nc_def_var(ncid, "v", NC_INT, NDIMS2, dimids, &varid)) ERR;
+      if (nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_deflate(ncid, varid, 1, 1, 4)) ERR;
+      if (nc_def_var(ncid, "contig", NC_INT, NDIMS2, dimids, &contig)) ERR;
+      if (nc_def_var_chunking(ncid, contig, NC_CONTIGUOUS, NULL)) ERR;
+
+      /* Nothing is stored before the variable is written. */
+      if (nc_inq_var_chunk_info(ncid, varid, 0, &nchunks, NULL, NULL, NULL, NULL)) ERR;
+      if (nchunks) ERR;
+      if (nc_inq_var_chunk_info(ncid, contig, 0, &nchunks, NULL, NULL, NULL, NULL) != NC_EINVAL) ERR;
+      if (nc_inq_var_chunk_info(ncid, varid + 5, 0, &nchunks, NULL, NULL, NULL, NULL) != NC_ENOTVAR) ERR;
+
+      /* Write the first half; only its chunks get storage. */
+      if (nc_put_vara_int(ncid, varid, start, count, data)) ERR;
+      if (nc_inq_var_chunk_info(ncid, varid, 0, &nchunks, NULL, NULL, NULL, NULL)) ERR;
+      if (nchunks != NCHUNKS / 2) ERR;
+      if (nc_inq_var_chunk_info(ncid, varid, NCHUNKS, &nchunks, offsets, addrs, nbytes, masks)) ERR;
+      memset(seen, 0, sizeof(seen));
+      for (i = 0; i < nchunks; i++)
+      {
+         size_t n;
+         unsigned int mask;
+
+         if (offsets[i * 2] % C0 || offsets[i * 2 + 1] % C1) ERR;
+         if (offsets[i * 2] >= D0 / 2) ERR;
+         if (seen[offsets[i * 2] / C0][offsets[i * 2 + 1] / C1]++) ERR;
+         if (!addrs[i] || !nbytes[i] || nbytes[i] >= CHUNK_BYTES) ERR;
+         if (masks[i]) ERR;
+         if (nc_read_chunk(ncid, varid, &offsets[i * 2], &mask, &n, NULL)) ERR;
+         if (n != nbytes[i] || mask != masks[i]) ERR;
+         total += nbytes[i];
+      }
+      if (total >= nchunks * CHUNK_BYTES) ERR;
+
+      /* Arrays sized from that count are too small once the rest is
+       * written; nothing is stored in them, but the count is right. */
+      if (nc_put_var_int(ncid, varid, data)) ERR;
+      memset(nbytes, 0, sizeof(nbytes));
+      if (nc_inq_var_chunk_info(ncid, varid, NCHUNKS / 2, &nchunks, NULL, NULL, nbytes, NULL) != NC_EINVAL) ERR;
+      if (nchunks != NCHUNKS) ERR;
+      for (i = 0; i < NCHUNKS; i++)
+         if (nbytes[i]) ERR;
+
+      /* A variable added later has no chunks yet. */
+      if (nc_redef(ncid)) ERR;
+      if (nc_def_var(ncid, "later", NC_INT, NDIMS2, dimids, &later)) ERR;
+      if (nc_def_var_chunking(ncid, later, NC_CHUNKED, chunks)) ERR;
+      if (nc_inq_var_chunk_info(ncid, later, 0, &nchunks, NULL, NULL, NULL, NULL)) ERR;
+      if (nchunks) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing reading chunks by file address...");
+   {
+      size_t offsets[NCHUNKS * NDIMS2], nbytes[NCHUNKS], nchunks;
+      unsigned long long addrs[NCHUNKS];
+      unsigned char raw[CHUNK_BYTES * 2], stored[CHUNK_BYTES * 2];
+      FILE *fp;
+
+      if (nc_open(FILE_NAME, NC_WRITE, &ncid)) ERR;
+      if (nc_put_var_int(ncid, varid, data)) ERR;
+      if (nc_close(ncid)) ERR;
+
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (nc_inq_var_chunk_info(ncid, varid, NCHUNKS, &nchunks, offsets, addrs, nbytes, NULL)) ERR;
+      if (nchunks != NCHUNKS) ERR;
+      if (!(fp = fopen(FILE_NAME, "rb"))) ERR;
+      for (i = 0; i < nchunks; i++)
+      {
+         if (nbytes[i] > sizeof(raw)) ERR;
+         if (fseek(fp, (long)addrs[i], SEEK_SET)) ERR;
+         if (fread(raw, 1, nbytes[i], fp) != nbytes[i]) ERR;
+         if (nc_read_chunk(ncid, varid, &offsets[i * 2], NULL, NULL, stored)) ERR;
+         if (memcmp(raw, stored, nbytes[i])) ERR;
+      }
+      fclose(fp);
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing classic files...");
+   {
+      size_t nchunks;
+
+      if (nc_create(FILE_NAME_CLASSIC, NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_var(ncid, "v", NC_INT, 1, dimids, &varid)) ERR;
+      if (nc_inq_var_chunk_info(ncid, varid, 0, &nchunks, NULL, NULL, NULL, NULL) != NC_ENOTNC4) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
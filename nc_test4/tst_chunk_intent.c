@@ -0,0 +1,143 @@
+/* This is part of the netCDF package.
+   Copyright 2019 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test chunk shapes chosen from declared access intents.
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_chunk.h"
+
+#define FILE_NAME "tst_chunk_intent.nc"
+#define FILE_NAME_CLASSIC "tst_chunk_intent_classic.nc"
+#define NDIMS3 3
+#define TIME_LEN 1460
+#define LAT_LEN 180
+#define LON_LEN 360
+
+/* Number of chunks touched when reading the whole of dimension d at a
+ * single index of every other dimension. */
+static size_t
+chunks_along(size_t len, size_t chunksize)
+{
+   return (len + chunksize - 1) / chunksize;
+}
+
+int
+main(int argc, char **argv)
+{
+   printf("\n*** Testing chunk shapes from access intents.\n");
+   printf("**** testing chunk shape optimizer...");
+   {
+      size_t dimlen[NDIMS3] = {TIME_LEN, LAT_LEN, LON_LEN};
+      int unlim[NDIMS3] = {0, 0, 0};
+      size_t cs[NDIMS3];
+      size_t nmap, nseries;
+
+      /* Spatial: a map is one chunk deep in time, and the whole map
+       * fits. */
+      if (NC_compute_chunk_shape(NC_CHUNK_INTENT_SPATIAL, 4, 4194304, NDIMS3,
+                                 dimlen, unlim, cs)) ERR;
+      if (cs[0] != 1 || cs[1] != LAT_LEN || cs[2] != LON_LEN) ERR;
+
+      /* Time series: a series is one chunk. */
+      if (NC_compute_chunk_shape(NC_CHUNK_INTENT_TIMESERIES, 4, 4194304, NDIMS3,
+                                 dimlen, unlim, cs)) ERR;
+      if (cs[0] != TIME_LEN) ERR;
+      if (cs[0] * cs[1] * cs[2] * 4 > 4194304) ERR;
+
+      /* Balanced: the two access patterns touch about as many chunks. */
+      if (NC_compute_chunk_shape(NC_CHUNK_INTENT_BALANCED, 4, 1048576, NDIMS3,
+                                 dimlen, unlim, cs)) ERR;
+      nmap = chunks_along(LAT_LEN, cs[1]) * chunks_along(LON_LEN, cs[2]);
+      nseries = chunks_along(TIME_LEN, cs[0]);
+      if (nmap > 4 * nseries || nseries > 4 * nmap) ERR;
+      if (cs[0] * cs[1] * cs[2] * 4 > 1048576) ERR;
+
+      /* An empty unlimited leading dimension still gets a usable
+       * shape. */
+      dimlen[0] = 0;
+      unlim[0] = 1;
+      if (NC_compute_chunk_shape(NC_CHUNK_INTENT_TIMESERIES, 4, 4194304, NDIMS3,
+                                 dimlen, unlim, cs)) ERR;
+      if (cs[0] != NC_CHUNK_UNLIM_EXTENT || !cs[1] || !cs[2]) ERR;
+
+      /* The default intent is not the optimizer's business. */
+      if (NC_compute_chunk_shape(NC_CHUNK_INTENT_DEFAULT, 4, 4194304, NDIMS3,
+                                 dimlen, unlim, cs) != NC_EINVAL) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing per-variable and per-file intents...");
+   {
+      int ncid, dimids[NDIMS3], varid, varid2, varid3;
+      size_t chunks[NDIMS3];
+      size_t mychunks[NDIMS3] = {10, 20, 30};
+      int storage, intent;
+      int d;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4, &ncid)) ERR;
+      if (nc_def_dim(ncid, "time", TIME_LEN, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "lat", LAT_LEN, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "lon", LON_LEN, &dimids[2])) ERR;
+
+      /* Vars start out with the default intent. */
+      if (nc_def_var(ncid, "t1", NC_FLOAT, NDIMS3, dimids, &varid)) ERR;
+      if (nc_inq_var_chunk_intent(ncid, varid, &intent)) ERR;
+      if (intent != NC_CHUNK_INTENT_DEFAULT) ERR;
+
+      /* Per-variable intent. */
+      if (nc_def_var_chunk_intent(ncid, varid, NC_CHUNK_INTENT_SPATIAL)) ERR;
+      if (nc_inq_var_chunk_intent(ncid, varid, &intent)) ERR;
+      if (intent != NC_CHUNK_INTENT_SPATIAL) ERR;
+      if (nc_inq_var_chunking(ncid, varid, &storage, chunks)) ERR;
+      if (chunks[0] != 1 || chunks[1] != LAT_LEN || chunks[2] != LON_LEN) ERR;
+
+      /* Bad intent. */
+      if (nc_def_var_chunk_intent(ncid, varid, NC_CHUNK_INTENT_MAX + 1) != NC_EINVAL) ERR;
+      if (nc_def_var_chunk_intent(ncid, varid + 10, NC_CHUNK_INTENT_SPATIAL) != NC_ENOTVAR) ERR;
+
+      /* Per-file intent applies to vars defined later. */
+      if (nc_def_var_chunk_intent(ncid, NC_GLOBAL, NC_CHUNK_INTENT_TIMESERIES)) ERR;
+      if (nc_inq_var_chunk_intent(ncid, NC_GLOBAL, &intent)) ERR;
+      if (intent != NC_CHUNK_INTENT_TIMESERIES) ERR;
+      if (nc_def_var(ncid, "t2", NC_FLOAT, NDIMS3, dimids, &varid2)) ERR;
+      if (nc_inq_var_chunk_intent(ncid, varid2, &intent)) ERR;
+      if (intent != NC_CHUNK_INTENT_TIMESERIES) ERR;
+      if (nc_def_var_deflate(ncid, varid2, 1, 1, 1)) ERR;
+      if (nc_inq_var_chunking(ncid, varid2, &storage, chunks)) ERR;
+      if (storage != NC_CHUNKED || chunks[0] != TIME_LEN) ERR;
+
+      /* Explicit chunksizes set afterwards still win. */
+      if (nc_def_var(ncid, "t3", NC_FLOAT, NDIMS3, dimids, &varid3)) ERR;
+      if (nc_def_var_chunking(ncid, varid3, NC_CHUNKED, mychunks)) ERR;
+      if (nc_inq_var_chunking(ncid, varid3, &storage, chunks)) ERR;
+      for (d = 0; d < NDIMS3; d++)
+         if (chunks[d] != mychunks[d]) ERR;
+
+      /* Too late once the dataset exists. */
+      if (nc_enddef(ncid)) ERR;
+      if (nc_def_var_chunk_intent(ncid, varid, NC_CHUNK_INTENT_BALANCED) != NC_ELATEDEF) ERR;
+      if (nc_close(ncid)) ERR;
+
+      /* The chunking made it to the file. */
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (nc_inq_var_chunking(ncid, varid, &storage, chunks)) ERR;
+      if (chunks[0] != 1 || chunks[1] != LAT_LEN || chunks[2] != LON_LEN) ERR;
+      if (nc_inq_var_chunking(ncid, varid2, &storage, chunks)) ERR;
+      if (chunks[0] != TIME_LEN) ERR;
+      if (nc_def_var_chunk_intent(ncid, NC_GLOBAL, NC_CHUNK_INTENT_SPATIAL) != NC_EPERM) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing intents with classic files...");
+   {
+      int ncid;
+
+      if (nc_create(FILE_NAME_CLASSIC, NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_var_chunk_intent(ncid, NC_GLOBAL, NC_CHUNK_INTENT_SPATIAL) != NC_ENOTNC4) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
@@ -0,0 +1,273 @@
+/* This is part of the netCDF package.
+   Copyright 2019 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the direct chunk read path and the raw chunk API.
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_chunk.h"
+
+#define FILE_NAME "tst_direct_chunk.nc"
+#define FILE_NAME_CLASSIC "tst_direct_chunk_classic.nc"
+#define NDIMS3 3
+#define D0 21
+#define D1 41
+#define D2 60
+#define C0 5
+#define C1 20
+#define C2 30
+#define NVALS (D0 * D1 * D2)
+#define NTHREADS 4
+#define SENTINEL 42.5f
+
+static float data[NVALS];
+static float back[NVALS];
+
+/* Value expected at [i][j][k] of the partly written variable. */
+static float
+partial_value(size_t i, size_t j, size_t k, float fill)
+{
+   if (i < C0 && j < C1 && k < C2)
+      return data[(i * D1 + j) * D2 + k];
+   return fill;
+}
+
+int
+main(int argc, char **argv)
+{
+   size_t chunks[NDIMS3] = {C0, C1, C2};
+   int ncid, dimids[NDIMS3];
+   int varid_z, varid_be, varid_part, varid_copy, varid_contig, varid_nofill;
+   size_t i;
+
+   for (i = 0; i < NVALS; i++)
+      data[i] = (float)(i % 1000) / 10.0f;
+
+   printf("\n*** Testing direct chunk reads.\n");
+   printf("**** creating file...");
+   {
+      size_t start[NDIMS3] = {0, 0, 0}, count[NDIMS3] = {C0, C1, C2};
+      float sub[C0 * C1 * C2];
+      size_t j, k;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "d1", D1, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "d2", D2, &dimids[2])) ERR;
+
+      /* Shuffle and deflate. */
+      if (nc_def_var(ncid, "z", NC_FLOAT, NDIMS3, dimids, &varid_z)) ERR;
+      if (nc_def_var_chunking(ncid, varid_z, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_deflate(ncid, varid_z, 1, 1, 4)) ERR;
+
+      /* Not in native byte order; read the usual way. */
+      if (nc_def_var(ncid, "be", NC_FLOAT, NDIMS3, dimids, &varid_be)) ERR;
+      if (nc_def_var_chunking(ncid, varid_be, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_deflate(ncid, varid_be, 0, 1, 1)) ERR;
+      if (nc_def_var_endian(ncid, varid_be, NC_ENDIAN_BIG)) ERR;
+
+      /* Only the first chunk is ever written. */
+      if (nc_def_var(ncid, "part", NC_FLOAT, NDIMS3, dimids, &varid_part)) ERR;
+      if (nc_def_var_chunking(ncid, varid_part, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_deflate(ncid, varid_part, 1, 1, 1)) ERR;
+
+      /* Filled in with raw chunks copied from z. */
+      if (nc_def_var(ncid, "copy", NC_FLOAT, NDIMS3, dimids, &varid_copy)) ERR;
+      if (nc_def_var_chunking(ncid, varid_copy, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_deflate(ncid, varid_copy, 1, 1, 4)) ERR;
+
+      if (nc_def_var(ncid, "contig", NC_FLOAT, NDIMS3, dimids, &varid_contig)) ERR;
+      if (nc_def_var_chunking(ncid, varid_contig, NC_CONTIGUOUS, NULL)) ERR;
+
+      /* Like part, but without fill values. */
+      if (nc_def_var(ncid, "nofill", NC_FLOAT, NDIMS3, dimids, &varid_nofill)) ERR;
+      if (nc_def_var_chunking(ncid, varid_nofill, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_deflate(ncid, varid_nofill, 1, 1, 1)) ERR;
+      if (nc_def_var_fill(ncid, varid_nofill, NC_NOFILL, NULL)) ERR;
+      if (nc_enddef(ncid)) ERR;
+
+      if (nc_put_var_float(ncid, varid_z, data)) ERR;
+      if (nc_put_var_float(ncid, varid_be, data)) ERR;
+      for (i = 0; i < C0; i++)
+         for (j = 0; j < C1; j++)
+            for (k = 0; k < C2; k++)
+               sub[(i * C1 + j) * C2 + k] = data[(i * D1 + j) * D2 + k];
+      if (nc_put_vara_float(ncid, varid_part, start, count, sub)) ERR;
+      if (nc_put_vara_float(ncid, varid_nofill, start, count, sub)) ERR;
+
+      /* Read back while the file is still open for writing. */
+      if (nc_set_chunk_threads(NTHREADS)) ERR;
+      memset(back, 0, sizeof(back));
+      if (nc_get_var_float(ncid, varid_z, back)) ERR;
+      for (i = 0; i < NVALS; i++)
+         if (back[i] != data[i]) ERR;
+      if (nc_set_chunk_threads(0)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing thread count...");
+   {
+      int nthreads;
+
+      if (nc_get_chunk_threads(&nthreads)) ERR;
+      if (nthreads != 0) ERR;
+      if (nc_set_chunk_threads(-1) != NC_EINVAL) ERR;
+      if (nc_set_chunk_threads(NTHREADS)) ERR;
+      if (nc_get_chunk_threads(&nthreads)) ERR;
+      if (nthreads != NTHREADS) ERR;
+      if (nc_get_chunk_threads(NULL)) ERR;
+      if (nc_set_chunk_threads(0)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing direct reads match filtered reads...");
+   {
+      size_t start[NDIMS3] = {C0, C1, 0}, count[NDIMS3] = {D0 - C0, D1 - C1, D2};
+      size_t ustart[NDIMS3] = {1, 3, 7}, ucount[NDIMS3] = {4, 5, 6};
+      int nt, threads[3] = {0, 1, NTHREADS};
+      size_t j, k;
+      float fill = NC_FILL_FLOAT;
+
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      for (nt = 0; nt < 3; nt++)
+      {
+         if (nc_set_chunk_threads(threads[nt])) ERR;
+
+         /* Whole variables. */
+         memset(back, 0, sizeof(back));
+         if (nc_get_var_float(ncid, varid_z, back)) ERR;
+         for (i = 0; i < NVALS; i++)
+            if (back[i] != data[i]) ERR;
+         memset(back, 0, sizeof(back));
+         if (nc_get_var_float(ncid, varid_be, back)) ERR;
+         for (i = 0; i < NVALS; i++)
+            if (back[i] != data[i]) ERR;
+
+         /* Chunk-aligned slab running to the (ragged) edge. */
+         memset(back, 0, sizeof(back));
+         if (nc_get_vara_float(ncid, varid_z, start, count, back)) ERR;
+         for (i = 0; i < count[0]; i++)
+            for (j = 0; j < count[1]; j++)
+               for (k = 0; k < count[2]; k++)
+                  if (back[(i * count[1] + j) * count[2] + k] !=
+                      data[((i + start[0]) * D1 + j + start[1]) * D2 + k]) ERR;
+
+         /* Unaligned slab. */
+         memset(back, 0, sizeof(back));
+         if (nc_get_vara_float(ncid, varid_z, ustart, ucount, back)) ERR;
+         for (i = 0; i < ucount[0]; i++)
+            for (j = 0; j < ucount[1]; j++)
+               for (k = 0; k < ucount[2]; k++)
+                  if (back[(i * ucount[1] + j) * ucount[2] + k] !=
+                      data[((i + ustart[0]) * D1 + j + ustart[1]) * D2 + k + ustart[2]]) ERR;
+
+         /* Chunks never written read as fill values. */
+         memset(back, 0, sizeof(back));
+         if (nc_get_var_float(ncid, varid_part, back)) ERR;
+         for (i = 0; i < D0; i++)
+            for (j = 0; j < D1; j++)
+               for (k = 0; k < D2; k++)
+                  if (back[(i * D1 + j) * D2 + k] != partial_value(i, j, k, fill)) ERR;
+
+         /* With no_fill, they leave the buffer alone, as HDF5 does. */
+         for (i = 0; i < NVALS; i++)
+            back[i] = SENTINEL;
+         if (nc_get_var_float(ncid, varid_nofill, back)) ERR;
+         for (i = 0; i < D0; i++)
+            for (j = 0; j < D1; j++)
+               for (k = 0; k < D2; k++)
+                  if (back[(i * D1 + j) * D2 + k] != partial_value(i, j, k, SENTINEL)) ERR;
+      }
+      if (nc_set_chunk_threads(0)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing raw chunk reads and writes...");
+   {
+      size_t offset[NDIMS3];
+      size_t bad_offset[NDIMS3] = {1, 0, 0};
+      size_t far_offset[NDIMS3] = {(D0 / C0 + 1) * C0, 0, 0};
+      size_t nbytes, nbytes2;
+      unsigned int mask;
+      void *raw;
+
+      if (!(raw = malloc(C0 * C1 * C2 * sizeof(float) * 2))) ERR;
+      if (nc_open(FILE_NAME, NC_WRITE, &ncid)) ERR;
+
+      /* Copy every chunk of z to copy, unchanged. */
+      for (offset[0] = 0; offset[0] < D0; offset[0] += C0)
+         for (offset[1] = 0; offset[1] < D1; offset[1] += C1)
+            for (offset[2] = 0; offset[2] < D2; offset[2] += C2)
+            {
+               if (nc_read_chunk(ncid, varid_z, offset, &mask, &nbytes, NULL)) ERR;
+               if (!nbytes || nbytes > C0 * C1 * C2 * sizeof(float) * 2) ERR;
+               if (nc_read_chunk(ncid, varid_z, offset, &mask, &nbytes2, raw)) ERR;
+               if (nbytes2 != nbytes || mask != 0) ERR;
+               if (nc_write_chunk(ncid, varid_copy, offset, mask, nbytes, raw)) ERR;
+            }
+      memset(back, 0, sizeof(back));
+      if (nc_get_var_float(ncid, varid_copy, back)) ERR;
+      for (i = 0; i < NVALS; i++)
+         if (back[i] != data[i]) ERR;
+
+      /* Unwritten chunks have no stored bytes. */
+      offset[0] = C0;
+      offset[1] = offset[2] = 0;
+      if (nc_read_chunk(ncid, varid_part, offset, NULL, &nbytes, NULL)) ERR;
+      if (nbytes != 0) ERR;
+
+      /* Bad requests. */
+      if (nc_read_chunk(ncid, varid_z, bad_offset, NULL, &nbytes, NULL) != NC_EINVAL) ERR;
+      if (nc_read_chunk(ncid, varid_z, far_offset, NULL, &nbytes, NULL) != NC_EINVALCOORDS) ERR;
+      if (nc_write_chunk(ncid, varid_z, far_offset, 0, nbytes2, raw) != NC_EINVALCOORDS) ERR;
+      if (nc_read_chunk(ncid, varid_contig, offset, NULL, &nbytes, NULL) != NC_EINVAL) ERR;
+      if (nc_read_chunk(ncid, varid_z + 10, offset, NULL, &nbytes, NULL) != NC_ENOTVAR) ERR;
+      if (nc_close(ncid)) ERR;
+
+      /* Read only. */
+      offset[0] = 0;
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (nc_write_chunk(ncid, varid_copy, offset, 0, nbytes2, raw) != NC_EPERM) ERR;
+      if (nc_close(ncid)) ERR;
+      free(raw);
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing raw chunk writes extend unlimited dims...");
+   {
+      int varid, dimid;
+      size_t offset[1] = {0}, len;
+      int vals[C0] = {1, 2, 3, 4, 5}, vals_in[C0 * 2];
+
+      if (nc_create(FILE_NAME, NC_NETCDF4, &ncid)) ERR;
+      if (nc_def_dim(ncid, "t", NC_UNLIMITED, &dimid)) ERR;
+      if (nc_def_var(ncid, "v", NC_INT, 1, &dimid, &varid)) ERR;
+      if (nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks)) ERR;
+      if (nc_write_chunk(ncid, varid, offset, 0, sizeof(vals), vals)) ERR;
+      offset[0] = C0;
+      if (nc_write_chunk(ncid, varid, offset, 0, sizeof(vals), vals)) ERR;
+      if (nc_inq_dimlen(ncid, dimid, &len)) ERR;
+      if (len != C0 * 2) ERR;
+      if (nc_close(ncid)) ERR;
+
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (nc_inq_dimlen(ncid, dimid, &len)) ERR;
+      if (len != C0 * 2) ERR;
+      if (nc_get_var_int(ncid, varid, vals_in)) ERR;
+      for (i = 0; i < C0 * 2; i++)
+         if (vals_in[i] != vals[i % C0]) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing raw chunks with classic files...");
+   {
+      size_t offset[1] = {0};
+      size_t nbytes;
+
+      if (nc_create(FILE_NAME_CLASSIC, NC_CLOBBER, &ncid)) ERR;
+      if (nc_read_chunk(ncid, 0, offset, NULL, &nbytes, NULL) != NC_ENOTNC4) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
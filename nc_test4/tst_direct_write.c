@@ -0,0 +1,229 @@
+/* This is part of the netCDF package.
+   Copyright 2019 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the multithreaded direct chunk writer: chunks it stores must
+   be the same, byte for byte, as those the HDF5 filter pipeline
+   stores.
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_chunk.h"
+
+#define FILE_NAME "tst_direct_write.nc"
+#define FILE_NAME_BZIP2 "tst_direct_write_bzip2.nc"
+#define NDIMS3 3
+#define D0 21
+#define D1 41
+#define D2 60
+#define C0 5
+#define C1 20
+#define C2 30
+#define NVALS (D0 * D1 * D2)
+#define NREC 7
+#define NTHREADS 4
+#define H5Z_FILTER_BZIP2 307
+#define MAX_CHUNK_BYTES (C0 * C1 * C2 * 8 * 2)
+
+static float data[NVALS];
+static float back[NVALS];
+static int noise[NVALS];
+
+/* Compare every stored chunk of two variables. */
+static int
+same_chunks(int ncid, int varid1, int varid2, int ndims, const size_t *dimlen,
+            const size_t *chunks)
+{
+   static unsigned char raw1[MAX_CHUNK_BYTES], raw2[MAX_CHUNK_BYTES];
+   size_t offset[NDIMS3] = {0, 0, 0};
+   int d;
+
+   for (;;)
+   {
+      size_t n1, n2;
+      unsigned int mask1, mask2;
+
+      if (nc_read_chunk(ncid, varid1, offset, &mask1, &n1, NULL)) return 0;
+      if (nc_read_chunk(ncid, varid2, offset, &mask2, &n2, NULL)) return 0;
+      if (n1 != n2 || mask1 != mask2 || n1 > MAX_CHUNK_BYTES) return 0;
+      if (n1)
+      {
+         if (nc_read_chunk(ncid, varid1, offset, NULL, NULL, raw1)) return 0;
+         if (nc_read_chunk(ncid, varid2, offset, NULL, NULL, raw2)) return 0;
+         if (memcmp(raw1, raw2, n1)) return 0;
+      }
+      for (d = ndims - 1; d >= 0; d--)
+      {
+         offset[d] += chunks[d];
+         if (offset[d] < dimlen[d])
+            break;
+         offset[d] = 0;
+      }
+      if (d < 0)
+         break;
+   }
+   return 1;
+}
+
+/* Define a pair of variables with the same settings. */
+static int
+def_pair(int ncid, const char *name, nc_type type, int ndims, int *dimids,
+         size_t *chunks, int shuffle, int level, int no_fill, int *varids)
+{
+   char pname[NC_MAX_NAME + 1];
+   int i;
+
+   for (i = 0; i < 2; i++)
+   {
+      snprintf(pname, sizeof(pname), "%s_%s", name, i ? "threaded" : "serial");
+      if (nc_def_var(ncid, pname, type, ndims, dimids, &varids[i])) return NC_EINVAL;
+      if (nc_def_var_chunking(ncid, varids[i], NC_CHUNKED, chunks)) return NC_EINVAL;
+      if (level && nc_def_var_deflate(ncid, varids[i], shuffle, 1, level)) return NC_EINVAL;
+      if (no_fill && nc_def_var_fill(ncid, varids[i], NC_NOFILL, NULL)) return NC_EINVAL;
+   }
+   return NC_NOERR;
+}
+
+int
+main(int argc, char **argv)
+{
+   size_t dimlen[NDIMS3] = {D0, D1, D2};
+   size_t chunks[NDIMS3] = {C0, C1, C2};
+   int dimids[NDIMS3];
+   int ncid;
+   size_t i;
+
+   for (i = 0; i < NVALS; i++)
+   {
+      data[i] = (float)(i % 1000) / 10.0f;
+      noise[i] = rand();
+   }
+
+   printf("\n*** Testing direct chunk writes.\n");
+   printf("**** testing threaded writes store the same chunks...");
+   {
+      int z[2], zi[2], nf[2], rec[2], f32;
+      int recdimid, recdims[NDIMS3];
+      size_t recstart[NDIMS3] = {0, 0, 0};
+      size_t reccount[NDIMS3] = {NREC, D1, D2};
+      size_t reclen[NDIMS3] = {C0 * 2, D1, D2};
+      size_t start[NDIMS3] = {C0, 0, 0}, count[NDIMS3] = {D0 - C0, D1, D2};
+      int t;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "d1", D1, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "d2", D2, &dimids[2])) ERR;
+      if (nc_def_dim(ncid, "rec", NC_UNLIMITED, &recdimid)) ERR;
+      recdims[0] = recdimid;
+      recdims[1] = dimids[1];
+      recdims[2] = dimids[2];
+
+      /* Shuffle and deflate, ragged edges. */
+      if (def_pair(ncid, "z", NC_FLOAT, NDIMS3, dimids, chunks, 1, 3, 0, z)) ERR;
+      /* Deflate of data that will not compress. */
+      if (def_pair(ncid, "zi", NC_INT, NDIMS3, dimids, chunks, 0, 9, 0, zi)) ERR;
+      /* No fill value. */
+      if (def_pair(ncid, "nf", NC_FLOAT, NDIMS3, dimids, chunks, 1, 1, 1, nf)) ERR;
+      /* Records, the last chunk only partly written. */
+      if (def_pair(ncid, "rec", NC_FLOAT, NDIMS3, recdims, chunks, 1, 5, 0, rec)) ERR;
+      /* Fletcher32, written through HDF5 only. */
+      if (nc_def_var(ncid, "f32", NC_FLOAT, NDIMS3, dimids, &f32)) ERR;
+      if (nc_def_var_chunking(ncid, f32, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_fletcher32(ncid, f32, NC_FLETCHER32)) ERR;
+      if (nc_enddef(ncid)) ERR;
+
+      for (t = 0; t < 2; t++)
+      {
+         if (nc_set_chunk_threads(t ? NTHREADS : 0)) ERR;
+         if (nc_put_var_float(ncid, z[t], data)) ERR;
+         if (nc_put_var_int(ncid, zi[t], noise)) ERR;
+         if (nc_put_vara_float(ncid, nf[t], start, count, data)) ERR;
+         if (nc_put_vara_float(ncid, rec[t], recstart, reccount, data)) ERR;
+      }
+      if (nc_put_var_float(ncid, f32, data)) ERR;
+      if (nc_set_chunk_threads(0)) ERR;
+
+      if (!same_chunks(ncid, z[0], z[1], NDIMS3, dimlen, chunks)) ERR;
+      if (!same_chunks(ncid, zi[0], zi[1], NDIMS3, dimlen, chunks)) ERR;
+      if (!same_chunks(ncid, nf[0], nf[1], NDIMS3, dimlen, chunks)) ERR;
+      if (!same_chunks(ncid, rec[0], rec[1], NDIMS3, reclen, chunks)) ERR;
+
+      /* Add to the partly written chunk; HDF5 has to merge. */
+      recstart[0] = NREC;
+      reccount[0] = 1;
+      for (t = 0; t < 2; t++)
+      {
+         if (nc_set_chunk_threads(t ? NTHREADS : 0)) ERR;
+         if (nc_put_vara_float(ncid, rec[t], recstart, reccount, data)) ERR;
+      }
+      if (nc_set_chunk_threads(0)) ERR;
+      if (!same_chunks(ncid, rec[0], rec[1], NDIMS3, reclen, chunks)) ERR;
+      if (nc_close(ncid)) ERR;
+
+      /* Everything reads back. */
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      for (t = 0; t < 2; t++)
+      {
+         int *ibuf = (int *)back;
+         size_t j, len;
+
+         if (nc_get_var_float(ncid, z[t], back)) ERR;
+         for (i = 0; i < NVALS; i++)
+            if (back[i] != data[i]) ERR;
+         if (nc_get_var_int(ncid, zi[t], ibuf)) ERR;
+         for (i = 0; i < NVALS; i++)
+            if (ibuf[i] != noise[i]) ERR;
+         if (nc_get_vara_float(ncid, nf[t], start, count, back)) ERR;
+         for (i = 0; i < count[0] * D1 * D2; i++)
+            if (back[i] != data[i]) ERR;
+         if (nc_inq_dimlen(ncid, recdimid, &len)) ERR;
+         if (len != NREC + 1) ERR;
+         if (nc_get_var_float(ncid, rec[t], back)) ERR;
+         for (i = 0; i < NREC; i++)
+            for (j = 0; j < D1 * D2; j++)
+               if (back[i * D1 * D2 + j] != data[i * D1 * D2 + j]) ERR;
+         for (j = 0; j < D1 * D2; j++)
+            if (back[NREC * D1 * D2 + j] != data[j]) ERR;
+      }
+      if (nc_get_var_float(ncid, f32, back)) ERR;
+      for (i = 0; i < NVALS; i++)
+         if (back[i] != data[i]) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing threaded writes with bzip2...");
+   {
+      unsigned int level = 9;
+      int bz[2];
+      int t;
+
+      /* The bzip2 plugin must be on HDF5_PLUGIN_PATH for this one. */
+      if (nc_create(FILE_NAME_BZIP2, NC_NETCDF4, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "d1", D1, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "d2", D2, &dimids[2])) ERR;
+      if (def_pair(ncid, "bz", NC_FLOAT, NDIMS3, dimids, chunks, 0, 0, 0, bz)) ERR;
+      for (t = 0; t < 2; t++)
+         if (nc_def_var_filter(ncid, bz[t], H5Z_FILTER_BZIP2, 1, &level)) ERR;
+      if (nc_enddef(ncid))
+         printf("(plugin not found, skipped)...");
+      else
+      {
+         for (t = 0; t < 2; t++)
+         {
+            if (nc_set_chunk_threads(t ? NTHREADS : 0)) ERR;
+            if (nc_put_var_float(ncid, bz[t], data)) ERR;
+         }
+         if (nc_set_chunk_threads(0)) ERR;
+         if (!same_chunks(ncid, bz[0], bz[1], NDIMS3, dimlen, chunks)) ERR;
+         if (nc_get_var_float(ncid, bz[1], back)) ERR;
+         for (i = 0; i < NVALS; i++)
+            if (back[i] != data[i]) ERR;
+      }
+      nc_close(ncid);
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
@@ -10,6 +10,7 @@ NCP=1
 UNK=1
 NGC=1
 MISC=1
+FAST=1
 
 # Load the findplugins function
 . ${builddir}/findplugin.sh
@@ -150,9 +151,45 @@ sed -e '/_Filter/p' -e d < ./tst_filter.txt >tst_filter2.txt
 test ! -s tst_filter2.txt
 echo "	*** Pass: -F var,none"
 
+echo "	*** Testing filter chain application"
+rm -f ./tst_filter.txt ./tst_filter2.txt ./tst_filterchain.nc
+${NCCOPY} -M0 -F "/g/var,32008;307,9,4" unfiltered.nc tst_filterchain.nc
+${NCDUMP} -s tst_filterchain.nc > ./tst_filter.txt
+sed -e '/_Filter = "32008,/p' -e d < ./tst_filter.txt >tst_filter2.txt
+test -s tst_filter2.txt
+${NCDUMP} -n unfiltered tst_filterchain.nc > ./tst_filter.txt
+${NCDUMP} unfiltered.nc > ./tst_filter2.txt
+diff -b -w ./tst_filter2.txt ./tst_filter.txt
+echo "	*** Pass: filter chain"
+
 echo "*** Pass: all nccopy filter tests"
 fi
 
+if test "x$FAST" = x1 ; then
+echo "*** Testing the LZ4 and Zstandard plugins, if built"
+rm -f ./unfiltered.nc ./tst_filter.txt ./tst_filter2.txt ./tst_filterfast.nc
+${NCGEN} -4 -lb -o unfiltered.nc ${srcdir}/ref_unfiltered.cdl
+${NCDUMP} unfiltered.nc > ./tst_filter2.txt
+# id, spec and plugin name, in that order
+for fast in "32004 32004,4096,2 h5lz4" "32015 32015,9 h5zstd" ; do
+  set -- $fast
+  if findplugin $3 ; then
+    echo "	*** Testing $3"
+    ${NCCOPY} -M0 -F "/g/var,$2" unfiltered.nc tst_filterfast.nc
+    ${NCDUMP} -s tst_filterfast.nc > ./tst_filter.txt
+    sed -e "/_Filter = \"$1,/p" -e d < ./tst_filter.txt > ./tst_filterfast.txt
+    test -s tst_filterfast.txt
+    ${NCDUMP} -n unfiltered tst_filterfast.nc > ./tst_filter.txt
+    diff -b -w ./tst_filter2.txt ./tst_filter.txt
+    echo "	*** Pass: $3"
+  else
+    echo "	*** $3 not built; skipped"
+  fi
+done
+rm -f ./tst_filterfast.nc ./tst_filterfast.txt
+echo "*** Pass: LZ4 and Zstandard plugins"
+fi
+
 if test "x$UNK" = x1 ; then
 echo "*** Testing access to filter info when filter dll is not available"
 rm -f bzip2.nc ./tst_filter.txt
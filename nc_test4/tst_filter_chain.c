@@ -0,0 +1,215 @@
+/* This is part of the netCDF package.
+   Copyright 2019 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test chains of filters: nc_def_var_filter(), nc_inq_var_filter_ids()
+   and nc_inq_var_filter_info().
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_filter.h"
+
+#define FILE_NAME "tst_filter_chain.nc"
+#define FILE_NAME_CLASSIC "tst_filter_chain_classic.nc"
+#define NDIMS2 2
+#define D0 32
+#define D1 64
+#define MAX_FILTERS 8
+#define MAX_PARAMS 16
+#define BLOCK 64
+
+static int data[D0 * D1];
+
+/* Check the filter chain of a var against the expected IDs. */
+static int
+check_chain(int ncid, int varid, size_t nexpected, const unsigned int *expected)
+{
+   unsigned int ids[MAX_FILTERS];
+   size_t nfilters, i;
+
+   if (nc_inq_var_filter_ids(ncid, varid, &nfilters, NULL)) ERR_RET;
+   if (nfilters != nexpected) ERR_RET;
+   if (nc_inq_var_filter_ids(ncid, varid, &nfilters, ids)) ERR_RET;
+   for (i = 0; i < nfilters; i++)
+      if (ids[i] != expected[i]) ERR_RET;
+   return 0;
+}
+
+/* Check that a var reads back as data. */
+static int
+check_data(int ncid, int varid)
+{
+   static int data_in[D0 * D1];
+   size_t i;
+
+   if (nc_get_var_int(ncid, varid, data_in)) ERR_RET;
+   for (i = 0; i < D0 * D1; i++)
+      if (data_in[i] != data[i]) ERR_RET;
+   return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+   int ncid, dimids[NDIMS2], varid, varid2, varid3;
+   size_t chunks[NDIMS2] = {D0 / 2, D1};
+   size_t i;
+
+   for (i = 0; i < D0 * D1; i++)
+      data[i] = (int)(i % 101) - 50;
+
+   printf("\n*** Testing filter chains.\n");
+   printf("**** testing chain order is kept...");
+   {
+      unsigned int bitshuffle_deflate[] = {H5Z_FILTER_BITSHUFFLE, H5Z_FILTER_DEFLATE};
+      unsigned int deflate_bitshuffle[] = {H5Z_FILTER_DEFLATE, H5Z_FILTER_BITSHUFFLE};
+      unsigned int params[MAX_PARAMS], id;
+      size_t nparams;
+      int shuffle, deflate, level, fletcher32;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "d1", D1, &dimids[1])) ERR;
+
+      /* Bitshuffle, then deflate, with checksums. */
+      if (nc_def_var(ncid, "v", NC_INT, NDIMS2, dimids, &varid)) ERR;
+      if (nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_filter(ncid, varid, H5Z_FILTER_BITSHUFFLE, 0, NULL)) ERR;
+      if (nc_def_var_deflate(ncid, varid, 0, 1, 3)) ERR;
+      if (nc_def_var_fletcher32(ncid, varid, NC_FLETCHER32)) ERR;
+      if (check_chain(ncid, varid, 2, bitshuffle_deflate)) ERR;
+
+      /* The other way round. (Bitshuffle needs whole elements, so
+       * after deflate it only works for bytes.) */
+      if (nc_def_var(ncid, "v2", NC_BYTE, NDIMS2, dimids, &varid2)) ERR;
+      if (nc_def_var_chunking(ncid, varid2, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_deflate(ncid, varid2, 1, 1, 1)) ERR;
+      if (nc_def_var_filter(ncid, varid2, H5Z_FILTER_BITSHUFFLE, 0, NULL)) ERR;
+      if (check_chain(ncid, varid2, 2, deflate_bitshuffle)) ERR;
+
+      /* nc_inq_var_filter() still reports the first filter that is
+       * not deflate. */
+      if (nc_inq_var_filter(ncid, varid2, &id, &nparams, NULL)) ERR;
+      if (id != H5Z_FILTER_BITSHUFFLE || nparams) ERR;
+
+      if (nc_put_var_int(ncid, varid, data)) ERR;
+      if (nc_put_var_int(ncid, varid2, data)) ERR;
+      if (nc_close(ncid)) ERR;
+
+      /* The chains come back from the file as they were defined. */
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (nc_inq_varid(ncid, "v", &varid)) ERR;
+      if (nc_inq_varid(ncid, "v2", &varid2)) ERR;
+      if (check_chain(ncid, varid, 2, bitshuffle_deflate)) ERR;
+      if (check_chain(ncid, varid2, 2, deflate_bitshuffle)) ERR;
+
+      /* Bitshuffle parameters are filled in for the element size. */
+      if (nc_inq_var_filter_info(ncid, varid, H5Z_FILTER_BITSHUFFLE, &nparams, params)) ERR;
+      if (nparams < 3 || params[2] != sizeof(int)) ERR;
+      if (nc_inq_var_filter_info(ncid, varid, H5Z_FILTER_DEFLATE, &nparams, params)) ERR;
+      if (nparams != 1 || params[0] != 3) ERR;
+      if (nc_inq_var_filter_info(ncid, varid, H5Z_FILTER_SZIP, &nparams, params) != NC_EFILTER) ERR;
+
+      if (nc_inq_var_deflate(ncid, varid, &shuffle, &deflate, &level)) ERR;
+      if (shuffle || !deflate || level != 3) ERR;
+      if (nc_inq_var_fletcher32(ncid, varid, &fletcher32)) ERR;
+      if (fletcher32 != NC_FLETCHER32) ERR;
+      if (nc_inq_var_deflate(ncid, varid2, &shuffle, &deflate, &level)) ERR;
+      if (!shuffle || !deflate || level != 1) ERR;
+      if (nc_inq_var_filter(ncid, varid, &id, &nparams, params)) ERR;
+      if (id != H5Z_FILTER_BITSHUFFLE || params[2] != sizeof(int)) ERR;
+
+      if (check_data(ncid, varid)) ERR;
+      if (check_data(ncid, varid2)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing redefinition of filters in a chain...");
+   {
+      unsigned int bitshuffle_deflate[] = {H5Z_FILTER_BITSHUFFLE, H5Z_FILTER_DEFLATE};
+      unsigned int bitshuffle[] = {H5Z_FILTER_BITSHUFFLE};
+      unsigned int block[] = {0, 0, 0, BLOCK};
+      unsigned int level_param[] = {5}, bad_level[] = {NC_MAX_DEFLATE_LEVEL + 1};
+      unsigned int params[MAX_PARAMS];
+      size_t nparams;
+      int shuffle, deflate, level;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "d1", D1, &dimids[1])) ERR;
+
+      /* Deflate given as a filter, then redefined; bitshuffle
+       * redefined with a block size. Neither moves. */
+      if (nc_def_var(ncid, "v", NC_INT, NDIMS2, dimids, &varid)) ERR;
+      if (nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_filter(ncid, varid, H5Z_FILTER_BITSHUFFLE, 0, NULL)) ERR;
+      if (nc_def_var_filter(ncid, varid, H5Z_FILTER_DEFLATE, 1, bad_level) != NC_EINVAL) ERR;
+      if (nc_def_var_filter(ncid, varid, H5Z_FILTER_DEFLATE, 1, level_param)) ERR;
+      if (nc_inq_var_deflate(ncid, varid, NULL, &deflate, &level)) ERR;
+      if (!deflate || level != 5) ERR;
+      if (nc_def_var_deflate(ncid, varid, 0, 1, 2)) ERR;
+      if (nc_def_var_filter(ncid, varid, H5Z_FILTER_BITSHUFFLE, 4, block)) ERR;
+      if (check_chain(ncid, varid, 2, bitshuffle_deflate)) ERR;
+
+      /* Shuffle given as a filter is the shuffle flag; turning
+       * deflate off takes it out of the chain. */
+      if (nc_def_var(ncid, "v2", NC_INT, NDIMS2, dimids, &varid2)) ERR;
+      if (nc_def_var_chunking(ncid, varid2, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_filter(ncid, varid2, H5Z_FILTER_SHUFFLE, 0, NULL)) ERR;
+      if (nc_def_var_deflate(ncid, varid2, 1, 1, 4)) ERR;
+      if (nc_def_var_filter(ncid, varid2, H5Z_FILTER_BITSHUFFLE, 0, NULL)) ERR;
+      if (nc_def_var_deflate(ncid, varid2, 1, 0, 0)) ERR;
+      if (check_chain(ncid, varid2, 1, bitshuffle)) ERR;
+
+      /* A var with filters can't be contiguous. */
+      if (nc_def_var(ncid, "v3", NC_INT, NDIMS2, dimids, &varid3)) ERR;
+      if (nc_def_var_filter(ncid, varid3, H5Z_FILTER_BITSHUFFLE, 0, NULL)) ERR;
+      if (nc_def_var_chunking(ncid, varid3, NC_CONTIGUOUS, NULL) != NC_EINVAL) ERR;
+
+      if (nc_put_var_int(ncid, varid, data)) ERR;
+      if (nc_put_var_int(ncid, varid2, data)) ERR;
+      if (nc_put_var_int(ncid, varid3, data)) ERR;
+
+      /* Too late now. */
+      if (nc_def_var_filter(ncid, varid, H5Z_FILTER_DEFLATE, 1, level_param) != NC_ELATEDEF) ERR;
+      if (nc_close(ncid)) ERR;
+
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (check_chain(ncid, varid, 2, bitshuffle_deflate)) ERR;
+      if (nc_inq_var_filter_info(ncid, varid, H5Z_FILTER_BITSHUFFLE, &nparams, params)) ERR;
+      if (nparams < 4 || params[3] != BLOCK) ERR;
+      if (nc_inq_var_filter_info(ncid, varid, H5Z_FILTER_DEFLATE, &nparams, params)) ERR;
+      if (nparams != 1 || params[0] != 2) ERR;
+      if (check_chain(ncid, varid2, 1, bitshuffle)) ERR;
+      if (nc_inq_var_deflate(ncid, varid2, &shuffle, &deflate, NULL)) ERR;
+      if (!shuffle || deflate) ERR;
+      if (check_data(ncid, varid)) ERR;
+      if (check_data(ncid, varid2)) ERR;
+      if (check_data(ncid, varid3)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing chains on other formats...");
+   {
+      size_t nfilters;
+
+      if (nc_create(FILE_NAME_CLASSIC, NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_var(ncid, "v", NC_INT, 1, dimids, &varid)) ERR;
+      if (nc_inq_var_filter_ids(ncid, varid, &nfilters, NULL) != NC_ENOTNC4) ERR;
+      if (nc_inq_var_filter_info(ncid, varid, H5Z_FILTER_DEFLATE, NULL, NULL) != NC_ENOTNC4) ERR;
+      if (nc_close(ncid)) ERR;
+
+      /* A var with no filters has an empty chain. */
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "d0", D0, &dimids[0])) ERR;
+      if (nc_def_var(ncid, "v", NC_INT, 1, dimids, &varid)) ERR;
+      if (nc_inq_var_filter_ids(ncid, varid, &nfilters, NULL)) ERR;
+      if (nfilters) ERR;
+      if (nc_inq_var_filter_ids(ncid, varid + 1, &nfilters, NULL) != NC_ENOTVAR) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
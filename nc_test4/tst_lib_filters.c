@@ -0,0 +1,301 @@
+/* This is part of the netCDF package.
+   Copyright 2019 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the library's own shuffle, fletcher32 and bitshuffle
+   filters. Shuffle and fletcher32 are run by the direct chunk path,
+   and must store the same bytes as the HDF5 filters.
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_chunk.h"
+#include "netcdf_filter.h"
+#include <hdf5.h>
+
+#define FILE_NAME "tst_lib_filters.nc"
+#define LEN 3000
+#define NTYPES 5
+#define NCHUNKLENS 5
+#define MAX_BYTES (LEN * 8 + 64)
+#define BSHUF_LEN 1000
+#define BSHUF_BLOCK 64
+
+static unsigned char data[LEN * 8];
+static unsigned char back[LEN * 8];
+
+/* Bitshuffle, one bit at a time. */
+static void
+ref_bitshuffle(const unsigned char *src, unsigned char *dst, size_t nbytes,
+               size_t size, size_t block)
+{
+   size_t nelems = nbytes / size, done = 0, n, i, b;
+
+   memset(dst, 0, nbytes);
+   while (done < nelems)
+   {
+      n = nelems - done < block ? nelems - done : block;
+      n -= n % 8;
+      if (!n)
+         break;
+      for (i = 0; i < n; i++)
+         for (b = 0; b < size * 8; b++)
+            if (src[(done + i) * size + b / 8] & (1 << (b % 8)))
+            {
+               size_t bit = b * n + i;
+               dst[done * size + bit / 8] |= (unsigned char)(1 << (bit % 8));
+            }
+      done += n;
+   }
+   memcpy(dst + done * size, src + done * size, (nelems - done) * size);
+}
+
+/* Run a registered filter over a copy of a buffer. */
+static size_t
+run_filter(int id, unsigned int flags, size_t nparams, const unsigned int *params,
+           const unsigned char *in, size_t nbytes, unsigned char *out)
+{
+   NC_FILTER_INFO info;
+   H5Z_class2_t *cls;
+   size_t buf_size = nbytes, n;
+   void *buf;
+
+   if (nc_filter_inq(NC_FILTER_FORMAT_HDF5, id, &info)) return 0;
+   cls = (H5Z_class2_t *)info.info;
+   if (!(buf = H5allocate_memory(nbytes ? nbytes : 1, 0))) return 0;
+   memcpy(buf, in, nbytes);
+   n = cls->filter(flags, nparams, params, nbytes, &buf_size, &buf);
+   if (n)
+      memcpy(out, buf, n);
+   H5free_memory(buf);
+   return n;
+}
+
+/* Compare every stored chunk of two 1D variables. */
+static int
+same_chunks(int ncid, int varid1, int varid2, size_t len, size_t chunk)
+{
+   static unsigned char raw1[MAX_BYTES], raw2[MAX_BYTES];
+   size_t offset, n1, n2;
+   unsigned int mask1, mask2;
+
+   for (offset = 0; offset < len; offset += chunk)
+   {
+      if (nc_read_chunk(ncid, varid1, &offset, &mask1, &n1, NULL)) return 0;
+      if (nc_read_chunk(ncid, varid2, &offset, &mask2, &n2, NULL)) return 0;
+      if (n1 != n2 || mask1 != mask2 || n1 > MAX_BYTES) return 0;
+      if (nc_read_chunk(ncid, varid1, &offset, NULL, NULL, raw1)) return 0;
+      if (nc_read_chunk(ncid, varid2, &offset, NULL, NULL, raw2)) return 0;
+      if (memcmp(raw1, raw2, n1)) return 0;
+   }
+   return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+   nc_type type[NTYPES] = {NC_BYTE, NC_SHORT, NC_INT, NC_FLOAT, NC_DOUBLE};
+   size_t chunklen[NCHUNKLENS] = {1, 7, 33, 257, 1001};
+   int ncid, dimid;
+   size_t i;
+
+   /* Smooth values with noise in the low bytes. */
+   for (i = 0; i < LEN * 8; i++)
+      data[i] = (unsigned char)(i % 8 < 4 ? rand() : i / 64);
+
+   printf("\n*** Testing the library's own filters.\n");
+   printf("**** testing direct shuffle and fletcher32 match HDF5...");
+   {
+      int varid[NTYPES][NCHUNKLENS][2];
+      int t, c, p;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "x", LEN, &dimid)) ERR;
+      for (t = 0; t < NTYPES; t++)
+         for (c = 0; c < NCHUNKLENS; c++)
+            for (p = 0; p < 2; p++)
+            {
+               char name[NC_MAX_NAME + 1];
+
+               snprintf(name, sizeof(name), "v%d_%d_%s", t, c, p ? "direct" : "hdf5");
+               if (nc_def_var(ncid, name, type[t], 1, &dimid, &varid[t][c][p])) ERR;
+               if (nc_def_var_chunking(ncid, varid[t][c][p], NC_CHUNKED, &chunklen[c])) ERR;
+               if (nc_def_var_deflate(ncid, varid[t][c][p], 1, c % 2, 1)) ERR;
+               if (nc_def_var_fletcher32(ncid, varid[t][c][p], NC_FLETCHER32)) ERR;
+            }
+      if (nc_enddef(ncid)) ERR;
+
+      /* The first of each pair is written by HDF5, the second by the
+       * direct path. */
+      for (p = 0; p < 2; p++)
+      {
+         if (nc_set_chunk_threads(p)) ERR;
+         for (t = 0; t < NTYPES; t++)
+            for (c = 0; c < NCHUNKLENS; c++)
+               if (nc_put_var(ncid, varid[t][c][p], data)) ERR;
+      }
+      if (nc_set_chunk_threads(0)) ERR;
+      for (t = 0; t < NTYPES; t++)
+         for (c = 0; c < NCHUNKLENS; c++)
+            if (!same_chunks(ncid, varid[t][c][0], varid[t][c][1], LEN, chunklen[c])) ERR;
+      if (nc_close(ncid)) ERR;
+
+      /* Both paths read both back. */
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      for (p = 0; p < 2; p++)
+      {
+         if (nc_set_chunk_threads(p)) ERR;
+         for (t = 0; t < NTYPES; t++)
+            for (c = 0; c < NCHUNKLENS; c++)
+            {
+               size_t size;
+               int q;
+
+               if (nc_inq_type(ncid, type[t], NULL, &size)) ERR;
+               for (q = 0; q < 2; q++)
+               {
+                  memset(back, 0, sizeof(back));
+                  if (nc_get_var(ncid, varid[t][c][q], back)) ERR;
+                  if (memcmp(back, data, LEN * size)) ERR;
+               }
+            }
+      }
+      if (nc_set_chunk_threads(0)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing direct reads check fletcher32...");
+   {
+      static unsigned char raw[MAX_BYTES];
+      size_t chunk = 100, offset = 200, n;
+      unsigned int mask;
+      int varid;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "x", LEN, &dimid)) ERR;
+      if (nc_def_var(ncid, "v", NC_INT, 1, &dimid, &varid)) ERR;
+      if (nc_def_var_chunking(ncid, varid, NC_CHUNKED, &chunk)) ERR;
+      if (nc_def_var_deflate(ncid, varid, 1, 0, 0)) ERR;
+      if (nc_def_var_fletcher32(ncid, varid, NC_FLETCHER32)) ERR;
+      if (nc_put_var(ncid, varid, data)) ERR;
+
+      /* Damage one chunk. */
+      if (nc_read_chunk(ncid, varid, &offset, &mask, &n, raw)) ERR;
+      raw[n / 2] ^= 0x10;
+      if (nc_write_chunk(ncid, varid, &offset, mask, n, raw)) ERR;
+      if (nc_close(ncid)) ERR;
+
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (nc_set_chunk_threads(1)) ERR;
+      if (nc_get_var(ncid, varid, back) == NC_NOERR) ERR;
+      if (nc_set_chunk_threads(0)) ERR;
+      if (nc_get_var(ncid, varid, back) == NC_NOERR) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing bitshuffle...");
+   {
+      static unsigned char raw[MAX_BYTES], ref[MAX_BYTES];
+      static float fdata[BSHUF_LEN], fback[BSHUF_LEN];
+      size_t len = BSHUF_LEN, chunk = BSHUF_LEN / 4 + 3;
+      unsigned int params[4] = {0, 0, 0, BSHUF_BLOCK};
+      int bs, bsb, bsd[2];
+      size_t offset, n, nparams;
+      unsigned int id, mask;
+      int p;
+
+      for (i = 0; i < len; i++)
+         fdata[i] = (float)i / 7.0f;
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "x", len, &dimid)) ERR;
+      if (nc_def_var(ncid, "bs", NC_FLOAT, 1, &dimid, &bs)) ERR;
+      if (nc_def_var_chunking(ncid, bs, NC_CHUNKED, &chunk)) ERR;
+      if (nc_def_var_filter(ncid, bs, H5Z_FILTER_BITSHUFFLE, 0, NULL)) ERR;
+      if (nc_def_var(ncid, "bs_block", NC_FLOAT, 1, &dimid, &bsb)) ERR;
+      if (nc_def_var_chunking(ncid, bsb, NC_CHUNKED, &chunk)) ERR;
+      if (nc_def_var_filter(ncid, bsb, H5Z_FILTER_BITSHUFFLE, 4, params)) ERR;
+      for (p = 0; p < 2; p++)
+      {
+         if (nc_def_var(ncid, p ? "bs_direct" : "bs_hdf5", NC_FLOAT, 1, &dimid, &bsd[p])) ERR;
+         if (nc_def_var_chunking(ncid, bsd[p], NC_CHUNKED, &chunk)) ERR;
+         if (nc_def_var_filter(ncid, bsd[p], H5Z_FILTER_BITSHUFFLE, 0, NULL)) ERR;
+      }
+      if (nc_put_var_float(ncid, bs, fdata)) ERR;
+      if (nc_put_var_float(ncid, bsb, fdata)) ERR;
+      for (p = 0; p < 2; p++)
+      {
+         if (nc_set_chunk_threads(p)) ERR;
+         if (nc_put_var_float(ncid, bsd[p], fdata)) ERR;
+      }
+      if (nc_set_chunk_threads(0)) ERR;
+      if (!same_chunks(ncid, bsd[0], bsd[1], len, chunk)) ERR;
+      if (nc_close(ncid)) ERR;
+
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (nc_inq_var_filter(ncid, bs, &id, &nparams, NULL)) ERR;
+      if (id != H5Z_FILTER_BITSHUFFLE || nparams != 3) ERR;
+      for (offset = 0; offset < len; offset += chunk)
+      {
+         size_t nvals = offset + chunk <= len ? chunk : len - offset;
+
+         /* A partial last chunk is stored whole, padded with fill. */
+         for (i = 0; i < chunk; i++)
+            fback[i] = i < nvals ? fdata[offset + i] : NC_FILL_FLOAT;
+         ref_bitshuffle((unsigned char *)fback, ref, chunk * sizeof(float),
+                        sizeof(float), 2048);
+         if (nc_read_chunk(ncid, bs, &offset, &mask, &n, raw)) ERR;
+         if (mask || n != chunk * sizeof(float) || memcmp(raw, ref, n)) ERR;
+         ref_bitshuffle((unsigned char *)fback, ref, chunk * sizeof(float),
+                        sizeof(float), BSHUF_BLOCK);
+         if (nc_read_chunk(ncid, bsb, &offset, &mask, &n, raw)) ERR;
+         if (mask || n != chunk * sizeof(float) || memcmp(raw, ref, n)) ERR;
+      }
+      for (p = 0; p < 2; p++)
+      {
+         if (nc_set_chunk_threads(p)) ERR;
+         if (nc_get_var_float(ncid, bs, fback)) ERR;
+         for (i = 0; i < len; i++)
+            if (fback[i] != fdata[i]) ERR;
+         if (nc_get_var_float(ncid, bsb, fback)) ERR;
+         for (i = 0; i < len; i++)
+            if (fback[i] != fdata[i]) ERR;
+      }
+      if (nc_set_chunk_threads(0)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing bitshuffle kernel...");
+   {
+      static unsigned char ref[MAX_BYTES], out[MAX_BYTES];
+      size_t sizes[] = {1, 2, 3, 4, 8, 16};
+      size_t lens[] = {0, 5, 8, 15, 16, 17, 64, 100, 255, 1024, 1499};
+      size_t blocks[] = {0, 8, 24, 128};
+      size_t s, l, b;
+
+      for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+         for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+            for (b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++)
+            {
+               unsigned int params[4] = {0, 3, 0, 0};
+               size_t nbytes = lens[l] * sizes[s];
+               size_t block = blocks[b];
+
+               params[2] = (unsigned int)sizes[s];
+               params[3] = (unsigned int)block;
+               if (!block)
+               {
+                  block = 8192 / sizes[s] / 8 * 8;
+                  if (block < 128)
+                     block = 128;
+               }
+               ref_bitshuffle(data, ref, nbytes, sizes[s], block);
+               if (run_filter(H5Z_FILTER_BITSHUFFLE, 0, 4, params, data, nbytes, out) != nbytes) ERR;
+               if (memcmp(out, ref, nbytes)) ERR;
+               if (run_filter(H5Z_FILTER_BITSHUFFLE, H5Z_FLAG_REVERSE, 4, params, ref, nbytes,
+                              out) != nbytes) ERR;
+               if (memcmp(out, data, nbytes)) ERR;
+            }
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
@@ -0,0 +1,209 @@
+/* Copyright 2019, UCAR/Unidata See COPYRIGHT file for copying and
+ * redistribution conditions.
+ *
+ * This program tests netcdf-4 parallel I/O with the deflate and
+ * shuffle filters. Each task writes its own rows of a fixed and of a
+ * record var, collectively, and then all the data are read back by
+ * every task. The file is then reopened and the record var extended
+ * with the default access.
+ */
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_chunk.h"
+#include <mpi.h>
+
+#define FILE "tst_parallel_compress.nc"
+#define NDIMS2 2
+#define NROWS 64
+#define NCOLS 256
+#define FIXED_VAR_NAME "temperature"
+#define REC_VAR_NAME "precipitation"
+#define DEFLATE_LEVEL 1
+
+#ifdef HDF5_SUPPORTS_PAR_FILTERS
+static float data_in[NROWS * NCOLS];
+
+/* The value of an element, whichever task wrote it. */
+static float
+expected(size_t row, size_t col)
+{
+   return 273.15f + (float)((row * 7 + col) % 101) / 10.0f;
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+   int mpi_size, mpi_rank;
+   MPI_Comm comm = MPI_COMM_WORLD;
+   MPI_Info info = MPI_INFO_NULL;
+   int ncid, dimids[NDIMS2], fvarid;
+#ifdef HDF5_SUPPORTS_PAR_FILTERS
+   int rec_dimids[NDIMS2], rvarid;
+   size_t chunks[NDIMS2] = {1, NCOLS};
+   size_t start[NDIMS2] = {0, 0}, count[NDIMS2] = {0, NCOLS};
+   float *data;
+   size_t r, c, rows;
+#endif
+
+   MPI_Init(&argc, &argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+   MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+
+   if (!mpi_rank)
+      printf("\n*** Testing parallel I/O with compression.\n");
+
+#ifndef HDF5_SUPPORTS_PAR_FILTERS
+   if (!mpi_rank)
+      printf("*** testing that filters are refused before HDF5 1.10.2...");
+   {
+      if (nc_create_par(FILE, NC_NETCDF4|NC_CLOBBER, comm, info, &ncid)) ERR;
+      if (nc_def_dim(ncid, "row", NROWS, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "col", NCOLS, &dimids[1])) ERR;
+      if (nc_def_var(ncid, FIXED_VAR_NAME, NC_FLOAT, NDIMS2, dimids, &fvarid)) ERR;
+      if (nc_def_var_deflate(ncid, fvarid, NC_SHUFFLE, 1, DEFLATE_LEVEL) != NC_EINVAL) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   if (!mpi_rank)
+      SUMMARIZE_ERR;
+#else
+   /* Each task must get the same number of rows. */
+   if (NROWS % mpi_size) ERR;
+   rows = NROWS / mpi_size;
+   start[0] = rows * mpi_rank;
+   count[0] = rows;
+   if (!(data = malloc(rows * NCOLS * sizeof(float)))) ERR;
+   for (r = 0; r < rows; r++)
+      for (c = 0; c < NCOLS; c++)
+         data[r * NCOLS + c] = expected(start[0] + r, c);
+
+   if (!mpi_rank)
+      printf("*** testing collective writes with deflate and shuffle...");
+   {
+      int shuffle, deflate, level;
+
+      if (nc_create_par(FILE, NC_NETCDF4|NC_CLOBBER, comm, info, &ncid)) ERR;
+      if (nc_def_dim(ncid, "row", NROWS, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "col", NCOLS, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "time", NC_UNLIMITED, &rec_dimids[0])) ERR;
+      rec_dimids[1] = dimids[1];
+      if (nc_def_var(ncid, FIXED_VAR_NAME, NC_FLOAT, NDIMS2, dimids, &fvarid)) ERR;
+      if (nc_def_var(ncid, REC_VAR_NAME, NC_FLOAT, NDIMS2, rec_dimids, &rvarid)) ERR;
+      if (nc_def_var_chunking(ncid, fvarid, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_chunking(ncid, rvarid, NC_CHUNKED, chunks)) ERR;
+
+      /* Asking for independent access first doesn't stick once a
+       * filter is added. */
+      if (nc_var_par_access(ncid, fvarid, NC_INDEPENDENT)) ERR;
+      if (nc_def_var_deflate(ncid, fvarid, NC_SHUFFLE, 1, DEFLATE_LEVEL)) ERR;
+      if (nc_def_var_deflate(ncid, rvarid, NC_SHUFFLE, 1, DEFLATE_LEVEL)) ERR;
+      if (nc_inq_var_deflate(ncid, fvarid, &shuffle, &deflate, &level)) ERR;
+      if (!shuffle || !deflate || level != DEFLATE_LEVEL) ERR;
+
+      /* Filtered data can't be written independently. */
+      if (nc_var_par_access(ncid, fvarid, NC_INDEPENDENT) != NC_EINVAL) ERR;
+      if (nc_var_par_access(ncid, rvarid, NC_INDEPENDENT) != NC_EINVAL) ERR;
+      if (nc_var_par_access(ncid, rvarid, NC_COLLECTIVE)) ERR;
+      if (nc_enddef(ncid)) ERR;
+
+      /* Each task writes its rows; the record var is extended
+       * collectively. */
+      if (nc_put_vara_float(ncid, fvarid, start, count, data)) ERR;
+      if (nc_put_vara_float(ncid, rvarid, start, count, data)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   if (!mpi_rank)
+      SUMMARIZE_ERR;
+
+   if (!mpi_rank)
+      printf("*** testing parallel reads of compressed data...");
+   {
+      int shuffle, deflate, level;
+      size_t len;
+
+      if (nc_open_par(FILE, NC_NOWRITE, comm, info, &ncid)) ERR;
+      if (nc_inq_varid(ncid, FIXED_VAR_NAME, &fvarid)) ERR;
+      if (nc_inq_varid(ncid, REC_VAR_NAME, &rvarid)) ERR;
+      if (nc_inq_var_deflate(ncid, rvarid, &shuffle, &deflate, &level)) ERR;
+      if (!shuffle || !deflate || level != DEFLATE_LEVEL) ERR;
+      if (nc_inq_dimlen(ncid, 0, &len)) ERR;
+      if (len != NROWS) ERR;
+
+      /* Independent reads of filtered data are fine. */
+      if (nc_var_par_access(ncid, fvarid, NC_INDEPENDENT)) ERR;
+      if (nc_get_var_float(ncid, fvarid, data_in)) ERR;
+      for (r = 0; r < NROWS; r++)
+         for (c = 0; c < NCOLS; c++)
+            if (data_in[r * NCOLS + c] != expected(r, c)) ERR;
+
+      if (nc_inq_unlimdim(ncid, &rec_dimids[0])) ERR;
+      if (nc_inq_dimlen(ncid, rec_dimids[0], &len)) ERR;
+      if (len != NROWS) ERR;
+      if (nc_get_var_float(ncid, rvarid, data_in)) ERR;
+      for (r = 0; r < NROWS; r++)
+         for (c = 0; c < NCOLS; c++)
+            if (data_in[r * NCOLS + c] != expected(r, c)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   if (!mpi_rank)
+      SUMMARIZE_ERR;
+
+   if (!mpi_rank)
+      printf("*** testing collective writes after reopening the file...");
+   {
+      size_t len, rec_start[NDIMS2] = {0, 0};
+
+      if (nc_open_par(FILE, NC_WRITE, comm, info, &ncid)) ERR;
+      if (nc_inq_varid(ncid, REC_VAR_NAME, &rvarid)) ERR;
+
+      /* The filters are found before the access is set, so the
+       * filtered var can't be made independent, and starts out
+       * collective. */
+      if (nc_var_par_access(ncid, rvarid, NC_INDEPENDENT) != NC_EINVAL) ERR;
+
+      /* Each task appends its rows again, with the default access. */
+      rec_start[0] = NROWS + start[0];
+      if (nc_put_vara_float(ncid, rvarid, rec_start, count, data)) ERR;
+      if (nc_close(ncid)) ERR;
+
+      if (nc_open_par(FILE, NC_NOWRITE, comm, info, &ncid)) ERR;
+      if (nc_inq_varid(ncid, REC_VAR_NAME, &rvarid)) ERR;
+      if (nc_inq_unlimdim(ncid, &rec_dimids[0])) ERR;
+      if (nc_inq_dimlen(ncid, rec_dimids[0], &len)) ERR;
+      if (len != 2 * NROWS) ERR;
+      if (nc_get_vara_float(ncid, rvarid, rec_start, count, data_in)) ERR;
+      for (r = 0; r < rows; r++)
+         for (c = 0; c < NCOLS; c++)
+            if (data_in[r * NCOLS + c] != expected(start[0] + r, c)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   if (!mpi_rank)
+      SUMMARIZE_ERR;
+
+   if (!mpi_rank)
+      printf("*** testing that the data were compressed...");
+   if (!mpi_rank)
+   {
+      size_t nchunks, nbytes[NROWS], stored = 0, i;
+
+      if (nc_open(FILE, NC_NOWRITE, &ncid)) ERR;
+      if (nc_inq_varid(ncid, FIXED_VAR_NAME, &fvarid)) ERR;
+      if (nc_inq_var_chunk_info(ncid, fvarid, 0, &nchunks, NULL, NULL, NULL, NULL)) ERR;
+      if (nchunks != NROWS) ERR;
+      if (nc_inq_var_chunk_info(ncid, fvarid, NROWS, &nchunks, NULL, NULL, nbytes, NULL)) ERR;
+      for (i = 0; i < nchunks; i++)
+         stored += nbytes[i];
+      if (stored >= NROWS * NCOLS * sizeof(float)) ERR;
+      if (nc_close(ncid)) ERR;
+      SUMMARIZE_ERR;
+   }
+   free(data);
+#endif /* HDF5_SUPPORTS_PAR_FILTERS */
+
+   MPI_Finalize();
+
+   if (!mpi_rank)
+      FINAL_RESULTS;
+   return 0;
+}
@@ -0,0 +1,189 @@
+/* This is part of the netCDF package.
+   Copyright 2019 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test quantization: nc_def_var_quantize() and nc_inq_var_quantize().
+*/
+
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "netcdf_chunk.h"
+#include <math.h>
+
+#define FILE_NAME "tst_quantize.nc"
+#define FILE_NAME_CLASSIC "tst_quantize_classic.nc"
+#define NDIMS2 2
+#define D0 64
+#define D1 128
+#define NSD_FLOAT 3
+#define NSD_DOUBLE 6
+#define FILL_IDX 17
+
+static float fdata[D0 * D1];
+static double ddata[D0 * D1];
+
+/* Sum of the stored sizes of the chunks of a var. */
+static int
+stored_size(int ncid, int varid, size_t *sizep)
+{
+   size_t nchunks, nbytes[D0], i;
+
+   if (nc_inq_var_chunk_info(ncid, varid, 0, &nchunks, NULL, NULL, NULL, NULL)) ERR_RET;
+   if (nchunks > D0) ERR_RET;
+   if (nc_inq_var_chunk_info(ncid, varid, D0, &nchunks, NULL, NULL, nbytes, NULL)) ERR_RET;
+   for (*sizep = 0, i = 0; i < nchunks; i++)
+      *sizep += nbytes[i];
+   return 0;
+}
+
+/* Check that data read back keeps nsd significant digits, and that
+ * fill values and zeros are untouched. */
+static int
+check_data(int ncid, int fvarid, int dvarid)
+{
+   static float fdata_in[D0 * D1];
+   static double ddata_in[D0 * D1];
+   size_t i;
+   int changed = 0;
+
+   if (nc_get_var_float(ncid, fvarid, fdata_in)) ERR_RET;
+   if (nc_get_var_double(ncid, dvarid, ddata_in)) ERR_RET;
+   for (i = 0; i < D0 * D1; i++)
+   {
+      if (fabs(fdata_in[i] - fdata[i]) > fabs(fdata[i]) * pow(10, -NSD_FLOAT)) ERR_RET;
+      if (fabs(ddata_in[i] - ddata[i]) > fabs(ddata[i]) * pow(10, -NSD_DOUBLE)) ERR_RET;
+      if (fdata_in[i] != fdata[i])
+         changed++;
+   }
+   if (!changed) ERR_RET;
+   if (fdata_in[FILL_IDX] != NC_FILL_FLOAT || ddata_in[FILL_IDX] != NC_FILL_DOUBLE) ERR_RET;
+   if (fdata_in[0] != 0 || ddata_in[0] != 0) ERR_RET;
+   return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+   int ncid, dimids[NDIMS2], fvarid, dvarid, ivarid, pvarid;
+   size_t chunks[NDIMS2] = {1, D1};
+   size_t i;
+
+   for (i = 0; i < D0 * D1; i++)
+   {
+      ddata[i] = 273.15 + 30 * sin((double)i / 300) + 0.01 * cos((double)i * 7);
+      fdata[i] = (float)ddata[i];
+   }
+   fdata[0] = 0;
+   ddata[0] = 0;
+   fdata[FILL_IDX] = NC_FILL_FLOAT;
+   ddata[FILL_IDX] = NC_FILL_DOUBLE;
+
+   printf("\n*** Testing quantization.\n");
+   printf("**** testing nc_def_var_quantize() errors...");
+   {
+      int mode, nsd;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "x", D0, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "y", D1, &dimids[1])) ERR;
+      if (nc_def_var(ncid, "f", NC_FLOAT, NDIMS2, dimids, &fvarid)) ERR;
+      if (nc_def_var(ncid, "i", NC_INT, NDIMS2, dimids, &ivarid)) ERR;
+
+      /* Not quantized until asked. */
+      if (nc_inq_var_quantize(ncid, fvarid, &mode, &nsd)) ERR;
+      if (mode != NC_NOQUANTIZE || nsd) ERR;
+
+      /* Bad modes, digits, types and ids. */
+      if (nc_def_var_quantize(ncid, fvarid, NC_QUANTIZE_MAX + 1, 3) != NC_EINVAL) ERR;
+      if (nc_def_var_quantize(ncid, fvarid, NC_QUANTIZE_BITGROOM, 0) != NC_EINVAL) ERR;
+      if (nc_def_var_quantize(ncid, fvarid, NC_QUANTIZE_BITGROOM,
+                              NC_QUANTIZE_MAX_FLOAT_NSD + 1) != NC_EINVAL) ERR;
+      if (nc_def_var_quantize(ncid, ivarid, NC_QUANTIZE_BITGROOM, 3) != NC_EINVAL) ERR;
+      if (nc_def_var_quantize(ncid, 99, NC_QUANTIZE_BITGROOM, 3) != NC_ENOTVAR) ERR;
+      if (nc_inq_var_quantize(ncid, 99, NULL, NULL) != NC_ENOTVAR) ERR;
+
+      /* Turning it on and off again leaves no attribute behind. */
+      if (nc_def_var_quantize(ncid, fvarid, NC_QUANTIZE_BITGROOM, 3)) ERR;
+      if (nc_get_att_int(ncid, fvarid, NC_QUANTIZE_BITGROOM_ATT_NAME, &nsd)) ERR;
+      if (nsd != 3) ERR;
+      if (nc_def_var_quantize(ncid, fvarid, NC_NOQUANTIZE, 0)) ERR;
+      if (nc_inq_att(ncid, fvarid, NC_QUANTIZE_BITGROOM_ATT_NAME, NULL, NULL) != NC_ENOTATT) ERR;
+      if (nc_inq_var_quantize(ncid, fvarid, &mode, &nsd)) ERR;
+      if (mode != NC_NOQUANTIZE || nsd) ERR;
+
+      /* Too late once the var exists in the file. */
+      if (nc_enddef(ncid)) ERR;
+      if (nc_def_var_quantize(ncid, fvarid, NC_QUANTIZE_BITGROOM, 3) != NC_ELATEDEF) ERR;
+      if (nc_close(ncid)) ERR;
+
+      /* Not for netCDF-3 files. */
+      if (nc_create(FILE_NAME_CLASSIC, NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "x", D0, &dimids[0])) ERR;
+      if (nc_def_var(ncid, "f", NC_FLOAT, 1, dimids, &fvarid)) ERR;
+      if (nc_def_var_quantize(ncid, fvarid, NC_QUANTIZE_BITGROOM, 3) != NC_ENOTNC4) ERR;
+      if (nc_inq_var_quantize(ncid, fvarid, NULL, NULL) != NC_ENOTNC4) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("**** testing quantized data...");
+   {
+      int mode, nsd;
+      size_t plain, quantized;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "x", D0, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "y", D1, &dimids[1])) ERR;
+      if (nc_def_var(ncid, "f", NC_FLOAT, NDIMS2, dimids, &fvarid)) ERR;
+      if (nc_def_var(ncid, "d", NC_DOUBLE, NDIMS2, dimids, &dvarid)) ERR;
+      if (nc_def_var(ncid, "p", NC_FLOAT, NDIMS2, dimids, &pvarid)) ERR;
+      if (nc_def_var_chunking(ncid, fvarid, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_chunking(ncid, dvarid, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_chunking(ncid, pvarid, NC_CHUNKED, chunks)) ERR;
+      if (nc_def_var_deflate(ncid, fvarid, NC_SHUFFLE, 1, 1)) ERR;
+      if (nc_def_var_deflate(ncid, dvarid, NC_SHUFFLE, 1, 1)) ERR;
+      if (nc_def_var_deflate(ncid, pvarid, NC_SHUFFLE, 1, 1)) ERR;
+      if (nc_def_var_quantize(ncid, fvarid, NC_QUANTIZE_BITGROOM, NSD_FLOAT)) ERR;
+      if (nc_def_var_quantize(ncid, dvarid, NC_QUANTIZE_BITGROOM, NSD_DOUBLE)) ERR;
+      if (nc_inq_var_quantize(ncid, dvarid, &mode, &nsd)) ERR;
+      if (mode != NC_QUANTIZE_BITGROOM || nsd != NSD_DOUBLE) ERR;
+
+      /* The float var gets converted doubles, and the double var the
+       * data in two slabs. */
+      if (nc_put_var_double(ncid, fvarid, ddata)) ERR;
+      {
+         size_t start[NDIMS2] = {0, 0}, count[NDIMS2] = {D0 / 2, D1};
+
+         if (nc_put_vara_double(ncid, dvarid, start, count, ddata)) ERR;
+         start[0] = D0 / 2;
+         if (nc_put_vara_double(ncid, dvarid, start, count, ddata + D0 / 2 * D1)) ERR;
+      }
+      if (nc_put_var_float(ncid, pvarid, fdata)) ERR;
+
+      /* The user's data is not changed. */
+      if (ddata[1] != 273.15 + 30 * sin(1.0 / 300) + 0.01 * cos(7.0)) ERR;
+
+      if (check_data(ncid, fvarid, dvarid)) ERR;
+      if (nc_sync(ncid)) ERR;
+      if (stored_size(ncid, fvarid, &quantized)) ERR;
+      if (stored_size(ncid, pvarid, &plain)) ERR;
+      if (quantized * 3 / 2 > plain) ERR;
+      if (nc_close(ncid)) ERR;
+
+      /* The setting is read back from the attribute. */
+      if (nc_open(FILE_NAME, NC_WRITE, &ncid)) ERR;
+      if (nc_inq_var_quantize(ncid, fvarid, &mode, &nsd)) ERR;
+      if (mode != NC_QUANTIZE_BITGROOM || nsd != NSD_FLOAT) ERR;
+      if (nc_inq_var_quantize(ncid, pvarid, &mode, &nsd)) ERR;
+      if (mode != NC_NOQUANTIZE || nsd) ERR;
+      if (nc_get_att_int(ncid, dvarid, NC_QUANTIZE_BITGROOM_ATT_NAME, &nsd)) ERR;
+      if (nsd != NSD_DOUBLE) ERR;
+      if (check_data(ncid, fvarid, dvarid)) ERR;
+
+      /* Later writes are quantized too. */
+      if (nc_put_var_float(ncid, fvarid, fdata)) ERR;
+      if (check_data(ncid, fvarid, dvarid)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
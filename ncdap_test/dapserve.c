@@ -0,0 +1,437 @@
+/*! \file
+
+Copyright 2019 University Corporation for Atmospheric Research/Unidata.
+
+See \ref copyright file for more info.
+
+A minimal DAP2 server on the loopback interface, so that the client's
+constrained requests can be tested without the remote test server.
+
+    dapserve <datadir> <portfile>
+
+serves <datadir>/NAME.das, NAME.dds and NAME.dods as
+http://127.0.0.1:PORT/dts/NAME.{das,dds,dods}, applying any projection
+in the query (u[0:1:3][0][0:20],v) to the DDS and DataDDS. Only
+datasets whose variables are all top level arrays of four or eight
+byte atomic types can be served, such as testdata3/fnoc1.nc. The
+port is chosen by the system and written to <portfile> once the
+server is listening. Requests are answered one at a time, each on a
+connection of its own; the server exits after a minute without any.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MAXVARS 64
+#define MAXDIMS 8
+#define MAXNAME 256
+#define MAXREQ 8192
+#define IDLETIME 60 /*seconds*/
+
+typedef struct Var {
+    char type[MAXNAME];
+    char name[MAXNAME];
+    int rank;
+    char dimnames[MAXDIMS][MAXNAME];
+    size_t dimsizes[MAXDIMS];
+    size_t size;        /* bytes per value */
+    const char* values; /* XDR encoded, within Dataset.dods */
+} Var;
+
+typedef struct Dataset {
+    char name[MAXNAME]; /* as in the DDS */
+    int nvars;
+    Var vars[MAXVARS];
+    char* dods;
+} Dataset;
+
+/* The part of a variable a projection asks for */
+typedef struct Slab {
+    Var* var;
+    size_t first[MAXDIMS];
+    size_t stride[MAXDIMS];
+    size_t count[MAXDIMS];
+} Slab;
+
+typedef struct Buffer {
+    char* data;
+    size_t len, alloc;
+} Buffer;
+
+static const char* datadir;
+
+static void
+append(Buffer* buf, const char* data, size_t len)
+{
+    if(buf->len + len > buf->alloc) {
+	buf->alloc = 2*(buf->len + len);
+	if((buf->data = (char*)realloc(buf->data,buf->alloc)) == NULL) {
+	    fprintf(stderr,"dapserve: out of memory\n");
+	    exit(1);
+	}
+    }
+    memcpy(buf->data+buf->len,data,len);
+    buf->len += len;
+}
+
+static void
+appendstr(Buffer* buf, const char* s)
+{
+    append(buf,s,strlen(s));
+}
+
+/* Read a whole file; return NULL if it cannot be read */
+static char*
+readfile(const char* name, const char* ext, size_t* lenp)
+{
+    char path[4096];
+    FILE* f;
+    Buffer buf = {NULL,0,0};
+    char chunk[8192];
+    size_t n;
+
+    snprintf(path,sizeof(path),"%s/%s.%s",datadir,name,ext);
+    if((f = fopen(path,"rb")) == NULL) return NULL;
+    while((n = fread(chunk,1,sizeof(chunk),f)) > 0)
+	append(&buf,chunk,n);
+    fclose(f);
+    append(&buf,"",1); /* nul terminate */
+    if(lenp) *lenp = buf.len-1;
+    return buf.data;
+}
+
+static size_t
+typesize(const char* type)
+{
+    if(strcmp(type,"Int16") == 0 || strcmp(type,"UInt16") == 0
+       || strcmp(type,"Int32") == 0 || strcmp(type,"UInt32") == 0
+       || strcmp(type,"Float32") == 0)
+	return 4;
+    if(strcmp(type,"Float64") == 0)
+	return 8;
+    return 0;
+}
+
+/* Parse the DDS and locate each variable's values in the DataDDS;
+   return 0 if the dataset cannot be served */
+static int
+loaddataset(const char* name, Dataset* ds)
+{
+    char* dds = readfile(name,"dds",NULL);
+    char *p, *line, *end;
+    size_t dodslen;
+    const char* data;
+    int i, d;
+
+    memset((void*)ds,0,sizeof(Dataset));
+    if(dds == NULL) return 0;
+    for(line=dds;*line;line=end) {
+	char* semi;
+	Var* var;
+	if((end = strchr(line,'\n')) == NULL) end = line+strlen(line);
+	else *end++ = '\0';
+	while(isspace((unsigned char)*line)) line++;
+	if(strncmp(line,"Dataset",7) == 0) continue;
+	if(*line == '}') {
+	    /* } NAME; */
+	    for(line++;isspace((unsigned char)*line);line++);
+	    if((semi = strchr(line,';')) != NULL) *semi = '\0';
+	    strncpy(ds->name,line,MAXNAME-1);
+	    continue;
+	}
+	if(*line == '\0') continue;
+	if(ds->nvars == MAXVARS) goto fail;
+	var = &ds->vars[ds->nvars++];
+	/* TYPE NAME[DIM = N]...; */
+	if(sscanf(line,"%255s %255[^[;]",var->type,var->name) != 2) goto fail;
+	if((var->size = typesize(var->type)) == 0) goto fail;
+	for(p=strchr(line,'[');p != NULL;p=strchr(p+1,'[')) {
+	    unsigned long n;
+	    if(var->rank == MAXDIMS) goto fail;
+	    if(sscanf(p,"[%255s = %lu]",var->dimnames[var->rank],&n) != 2) goto fail;
+	    var->dimsizes[var->rank++] = (size_t)n;
+	}
+	if(var->rank == 0) goto fail; /* scalars are not encoded as arrays */
+    }
+    free(dds);
+    dds = NULL;
+
+    if((ds->dods = readfile(name,"dods",&dodslen)) == NULL) goto fail;
+    if((p = strstr(ds->dods,"\nData:\n")) == NULL) goto fail;
+    data = p + strlen("\nData:\n");
+    for(i=0;i<ds->nvars;i++) {
+	Var* var = &ds->vars[i];
+	size_t n = 1;
+	for(d=0;d<var->rank;d++) n *= var->dimsizes[d];
+	data += 8; /* the count, twice */
+	var->values = data;
+	data += n*var->size;
+	if(data > ds->dods+dodslen) goto fail;
+    }
+    return 1;
+
+fail:
+    free(dds);
+    free(ds->dods);
+    ds->dods = NULL;
+    return 0;
+}
+
+/* Decode %XX escapes in place */
+static void
+unescape(char* s)
+{
+    char* q = s;
+    for(;*s;s++) {
+	unsigned int c;
+	if(*s == '%' && isxdigit((unsigned char)s[1]) && isxdigit((unsigned char)s[2])
+	   && sscanf(s+1,"%2x",&c) == 1) {
+	    *q++ = (char)c;
+	    s += 2;
+	} else
+	    *q++ = *s;
+    }
+    *q = '\0';
+}
+
+/* Parse the projections of query; an empty query asks for every var.
+   Return the number of slabs, or -1 if the query is not understood. */
+static int
+project(Dataset* ds, char* query, Slab* slabs)
+{
+    int nslabs = 0;
+    char* proj;
+    char* next;
+
+    if(query == NULL || *query == '\0') {
+	for(nslabs=0;nslabs<ds->nvars;nslabs++) {
+	    Slab* slab = &slabs[nslabs];
+	    int d;
+	    slab->var = &ds->vars[nslabs];
+	    for(d=0;d<slab->var->rank;d++) {
+		slab->first[d] = 0;
+		slab->stride[d] = 1;
+		slab->count[d] = slab->var->dimsizes[d];
+	    }
+	}
+	return nslabs;
+    }
+    for(proj=query;proj != NULL;proj=next) {
+	Slab* slab = &slabs[nslabs];
+	char* p;
+	int i, d;
+	if((next = strchr(proj,',')) != NULL) *next++ = '\0';
+	if(nslabs == MAXVARS) return -1;
+	if((p = strchr(proj,'[')) == NULL) p = proj+strlen(proj);
+	slab->var = NULL;
+	for(i=0;i<ds->nvars;i++) {
+	    if(strlen(ds->vars[i].name) == (size_t)(p-proj)
+	       && strncmp(ds->vars[i].name,proj,(size_t)(p-proj)) == 0)
+		slab->var = &ds->vars[i];
+	}
+	if(slab->var == NULL) return -1;
+	for(d=0;d<slab->var->rank;d++) {
+	    unsigned long a, b, c;
+	    size_t last;
+	    if(*p != '[') {
+		a = 0; b = 1; c = slab->var->dimsizes[d]-1;
+	    } else if(sscanf(p,"[%lu:%lu:%lu]",&a,&b,&c) == 3) {
+	    } else if(sscanf(p,"[%lu:%lu]",&a,&c) == 2) {
+		b = 1;
+	    } else if(sscanf(p,"[%lu]",&a) == 1) {
+		b = 1; c = a;
+	    } else
+		return -1;
+	    if(*p == '[' && (p = strchr(p,']')) != NULL) p++;
+	    if(p == NULL || b == 0 || a > c || c >= slab->var->dimsizes[d]) return -1;
+	    last = (size_t)c;
+	    slab->first[d] = (size_t)a;
+	    slab->stride[d] = (size_t)b;
+	    slab->count[d] = (last - (size_t)a)/(size_t)b + 1;
+	}
+	nslabs++;
+    }
+    return nslabs;
+}
+
+static void
+ddstext(Dataset* ds, Slab* slabs, int nslabs, Buffer* buf)
+{
+    char text[1024];
+    int i, d;
+    appendstr(buf,"Dataset {\n");
+    for(i=0;i<nslabs;i++) {
+	Var* var = slabs[i].var;
+	snprintf(text,sizeof(text),"    %s %s",var->type,var->name);
+	appendstr(buf,text);
+	for(d=0;d<var->rank;d++) {
+	    snprintf(text,sizeof(text),"[%s = %lu]",var->dimnames[d],
+		     (unsigned long)slabs[i].count[d]);
+	    appendstr(buf,text);
+	}
+	appendstr(buf,";\n");
+    }
+    snprintf(text,sizeof(text),"} %s;\n",ds->name);
+    appendstr(buf,text);
+}
+
+/* Append the XDR encoding of a slab: the count twice, then the values,
+   which are copied as they are encoded in the DataDDS file */
+static void
+slabdata(Slab* slab, Buffer* buf)
+{
+    Var* var = slab->var;
+    size_t n = 1, i, index[MAXDIMS];
+    unsigned char count[4];
+    int d;
+
+    for(d=0;d<var->rank;d++) {
+	n *= slab->count[d];
+	index[d] = 0;
+    }
+    for(d=0;d<4;d++) count[d] = (unsigned char)((n >> (8*(3-d))) & 0xff);
+    append(buf,(char*)count,4);
+    append(buf,(char*)count,4);
+    for(i=0;i<n;i++) {
+	size_t offset = 0;
+	for(d=0;d<var->rank;d++)
+	    offset = offset*var->dimsizes[d] + slab->first[d] + index[d]*slab->stride[d];
+	append(buf,var->values + offset*var->size,var->size);
+	/* odometer */
+	for(d=var->rank-1;d>=0;d--) {
+	    if(++index[d] < slab->count[d]) break;
+	    index[d] = 0;
+	}
+    }
+}
+
+static void
+respond(int fd, int code, const Buffer* body)
+{
+    char header[256];
+    size_t off;
+    snprintf(header,sizeof(header),
+	     "HTTP/1.0 %d %s\r\nContent-Type: text/plain\r\n"
+	     "Content-Length: %lu\r\nConnection: close\r\n\r\n",
+	     code,(code == 200 ? "OK" : "Not Found"),(unsigned long)body->len);
+    if(write(fd,header,strlen(header)) < 0) return;
+    for(off=0;off<body->len;) {
+	ssize_t n = write(fd,body->data+off,body->len-off);
+	if(n <= 0) return;
+	off += (size_t)n;
+    }
+}
+
+static void
+serve(int fd)
+{
+    char req[MAXREQ];
+    size_t len = 0;
+    char *path, *query, *ext;
+    Buffer body = {NULL,0,0};
+    int code = 404;
+
+    /* Read up to the end of the request header */
+    while(len < sizeof(req)-1) {
+	ssize_t n = read(fd,req+len,sizeof(req)-1-len);
+	if(n <= 0) break;
+	len += (size_t)n;
+	req[len] = '\0';
+	if(strstr(req,"\r\n\r\n") != NULL) break;
+    }
+    req[len] = '\0';
+    if(strncmp(req,"GET ",4) != 0) goto done;
+    path = req+4;
+    path[strcspn(path," \r\n")] = '\0';
+    if((query = strchr(path,'?')) != NULL) *query++ = '\0';
+    fprintf(stderr,"dapserve: %s%s%s\n",path,(query ? "?" : ""),(query ? query : ""));
+
+    if(strcmp(path,"/dts") == 0 || strcmp(path,"/dts/") == 0) {
+	appendstr(&body,"dts\n");
+	code = 200;
+    } else if(strncmp(path,"/dts/",5) == 0 && strstr(path,"..") == NULL
+	      && (ext = strrchr(path,'.')) != NULL) {
+	char* name = path+5;
+	*ext++ = '\0';
+	if(strcmp(ext,"das") == 0) {
+	    char* das = readfile(name,"das",&len);
+	    if(das != NULL) {
+		append(&body,das,len);
+		free(das);
+		code = 200;
+	    }
+	} else if(strcmp(ext,"dds") == 0 || strcmp(ext,"dods") == 0) {
+	    static Dataset ds;
+	    static Slab slabs[MAXVARS];
+	    int i, nslabs;
+	    if(query != NULL) unescape(query);
+	    if(loaddataset(name,&ds)
+	       && (nslabs = project(&ds,query,slabs)) >= 0) {
+		ddstext(&ds,slabs,nslabs,&body);
+		if(strcmp(ext,"dods") == 0) {
+		    appendstr(&body,"\nData:\n");
+		    for(i=0;i<nslabs;i++)
+			slabdata(&slabs[i],&body);
+		}
+		code = 200;
+	    }
+	    free(ds.dods);
+	}
+    }
+done:
+    respond(fd,code,&body);
+    free(body.data);
+}
+
+int
+main(int argc, char** argv)
+{
+    int sock, fd;
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    char tmpname[4096];
+    FILE* f;
+
+    if(argc != 3) {
+	fprintf(stderr,"usage: dapserve <datadir> <portfile>\n");
+	exit(1);
+    }
+    datadir = argv[1];
+    signal(SIGPIPE,SIG_IGN);
+
+    memset((void*)&addr,0,sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0; /* any free port */
+    if((sock = socket(AF_INET,SOCK_STREAM,0)) < 0
+       || bind(sock,(struct sockaddr*)&addr,sizeof(addr)) < 0
+       || listen(sock,16) < 0
+       || getsockname(sock,(struct sockaddr*)&addr,&addrlen) < 0) {
+	perror("dapserve");
+	exit(1);
+    }
+
+    /* Write the port where a reader never sees half of it */
+    snprintf(tmpname,sizeof(tmpname),"%s.tmp",argv[2]);
+    if((f = fopen(tmpname,"w")) == NULL) {perror(tmpname); exit(1);}
+    fprintf(f,"%d\n",ntohs(addr.sin_port));
+    fclose(f);
+    if(rename(tmpname,argv[2]) != 0) {perror(argv[2]); exit(1);}
+
+    for(;;) {
+	alarm(IDLETIME);
+	if((fd = accept(sock,NULL,NULL)) < 0) continue;
+	serve(fd);
+	close(fd);
+    }
+    return 0;
+}
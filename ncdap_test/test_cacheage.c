@@ -0,0 +1,181 @@
+/*! \file
+
+Copyright 2019 University Corporation for Atmospheric Research/Unidata.
+
+See \ref copyright file for more info.
+
+Check the use of cached slabs of u of fnoc1.nc, counting the requests
+in the [show=fetch] log: a slab that lies within a cached one, with a
+stride that is a multiple of the cached stride, is taken from the
+cache, and with [cacheage] a cached slab is fetched again once it is
+too old. The values are checked against the file:// copy.
+
+The server is the remote test server, or the one given as the first
+argument: tst_localdap.sh runs this against a local dapserve.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "netcdf.h"
+#include "nclog.h"
+#include "nctestserver.h"
+#include "t_srcdir.h"
+
+#define DTSTEST "/fnoc1.nc"
+#define LOGFILE "test_cacheage.log"
+
+#define NTIME 16
+#define NLAT 17
+#define NLON 21
+
+#define CACHEAGE 1 /*seconds*/
+
+#define ERRCODE 2
+#define ERR(e) {printf("Error: line %d: %s\n", __LINE__, nc_strerror(e)); exit(ERRCODE);}
+
+static short expected[NTIME*NLAT*NLON];
+static int ncid, varid;
+static int nerrs = 0;
+
+static void
+getexpected(void)
+{
+    int retval;
+    char url[4096];
+
+    snprintf(url,sizeof(url),"file://%s/ncdap_test/testdata3/fnoc1.nc",gettopsrcdir());
+    if((retval = nc_open(url,NC_NOWRITE,&ncid))) ERR(retval);
+    if((retval = nc_inq_varid(ncid,"u",&varid))) ERR(retval);
+    if((retval = nc_get_var_short(ncid,varid,expected))) ERR(retval);
+    if((retval = nc_close(ncid))) ERR(retval);
+}
+
+static void
+openurl(const char* url)
+{
+    int retval;
+    printf("test_cacheage: url=%s\n",url);
+    remove(LOGFILE);
+    if(!nclogopen(LOGFILE)) {fprintf(stderr,"cannot open %s\n",LOGFILE); exit(ERRCODE);}
+    ncsetlogging(1);
+    if((retval = nc_open(url,NC_NOWRITE,&ncid))) ERR(retval);
+    if((retval = nc_inq_varid(ncid,"u",&varid))) ERR(retval);
+}
+
+static void
+closeurl(void)
+{
+    int retval;
+    if((retval = nc_close(ncid))) ERR(retval);
+    ncsetlogging(0);
+    nclogclose();
+}
+
+/* Number of requests for u so far */
+static int
+countfetches(void)
+{
+    FILE* f;
+    char line[8192];
+    int fetches = 0;
+
+    fflush(NULL);
+    if((f = fopen(LOGFILE,"r")) == NULL) return 0;
+    while(fgets(line,sizeof(line),f) != NULL) {
+	if(strstr(line,":fetch: ") != NULL && strstr(line,"u[") != NULL)
+	    fetches++;
+    }
+    fclose(f);
+    return fetches;
+}
+
+/* Read a slab of u, compare it with the expected values, and check
+   the number of requests made so far */
+static void
+readslab(size_t t0, size_t nt, size_t st, size_t y0, size_t ny, size_t sy,
+	 size_t x0, size_t nx, size_t sx, int wantfetches)
+{
+    static short slab[NTIME*NLAT*NLON];
+    size_t start[3], count[3];
+    ptrdiff_t stride[3];
+    size_t i, j, k, n = 0;
+    int retval, fetches;
+
+    start[0] = t0; count[0] = nt; stride[0] = (ptrdiff_t)st;
+    start[1] = y0; count[1] = ny; stride[1] = (ptrdiff_t)sy;
+    start[2] = x0; count[2] = nx; stride[2] = (ptrdiff_t)sx;
+    if((retval = nc_get_vars_short(ncid,varid,start,count,stride,slab))) ERR(retval);
+    for(i=0;i<nt;i++)
+    for(j=0;j<ny;j++)
+    for(k=0;k<nx;k++,n++) {
+	size_t t = t0+i*st, y = y0+j*sy, x = x0+k*sx;
+	if(slab[n] != expected[(t*NLAT+y)*NLON+x]) {
+	    fprintf(stderr,"fail: u[%lu][%lu][%lu] = %d ; expected %d\n",
+		(unsigned long)t,(unsigned long)y,(unsigned long)x,
+		slab[n],expected[(t*NLAT+y)*NLON+x]);
+	    nerrs++;
+	    return;
+	}
+    }
+    fetches = countfetches();
+    if(fetches != wantfetches) {
+	fprintf(stderr,"fail: u[%lu:%lu:%lu][%lu:%lu:%lu][%lu:%lu:%lu]: %d requests ; expected %d\n",
+	    (unsigned long)t0,(unsigned long)st,(unsigned long)(t0+st*(nt-1)),
+	    (unsigned long)y0,(unsigned long)sy,(unsigned long)(y0+sy*(ny-1)),
+	    (unsigned long)x0,(unsigned long)sx,(unsigned long)(x0+sx*(nx-1)),
+	    fetches,wantfetches);
+	nerrs++;
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    char url[4096];
+    char* svc = NULL;
+
+    /* Logging and the expected values need the library's global state */
+    if(nc_initialize()) exit(ERRCODE);
+
+    /* Find Test Server, unless one is given */
+    if(argc > 1)
+	svc = strdup(argv[1]);
+    else
+	svc = nc_findtestserver("dts",0,REMOTETESTSERVERS);
+    if(svc == NULL) {
+	fprintf(stderr,"Cannot locate test server\n");
+	exit(0);
+    }
+    getexpected();
+
+    /* test 1: slabs within a cached slab */
+    snprintf(url,sizeof(url),"[show=fetch]%s%s",svc,DTSTEST);
+    openurl(url);
+    readslab(0,8,2, 0,NLAT,1, 0,NLON,1, 1); /* u[0:2:14] */
+    readslab(0,8,2, 0,NLAT,1, 0,NLON,1, 1); /* the same */
+    readslab(4,3,2, 0,NLAT,1, 0,NLON,1, 1); /* within */
+    readslab(2,4,4, 1,5,3, 2,4,5, 1);       /* within, strided */
+    readslab(6,1,1, 8,1,1, 9,1,1, 1);       /* one value */
+    readslab(1,1,1, 0,NLAT,1, 0,NLON,1, 2); /* between cached steps */
+    readslab(0,5,3, 0,NLAT,1, 0,NLON,1, 3); /* stride not a multiple */
+    closeurl();
+
+    /* test 2: a cached slab expires after cacheage seconds */
+    snprintf(url,sizeof(url),"[show=fetch][cacheage=%d]%s%s",CACHEAGE,svc,DTSTEST);
+    openurl(url);
+    readslab(0,4,1, 0,NLAT,1, 0,NLON,1, 1);
+    readslab(1,2,1, 0,NLAT,1, 0,NLON,1, 1);
+    sleep(CACHEAGE+2);
+    readslab(1,2,1, 0,NLAT,1, 0,NLON,1, 2);
+    closeurl();
+
+    free(svc);
+    remove(LOGFILE);
+    printf("*** %s\n",(nerrs ? "FAIL" : "PASS"));
+    return (nerrs ? 1 : 0);
+}
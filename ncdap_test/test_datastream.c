@@ -0,0 +1,206 @@
+/*! \file
+
+Copyright 2019 University Corporation for Atmospheric Research/Unidata.
+
+See \ref copyright file for more info.
+
+Check oc_stream_data against DATADDS files written here, each holding
+one array (file://, so no server is needed). The arrays are larger
+than the decoding window and than the pieces in which the file is
+fed through, so values are handed over in several calls and some
+values are split between two pieces.
+*/
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "netcdf.h"
+#include "oc.h"
+
+#define ERRCODE 2
+#define CHECK(e) {OCerror ocerr = (e); if(ocerr != OC_NOERR) {fprintf(stderr,"line %d: oc error %d\n",__LINE__,(int)ocerr); exit(ERRCODE);}}
+
+#define NF64 20001
+#define NI16 40000
+#define NBYTE 50001
+
+struct Expected {
+    OCtype etype;
+    size_t nelems;
+    size_t next;   /* next value expected */
+    size_t ncalls;
+    size_t stopafter; /* fail the transfer after this many calls; 0 => never */
+    int fail;
+};
+
+static double
+f64value(size_t i) {return (double)i * 0.5 - 1000.0;}
+
+static short
+i16value(size_t i) {return (short)((long)i - NI16/2);}
+
+static unsigned char
+bytevalue(size_t i) {return (unsigned char)(i * 7);}
+
+static void
+put32(FILE* f, unsigned int v)
+{
+    unsigned char b[4];
+    b[0] = (unsigned char)(v >> 24); b[1] = (unsigned char)(v >> 16);
+    b[2] = (unsigned char)(v >> 8); b[3] = (unsigned char)v;
+    fwrite(b,1,4,f);
+}
+
+/* Write the .das, .dds and .dods files of a dataset holding one array */
+static void
+writedataset(const char* name, const char* typename, OCtype etype, size_t n)
+{
+    char path[1024];
+    char dds[256];
+    FILE* f;
+    size_t i;
+
+    snprintf(dds,sizeof(dds),"Dataset {\n    %s data[n = %lu];\n} %s;\n",
+	typename,(unsigned long)n,name);
+    snprintf(path,sizeof(path),"%s.das",name);
+    if((f = fopen(path,"wb")) == NULL) exit(ERRCODE);
+    fputs("Attributes {\n}\n",f);
+    fclose(f);
+    snprintf(path,sizeof(path),"%s.dds",name);
+    if((f = fopen(path,"wb")) == NULL) exit(ERRCODE);
+    fputs(dds,f);
+    fclose(f);
+    snprintf(path,sizeof(path),"%s.dods",name);
+    if((f = fopen(path,"wb")) == NULL) exit(ERRCODE);
+    fputs(dds,f);
+    fputs("Data:\n",f);
+    put32(f,(unsigned int)n);
+    put32(f,(unsigned int)n);
+    for(i=0;i<n;i++) {
+	switch (etype) {
+	case OC_Float64: {
+	    double d = f64value(i);
+	    unsigned long long u;
+	    memcpy(&u,&d,sizeof(u));
+	    put32(f,(unsigned int)(u >> 32));
+	    put32(f,(unsigned int)u);
+	    } break;
+	case OC_Int16:
+	    put32(f,(unsigned int)(int)i16value(i));
+	    break;
+	case OC_Byte:
+	    fputc(bytevalue(i),f);
+	    break;
+	default: exit(ERRCODE);
+	}
+    }
+    /* arrays of bytes are packed and padded to a multiple of four */
+    if(etype == OC_Byte)
+	for(i=n;i%4;i++) fputc(0,f);
+    fclose(f);
+}
+
+static OCerror
+checkvalues(void* userdata, const void* values, size_t start, size_t count)
+{
+    struct Expected* ex = (struct Expected*)userdata;
+    size_t i;
+
+    ex->ncalls++;
+    if(start != ex->next || count == 0 || start + count > ex->nelems) {
+	fprintf(stderr,"fail: window [%lu,%lu)\n",(unsigned long)start,(unsigned long)(start+count));
+	ex->fail = 1;
+	return OC_EINVAL;
+    }
+    for(i=0;i<count;i++) {
+	size_t k = start+i;
+	int ok = 1;
+	switch (ex->etype) {
+	case OC_Float64: ok = (((const double*)values)[i] == f64value(k)); break;
+	case OC_Int16: ok = (((const short*)values)[i] == i16value(k)); break;
+	case OC_Byte: ok = (((const unsigned char*)values)[i] == bytevalue(k)); break;
+	default: ok = 0; break;
+	}
+	if(!ok) {
+	    fprintf(stderr,"fail: value %lu\n",(unsigned long)k);
+	    ex->fail = 1;
+	    return OC_EINVAL;
+	}
+    }
+    ex->next += count;
+    if(ex->stopafter > 0 && ex->ncalls == ex->stopafter)
+	return OC_EINVAL;
+    return OC_NOERR;
+}
+
+/* Stream a dataset written by writedataset; return the oc status */
+static OCerror
+streamdataset(const char* name, struct Expected* ex)
+{
+    OClink link;
+    OCerror ocstat;
+    char url[4096];
+    char cwd[4000];
+
+    if(getcwd(cwd,sizeof(cwd)) == NULL) exit(ERRCODE);
+    snprintf(url,sizeof(url),"file://%s/%s",cwd,name);
+    printf("test_datastream: url=%s\n",url);
+    CHECK(oc_open(url,&link));
+    ocstat = oc_stream_data(link,NULL,ex->etype,ex->nelems,checkvalues,ex);
+    oc_close(link);
+    return ocstat;
+}
+
+static void
+expect(struct Expected* ex, OCtype etype, size_t nelems)
+{
+    memset((void*)ex,0,sizeof(struct Expected));
+    ex->etype = etype;
+    ex->nelems = nelems;
+}
+
+int
+main()
+{
+    struct Expected ex;
+    OCerror ocstat;
+    int fail = 0;
+
+    /* oc_open() needs the library's global state */
+    if(nc_initialize()) exit(ERRCODE);
+    writedataset("datastream_f64","Float64",OC_Float64,NF64);
+    writedataset("datastream_i16","Int16",OC_Int16,NI16);
+    writedataset("datastream_byte","Byte",OC_Byte,NBYTE);
+
+    /* test 1: 8-byte values, over several windows */
+    expect(&ex,OC_Float64,NF64);
+    CHECK(streamdataset("datastream_f64",&ex));
+    if(ex.fail || ex.next != NF64 || ex.ncalls < 2) fail = 1;
+
+    /* test 2: 2-byte values, sent as 4 bytes each */
+    expect(&ex,OC_Int16,NI16);
+    CHECK(streamdataset("datastream_i16",&ex));
+    if(ex.fail || ex.next != NI16 || ex.ncalls < 2) fail = 1;
+
+    /* test 3: packed bytes, followed by padding */
+    expect(&ex,OC_Byte,NBYTE);
+    CHECK(streamdataset("datastream_byte",&ex));
+    if(ex.fail || ex.next != NBYTE) fail = 1;
+
+    /* test 4: the array is not the size asked for */
+    expect(&ex,OC_Float64,NF64-1);
+    ocstat = streamdataset("datastream_f64",&ex);
+    if(ocstat == OC_NOERR || ex.ncalls != 0) fail = 1;
+
+    /* test 5: the callback stops the transfer */
+    expect(&ex,OC_Float64,NF64);
+    ex.stopafter = 1;
+    ocstat = streamdataset("datastream_f64",&ex);
+    if(ocstat != OC_EINVAL || ex.ncalls != 1) fail = 1;
+
+    printf("*** %s\n",(fail ? "FAIL" : "PASS"));
+    return fail;
+}
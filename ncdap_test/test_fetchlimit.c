@@ -0,0 +1,179 @@
+/*! \file
+
+Copyright 2019 University Corporation for Atmospheric Research/Unidata.
+
+See \ref copyright file for more info.
+
+Check the [fetchlimit] client parameter: slabs of u of fnoc1.nc larger
+than the limit are streamed into memory rather than fetched into the
+cache, as the [show=fetch] log tells, and hold the same values as the
+file:// copy of the dataset, whether strided or converted.
+
+The server is the remote test server, or the one given as the first
+argument: tst_localdap.sh runs this against a local dapserve, and
+against the file:// copy itself. A file cannot be constrained, so it
+is read whole and nothing is streamed, whatever the limit.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "netcdf.h"
+#include "nclog.h"
+#include "nctestserver.h"
+#include "t_srcdir.h"
+
+#define DTSTEST "/fnoc1.nc"
+#define LOGFILE "test_fetchlimit.log"
+
+#define NTIME 16
+#define NLAT 17
+#define NLON 21
+
+#define ERRCODE 2
+#define ERR(e) {printf("Error: line %d: %s\n", __LINE__, nc_strerror(e)); exit(ERRCODE);}
+
+static short expected[NTIME*NLAT*NLON];
+
+typedef struct Counts {
+    int fetches; /* requests for u into the cache */
+    int streams; /* requests for u streamed into memory */
+} Counts;
+
+static void
+getexpected(void)
+{
+    int ncid, varid, retval;
+    char url[4096];
+
+    snprintf(url,sizeof(url),"file://%s/ncdap_test/testdata3/fnoc1.nc",gettopsrcdir());
+    if((retval = nc_open(url,NC_NOWRITE,&ncid))) ERR(retval);
+    if((retval = nc_inq_varid(ncid,"u",&varid))) ERR(retval);
+    if((retval = nc_get_var_short(ncid,varid,expected))) ERR(retval);
+    if((retval = nc_close(ncid))) ERR(retval);
+}
+
+static void
+countlog(Counts* counts)
+{
+    FILE* f;
+    char line[8192];
+
+    memset((void*)counts,0,sizeof(Counts));
+    if((f = fopen(LOGFILE,"r")) == NULL) return;
+    while(fgets(line,sizeof(line),f) != NULL) {
+	if(strstr(line,"u[") == NULL) continue;
+	if(strstr(line,":fetch: ") != NULL) counts->fetches++;
+	else if(strstr(line,":stream: ") != NULL) counts->streams++;
+    }
+    fclose(f);
+}
+
+/* Compare a (strided) slab of u with the expected values */
+static int
+checkslab(const char* what, const float* slab, const size_t* start,
+	  const size_t* count, const ptrdiff_t* stride)
+{
+    size_t i, j, k, n = 0;
+    for(i=0;i<count[0];i++)
+    for(j=0;j<count[1];j++)
+    for(k=0;k<count[2];k++,n++) {
+	size_t t = start[0]+i*(size_t)stride[0];
+	size_t y = start[1]+j*(size_t)stride[1];
+	size_t x = start[2]+k*(size_t)stride[2];
+	short want = expected[(t*NLAT+y)*NLON+x];
+	if(slab[n] != (float)want) {
+	    fprintf(stderr,"fail: %s: u[%lu][%lu][%lu] = %g ; expected %d\n",
+		what,(unsigned long)t,(unsigned long)y,(unsigned long)x,slab[n],want);
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/* Read some slabs of u through url; return # of errors */
+static int
+readslabs(const char* url, Counts* counts)
+{
+    int ncid, varid, retval;
+    int nerrs = 0;
+    size_t i;
+    static short sslab[NTIME*NLAT*NLON];
+    static float fslab[NTIME*NLAT*NLON];
+    size_t start[3] = {2,0,0};
+    size_t count[3] = {4,NLAT,NLON};
+    ptrdiff_t stride[3] = {1,1,1};
+    size_t vstart[3] = {1,0,1};
+    size_t vcount[3] = {5,NLAT,10};
+    ptrdiff_t vstride[3] = {3,1,2};
+
+    printf("test_fetchlimit: url=%s\n",url);
+    remove(LOGFILE);
+    if(!nclogopen(LOGFILE)) {fprintf(stderr,"cannot open %s\n",LOGFILE); exit(ERRCODE);}
+    ncsetlogging(1);
+    if((retval = nc_open(url,NC_NOWRITE,&ncid))) ERR(retval);
+    if((retval = nc_inq_varid(ncid,"u",&varid))) ERR(retval);
+
+    /* a slab in the type of the variable */
+    if((retval = nc_get_vara_short(ncid,varid,start,count,sslab))) ERR(retval);
+    for(i=0;i<count[0]*NLAT*NLON;i++) fslab[i] = sslab[i];
+    nerrs += checkslab("short",fslab,start,count,stride);
+    /* the same slab, converted */
+    memset((void*)fslab,0,sizeof(fslab));
+    if((retval = nc_get_vara_float(ncid,varid,start,count,fslab))) ERR(retval);
+    nerrs += checkslab("float",fslab,start,count,stride);
+    /* a strided slab */
+    memset((void*)fslab,0,sizeof(fslab));
+    if((retval = nc_get_vars_float(ncid,varid,vstart,vcount,vstride,fslab))) ERR(retval);
+    nerrs += checkslab("strided",fslab,vstart,vcount,vstride);
+
+    if((retval = nc_close(ncid))) ERR(retval);
+    ncsetlogging(0);
+    nclogclose();
+    countlog(counts);
+    printf("fetches=%d streams=%d\n",counts->fetches,counts->streams);
+    return nerrs;
+}
+
+int
+main(int argc, char** argv)
+{
+    char url[4096];
+    char* svc = NULL;
+    Counts counts;
+    int fail = 0;
+    int isfile;
+
+    /* Logging and the expected values need the library's global state */
+    if(nc_initialize()) exit(ERRCODE);
+
+    /* Find Test Server, unless one is given */
+    if(argc > 1)
+	svc = strdup(argv[1]);
+    else
+	svc = nc_findtestserver("dts",0,REMOTETESTSERVERS);
+    if(svc == NULL) {
+	fprintf(stderr,"Cannot locate test server\n");
+	exit(0);
+    }
+    isfile = (strncmp(svc,"file:",5) == 0);
+    getexpected();
+
+    /* test 1: under the default limit (10 megabytes) the slabs go
+       through the cache */
+    snprintf(url,sizeof(url),"[show=fetch]%s%s",svc,DTSTEST);
+    if(readslabs(url,&counts)) fail = 1;
+    if(counts.streams != 0 || (!isfile && counts.fetches == 0)) fail = 1;
+
+    /* test 2: every slab is larger than 1000 bytes, so each one is
+       streamed and none is cached */
+    snprintf(url,sizeof(url),"[show=fetch][fetchlimit=1000]%s%s",svc,DTSTEST);
+    if(readslabs(url,&counts)) fail = 1;
+    if(counts.streams != (isfile ? 0 : 3) || counts.fetches != 0) fail = 1;
+
+    free(svc);
+    remove(LOGFILE);
+    printf("*** %s\n",(fail ? "FAIL" : "PASS"));
+    return fail;
+}
@@ -0,0 +1,166 @@
+/*! \file
+
+Copyright 2019 University Corporation for Atmospheric Research/Unidata.
+
+See \ref copyright file for more info.
+
+Check the [aggregate] and [readahead] client parameters: read the
+time steps of u and v of fnoc1.nc one after the other, as a model
+loop would, and count the requests in the [show=fetch] log. Without
+the parameters every slab is its own request; with them the slabs of
+u and v go together and the next step is read in the background. The
+values are checked against the file:// copy of the dataset.
+
+The server is the remote test server, or the one given as the first
+argument: tst_localdap.sh runs this against a local dapserve.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "netcdf.h"
+#include "nclog.h"
+#include "ncthreads.h"
+#include "nctestserver.h"
+#include "t_srcdir.h"
+
+#define DTSTEST "/fnoc1.nc"
+#define LOGFILE "test_readahead.log"
+
+#define NTIME 16
+#define NLAT 17
+#define NLON 21
+#define NSTEPS 4
+#define NVARS 2
+
+#define ERRCODE 2
+#define ERR(e) {printf("Error: line %d: %s\n", __LINE__, nc_strerror(e)); exit(ERRCODE);}
+
+static const char* varnames[NVARS] = {"u","v"};
+static short expected[NVARS][NTIME*NLAT*NLON];
+
+typedef struct Counts {
+    int fetches;    /* requests for a slab of u or v */
+    int together;   /* of which for both u and v */
+    int readaheads; /* background requests started */
+} Counts;
+
+static void
+getexpected(void)
+{
+    int ncid, varid, i, retval;
+    char url[4096];
+
+    snprintf(url,sizeof(url),"file://%s/ncdap_test/testdata3/fnoc1.nc",gettopsrcdir());
+    if((retval = nc_open(url,NC_NOWRITE,&ncid))) ERR(retval);
+    for(i=0;i<NVARS;i++) {
+	if((retval = nc_inq_varid(ncid,varnames[i],&varid))) ERR(retval);
+	if((retval = nc_get_var_short(ncid,varid,expected[i]))) ERR(retval);
+    }
+    if((retval = nc_close(ncid))) ERR(retval);
+}
+
+static void
+countlog(Counts* counts)
+{
+    FILE* f;
+    char line[8192];
+
+    memset((void*)counts,0,sizeof(Counts));
+    if((f = fopen(LOGFILE,"r")) == NULL) return;
+    while(fgets(line,sizeof(line),f) != NULL) {
+	if(strstr(line,":fetch: ") != NULL) {
+	    int hasu = (strstr(line,"u[") != NULL);
+	    int hasv = (strstr(line,"v[") != NULL);
+	    if(hasu || hasv) counts->fetches++;
+	    if(hasu && hasv) counts->together++;
+	} else if(strstr(line,":readahead: ") != NULL)
+	    counts->readaheads++;
+    }
+    fclose(f);
+}
+
+/* Read NSTEPS time steps of u and v through url; return # of errors */
+static int
+readsteps(const char* url, Counts* counts)
+{
+    int ncid, varids[NVARS], i, j, retval;
+    int nerrs = 0;
+    size_t start[3] = {0,0,0};
+    size_t count[3] = {1,NLAT,NLON};
+    short slab[NLAT*NLON];
+
+    printf("test_readahead: url=%s\n",url);
+    remove(LOGFILE);
+    if(!nclogopen(LOGFILE)) {fprintf(stderr,"cannot open %s\n",LOGFILE); exit(ERRCODE);}
+    ncsetlogging(1);
+    if((retval = nc_open(url,NC_NOWRITE,&ncid))) ERR(retval);
+    for(i=0;i<NVARS;i++)
+	if((retval = nc_inq_varid(ncid,varnames[i],&varids[i]))) ERR(retval);
+    for(start[0]=0;start[0]<NSTEPS;start[0]++) {
+	for(i=0;i<NVARS;i++) {
+	    const short* want = expected[i] + start[0]*NLAT*NLON;
+	    if((retval = nc_get_vara_short(ncid,varids[i],start,count,slab))) ERR(retval);
+	    for(j=0;j<NLAT*NLON;j++) {
+		if(slab[j] != want[j]) {
+		    fprintf(stderr,"fail: %s[%lu] element %d = %d ; expected %d\n",
+			varnames[i],(unsigned long)start[0],j,slab[j],want[j]);
+		    nerrs++;
+		    break;
+		}
+	    }
+	}
+    }
+    if((retval = nc_close(ncid))) ERR(retval);
+    ncsetlogging(0);
+    nclogclose();
+    countlog(counts);
+    printf("fetches=%d together=%d readaheads=%d\n",
+	counts->fetches,counts->together,counts->readaheads);
+    return nerrs;
+}
+
+int
+main(int argc, char** argv)
+{
+    char url[4096];
+    char* svc = NULL;
+    Counts counts;
+    int fail = 0;
+
+    /* Logging and the expected values need the library's global state */
+    if(nc_initialize()) exit(ERRCODE);
+
+    /* Find Test Server, unless one is given, as by tst_localdap.sh */
+    if(argc > 1)
+	svc = strdup(argv[1]);
+    else
+	svc = nc_findtestserver("dts",0,REMOTETESTSERVERS);
+    if(svc == NULL) {
+	fprintf(stderr,"Cannot locate test server\n");
+	exit(0);
+    }
+    getexpected();
+
+    /* test 1: by default each slab is fetched alone, when it is read */
+    snprintf(url,sizeof(url),"[show=fetch]%s%s",svc,DTSTEST);
+    if(readsteps(url,&counts)) fail = 1;
+    if(counts.fetches != NVARS*NSTEPS || counts.together != 0
+       || counts.readaheads != 0)
+	fail = 1;
+
+    /* test 2: after the first step, one request per step brings both
+       u and v, and the next step is read ahead when threads exist */
+    snprintf(url,sizeof(url),"[show=fetch][aggregate][readahead]%s%s",svc,DTSTEST);
+    if(readsteps(url,&counts)) fail = 1;
+    if(counts.fetches != NVARS+(NSTEPS-1) || counts.together != NSTEPS-1)
+	fail = 1;
+    if(NC_threads_available() ? counts.readaheads == 0 : counts.readaheads != 0)
+	fail = 1;
+
+    free(svc);
+    remove(LOGFILE);
+    printf("*** %s\n",(fail ? "FAIL" : "PASS"));
+    return fail;
+}
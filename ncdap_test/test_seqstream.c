@@ -0,0 +1,141 @@
+/*! \file
+
+Copyright 2019 University Corporation for Atmospheric Research/Unidata.
+
+See \ref copyright file for more info.
+
+Check oc_stream_records against the records of a compiled DATADDS,
+using the two sequences of test.07 (file://, so no server is needed).
+*/
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "netcdf.h"
+#include "oc.h"
+#include "t_srcdir.h"
+
+/* test.07 is Dataset {Sequence {String name; Int32 age;} person;
+                       Sequence {Byte b; Int32 i32; ... String s; Url u;} types;} */
+#define NRECORDS 5
+#define BATCH 2
+
+#define ERRCODE 2
+#define CHECK(e) {OCerror ocerr = (e); if(ocerr != OC_NOERR) {fprintf(stderr,"line %d: oc error %d\n",__LINE__,(int)ocerr); exit(ERRCODE);}}
+
+struct Expected {
+    OClink link;
+    size_t nfield; /* the Int32 field to compare */
+    int values[NRECORDS];
+    size_t next;   /* next record expected */
+    size_t ncalls;
+    size_t batch;
+    int fail;
+};
+
+static OCerror
+checkrecords(void* userdata, OCdatanode* records, size_t start, size_t count)
+{
+    struct Expected* ex = (struct Expected*)userdata;
+    size_t i;
+
+    ex->ncalls++;
+    if(start != ex->next || count == 0 || count > ex->batch
+       || start + count > NRECORDS) {
+	fprintf(stderr,"fail: batch [%lu,%lu)\n",(unsigned long)start,(unsigned long)(start+count));
+	ex->fail = 1;
+	return OC_EINVAL;
+    }
+    for(i=0;i<count;i++) {
+	OCdatanode field;
+	int value;
+	CHECK(oc_data_ithfield(ex->link,records[i],ex->nfield,&field));
+	CHECK(oc_data_readscalar(ex->link,field,sizeof(value),&value));
+	if(value != ex->values[start+i]) {
+	    fprintf(stderr,"fail: record %lu = %d ; expected %d\n",
+		(unsigned long)(start+i),value,ex->values[start+i]);
+	    ex->fail = 1;
+	}
+    }
+    ex->next += count;
+    return OC_NOERR;
+}
+
+static OCerror
+stopearly(void* userdata, OCdatanode* records, size_t start, size_t count)
+{
+    (void)records; (void)start; (void)count;
+    (*(size_t*)userdata)++;
+    return OC_EINVAL;
+}
+
+/* Read field nfield of each record of sequence nseq the usual way */
+static void
+getexpected(OClink link, OCddsnode root, size_t nseq, size_t nfield, struct Expected* ex)
+{
+    OCdatanode data, seq;
+    size_t i, nrecords;
+
+    memset((void*)ex,0,sizeof(struct Expected));
+    ex->link = link;
+    ex->nfield = nfield;
+    CHECK(oc_data_getroot(link,root,&data));
+    CHECK(oc_data_ithfield(link,data,nseq,&seq));
+    CHECK(oc_data_recordcount(link,seq,&nrecords));
+    if(nrecords != NRECORDS) {fprintf(stderr,"fail: %lu records\n",(unsigned long)nrecords); exit(ERRCODE);}
+    for(i=0;i<nrecords;i++) {
+	OCdatanode record, field;
+	CHECK(oc_data_ithrecord(link,seq,i,&record));
+	CHECK(oc_data_ithfield(link,record,nfield,&field));
+	CHECK(oc_data_readscalar(link,field,sizeof(int),&ex->values[i]));
+    }
+}
+
+int
+main()
+{
+    OClink link;
+    OCddsnode root;
+    OCerror ocstat;
+    const char* topsrcdir;
+    char url[4096];
+    struct Expected ex;
+    size_t ncalls;
+    int fail = 0;
+
+    /* oc_open() needs the library's global state */
+    if(nc_initialize()) exit(ERRCODE);
+    topsrcdir = gettopsrcdir();
+    snprintf(url,sizeof(url),"file://%s/ncdap_test/testdata3/test.07",topsrcdir);
+    printf("test_seqstream: url=%s\n",url);
+
+    CHECK(oc_open(url,&link));
+    CHECK(oc_fetch(link,NULL,OCDATADDS,0,&root));
+
+    /* test 1: the second sequence, in batches, skipping the first */
+    getexpected(link,root,1,1,&ex); /* types.i32 */
+    ex.batch = BATCH;
+    CHECK(oc_stream_records(link,NULL,"types",BATCH,checkrecords,&ex));
+    if(ex.fail || ex.next != NRECORDS || ex.ncalls != (NRECORDS+BATCH-1)/BATCH) fail = 1;
+
+    /* test 2: the first sequence by default, in one batch */
+    getexpected(link,root,0,1,&ex); /* person.age */
+    ex.batch = NRECORDS;
+    CHECK(oc_stream_records(link,NULL,NULL,0,checkrecords,&ex));
+    if(ex.fail || ex.next != NRECORDS || ex.ncalls != 1) fail = 1;
+
+    /* test 3: no such sequence */
+    ocstat = oc_stream_records(link,NULL,"nosuchsequence",0,checkrecords,&ex);
+    if(ocstat != OC_EDATADDS) fail = 1;
+
+    /* test 4: the callback stops the transfer */
+    ncalls = 0;
+    ocstat = oc_stream_records(link,NULL,"types",1,stopearly,&ncalls);
+    if(ocstat != OC_EINVAL || ncalls != 1) fail = 1;
+
+    oc_root_free(link,root);
+    oc_close(link);
+
+    printf("*** %s\n",(fail ? "FAIL" : "PASS"));
+    return fail;
+}
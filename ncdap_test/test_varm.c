@@ -0,0 +1,215 @@
+/*! \file
+
+Copyright 2019 University Corporation for Atmospheric Research/Unidata.
+
+See \ref copyright file for more info.
+
+Check nc_get_varm against nc_get_vara on a DAP2 variable: the DAP2
+dispatcher reads the strided slab once and applies the map locally.
+
+Given a server as the first argument, as by tst_localdap.sh, also
+check in the [show=fetch] log that a strided, mapped read of u of
+fnoc1.nc from it is one request, with the stride in its constraint.
+*/
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "netcdf.h"
+#include "nclog.h"
+#include "t_srcdir.h"
+
+/* Use the ThreeD variable of test.06; it is double ThreeD(x, y, z) */
+#define VAR "ThreeD"
+
+#define X 10
+#define Y 10
+#define Z 10
+
+#define RANK 3
+
+#define ERRCODE 2
+#define ERR(e) {printf("Error: %s\n", nc_strerror(e)); exit(ERRCODE);}
+
+static float threeD[X][Y][Z];
+static float result[X*Y*Z];
+
+/* For the server check: u of fnoc1.nc is short u(time_a,lat,lon) */
+#define NTIME 16
+#define NLAT 17
+#define NLON 21
+#define LOGFILE "test_varm.log"
+#define UCONSTRAINT "u[1:2:8][2:3:16][3:2:14]"
+
+static short u[NTIME][NLAT][NLON];
+static short uresult[NTIME*NLAT*NLON];
+
+/* Read start/count/stride transposed (z,y,x order in memory) and
+   compare each value with the whole variable */
+static int
+checktranspose(int ncid, int varid, size_t* start, size_t* count, ptrdiff_t* stride)
+{
+    int retval;
+    size_t i,j,k;
+    ptrdiff_t imap[RANK];
+
+    imap[0] = 1;
+    imap[1] = (ptrdiff_t)count[0];
+    imap[2] = (ptrdiff_t)(count[0]*count[1]);
+    memset(result,0,sizeof(result));
+    if((retval = nc_get_varm_float(ncid,varid,start,count,stride,imap,result)))
+       ERR(retval);
+    for(i=0;i<count[0];i++)
+    for(j=0;j<count[1];j++)
+    for(k=0;k<count[2];k++) {
+	float expected = threeD[start[0]+i*(size_t)stride[0]]
+			       [start[1]+j*(size_t)stride[1]]
+			       [start[2]+k*(size_t)stride[2]];
+	float got = result[i*(size_t)imap[0]+j*(size_t)imap[1]+k*(size_t)imap[2]];
+	if(got != expected) {
+	    fprintf(stderr,"fail: [%lu][%lu][%lu] = %f ; expected %f\n",
+		(unsigned long)i,(unsigned long)j,(unsigned long)k,got,expected);
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+/* Read a strided slab of u from svc transposed, compare it with the
+   file:// copy, and count the requests; return 1 if all is well */
+static int
+checkserver(const char* svc)
+{
+    int ncid, varid;
+    int retval;
+    char url[4096];
+    char line[8192];
+    FILE* f;
+    int fetches = 0, pushed = 0;
+    size_t start[RANK] = {1,2,3};
+    size_t count[RANK] = {4,5,6};
+    ptrdiff_t stride[RANK] = {2,3,2};
+    ptrdiff_t imap[RANK];
+    size_t i,j,k;
+
+    snprintf(url,sizeof(url),"file://%s/ncdap_test/testdata3/fnoc1.nc",gettopsrcdir());
+    if((retval = nc_open(url,NC_NOWRITE,&ncid))) ERR(retval);
+    if((retval = nc_inq_varid(ncid,"u",&varid))) ERR(retval);
+    if((retval = nc_get_var_short(ncid,varid,(short*)u))) ERR(retval);
+    if((retval = nc_close(ncid))) ERR(retval);
+
+    snprintf(url,sizeof(url),"[show=fetch]%s/fnoc1.nc",svc);
+    printf("test_varm: url=%s\n",url);
+    remove(LOGFILE);
+    if(!nclogopen(LOGFILE)) {fprintf(stderr,"cannot open %s\n",LOGFILE); exit(ERRCODE);}
+    ncsetlogging(1);
+    if((retval = nc_open(url,NC_NOWRITE,&ncid))) ERR(retval);
+    if((retval = nc_inq_varid(ncid,"u",&varid))) ERR(retval);
+    imap[0] = 1;
+    imap[1] = (ptrdiff_t)count[0];
+    imap[2] = (ptrdiff_t)(count[0]*count[1]);
+    if((retval = nc_get_varm_short(ncid,varid,start,count,stride,imap,uresult)))
+       ERR(retval);
+    if((retval = nc_close(ncid))) ERR(retval);
+    ncsetlogging(0);
+    nclogclose();
+
+    for(i=0;i<count[0];i++)
+    for(j=0;j<count[1];j++)
+    for(k=0;k<count[2];k++) {
+	short expected = u[start[0]+i*(size_t)stride[0]]
+			  [start[1]+j*(size_t)stride[1]]
+			  [start[2]+k*(size_t)stride[2]];
+	short got = uresult[i*(size_t)imap[0]+j*(size_t)imap[1]+k*(size_t)imap[2]];
+	if(got != expected) {
+	    fprintf(stderr,"fail: u: [%lu][%lu][%lu] = %d ; expected %d\n",
+		(unsigned long)i,(unsigned long)j,(unsigned long)k,got,expected);
+	    return 0;
+	}
+    }
+
+    if((f = fopen(LOGFILE,"r")) == NULL) return 0;
+    while(fgets(line,sizeof(line),f) != NULL) {
+	if(strstr(line,":fetch: ") == NULL || strstr(line,"u[") == NULL) continue;
+	fetches++;
+	if(strstr(line,UCONSTRAINT) != NULL) pushed++;
+    }
+    fclose(f);
+    remove(LOGFILE);
+    printf("fetches=%d with %s=%d\n",fetches,UCONSTRAINT,pushed);
+    return (fetches == 1 && pushed == 1);
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid;
+    int retval;
+    const char* topsrcdir;
+    char url[4096];
+    size_t start0[RANK] = {0,0,0};
+    size_t count0[RANK] = {X,Y,Z};
+    ptrdiff_t stride1[RANK] = {1,1,1};
+    size_t start[RANK] = {1,0,2};
+    size_t count[RANK] = {4,5,3};
+    ptrdiff_t stride[RANK] = {2,2,3};
+
+    topsrcdir = gettopsrcdir();
+
+    strncpy(url,"file://",sizeof(url));
+    strlcat(url,topsrcdir,sizeof(url));
+    strlcat(url,"/ncdap_test/testdata3/test.06",sizeof(url));
+
+    printf("test_varm: url=%s\n",url);
+
+    if((retval = nc_open(url, NC_NOWRITE, &ncid)))
+       ERR(retval);
+    if((retval = nc_inq_varid(ncid, VAR, &varid)))
+       ERR(retval);
+
+    /* The reference: the whole variable */
+    if((retval = nc_get_vara_float(ncid,varid,start0,count0,(float*)threeD)))
+       ERR(retval);
+
+    /* test 1: whole variable, transposed */
+    if(!checktranspose(ncid,varid,start0,count0,stride1)) goto fail;
+
+    /* test 2: a strided subset, transposed */
+    if(!checktranspose(ncid,varid,start,count,stride)) goto fail;
+
+    /* test 3: the default map is the same as get_vars */
+    memset(result,0,sizeof(result));
+    if((retval = nc_get_varm_float(ncid,varid,start,count,stride,NULL,result)))
+       ERR(retval);
+    {
+	size_t i,j,k,n = 0;
+	for(i=0;i<count[0];i++)
+	for(j=0;j<count[1];j++)
+	for(k=0;k<count[2];k++,n++) {
+	    if(result[n] != threeD[start[0]+i*(size_t)stride[0]]
+				  [start[1]+j*(size_t)stride[1]]
+				  [start[2]+k*(size_t)stride[2]]) goto fail;
+	}
+    }
+
+    /* test 4: a bad stride is still caught */
+    stride[0] = 0;
+    if(nc_get_varm_float(ncid,varid,start,count,stride,NULL,result) != NC_ESTRIDE)
+	goto fail;
+
+    if((retval = nc_close(ncid)))
+       ERR(retval);
+
+    /* test 5: against a server, one request with the stride */
+    if(argc > 1) {
+	/* Logging needs the library's global state */
+	if((retval = nc_initialize())) ERR(retval);
+	if(!checkserver(argv[1])) goto fail;
+    }
+
+    printf("*** PASS\n");
+    return 0;
+fail:
+    printf("*** FAIL\n");
+    return 1;
+}
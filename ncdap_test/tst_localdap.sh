@@ -0,0 +1,39 @@
+#!/bin/sh
+
+if test "x$SETX" = x1 ; then set -x ; fi
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+set -e
+
+# Run the tests of constrained DAP2 requests against a local server
+# for testdata3, so that they need not wait for the remote one.
+
+echo "*** Starting dapserve"
+rm -f dapserve.port
+${execdir}/dapserve ${srcdir}/testdata3 dapserve.port 2> dapserve.log &
+SERVER=$!
+trap "kill $SERVER 2> /dev/null || true" 0
+i=0
+while test ! -s dapserve.port ; do
+  i=`expr $i + 1`
+  if test $i -gt 10 ; then echo "*** FAIL: dapserve did not start"; exit 1; fi
+  sleep 1
+done
+SVC="http://127.0.0.1:`cat dapserve.port`/dts"
+
+echo "*** Testing a strided, mapped read against ${SVC}"
+${execdir}/test_varm "${SVC}"
+
+echo "*** Testing [aggregate] and [readahead] against ${SVC}"
+${execdir}/test_readahead "${SVC}"
+
+echo "*** Testing [fetchlimit] against ${SVC}"
+${execdir}/test_fetchlimit "${SVC}"
+echo "*** Testing [fetchlimit] against the file:// copy"
+${execdir}/test_fetchlimit "file://${top_srcdir}/ncdap_test/testdata3"
+
+echo "*** Testing cached slabs and [cacheage] against ${SVC}"
+${execdir}/test_cacheage "${SVC}"
+
+rm -f dapserve.port dapserve.log
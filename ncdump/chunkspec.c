@@ -8,6 +8,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "netcdf.h"
+#include "netcdf_chunk.h"
 #include "list.h"
 #include "utils.h"
 #include "chunkspec.h"
@@ -30,6 +31,20 @@ struct VarChunkSpec {
 
 static List* varchunkspecs = NULL;      /* List<VarChunkSpec> */
 
+/* Access intent named on the command line, if any */
+static int chunkintent = NC_CHUNK_INTENT_DEFAULT;
+
+/* Map access intent keywords to intents */
+static struct ChunkIntentName {
+    const char* name;
+    int intent;
+} chunkintentnames[] = {
+{"balanced", NC_CHUNK_INTENT_BALANCED},
+{"spatial", NC_CHUNK_INTENT_SPATIAL},
+{"timeseries", NC_CHUNK_INTENT_TIMESERIES},
+{NULL, NC_CHUNK_INTENT_DEFAULT}
+};
+
 /* Forward */
 static int dimchunkspec_parse(int ncid, const char *spec);
 static int varchunkspec_parse(int ncid, const char *spec);
@@ -41,6 +56,7 @@ chunkspecinit(void)
     if(varchunkspecs == NULL)
 	varchunkspecs = listnew();
     memset(&dimchunkspecs,0,sizeof(dimchunkspecs));
+    chunkintent = NC_CHUNK_INTENT_DEFAULT;
 }
 
 /*
@@ -51,8 +67,16 @@ int
 chunkspec_parse(int igrp, const char *spec)
 {
     /* Decide if this is a per-variable or per-dimension chunkspec */
+    struct ChunkIntentName* p;
     if (!spec || *spec == '\0')
 	return NC_NOERR; /* Use defaults */
+    /* A bare access intent keyword selects optimized chunk shapes */
+    for(p=chunkintentnames;p->name != NULL;p++) {
+	if(strcmp(spec,p->name) == 0) {
+	    chunkintent = p->intent;
+	    return NC_NOERR;
+	}
+    }
     if(strchr(spec,':') == NULL)
 	return dimchunkspec_parse(igrp,spec);
     else
@@ -307,6 +331,14 @@ done:
 
 /* Accessors */
 
+/* Return the access intent specified on the command line, or
+ * NC_CHUNK_INTENT_DEFAULT if none. */
+int
+chunkspec_intent(void)
+{
+    return chunkintent;
+}
+
 bool_t
 varchunkspec_exists(int igrpid, int ivarid)
 {
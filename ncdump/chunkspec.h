@@ -36,6 +36,10 @@ extern size_t varchunkspec_ndims(int grpid, int varid);
 
 extern bool_t varchunkspec_exists(int grpid, int varid);
 
+/* Return the access intent ("balanced", "spatial", "timeseries")
+ * specified in a chunkspec string, NC_CHUNK_INTENT_DEFAULT if none. */
+extern int chunkspec_intent(void);
+
 extern void chunkspecinit(void);
 
 
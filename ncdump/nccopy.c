@@ -16,14 +16,20 @@
 #include <unistd.h>
 #endif
 #include <string.h>
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#include <time.h>
 #include "netcdf.h"
 #include "netcdf_filter.h"
+#include "netcdf_chunk.h"
 #include "nciter.h"
 #include "utils.h"
 #include "chunkspec.h"
 #include "dimmap.h"
 #include "nccomps.h"
 #include "list.h"
+#include "ncthreads.h"
 
 #undef DEBUGFILTER
 
@@ -38,7 +44,9 @@ int optind;
  * values during copy */
 #define COPY_BUFFER_SIZE (5000000)
 #define COPY_CHUNKCACHE_PREEMPTION (1.0f) /* for copying, can eject fully read chunks */
+#define STAGING_MAX_CHUNKS (64)	/* most temporary chunks in a -R slab */
 #define SAME_AS_INPUT (-1)	/* default, if kind not specified */
+#define STAGING_SUFFIX ".rechunk.tmp" /* appended to output name for -R temporary file */
 #define CHUNK_THRESHOLD (8192)	/* non-record variables with fewer bytes don't get chunked */
 
 #ifndef USE_NETCDF4
@@ -62,14 +70,20 @@ typedef struct VarID {
 #define MAX_FILTER_SPECS 64
 #define MAX_FILTER_PARAMS 256
 
-struct FilterSpec {
-    char* fqn;
-    int nofilter; /* 1=> do not apply any filters to this variable */
+/* One filter of a chain */
+struct Filter {
     unsigned int filterid;
     size_t nparams;
     unsigned int* params;
 };
 
+struct FilterSpec {
+    char* fqn;
+    int nofilter; /* 1=> do not apply any filters to this variable */
+    size_t nfilters;
+    struct Filter* filters; /* in the order they are applied on write */
+};
+
 static List* filterspecs = NULL;
 static int suppressfilters = 0; /* 1 => do not apply any output filters unless specified */
 
@@ -125,6 +139,7 @@ char *progname;	       /* for error messages */
 static int option_kind = SAME_AS_INPUT;
 static int option_deflate_level = -1;	/* default, compress output only if input compressed */
 static int option_shuffle_vars = NC_NOSHUFFLE; /* default, no shuffling on compression */
+static int option_quantize_nsd = -1; /* default, quantize output only if input quantized */
 static int option_fix_unlimdims = 0; /* default, preserve unlimited dimensions */
 static List* option_chunkspecs = NULL;   /* default, no chunk specification */
 static size_t option_copy_buffer_size = COPY_BUFFER_SIZE;
@@ -147,6 +162,13 @@ static int option_nlvars = 0; /* Number of variables specified with -v * option
 static char** option_lvars = 0;		/* list of variable names specified with -v
 					 * option on command line */
 static bool_t option_varstruct = false;	  /* if -v set, copy structure for non-selected vars */
+#ifdef USE_NETCDF4
+static int option_nthreads = 0;	/* default, filter chunks through HDF5 on one thread */
+#endif
+static int option_timing = 0;	/* default, don't report time spent copying each variable */
+static int overlap_io = 0;	/* read next slab while writing current one, set in copy() */
+static int option_stage_rechunk = 0; /* default, don't stage rechunked variables through a file */
+static char *staging_path = NULL; /* temporary file for -R, set in copy() */
 static int option_compute_chunkcaches = 0; /* default, don't try still flaky estimate of
 					    * chunk cache for each variable */
 
@@ -276,18 +298,56 @@ done:
     return stat;
 }
 
+static void
+freefilters(struct Filter* filters, size_t nfilters)
+{
+    size_t i;
+    if(filters == NULL) return;
+    for(i=0;i<nfilters;i++)
+        if(filters[i].params) free(filters[i].params);
+    free(filters);
+}
+
+/* Parse a chain of filters: "id,params...;id,params...;..." */
+static int
+parsefilterchain(char* chain, struct Filter** filtersp, size_t* nfiltersp)
+{
+    int stat = NC_NOERR;
+    struct Filter* filters = NULL;
+    size_t nfilters = 0;
+    char* p;
+    char* q;
+
+    /* Count the filters */
+    nfilters = 1;
+    for(p=chain;*p;p++) if(*p == ';') nfilters++;
+    if((filters = calloc(nfilters,sizeof(struct Filter)))==NULL)
+        {stat = NC_ENOMEM; goto done;}
+    for(p=chain,nfilters=0;p != NULL;p=q,nfilters++) {
+        if((q = strchr(p,';')) != NULL) *q++ = '\0';
+        if((stat=NC_parsefilterspec(p,&filters[nfilters].filterid,
+                                    &filters[nfilters].nparams,
+                                    &filters[nfilters].params))) goto done;
+    }
+    *filtersp = filters; filters = NULL;
+    *nfiltersp = nfilters;
+done:
+    freefilters(filters,nfilters);
+    return stat;
+}
+
 static int
 parsefilterspec(const char* optarg0, List* speclist)
 {
     int stat = NC_NOERR;
     char* optarg = NULL;
-    unsigned int* params = NULL;
-    size_t nparams;
-    unsigned int id;
+    struct Filter* filters = NULL;
+    size_t nfilters = 0;
     char* p = NULL;
     char* remainder = NULL;
     List* vlist = NULL;
     int i;
+    size_t j;
     int isnone = 0;
 
     if(optarg0 == NULL || strlen(optarg0) == 0 || speclist == NULL) return 0;
@@ -307,8 +367,8 @@ parsefilterspec(const char* optarg0, List* speclist)
     if((stat=parsevarlist(optarg,vlist))) goto done;        
 
     if(strcasecmp(remainder,"none") != 0) {
-        /* Collect the id+parameters */
-        if((stat=NC_parsefilterspec(remainder,&id,&nparams,&params))) goto done;
+        /* Collect the id+parameters of each filter in the chain */
+        if((stat=parsefilterchain(remainder,&filters,&nfilters))) goto done;
     } else
         isnone = 1;
     
@@ -329,19 +389,26 @@ parsefilterspec(const char* optarg0, List* speclist)
 	if(isnone)
 	    spec->nofilter = 1;
 	else {
- 	    spec->filterid = id;
-	    spec->nparams = nparams;
-	    /* Duplicate the params */
-	    spec->params = malloc(nparams*sizeof(unsigned int));
-	    if(spec->params == NULL) {stat = NC_ENOMEM; goto done;}
-	    memcpy(spec->params,params,nparams*sizeof(unsigned int));
+	    /* Duplicate the chain */
+	    spec->filters = calloc(nfilters,sizeof(struct Filter));
+	    if(spec->filters == NULL) {stat = NC_ENOMEM; goto done;}
+	    spec->nfilters = nfilters;
+	    for(j=0;j<nfilters;j++) {
+		struct Filter* f = &spec->filters[j];
+		f->filterid = filters[j].filterid;
+		f->nparams = filters[j].nparams;
+		if(f->nparams == 0) continue;
+		f->params = malloc(f->nparams*sizeof(unsigned int));
+		if(f->params == NULL) {stat = NC_ENOMEM; goto done;}
+		memcpy(f->params,filters[j].params,f->nparams*sizeof(unsigned int));
+	    }
 	}
 	listpush(speclist,spec);
 	spec = NULL;
     }
 
 done:
-    if(params) free(params);
+    freefilters(filters,nfilters);
     if(vlist) listfreeall(vlist);
     if(optarg) free(optarg);
     return stat;
@@ -745,6 +812,7 @@ copy_var_filter(int igrp, int varid, int ogrp, int o_varid, int inkind, int outk
     struct FilterSpec* actualspec = NULL;
     char* ofqn = NULL;
     int inputdefined, outputdefined, unfiltered;
+    size_t i;
     int innc4 = (inkind == NC_FORMAT_NETCDF4 || inkind == NC_FORMAT_NETCDF4_CLASSIC);
     int outnc4 = (outkind == NC_FORMAT_NETCDF4 || outkind == NC_FORMAT_NETCDF4_CLASSIC);
 
@@ -775,14 +843,34 @@ copy_var_filter(int igrp, int varid, int ogrp, int o_varid, int inkind, int outk
     inputdefined = 0; /* default is no filter defined */
     /* Only bother to look if input is netcdf-4 variant */
     if(innc4) {
-      stat=nc_inq_var_filter(vid.grpid,vid.varid,&inspec.filterid,&inspec.nparams,NULL);
-      if(stat && stat != NC_EFILTER)
-	    goto done; /* true error */
-      if(stat == NC_NOERR && inspec.filterid > 0) {/* input has a filter */
-  	    inspec.params = (unsigned int*)malloc(sizeof(unsigned int)*inspec.nparams);
-	    if((stat=nc_inq_var_filter(vid.grpid,vid.varid,&inspec.filterid,&inspec.nparams,inspec.params)))
-	          goto done;
-	    inputdefined = 1;
+      size_t nfilters = 0;
+      unsigned int* ids = NULL;
+      if((stat=nc_inq_var_filter_ids(vid.grpid,vid.varid,&nfilters,NULL)))
+	    goto done;
+      if(nfilters > 0) {/* input has filters */
+	    if((ids = malloc(nfilters*sizeof(unsigned int))) == NULL
+	       || (inspec.filters = calloc(nfilters,sizeof(struct Filter))) == NULL)
+		{free(ids); stat = NC_ENOMEM; goto done;}
+	    if((stat=nc_inq_var_filter_ids(vid.grpid,vid.varid,&nfilters,ids)))
+		{free(ids); goto done;}
+	    for(i=0;i<nfilters;i++) {
+		struct Filter* f = &inspec.filters[inspec.nfilters];
+		/* Unless copying it, deflate is left to the -d option */
+		if(ids[i] == H5Z_FILTER_DEFLATE && option_deflate_level != -1)
+		    continue;
+		f->filterid = ids[i];
+		inspec.nfilters++;
+		if((stat=nc_inq_var_filter_info(vid.grpid,vid.varid,ids[i],&f->nparams,NULL)))
+		    break;
+		if(f->nparams == 0) continue;
+		if((f->params = malloc(f->nparams*sizeof(unsigned int))) == NULL)
+		    {stat = NC_ENOMEM; break;}
+		if((stat=nc_inq_var_filter_info(vid.grpid,vid.varid,ids[i],&f->nparams,f->params)))
+		    break;
+	    }
+	    free(ids);
+	    if(stat) goto done;
+	    inputdefined = (inspec.nfilters > 0);
       }
     }
 
@@ -817,19 +905,20 @@ copy_var_filter(int igrp, int varid, int ogrp, int o_varid, int inkind, int outk
     else if(!suppressfilters && !outputdefined && !inputdefined) /* row 7 */
       unfiltered = 1;
 
-    /* Apply actual filter spec if any */
+    /* Apply actual filter chain if any */
     if(!unfiltered) {
-	if((stat=nc_def_var_filter(ovid.grpid,ovid.varid,
-				   actualspec->filterid,
-				   actualspec->nparams,
-				   actualspec->params)))
+	for(i=0;i<actualspec->nfilters;i++) {
+	    struct Filter* f = &actualspec->filters[i];
+	    if((stat=nc_def_var_filter(ovid.grpid,ovid.varid,
+				       f->filterid,f->nparams,f->params)))
 	        goto done;
+	}
     }
 done:
     /* Cleanup */
     if(ofqn != NULL) free(ofqn);
     if(inspec.fqn) free(inspec.fqn);
-    if(inspec.params) free(inspec.params);
+    freefilters(inspec.filters,inspec.nfilters);
     /* Note we do not clean actualspec because it is a copy of in|out spec */
     return stat;
 }
@@ -870,6 +959,15 @@ copy_chunking(int igrp, int i_varid, int ogrp, int o_varid, int ndims, int inkin
 	goto done;
     }
 
+    /* If an access intent was given with -c, let the library pick
+       chunk shapes optimized for it; only multidimensional variables
+       have a time/space tradeoff to make. */
+    if(chunkspec_intent() != NC_CHUNK_INTENT_DEFAULT && ndims > 1) {
+	NC_CHECK(nc_def_var_chunk_intent(ogrp, o_varid, chunkspec_intent()));
+	NC_CHECK(nc_def_var_chunking(ogrp, o_varid, NC_CHUNKED, NULL));
+	goto done;
+    }
+
     /* See about dim-specific chunking */
     {
 	int idim;
@@ -1027,7 +1125,6 @@ copy_var_specials(int igrp, int varid, int ogrp, int o_varid, int inkind, int ou
     int stat = NC_NOERR;
     int innc4 = (inkind == NC_FORMAT_NETCDF4 || inkind == NC_FORMAT_NETCDF4_CLASSIC);
     int outnc4 = (outkind == NC_FORMAT_NETCDF4 || outkind == NC_FORMAT_NETCDF4_CLASSIC);
-    int deflated = 0; /* true iff deflation is applied */
 
     if(!outnc4)
 	return stat; /* Ignore non-netcdf4 files */
@@ -1040,6 +1137,10 @@ copy_var_specials(int igrp, int varid, int ogrp, int o_varid, int inkind, int ou
 	}
     }
 
+    /* handle general filter chains; these come before deflation so
+       that a deflate copied from the input keeps its place in the chain */
+    NC_CHECK(copy_var_filter(igrp, varid, ogrp, o_varid, inkind, outkind));
+
     { /* handle compression parameters, copying from input, overriding
        * with command-line options */
 	int shuffle_in=0, deflate_in=0, deflate_level_in=0;
@@ -1067,7 +1168,27 @@ copy_var_specials(int igrp, int varid, int ogrp, int o_varid, int inkind, int ou
                then default chunking will be turned on; so do a special check for that. */
 	    if(shuffle_out != 0 || deflate_out != 0)
 	        NC_CHECK(nc_def_var_deflate(ogrp, o_varid, shuffle_out, deflate_out, deflate_level_out));
-	    deflated = deflate_out;
+	}
+    }
+
+    { /* handle quantization, copying from input, overriding with -Q */
+	nc_type vartype;
+	NC_CHECK(nc_inq_vartype(ogrp, o_varid, &vartype));
+	if(vartype == NC_FLOAT || vartype == NC_DOUBLE) {
+	    int mode_in = NC_NOQUANTIZE, nsd_in = 0, nsd_out = 0;
+	    if(innc4) {
+		NC_CHECK(nc_inq_var_quantize(igrp, varid, &mode_in, &nsd_in));
+	    }
+	    if(option_quantize_nsd == -1) {
+		if(mode_in != NC_NOQUANTIZE)
+		    nsd_out = nsd_in;
+	    } else
+		nsd_out = option_quantize_nsd;
+	    if(vartype == NC_FLOAT && nsd_out > NC_QUANTIZE_MAX_FLOAT_NSD)
+		nsd_out = NC_QUANTIZE_MAX_FLOAT_NSD;
+	    if(nsd_out > 0) {
+		NC_CHECK(nc_def_var_quantize(ogrp, o_varid, NC_QUANTIZE_BITGROOM, nsd_out));
+	    }
 	}
     }
 
@@ -1089,11 +1210,6 @@ copy_var_specials(int igrp, int varid, int ogrp, int o_varid, int inkind, int ou
 	}
     }
 
-    if(!deflated) {
-        /* handle other general filters */
-        NC_CHECK(copy_var_filter(igrp, varid, ogrp, o_varid, inkind, outkind));
-    }
-
     return stat;
 }
 
@@ -1481,6 +1597,376 @@ inq_nvals(int igrp, int varid, long long *nvalsp) {
     return stat;
 }
 
+/* Wall clock time in seconds, for -T */
+static double
+wall_time(void) {
+#ifdef HAVE_GETTIMEOFDAY
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + 1.0e-6 * (double)tv.tv_usec;
+#else
+    return (double)time(NULL);
+#endif
+}
+
+/* Print the time and throughput of the copy of a variable, for -T */
+static void
+report_timing(const char *varname, long long nvalues, size_t value_size, size_t nslabs,
+	      double t0, const char *how) {
+    double secs = wall_time() - t0;
+    double mbytes = (double)nvalues * (double)value_size / 1.0e6;
+    printf("%s: %.1f MB in %lu slabs, %.3f s, %.1f MB/s%s\n", varname, mbytes,
+	   (unsigned long)nslabs, secs, secs > 0 ? mbytes / secs : 0.0, how);
+}
+
+#ifdef USE_NETCDF4
+/* Greatest common divisor of two positive integers */
+static size_t
+gcd(size_t a, size_t b) {
+    while(b != 0) {
+	size_t t = a % b;
+	a = b;
+	b = t;
+    }
+    return a;
+}
+
+/* Least common multiple of two positive integers */
+static size_t
+lcm(size_t a, size_t b) {
+    return a / gcd(a, b) * b;
+}
+
+/* Get the dimension lengths of variable varid in group igrp, and the
+ * chunk lengths of it and of ovarid in ogrp, no longer than the
+ * dimensions; a contiguous variable has chunk lengths 1. */
+static int
+inq_chunk_shapes(int igrp, int varid, int ogrp, int ovarid, size_t *lens,
+		 size_t *ichunks, size_t *ochunks, int *icontigp, int *ocontigp) {
+    int stat = NC_NOERR;
+    int ndims, dim;
+    int *dimids;
+
+    NC_CHECK(nc_inq_varndims(igrp, varid, &ndims));
+    dimids = (int *) emalloc((ndims + 1) * sizeof(int));
+    NC_CHECK(nc_inq_vardimid(igrp, varid, dimids));
+    NC_CHECK(nc_inq_var_chunking(igrp, varid, icontigp, ichunks));
+    NC_CHECK(nc_inq_var_chunking(ogrp, ovarid, ocontigp, ochunks));
+    for(dim = 0; dim < ndims; dim++) {
+	NC_CHECK(nc_inq_dimlen(igrp, dimids[dim], &lens[dim]));
+	if(*icontigp != NC_CHUNKED)
+	    ichunks[dim] = 1;
+	if(*ocontigp != NC_CHUNKED)
+	    ochunks[dim] = 1;
+	if(ichunks[dim] > lens[dim] && lens[dim] > 0)
+	    ichunks[dim] = lens[dim];
+	if(ochunks[dim] > lens[dim] && lens[dim] > 0)
+	    ochunks[dim] = lens[dim];
+    }
+    free(dimids);
+    return stat;
+}
+
+/* Choose the shape of the units in which variable varid in group igrp
+ * is copied to ovarid in ogrp: whole chunks of both the input and the
+ * output variable if such a unit fits in bufsize bytes, else whole
+ * output chunks, else whole input chunks.  Sets *alignedp to 0 if
+ * neither variable is chunked or no unit fits, in which case the
+ * default iteration is used. */
+static int
+plan_slab_shape(int igrp, int varid, int ogrp, int ovarid, size_t value_size,
+		size_t bufsize, size_t *shape, int *alignedp) {
+    int stat = NC_NOERR;
+    int ndims, dim;
+    int icontig = 1, ocontig = 1;
+    size_t lens[NC_MAX_VAR_DIMS], ichunks[NC_MAX_VAR_DIMS], ochunks[NC_MAX_VAR_DIMS];
+    size_t ibytes = value_size, obytes = value_size, ubytes = value_size;
+
+    *alignedp = 0;
+    NC_CHECK(nc_inq_varndims(igrp, varid, &ndims));
+    if(ndims == 0)
+	return stat;
+    NC_CHECK(inq_chunk_shapes(igrp, varid, ogrp, ovarid, lens, ichunks, ochunks,
+			      &icontig, &ocontig));
+    for(dim = 0; dim < ndims; dim++) {
+	/* A unit spanning the whole dimension is aligned with both */
+	shape[dim] = lcm(ichunks[dim], ochunks[dim]);
+	if(shape[dim] > lens[dim])
+	    shape[dim] = lens[dim];
+	ibytes *= ichunks[dim];
+	obytes *= ochunks[dim];
+	ubytes *= shape[dim];
+    }
+    if(icontig != NC_CHUNKED && ocontig != NC_CHUNKED) {
+	/* nothing to align with */
+    } else if(ubytes <= bufsize) {
+	*alignedp = 1;
+    } else if(ocontig == NC_CHUNKED && obytes <= bufsize) {
+	memcpy(shape, ochunks, ndims * sizeof(size_t));
+	*alignedp = 1;
+    } else if(icontig == NC_CHUNKED && ibytes <= bufsize) {
+	memcpy(shape, ichunks, ndims * sizeof(size_t));
+	*alignedp = 1;
+    }
+    return stat;
+}
+
+/* Largest multiple of unit that divides whole, such that bytes, the
+ * size of a slab with unit along this dimension, stays within bufsize
+ * when unit is replaced by the multiple. */
+static size_t
+grow_unit(size_t unit, size_t whole, size_t bytes, size_t bufsize) {
+    size_t k;
+    for(k = whole / unit; k > 1; k--) {
+	if((whole / unit) % k == 0 && bytes / unit * unit * k <= bufsize)
+	    return unit * k;
+    }
+    return unit;
+}
+
+/* Plan an out-of-core rechunking (-R) of variable varid in group igrp
+ * to ovarid in ogrp, for when both are chunked but no slab of whole
+ * input and output chunks fits in bufsize bytes.  The data are then
+ * copied to a temporary variable with chunks tshape in slabs rshape
+ * made of whole input chunks, and from there in slabs wshape made of
+ * whole output chunks.  The temporary chunks divide both slab shapes,
+ * so each chunk of the three variables is written and read only once.
+ * Where the input and output chunk lengths have a small common divisor,
+ * the slabs are made the same length along some dimensions to enlarge
+ * the temporary chunks; if these would still be smaller than
+ * bufsize/STAGING_MAX_CHUNKS, there would be too many of them, and
+ * copying in whole output or input chunks is left to
+ * plan_slab_shape() instead.
+ * Sets *bytesp to the largest slab size, which only exceeds bufsize if
+ * a single chunk does, and *stagedp to 0 if no staging is done. */
+static int
+plan_staging(int igrp, int varid, int ogrp, int ovarid, size_t value_size,
+	     size_t bufsize, size_t *rshape, size_t *wshape, size_t *tshape,
+	     size_t *bytesp, int *stagedp) {
+    int stat = NC_NOERR;
+    int ndims, dim;
+    int icontig = 1, ocontig = 1;
+    size_t lens[NC_MAX_VAR_DIMS], ichunks[NC_MAX_VAR_DIMS], ochunks[NC_MAX_VAR_DIMS];
+    size_t rbytes = value_size, wbytes = value_size, ubytes = value_size;
+    size_t tbytes = value_size;
+
+    *stagedp = 0;
+    NC_CHECK(nc_inq_varndims(igrp, varid, &ndims));
+    if(ndims == 0)
+	return stat;
+    NC_CHECK(inq_chunk_shapes(igrp, varid, ogrp, ovarid, lens, ichunks, ochunks,
+			      &icontig, &ocontig));
+    if(icontig != NC_CHUNKED || ocontig != NC_CHUNKED)
+	return stat;
+    for(dim = 0; dim < ndims; dim++) {
+	size_t unit = lcm(ichunks[dim], ochunks[dim]);
+	ubytes *= unit > lens[dim] ? lens[dim] : unit;
+	rshape[dim] = ichunks[dim];
+	wshape[dim] = ochunks[dim];
+	rbytes *= rshape[dim];
+	wbytes *= wshape[dim];
+    }
+    if(ubytes <= bufsize)
+	return stat;
+    /* Read more input chunks at a time along the dimensions in which
+     * they are shorter than the output chunks, and write more output
+     * chunks along those in which they are shorter than the input
+     * chunks, as far as the buffer allows. */
+    for(dim = 0; dim < ndims; dim++) {
+	if(ochunks[dim] > ichunks[dim] && ochunks[dim] % ichunks[dim] == 0) {
+	    rshape[dim] = grow_unit(ichunks[dim], ochunks[dim], rbytes, bufsize);
+	    rbytes = rbytes / ichunks[dim] * rshape[dim];
+	} else if(ichunks[dim] > ochunks[dim] && ichunks[dim] % ochunks[dim] == 0) {
+	    wshape[dim] = grow_unit(ochunks[dim], ichunks[dim], wbytes, bufsize);
+	    wbytes = wbytes / ochunks[dim] * wshape[dim];
+	}
+    }
+    for(dim = 0; dim < ndims; dim++) {
+	tshape[dim] = gcd(rshape[dim], wshape[dim]);
+	tbytes *= tshape[dim];
+    }
+    /* Read and write slabs of the same length, a multiple of both
+     * chunk lengths, along the fastest varying dimensions for which
+     * the buffer allows it, until the temporary chunks are big enough */
+    for(dim = ndims - 1; dim >= 0 && tbytes < bufsize / STAGING_MAX_CHUNKS; dim--) {
+	size_t len = lcm(rshape[dim], wshape[dim]);
+	if(len > lens[dim])
+	    len = lens[dim];
+	if(len == tshape[dim] || rbytes / rshape[dim] * len > bufsize
+	   || wbytes / wshape[dim] * len > bufsize)
+	    continue;
+	rbytes = rbytes / rshape[dim] * len;
+	wbytes = wbytes / wshape[dim] * len;
+	tbytes = tbytes / tshape[dim] * len;
+	rshape[dim] = wshape[dim] = tshape[dim] = len;
+    }
+    if(tbytes < bufsize / STAGING_MAX_CHUNKS)
+	return stat;
+    *bytesp = rbytes > wbytes ? rbytes : wbytes;
+    *stagedp = 1;
+    return stat;
+}
+
+/* Copy all of variable varid in group igrp to ovarid in ogrp in slabs
+ * given by iterp, through buf */
+static int
+copy_slabs(int igrp, int varid, int ogrp, int ovarid, nciter_t *iterp,
+	   void *buf, size_t *nslabsp) {
+    int stat = NC_NOERR;
+    size_t *start, *count;
+
+    start = (size_t *) emalloc((iterp->rank + 1) * sizeof(size_t));
+    count = (size_t *) emalloc((iterp->rank + 1) * sizeof(size_t));
+    while(nc_next_iter(iterp, start, count) > 0) {
+	(*nslabsp)++;
+	NC_CHECK(nc_get_vara(igrp, varid, start, count, buf));
+	NC_CHECK(nc_put_vara(ogrp, ovarid, start, count, buf));
+    }
+    free(start);
+    free(count);
+    return stat;
+}
+
+/* Copy variable varid of atomic type vartype in group igrp to ovarid
+ * in ogrp through a temporary file, as planned by plan_staging().  The
+ * chunk caches of all three variables are turned off, since only whole
+ * chunks are read or written, so memory use is bounded by bufsize. */
+static int
+copy_var_staged(int igrp, int varid, int ogrp, int ovarid, nc_type vartype,
+		const size_t *rshape, const size_t *wshape, const size_t *tshape,
+		void *buf, size_t bufsize, size_t *nslabsp) {
+    int stat = NC_NOERR;
+    int tmpid, tvarid;
+    int ndims, dim;
+    int dimids[NC_MAX_VAR_DIMS];
+    nciter_t *iterp;
+
+    NC_CHECK(nc_inq_varndims(igrp, varid, &ndims));
+    NC_CHECK(nc_inq_vardimid(igrp, varid, dimids));
+    NC_CHECK(nc_create(staging_path, NC_CLOBBER | NC_NETCDF4, &tmpid));
+    NC_CHECK(nc_set_fill(tmpid, NC_NOFILL, NULL));
+    for(dim = 0; dim < ndims; dim++) {
+	char name[NC_MAX_NAME + 1];
+	size_t len;
+	NC_CHECK(nc_inq_dimlen(igrp, dimids[dim], &len));
+	snprintf(name, sizeof(name), "d%d", dim);
+	NC_CHECK(nc_def_dim(tmpid, name, len, &dimids[dim]));
+    }
+    NC_CHECK(nc_def_var(tmpid, "staged", vartype, ndims, dimids, &tvarid));
+    NC_CHECK(nc_def_var_chunking(tmpid, tvarid, NC_CHUNKED, tshape));
+    NC_CHECK(nc_enddef(tmpid));
+    NC_CHECK(nc_set_var_chunk_cache(tmpid, tvarid, 0, option_chunk_cache_nelems,
+				    COPY_CHUNKCACHE_PREEMPTION));
+    NC_CHECK(nc_set_var_chunk_cache(igrp, varid, 0, option_chunk_cache_nelems,
+				    COPY_CHUNKCACHE_PREEMPTION));
+    NC_CHECK(nc_set_var_chunk_cache(ogrp, ovarid, 0, option_chunk_cache_nelems,
+				    COPY_CHUNKCACHE_PREEMPTION));
+
+    /* input chunks to temporary chunks */
+    NC_CHECK(nc_get_iter_tiled(igrp, varid, bufsize, rshape, &iterp));
+    NC_CHECK(copy_slabs(igrp, varid, tmpid, tvarid, iterp, buf, nslabsp));
+    NC_CHECK(nc_free_iter(iterp));
+    /* temporary chunks to output chunks */
+    NC_CHECK(nc_get_iter_tiled(tmpid, tvarid, bufsize, wshape, &iterp));
+    NC_CHECK(copy_slabs(tmpid, tvarid, ogrp, ovarid, iterp, buf, nslabsp));
+    NC_CHECK(nc_free_iter(iterp));
+
+    NC_CHECK(nc_close(tmpid));
+    if(remove(staging_path) != 0)
+	error("can't remove temporary file %s", staging_path);
+    return stat;
+}
+#endif	/* USE_NETCDF4 */
+
+/* A variable copy in which the read of the next slab overlaps the
+ * write of the current one, each with its own buffer */
+typedef struct SlabCopy {
+    int igrp, varid;		/* input variable */
+    int ogrp, ovarid;		/* output variable */
+    size_t *start[2];
+    size_t *count[2];
+    void *buf[2];
+    int cur;			/* which buffer holds the slab being written */
+} SlabCopy;
+
+/* Task 0 writes the current slab, task 1 reads the next one */
+static int
+slab_task(void *state, size_t task) {
+    SlabCopy *sc = (SlabCopy *)state;
+    int b = task == 0 ? sc->cur : 1 - sc->cur;
+    if(task == 0)
+	return nc_put_vara(sc->ogrp, sc->ovarid, sc->start[b], sc->count[b], sc->buf[b]);
+    return nc_get_vara(sc->igrp, sc->varid, sc->start[b], sc->count[b], sc->buf[b]);
+}
+
+/* Copy all slabs of a variable given by iterp, overlapping reads and
+ * writes on two threads.  Only used if the input and output files are
+ * handled by different libraries (netCDF-3 and HDF5).
+ *
+ * Neither library is thread-safe, so this relies on what the two
+ * tasks do and do not share:
+ *  - each task calls only one dispatch library, and no more than one
+ *    call to either is in progress at a time, since NC_run_tasks()
+ *    joins both tasks before the next pair starts;
+ *  - HDF5, and so its error stack and free lists, is only ever called
+ *    by the task using the netCDF-4 file;
+ *  - the list of open files in libdispatch, which both tasks search
+ *    to find their ncid, is locked (see nclistmgr.c);
+ *  - logging is set up by nc_initialize() before any file is opened;
+ *  - the netCDF-3 get/put path has no mutable globals.
+ * Nothing is opened, closed or defined while the tasks run. */
+static int
+copy_slabs_overlapped(int igrp, int varid, int ogrp, int ovarid,
+		      nciter_t *iterp, void *buf0, void *buf1, size_t *nslabsp) {
+    int stat = NC_NOERR;
+    SlabCopy sc;
+    size_t *start, *count;
+    size_t nbytes = (iterp->rank + 1) * sizeof(size_t);
+    int b;
+
+    sc.igrp = igrp;
+    sc.varid = varid;
+    sc.ogrp = ogrp;
+    sc.ovarid = ovarid;
+    sc.buf[0] = buf0;
+    sc.buf[1] = buf1;
+    sc.cur = 0;
+    for(b = 0; b < 2; b++) {
+	sc.start[b] = (size_t *) emalloc(nbytes);
+	sc.count[b] = (size_t *) emalloc(nbytes);
+    }
+    /* nc_next_iter() steps start and count in place, so they are
+     * copied to the slab's own vectors */
+    start = (size_t *) emalloc(nbytes);
+    count = (size_t *) emalloc(nbytes);
+    *nslabsp = 0;
+    if(nc_next_iter(iterp, start, count) > 0) {
+	memcpy(sc.start[0], start, nbytes);
+	memcpy(sc.count[0], count, nbytes);
+	NC_CHECK(nc_get_vara(igrp, varid, sc.start[0], sc.count[0], sc.buf[0]));
+	for(;;) {
+	    int next = 1 - sc.cur;
+	    (*nslabsp)++;
+	    if(nc_next_iter(iterp, start, count) == 0) {
+		NC_CHECK(nc_put_vara(ogrp, ovarid, sc.start[sc.cur], sc.count[sc.cur],
+				     sc.buf[sc.cur]));
+		break;
+	    }
+	    memcpy(sc.start[next], start, nbytes);
+	    memcpy(sc.count[next], count, nbytes);
+	    NC_CHECK(NC_run_tasks(2, 2, slab_task, &sc));
+	    sc.cur = next;
+	}
+    }
+    for(b = 0; b < 2; b++) {
+	free(sc.start[b]);
+	free(sc.count[b]);
+    }
+    free(start);
+    free(count);
+    return stat;
+}
+
 /* Copy data from variable varid in group igrp to corresponding group
  * ogrp. */
 static int
@@ -1491,16 +1977,24 @@ copy_var_data(int igrp, int varid, int ogrp) {
     size_t ntoget;		/* number of values to access this iteration */
     size_t value_size;		/* size of a single value of this variable */
     static void *buf = 0;	/* buffer for the variable values */
+    static void *buf2 = 0;	/* second buffer, for overlapped reads */
     char varname[NC_MAX_NAME];
     int ovarid;
     size_t *start;
     size_t *count;
     nciter_t *iterp;		/* opaque structure for iteration status */
     int do_realloc = 0;
+    int overlap;		/* read next slab while writing current one */
+    size_t nslabs = 0;
+    double t0 = 0;
 #ifdef USE_NETCDF4
     int okind;
     size_t chunksize;
+    size_t *shape = NULL;	/* unit of chunk-aligned slabs */
+    int aligned = 0;
+    size_t rshape[NC_MAX_VAR_DIMS], wshape[NC_MAX_VAR_DIMS], tshape[NC_MAX_VAR_DIMS];
 #endif
+    int staged = 0;		/* rechunked through a temporary file */
 
     NC_CHECK(inq_nvals(igrp, varid, &nvalues));
     if(nvalues == 0)
@@ -1542,6 +2036,15 @@ copy_var_data(int igrp, int varid, int ogrp) {
 						option_chunk_cache_nelems,
 						COPY_CHUNKCACHE_PREEMPTION));
 	    }
+	    if(option_nthreads > 0) {
+		/* Make room for at least one output chunk per thread,
+		 * so the library can filter them concurrently. */
+		NC_CHECK(inq_var_chunksize(ogrp, ovarid, &chunksize));
+		if(chunksize * option_nthreads > option_copy_buffer_size) {
+		    option_copy_buffer_size = chunksize * option_nthreads;
+		    do_realloc = 1;
+		}
+	    }
 	}
     }
     /* For chunked variables, option_copy_buffer_size must also be at least as large as
@@ -1553,25 +2056,76 @@ copy_var_data(int igrp, int varid, int ogrp) {
 	    do_realloc = 1;
 	}
     }
+    /* With -R, rechunk through a temporary file if whole input and
+     * output chunks can't both be copied within the buffer */
+    if(option_stage_rechunk && vartype <= NC_MAX_ATOMIC_TYPE && vartype != NC_STRING) {
+	size_t needed;
+	NC_CHECK(plan_staging(igrp, varid, ogrp, ovarid, value_size, option_copy_buffer_size,
+			      rshape, wshape, tshape, &needed, &staged));
+	if(staged && needed > option_copy_buffer_size) {
+	    option_copy_buffer_size = needed;
+	    do_realloc = 1;
+	}
+    }
 #endif	/* USE_NETCDF4 */
+    /* Strings and vlens are freed after each slab, so are copied
+     * one slab at a time */
+    overlap = overlap_io && !staged && vartype <= NC_MAX_ATOMIC_TYPE && vartype != NC_STRING;
     if(buf && do_realloc) {
 	free(buf);
 	buf = 0;
+	if(buf2) {
+	    free(buf2);
+	    buf2 = 0;
+	}
     }
     if(buf == 0) {		/* first time or needs to grow */
 	buf = emalloc(option_copy_buffer_size);
 	memset((void*)buf,0,option_copy_buffer_size);
     }
+    if(overlap && buf2 == 0) {
+	buf2 = emalloc(option_copy_buffer_size);
+	memset((void*)buf2,0,option_copy_buffer_size);
+    }
+    if(option_timing)
+	t0 = wall_time();
 
-    /* initialize variable iteration */
-    NC_CHECK(nc_get_iter(igrp, varid, option_copy_buffer_size, &iterp));
+#ifdef USE_NETCDF4
+    if(staged) {
+	NC_CHECK(copy_var_staged(igrp, varid, ogrp, ovarid, vartype, rshape, wshape, tshape,
+				 buf, option_copy_buffer_size, &nslabs));
+	if(option_timing)
+	    report_timing(varname, nvalues, value_size, nslabs, t0, " (staged)");
+	return stat;
+    }
+#endif
+
+    /* initialize variable iteration, in slabs aligned with the chunks
+     * of the input and output variables if possible */
+#ifdef USE_NETCDF4
+    shape = (size_t *) emalloc((NC_MAX_VAR_DIMS + 1) * sizeof(size_t));
+    NC_CHECK(plan_slab_shape(igrp, varid, ogrp, ovarid, value_size,
+			     option_copy_buffer_size, shape, &aligned));
+    if(aligned) {
+	NC_CHECK(nc_get_iter_tiled(igrp, varid, option_copy_buffer_size, shape, &iterp));
+    } else
+#endif
+    {
+	NC_CHECK(nc_get_iter(igrp, varid, option_copy_buffer_size, &iterp));
+    }
+#ifdef USE_NETCDF4
+    free(shape);
+#endif
 
     start = (size_t *) emalloc((iterp->rank + 1) * sizeof(size_t));
     count = (size_t *) emalloc((iterp->rank + 1) * sizeof(size_t));
+    if(overlap)
+	NC_CHECK(copy_slabs_overlapped(igrp, varid, ogrp, ovarid, iterp, buf, buf2, &nslabs));
     /* nc_next_iter() initializes start and count on first call,
      * changes start and count to iterate through whole variable on
      * subsequent calls. */
-    while((ntoget = nc_next_iter(iterp, start, count)) > 0) {
+    while(!overlap && (ntoget = nc_next_iter(iterp, start, count)) > 0) {
+	nslabs++;
 	NC_CHECK(nc_get_vara(igrp, varid, start, count, buf));
 	NC_CHECK(nc_put_vara(ogrp, ovarid, start, count, buf));
 #ifdef USE_NETCDF4
@@ -1593,6 +2147,8 @@ copy_var_data(int igrp, int varid, int ogrp) {
     /* NC_CHECK(free_var_chunk_cache(igrp, varid)); */
     /* NC_CHECK(free_var_chunk_cache(ogrp, ovarid)); */
 #endif	/* USE_NETCDF4 */
+    if(option_timing)
+	report_timing(varname, nvalues, value_size, nslabs, t0, overlap ? " (overlapped)" : "");
     free(start);
     free(count);
     NC_CHECK(nc_free_iter(iterp));
@@ -1888,6 +2444,18 @@ copy_record_data(int ncid, int ogrp, size_t nrec_vars, int *rec_varids) {
     return NC_NOERR;
 }
 
+/* Return 1 if one of the input and output files is handled by the
+ * netCDF-3 library and the other by HDF5, so that a read from one can
+ * run at the same time as a write to the other. */
+static int
+io_libraries_differ(int igrp, int ogrp) {
+    int iformat, oformat;
+    NC_CHECK(nc_inq_format_extended(igrp, &iformat, NULL));
+    NC_CHECK(nc_inq_format_extended(ogrp, &oformat, NULL));
+    return (iformat == NC_FORMATX_NC3 && oformat == NC_FORMATX_NC_HDF5)
+	|| (iformat == NC_FORMATX_NC_HDF5 && oformat == NC_FORMATX_NC3);
+}
+
 /* copy infile to outfile using netCDF API
  */
 static int
@@ -1924,6 +2492,7 @@ copy(char* infile, char* outfile)
 	if (inkind == NC_FORMAT_CLASSIC || inkind == NC_FORMAT_64BIT_OFFSET
 	    || inkind == NC_FORMAT_CDF5) {
 	    if (option_deflate_level > 0 ||
+		option_quantize_nsd > 0 ||
 		option_shuffle_vars == NC_SHUFFLE ||
 		listlength(option_chunkspecs) > 0)
 	    {
@@ -1994,6 +2563,12 @@ copy(char* infile, char* outfile)
     }
     NC_CHECK(nc_create(outfile, create_mode, &ogrp));
     NC_CHECK(nc_set_fill(ogrp, NC_NOFILL, NULL));
+    if(option_stage_rechunk) {
+	staging_path = (char *) emalloc(strlen(outfile) + strlen(STAGING_SUFFIX) + 1);
+	strcpy(staging_path, outfile);
+	strcat(staging_path, STAGING_SUFFIX);
+    }
+    overlap_io = NC_threads_available() && io_libraries_differ(igrp, ogrp);
 
 #ifdef USE_NETCDF4
     /* Because types in one group may depend on types in a different
@@ -2034,6 +2609,10 @@ copy(char* infile, char* outfile)
 
     NC_CHECK(nc_close(igrp));
     NC_CHECK(nc_close(ogrp));
+    if(staging_path) {
+	free(staging_path);
+	staging_path = NULL;
+    }
     return stat;
 }
 
@@ -2089,7 +2668,9 @@ usage(void)
   [-5]      CDF5 output (same as -k 'cdf5)\n\
   [-d n]    set output deflation compression level, default same as input (0=none 9=max)\n\
   [-s]      add shuffle option to deflation compression\n\
+  [-Q n]    keep only n significant digits of float and double data (0=all), default same as input\n\
   [-c chunkspec] specify chunking for dimensions, e.g. \"dim1/N1,dim2/N2,...\"\n\
+	    or access intent for chunk shapes: 'balanced', 'spatial', 'timeseries'\n\
   [-u]      convert unlimited dimensions to fixed-size dimensions in output copy\n\
   [-w]      write whole output file from diskless netCDF on close\n\
   [-v var1,...] include data for only listed variables, but definitions for all variables\n\
@@ -2100,9 +2681,12 @@ usage(void)
   [-h n]    set size in bytes of chunk_cache for chunked variables\n\
   [-e n]    set number of elements that chunk_cache can hold\n\
   [-r]      read whole input file into diskless file on open (classic or 64-bit offset or cdf5 formats only)\n\
-  [-F filterspec] specify the compression algorithm to apply to an output variable.\n\
+  [-F filterspec] specify the filters to apply to output variables, e.g. \"var,id,p1,...;id,p1,...\"\n\
   [-Ln]     set log level to n (>= 0); ignored if logging isn't enabled.\n\
   [-Mn]     set minimum chunk size to n bytes (n >= 0)\n\
+  [-j n]    filter chunks of netCDF-4 variables on n threads\n\
+  [-T]      print time and throughput of the copy of each variable\n\
+  [-R n]    rechunk through a temporary file, copying at most n bytes at a time\n\
   infile    name of netCDF input file\n\
   outfile   name for netCDF output file\n"
 
@@ -2110,7 +2694,7 @@ usage(void)
     /* [-x]      use experimental computed estimates for variable-specific chunk caches\n\ */
 
 
-    error("%s [-k kind] [-[3|4|6|7]] [-d n] [-s] [-c chunkspec] [-u] [-w] [-[v|V] varlist] [-[g|G] grplist] [-m n] [-h n] [-e n] [-r] [-F filterspec] [-Ln] [-Mn] infile outfile\n%s\nnetCDF library version %s",
+    error("%s [-k kind] [-[3|4|6|7]] [-d n] [-s] [-Q n] [-c chunkspec] [-u] [-w] [-[v|V] varlist] [-[g|G] grplist] [-m n] [-h n] [-e n] [-r] [-F filterspec] [-Ln] [-Mn] [-j n] [-T] [-R n] infile outfile\n%s\nnetCDF library version %s",
 	  progname, USAGE, nc_inq_libvers());
 
 }
@@ -2134,7 +2718,7 @@ main(int argc, char**argv)
        usage();
     }
 
-    while ((c = getopt(argc, argv, "k:3467d:sum:c:h:e:rwxg:G:v:V:F:L:M:")) != -1) {
+    while ((c = getopt(argc, argv, "k:3467d:sQ:um:c:h:e:rwxg:G:v:V:F:L:M:j:TR:")) != -1) {
 	switch(c) {
         case 'k': /* for specifying variant of netCDF format to be generated
                      Format names:
@@ -2189,6 +2773,12 @@ main(int argc, char**argv)
 	case 's':		/* shuffling, may improve compression */
 	    option_shuffle_vars = NC_SHUFFLE;
 	    break;
+	case 'Q':		/* quantization, improves compression */
+	    option_quantize_nsd = strtol(optarg, NULL, 10);
+	    if(option_quantize_nsd < 0 || option_quantize_nsd > NC_QUANTIZE_MAX_DOUBLE_NSD) {
+		error("invalid number of significant digits: %d", option_quantize_nsd);
+	    }
+	    break;
 	case 'u':		/* convert unlimited dimensions to fixed size */
 	    option_fix_unlimdims = 1;
 	    break;
@@ -2222,6 +2812,9 @@ main(int argc, char**argv)
 	case 'w':
 	    option_write_diskless = 1; /* write to memory, persist on close */
 	    break;
+	case 'T':		/* report time spent copying each variable */
+	    option_timing = 1;
+	    break;
 	case 'x':		/* use experimental variable-specific chunk caches */
 	    option_compute_chunkcaches = 1;
 	    break;
@@ -2288,6 +2881,29 @@ main(int argc, char**argv)
 #else
 	    error("-M requires netcdf-4");
 #endif
+	case 'R':		/* out-of-core rechunking within n bytes */
+#ifdef USE_NETCDF4
+	{
+	    double dval = double_with_suffix(optarg);	/* "K" for kilobytes. "M" for megabytes, ... */
+	    if(dval <= 0)
+		error("Suffix used for '-R' option value must be K, M, G, T, or P");
+	    option_copy_buffer_size = dval;
+	    option_stage_rechunk = 1;
+	    break;
+	}
+#else
+	    error("-R requires netcdf-4");
+#endif
+	case 'j': /* threads for filtering chunks */
+#ifdef USE_NETCDF4
+	    option_nthreads = atoi(optarg);
+	    if(option_nthreads < 1)
+		error("invalid number of threads: %s", optarg);
+	    NC_CHECK(nc_set_chunk_threads(option_nthreads));
+	    break;
+#else
+	    error("-j requires netcdf-4");
+#endif
 
 	default:
 	    usage();
@@ -2311,11 +2927,14 @@ main(int argc, char**argv)
     { int i,j;
         for(i=0;i<listlength(filterspecs);i++) {
 	    struct FilterSpec *spec = listget(filterspecs,i);
-	    fprintf(stderr,"filterspecs[%d]={fqn=|%s| filterid=%u nparams=%ld params=",
-		i,spec->fqn,spec->filterid,(unsigned long)spec->nparams);
-	    for(j=0;j<spec->nparams;j++) {
-		if(j>0) fprintf(stderr,",");
-		fprintf(stderr,"%u",spec->params[j]);
+	    size_t k;
+	    fprintf(stderr,"filterspecs[%d]={fqn=|%s| filters=",i,spec->fqn);
+	    for(k=0;k<spec->nfilters;k++) {
+		struct Filter* f = &spec->filters[k];
+		if(k>0) fprintf(stderr,";");
+		fprintf(stderr,"%u",f->filterid);
+	        for(j=0;j<f->nparams;j++)
+		    fprintf(stderr,",%u",f->params[j]);
 	    }
 	    fprintf(stderr,"}\n");
 	    fflush(stderr);
@@ -2333,7 +2952,7 @@ main(int argc, char**argv)
         for(i=0;i<listlength(filterspecs);i++) {
 	    struct FilterSpec* spec = listget(filterspecs,i);
 	    if(spec->fqn) free(spec->fqn);
-            if(spec->params) free(spec->params);
+            freefilters(spec->filters,spec->nfilters);
 	}
     }
 #endif /*USE_NETCDF4*/
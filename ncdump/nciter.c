@@ -166,16 +166,48 @@ up_start_by_chunks(
     return ret;
 }
 
-/* Begin public interfaces */
+/*
+ * Grow a tile of whole chunks until it fills bufsize bytes, rightmost
+ * dimension first, so that each slab is as contiguous as possible.
+ */
+static void
+tile_chunks(size_t bufsize, 	/* size in bytes of in-memory copy buffer */
+	    size_t value_size,  /* size in bytes of each variable element */
+	    int rank,		/* number of dimensions for variable */
+	    const size_t *dims, /* dimension sizes */
+	    const size_t *chunks, /* chunk shape */
+	    size_t *tile	/* returned tile shape */
+    )
+{
+    size_t prod = value_size;
+    int i;
 
-/* Initialize iteration for a variable.  Just a wrapper for
- * nc_blkio_init() that makes the netCDF calls needed to initialize
- * lower-level iterator. */
-int
-nc_get_iter(int ncid,
-	     int varid,
-	     size_t bufsize,   /* size in bytes of memory buffer */
-	     nciter_t **iterpp /* returned opaque iteration state */)
+    for(i = 0; i < rank; i++) {
+	tile[i] = chunks[i];
+	prod *= chunks[i];
+    }
+    for(i = rank - 1; i >= 0; i--) {
+	size_t nchunks = (dims[i] + chunks[i] - 1) / chunks[i];
+	size_t fit = bufsize / prod;
+	if(fit <= 1 || nchunks == 0)
+	    break;
+	if(fit > nchunks)
+	    fit = nchunks;
+	tile[i] = chunks[i] * fit;
+	prod *= fit;
+	if(fit < nchunks)
+	    break;
+    }
+}
+
+/* Set up an iterator; if tile_shape is not NULL, iterate over tiles
+ * of chunks of that shape instead of the variable's own chunks. */
+static int
+get_iter(int ncid,
+	 int varid,
+	 size_t bufsize,   /* size in bytes of memory buffer */
+	 const size_t *tile_shape, /* chunk shape to tile with, or NULL */
+	 nciter_t **iterpp /* returned opaque iteration state */)
 {
     int stat = NC_NOERR;
     nciter_t *iterp;
@@ -207,8 +239,16 @@ nc_get_iter(int ncid,
     }
     NC_CHECK(nc_inq_vartype(ncid, varid, &vartype));
     NC_CHECK(inq_value_size(ncid, vartype, &value_size));
+    if(tile_shape && ndims > 0) {
+	for(dim = 0; dim < ndims; dim++)
+	    if(tile_shape[dim] == 0)
+		NC_CHECK(NC_EINVAL);
+	tile_chunks(bufsize, value_size, ndims, iterp->dimsizes, tile_shape,
+		    iterp->chunksizes);
+	chunked = 1;
+    }
 #ifdef USE_NETCDF4
-    {
+    else {
 	int contig = 1;
 	if(ndims > 0) {
 	    NC_CHECK(nc_inq_var_chunking(ncid, varid, &contig, NULL));
@@ -226,6 +266,33 @@ nc_get_iter(int ncid,
     return stat;
 }
 
+/* Begin public interfaces */
+
+/* Initialize iteration for a variable.  Just a wrapper for
+ * nc_blkio_init() that makes the netCDF calls needed to initialize
+ * lower-level iterator. */
+int
+nc_get_iter(int ncid,
+	     int varid,
+	     size_t bufsize,   /* size in bytes of memory buffer */
+	     nciter_t **iterpp /* returned opaque iteration state */)
+{
+    return get_iter(ncid, varid, bufsize, NULL, iterpp);
+}
+
+/* Initialize iteration for a variable in slabs of whole chunks of
+ * shape chunksizes, e.g. those of the variable it is copied to, so
+ * that every write covers whole chunks. */
+int
+nc_get_iter_tiled(int ncid,
+		  int varid,
+		  size_t bufsize,   /* size in bytes of memory buffer */
+		  const size_t *chunksizes, /* chunk shape to tile with */
+		  nciter_t **iterpp /* returned opaque iteration state */)
+{
+    return get_iter(ncid, varid, bufsize, chunksizes, iterpp);
+}
+
 /* Iterate on blocks for variables, by updating start and count vector
  * for next vara call.  Assumes nc_get_iter called first.  Returns
  * number of variable values to get, 0 if done, negative number if
@@ -43,6 +43,14 @@ typedef struct {
 extern int
 nc_get_iter(int ncid, int varid, size_t bufsize, nciter_t **iterpp);
 
+/* Get iterator for variable data in slabs made of whole chunks of
+ * the given shape (usually that of the output variable), as many as
+ * fit in bufsize bytes.  If one chunk doesn't fit, each slab is a
+ * single chunk, larger than bufsize.  Release with nc_free_iter(). */
+extern int
+nc_get_iter_tiled(int ncid, int varid, size_t bufsize,
+		  const size_t *chunksizes, nciter_t **iterpp);
+
 /* Iterate over blocks of variable values, using start and count
  * vectors.  Returns number of values to access (product of counts),
  * or 0 if done. */
@@ -63,7 +63,29 @@ fi
 if fgrep '_Shuffle' < tmp.cdl ; then
     exit 1
 fi
-rm tst_deflated.nc tst_inflated.nc tst_inflated4.nc tmp.nc tmp.cdl
+echo "*** Test nccopy -Q keeps infinities, NaNs and fill values, and records the digits ..."
+${NCCOPY} -Q3 tst_nans.nc tmp.nc
+${NCDUMP} -n tst_nans tmp.nc | sed -e '/_QuantizeBitGroomNumberOfSignificantDigits = 3 ;/d' > tmp.cdl
+${NCDUMP} tst_nans.nc | diff - tmp.cdl
+${NCDUMP} -h tmp.nc | fgrep 'fvar:_QuantizeBitGroomNumberOfSignificantDigits = 3 ;'
+echo "*** Test nccopy -Q passes quantization through and -Q0 turns it off ..."
+${NCCOPY} tmp.nc tst_deflated.nc
+${NCDUMP} -h tst_deflated.nc | fgrep 'dvar:_QuantizeBitGroomNumberOfSignificantDigits = 3 ;'
+${NCCOPY} -Q0 tst_nans.nc tst_deflated.nc
+if ${NCDUMP} -h tst_deflated.nc | fgrep '_Quantize' ; then
+    exit 1
+fi
+echo "*** Test nccopy -T overlaps reads and writes between classic and netCDF-4 files ..."
+# Without thread support the copies are made serially, without the
+# "(overlapped)" timing note, so only the data can be compared.
+${NCCOPY} -T -d1 -c dim1/1000 -m 8000 tst_inflated.nc tmp.nc > tmp.txt
+if test "x$has_threads" = xyes ; then fgrep '(overlapped)' tmp.txt ; fi
+${NCDUMP} -n tst_inflated tst_inflated.nc > tmp.cdl
+${NCDUMP} -n tst_inflated tmp.nc | diff - tmp.cdl
+${NCCOPY} -T -k classic -m 8000 tmp.nc tst_deflated.nc > tmp.txt
+if test "x$has_threads" = xyes ; then fgrep '(overlapped)' tmp.txt ; fi
+${NCDUMP} -n tst_inflated tst_deflated.nc | diff - tmp.cdl
+rm tst_deflated.nc tst_inflated.nc tst_inflated4.nc tmp.nc tmp.cdl tmp.txt
 
 echo "*** Testing nccopy -d1 -s on ncdump/*.nc files"
 for i in $TESTFILES ; do
@@ -88,6 +110,32 @@ diff tmp.cdl tmp-unchunked.cdl
 ${NCCOPY} -c // tmp-chunked.nc tmp-unchunked.nc
 ${NCDUMP} -n tmp tmp-unchunked.nc > tmp-unchunked.cdl
 diff tmp.cdl tmp-unchunked.cdl
+echo "*** Test that nccopy -j filters chunks on several threads with the same result"
+${NCCOPY} -d1 -s -m 10K -c dim0/,dim1/1,dim2/,dim3/1,dim4/,dim5/1,dim6/ tst_chunking.nc tmp-chunked.nc
+${NCDUMP} -s -n tmp tmp-chunked.nc > tmp-chunked.cdl
+${NCCOPY} -j 4 -d1 -s -m 10K -c dim0/,dim1/1,dim2/,dim3/1,dim4/,dim5/1,dim6/ tst_chunking.nc tmp-unchunked.nc
+${NCDUMP} -s -n tmp tmp-unchunked.nc > tmp-unchunked.cdl
+diff tmp-chunked.cdl tmp-unchunked.cdl
+${NCCOPY} tmp-chunked.nc tmp.nc
+${NCDUMP} -s -n tmp tmp.nc > tmp.cdl
+${NCCOPY} -j 3 tmp-chunked.nc tmp-unchunked.nc
+${NCDUMP} -s -n tmp tmp-unchunked.nc > tmp-unchunked.cdl
+diff tmp.cdl tmp-unchunked.cdl
+echo "*** Test that nccopy -R rechunks through a temporary file within a small buffer"
+${NCCOPY} -M0 -c dim0/,dim1/1,dim2/,dim3/1,dim4/,dim5/1,dim6/ tst_chunking.nc tmp-chunked.nc
+${NCCOPY} -M0 -T -R 40K -c dim0/1,dim1/,dim2/1,dim3/,dim4/1,dim5/,dim6/1 tmp-chunked.nc tmp.nc > tmp.txt
+fgrep 'ivar: ' tmp.txt | fgrep '(staged)'
+test ! -f tmp.nc.rechunk.tmp
+${NCDUMP} -n tmp tst_chunking.nc > tmp-chunked.cdl
+${NCDUMP} -n tmp tmp.nc > tmp.cdl
+diff tmp-chunked.cdl tmp.cdl
+# Within 10K the temporary chunks of ivar would hold only 28 values,
+# too few to be worth it, so it is copied directly
+${NCCOPY} -M0 -T -R 10K -c dim0/1,dim1/,dim2/1,dim3/,dim4/1,dim5/,dim6/1 tmp-chunked.nc tmp.nc > tmp.txt
+if fgrep 'ivar: ' tmp.txt | fgrep '(staged)' ; then exit 1 ; fi
+${NCDUMP} -n tmp tmp.nc > tmp.cdl
+diff tmp-chunked.cdl tmp.cdl
+rm tmp.txt
 echo "*** Test that nccopy -c works as intended for record dimension default (1)"
 ${NCGEN} -b -o tst_bug321.nc $srcdir/tst_bug321.cdl
 ${NCCOPY} -k nc7 -c"lat/2,lon/2" tst_bug321.nc tmp.nc
@@ -5,6 +5,7 @@
 #include "config.h"
 #include "dapparselex.h"
 #include "dapy.h"
+#include "nchashmap.h"
 
 /* Forward */
 
@@ -399,26 +400,31 @@ check_int32(char* val, long* value)
     return ok;
 }
 
+/* Remove the later occurrences of each name in a scope and return
+   them, or NULL if there are none. Names seen are kept in a hash map
+   so that scopes with many thousands of names are not quadratic. */
 static NClist*
 scopeduplicates(NClist* list)
 {
-    unsigned int i,j;
-    unsigned int len = nclistlength(list);
+    size_t i,keep;
+    size_t len = nclistlength(list);
     NClist* dups = NULL;
-    for(i=0;i<len;i++) {
+    NC_hashmap* seen = NULL;
+    if(len < 2) return NULL;
+    seen = NC_hashmapnew(len);
+    for(keep=0,i=0;i<len;i++) {
 	OCnode* io = (OCnode*)nclistget(list,i);
-retry:
-        for(j=i+1;j<len;j++) {
-	    OCnode* jo = (OCnode*)nclistget(list,j);
-	    if(strcmp(io->name,jo->name)==0) {
-		if(dups == NULL) dups = nclistnew();
-		nclistpush(dups,jo);
-		nclistremove(list,j);
-		len--;
-		goto retry;
-	    }
+	size_t namelen = strlen(io->name)+1; /* nul too, so "" is a key */
+	if(NC_hashmapget(seen,io->name,namelen,NULL)) {
+	    if(dups == NULL) dups = nclistnew();
+	    nclistpush(dups,io);
+	    continue;
 	}
+	NC_hashmapadd(seen,(uintptr_t)io,io->name,namelen);
+	nclistset(list,keep++,io);
     }
+    nclistsetlength(list,keep);
+    NC_hashmapfree(seen);
     return dups;
 }
 
@@ -14,6 +14,7 @@
 #include "ncrc.h"
 #include "occurlfunctions.h"
 #include "ochttp.h"
+#include "ocread.h"
 #include "ncwinpath.h"
 
 #undef TRACK
@@ -130,6 +131,129 @@ oc_fetch(OCobject link, const char* constraint,
     return OCTHROW(ocerr);
 }
 
+/*!
+This procedure starts reading the DATADDS response for a constraint
+in the background, so that a later oc_fetch of a DATADDS with exactly
+the same constraint finds the response already (partly) transferred.
+Only one read ahead is pending per link; starting another drops the
+first. It does nothing for file:// urls or when the library was built
+without thread support.
+
+\param[in] link The link through which the server is accessed.
+\param[in] constraint The constraint of the expected request.
+
+\retval OC_NOERR The procedure executed normally.
+\retval OC_EINVAL  One of the arguments (link, etc.) was invalid.
+*/
+
+OCerror
+oc_prefetch(OCobject link, const char* constraint)
+{
+    OCstate* state;
+    OCVERIFY(OC_State,link);
+    OCDEREF(OCstate*,state,link);
+    return OCTHROW(ocprefetch(state,constraint));
+}
+
+/*!
+This procedure fetches a DATADDS response that is expected to
+hold exactly one atomic array of a given type and number of
+elements, as for a constraint projecting a single top-level array
+variable. Rather than staging the whole response in memory or on
+disk and building a data tree, the values are decoded as they arrive
+and passed to a callback, a bounded window at a time. For file://
+urls the constraint is ignored and the file is read in pieces the
+same way, so the file must hold just the one array.
+
+\param[in] link The link through which the server is accessed.
+\param[in] constraint The constraint to be applied to the request.
+\param[in] etype The atomic type of the array; not OC_String or OC_URL.
+\param[in] nelems The number of elements in the (constrained) array.
+\param[in] fcn The procedure receiving the values.
+\param[in] userdata Passed to fcn.
+
+\retval OC_NOERR The procedure executed normally.
+\retval OC_EINVAL  One of the arguments (link, etc.) was invalid.
+\retval OC_EDATADDS The response was not the expected single array.
+*/
+
+OCerror
+oc_stream_data(OCobject link, const char* constraint, OCtype etype,
+	       size_t nelems, OCstreamfcn fcn, void* userdata)
+{
+    OCstate* state;
+    OCVERIFY(OC_State,link);
+    OCDEREF(OCstate*,state,link);
+    if(fcn == NULL || etype == OC_String || etype == OC_URL
+       || octypesize(etype) == 0)
+	return OCTHROW(OC_EINVAL);
+    return OCTHROW(readDATADDSstream(state,constraint,etype,nelems,fcn,userdata));
+}
+
+/*!
+This procedure fetches a DATADDS and walks the records of one of its
+top-level sequences like a cursor: records are decoded as the
+response arrives and passed to a callback in batches of at most
+batchsize records, so that memory use is bounded by the batch rather
+than by the length of the sequence. Each batch, and the data of the
+records in it, is reclaimed when the callback returns. Any top-level
+variables in front of the sequence are decoded and dropped, and the
+rest of the response after it is ignored. For file:// urls the file
+is read in pieces the same way.
+
+\param[in] link The link through which the server is accessed.
+\param[in] constraint The constraint to be applied to the request.
+\param[in] name The name of the sequence; NULL means the first
+top-level sequence.
+\param[in] batchsize The largest number of records per call of fcn;
+0 means a default.
+\param[in] fcn The procedure receiving the records.
+\param[in] userdata Passed to fcn.
+
+\retval OC_NOERR The procedure executed normally.
+\retval OC_EINVAL  One of the arguments (link, etc.) was invalid.
+\retval OC_EDATADDS The response has no such sequence or is too short.
+*/
+
+OCerror
+oc_stream_records(OCobject link, const char* constraint, const char* name,
+		  size_t batchsize, OCrecordfcn fcn, void* userdata)
+{
+    OCstate* state;
+    OCVERIFY(OC_State,link);
+    OCDEREF(OCstate*,state,link);
+    if(fcn == NULL)
+	return OCTHROW(OC_EINVAL);
+    return OCTHROW(readDATADDSrecords(state,constraint,name,batchsize,fcn,userdata));
+}
+
+/*!
+This procedure reports how many response body bytes have been fetched
+through a link: as they came over the wire and after any
+Content-Encoding (gzip, deflate, ...) was undone. The two differ when
+the server compressed its responses; see HTTP.DEFLATE. Responses read
+from file:// urls are not counted.
+
+\param[in] link The link through which the server is accessed.
+\param[out] wirep The number of bytes received; may be NULL.
+\param[out] decodedp The number of bytes after decoding; may be NULL.
+
+\retval OC_NOERR The procedure executed normally.
+\retval OC_EINVAL  The link was invalid.
+*/
+
+OCerror
+oc_transfer_counts(OCobject link, unsigned long long* wirep,
+		   unsigned long long* decodedp)
+{
+    OCstate* state;
+    OCVERIFY(OC_State,link);
+    OCDEREF(OCstate*,state,link);
+    if(wirep) *wirep = state->transfer.wire;
+    if(decodedp) *decodedp = state->transfer.decoded;
+    return OCTHROW(OC_NOERR);
+}
+
 
 /*!
 This procedure reclaims all resources
@@ -194,6 +194,23 @@ term "connection"
 */
 typedef OCobject OClink;
 
+/*!\typedef OCstreamfcn
+Called by oc_stream_data with the values [start,start+count) of the
+array as they arrive, in the same memory form as oc_data_readn.
+Returning anything but OC_NOERR stops the transfer.
+*/
+typedef OCerror (*OCstreamfcn)(void* userdata, const void* values,
+			       size_t start, size_t count);
+
+/*!\typedef OCrecordfcn
+Called by oc_stream_records with the records [start,start+count) of a
+sequence as they arrive. The records are data nodes for use with the
+oc_data_* procedures, valid only until the call returns. Returning
+anything but OC_NOERR stops the transfer.
+*/
+typedef OCerror (*OCrecordfcn)(void* userdata, OCdatanode* records,
+			       size_t start, size_t count);
+
 /**@}*/
 
 /**************************************************/
@@ -230,6 +247,26 @@ EXTERNL OCerror oc_fetch(OClink,
 			OCflags,
 			OCddsnode*);
 
+/* Start reading a DATADDS ahead of a matching oc_fetch */
+EXTERNL OCerror oc_prefetch(OClink, const char* constraint);
+
+/* Fetch a DATADDS holding a single atomic array and pass its values
+   on as they arrive, without building a tree */
+EXTERNL OCerror oc_stream_data(OClink, const char* constraint,
+			       OCtype etype, size_t nelems,
+			       OCstreamfcn, void* userdata);
+
+/* Fetch a DATADDS and pass the records of one of its top-level
+   sequences on in batches as they arrive, without building a tree */
+EXTERNL OCerror oc_stream_records(OClink, const char* constraint,
+				  const char* name, size_t batchsize,
+				  OCrecordfcn, void* userdata);
+
+/* Response body bytes fetched through this link so far, as sent by the
+   server (possibly compressed) and as decoded */
+EXTERNL OCerror oc_transfer_counts(OClink, unsigned long long* wirep,
+				   unsigned long long* decodedp);
+
 EXTERNL OCerror oc_root_free(OClink, OCddsnode root);
 EXTERNL const char* oc_tree_text(OClink, OCddsnode root);
 
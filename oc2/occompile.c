@@ -17,6 +17,7 @@
 
 /* Forward */
 static OCdata* newocdata(OCnode* pattern);
+static void* ocdataalloc(OCnode* pattern, size_t size);
 static size_t ocxdrsize(OCtype etype,int isscalar);
 static OCerror occompile1(OCstate*, OCnode*, XXDR*, OCdata**);
 static OCerror occompilerecord(OCstate*, OCnode*, XXDR*, OCdata**);
@@ -55,9 +56,19 @@ occompile(OCstate* state, OCnode* xroot)
     xxdrs = xtree->data.xdrs;
     if(xxdrs == NULL) return OCTHROW(OC_EXDR);
 
+    /* All of the data tree lives in one arena, freed with the tree */
+    xtree->data.arena = ocarena_new();
+    if(xtree->data.arena == NULL) return OCTHROW(OC_ENOMEM);
+
     ocstat = occompile1(state,xroot,xxdrs,&data);
     if(ocstat == OC_NOERR)
 	xtree->data.data = data;
+    else {
+	/* See if we can extract error info from the response */
+	ocerrorstring(xxdrs);
+	ocarena_free(xtree->data.arena);
+	xtree->data.arena = NULL;
+    }
 
 #ifdef OCDEBUG
 {
@@ -111,7 +122,7 @@ occompile1(OCstate* state, OCnode* xnode, XXDR* xxdrs, OCdata** datap)
    	        {ocstat=OCTHROW(OC_EINVALCOORDS); goto fail;}
 
 	    /* allocate space to capture all the element instances */
-	    data->instances = (OCdata**)malloc(nelements*sizeof(OCdata*));
+	    data->instances = (OCdata**)ocdataalloc(xnode,nelements*sizeof(OCdata*));
 	    MEMGOTO(data->instances,ocstat,fail);
 	    data->ninstances = 0;
 
@@ -167,8 +178,12 @@ occompile1(OCstate* state, OCnode* xnode, XXDR* xxdrs, OCdata** datap)
         OCASSERT(nelements == nclistlength(records));
 	/* extract the content */
 	data->ninstances = nelements;
-	data->instances = (OCdata**)nclistdup(records);
-	MEMGOTO(data,ocstat,fail);
+	if(nelements > 0) {
+	    data->instances = (OCdata**)ocdataalloc(xnode,nelements*sizeof(OCdata*));
+	    MEMGOTO(data->instances,ocstat,fail);
+	    for(i=0;i<nelements;i++)
+		data->instances[i] = (OCdata*)nclistget(records,i);
+	}
 	nclistfree(records);	    
 	records = NULL;
         break;
@@ -185,29 +200,12 @@ occompile1(OCstate* state, OCnode* xnode, XXDR* xxdrs, OCdata** datap)
     }
 
 /*ok:*/
-    if(datap) {
-	*datap = data;
-	data = NULL;
-    }
-
-    if(data != NULL)
-	ocdata_free(state,data);
-
+    if(datap) *datap = data;
     return OCTHROW(ocstat);    
 
 fail:
-    /* See if we can extract error info from the response */
-    ocerrorstring(xxdrs);
-
-    if(records != NULL) {
-	for(i=0;i<nclistlength(records);i++)
-	    ocdata_free(state,(OCdata*)nclistget(records,i));
-	nclistfree(records);
-    }
-
-    if(data != NULL)
-	ocdata_free(state,data);
-
+    /* The partial data tree is reclaimed with the arena */
+    nclistfree(records);
     return OCTHROW(ocstat);
 }
 
@@ -223,14 +221,8 @@ occompilerecord(OCstate* state, OCnode* xnode, XXDR* xxdrs, OCdata** recordp)
     record->xdroffset = xxdr_getpos(xxdrs);
     /* Compile the fields of this record */
     ocstat = OCTHROW(occompilefields(state,record,xxdrs,!TOPLEVEL));
-    if(ocstat == OC_NOERR) {
-        if(recordp) {
-	    *recordp = record;
-	    record = NULL;
-	}
-        if(record != NULL)
-	    ocdata_free(state,record);
-    }
+    if(ocstat == OC_NOERR && recordp)
+	*recordp = record;
     return OCTHROW(ocstat);    
 }
 
@@ -246,7 +238,7 @@ occompilefields(OCstate* state, OCdata* data, XXDR* xxdrs, int istoplevel)
     nelements = nclistlength(xnode->subnodes);
     if(nelements == 0)
 	goto done;
-    data->instances = (OCdata**)malloc(nelements*sizeof(OCdata*));
+    data->instances = (OCdata**)ocdataalloc(xnode,nelements*sizeof(OCdata*));
     MEMFAIL(data->instances);
     for(i=0;i<nelements;i++) {
         OCnode* fieldnode;
@@ -276,11 +268,7 @@ done:
     return OCTHROW(ocstat);
 
 fail:
-    if(data->instances != NULL) {
-	for(i=0;i<data->ninstances;i++)
-	    ocdata_free(state,data->instances[i]);
-	data->ninstances = 0;
-    }
+    data->ninstances = 0;
     return OCTHROW(ocstat);
 }
 
@@ -324,7 +312,8 @@ occompileatomic(OCstate* state, OCdata* data, XXDR* xxdrs)
     case OC_Int64: case OC_UInt64:
     case OC_Float32: case OC_Float64:
 	/* Skip the data */
-	xxdr_skip(xxdrs,data->ninstances*data->xdrsize);
+	if(!xxdr_skip(xxdrs,(off_t)data->ninstances*data->xdrsize))
+	    {ocstat = OC_EXDR; goto fail;}
 	break;
 
     /* Do the fixed sized, possibly packed cases */
@@ -335,14 +324,15 @@ occompileatomic(OCstate* state, OCdata* data, XXDR* xxdrs)
 	xdrsize = data->ninstances*data->xdrsize;
 	xdrsize = RNDUP(xdrsize);
 	/* Skip the data */
-	xxdr_skip(xxdrs,xdrsize);
+	if(!xxdr_skip(xxdrs,xdrsize)) {ocstat = OC_EXDR; goto fail;}
 	break;
 
     /* Hard case, because strings are variable length */
     case OC_String: case OC_URL:
 	/* Start by allocating a set of pointers for each string */
 	data->nstrings = xxdrcount;
-	data->strings = (off_t*)malloc(sizeof(off_t)*data->nstrings);
+	data->strings = (off_t*)ocdataalloc(xnode,sizeof(off_t)*data->nstrings);
+	if(data->strings == NULL) {ocstat = OC_ENOMEM; goto fail;}
 	/* We need to walk each string, get size, then skip */
         for(i=0;i<data->nstrings;i++) {
 	    unsigned int len;
@@ -353,7 +343,7 @@ occompileatomic(OCstate* state, OCdata* data, XXDR* xxdrs)
 	    lenz = (off_t)len;
 	    lenz = RNDUP(lenz);
 	    /* Skip the data */
-	    xxdr_skip(xxdrs,lenz);
+	    if(!xxdr_skip(xxdrs,lenz)) {ocstat = OC_EXDR; goto fail;}
         }
         break;
 
@@ -366,34 +356,78 @@ occompileatomic(OCstate* state, OCdata* data, XXDR* xxdrs)
     return OCTHROW(ocstat);
 
 fail:
-    if(data->strings != NULL)
-	free(data->strings);
     data->strings = NULL;
     data->ninstances = 0;
     return OCTHROW(ocstat);
 }
 
-void
-ocdata_free(OCstate* state, OCdata* data)
+/*
+The pieces of a DATADDS that is decoded as it arrives (see
+oc_stream_records): the top-level variables and the records of a
+top-level sequence are compiled one at a time from the current
+position of xxdrs into the arena of the tree, and the records handed
+out together get a sequence instance of their own. OC_EXDR means that
+xxdrs ended first; the caller then retries with more of the response.
+*/
+
+OCerror
+occompilevar(OCstate* state, OCnode* xnode, XXDR* xxdrs, OCdata** datap)
+{
+    return OCTHROW(occompile1(state,xnode,xxdrs,datap));
+}
+
+/* Compile the next record of a sequence, including its begin
+   marker; *recordp is set to NULL at the end marker */
+OCerror
+occompileseqrecord(OCstate* state, OCnode* xnode, XXDR* xxdrs, OCdata** recordp)
 {
-    if(data == NULL)
-	return;
-
-    if(data->instances != NULL) {
-	int i;
-        for(i=0;i<data->ninstances;i++)
-	    ocdata_free(state,data->instances[i]);
-	free(data->instances);
+    char tmp[sizeof(unsigned int)];
+
+    OCASSERT(xnode->octype == OC_Sequence);
+    *recordp = NULL;
+    if(!xxdr_opaque(xxdrs,tmp,(off_t)sizeof(tmp)))
+	return OC_EXDR;
+    if(tmp[0] == EndOfSequence)
+	return OC_NOERR;
+    if(tmp[0] != StartOfSequence) {
+	nclog(NCLOGERR,"missing/invalid begin/end record marker\n");
+	return OCTHROW(OC_EINVALCOORDS);
     }
-    if(data->strings != NULL)
-	free(data->strings);
-    free(data);
+    return OCTHROW(occompilerecord(state,xnode,xxdrs,recordp));
+}
+
+OCdata*
+occompilebatch(OCnode* xnode, OCdata** records, size_t nrecords)
+{
+    size_t i;
+    OCdata* data = newocdata(xnode);
+    MEMCHECK(data,NULL);
+    fset(data->datamode,OCDT_SEQUENCE);
+    if(nrecords > 0) {
+	data->instances = (OCdata**)ocdataalloc(xnode,nrecords*sizeof(OCdata*));
+	MEMCHECK(data->instances,NULL);
+    }
+    for(i=0;i<nrecords;i++) {
+	data->instances[i] = records[i];
+	records[i]->container = data;
+	records[i]->index = i;
+    }
+    data->ninstances = nrecords;
+    return data;
+}
+
+/* Allocate zeroed memory for the data tree of pattern's tree */
+static void*
+ocdataalloc(OCnode* pattern, size_t size)
+{
+    OCtree* tree = pattern->root->tree;
+    return ocarena_alloc(tree->data.arena,size);
 }
 
 static OCdata*
 newocdata(OCnode* pattern)
 {
-    OCdata* data = (OCdata*)calloc(1,sizeof(OCdata));
+    OCdata* data = (OCdata*)ocdataalloc(pattern,sizeof(OCdata));
     MEMCHECK(data,NULL);
     data->header.magic = OCMAGIC;
     data->header.occlass = OC_Data;
@@ -6,4 +6,9 @@
 
 extern OCerror occompile(OCstate* state, OCnode* xroot);
 
+/* Streamed DATADDS pieces */
+extern OCerror occompilevar(OCstate*, OCnode* xnode, XXDR*, OCdata**);
+extern OCerror occompileseqrecord(OCstate*, OCnode* xnode, XXDR*, OCdata**);
+extern OCdata* occompilebatch(OCnode* xnode, OCdata** records, size_t nrecords);
+
 #endif /*OCCOMPILE_H*/
@@ -28,8 +28,6 @@ struct OCdata {
 };
 
 
-extern void ocdata_free(OCstate*, OCdata*);
-
 extern OCerror ocdata_ithfield(OCstate*, OCdata* container, size_t index, OCdata** fieldp);
 extern OCerror ocdata_container(OCstate*, OCdata* data, OCdata** containerp);
 extern OCerror ocdata_root(OCstate*, OCdata* data, OCdata** rootp);
@@ -8,6 +8,7 @@
 #include "ocinternal.h"
 #include "ocdebug.h"
 #include "ochttp.h"
+#include "nccurlpool.h"
 
 static size_t WriteFileCallback(void*, size_t, size_t, void*);
 static size_t WriteMemoryCallback(void*, size_t, size_t, void*);
@@ -17,6 +18,22 @@ struct Fetchdata {
 	size_t size;
 };
 
+/* Counts what a stream writer is handed */
+struct Streamdata {
+	size_t (*writer)(void*,size_t,size_t,void*);
+	void* data;
+	off_t size;
+};
+
+static size_t
+WriteStreamCallback(void* ptr, size_t size, size_t nmemb, void* data)
+{
+    struct Streamdata* sd = (struct Streamdata*)data;
+    size_t n = sd->writer(ptr,size,nmemb,sd->data);
+    sd->size += (off_t)n;
+    return n;
+}
+
 long
 ocfetchhttpcode(CURL* curl)
 {
@@ -28,6 +45,24 @@ ocfetchhttpcode(CURL* curl)
     return httpcode;
 }
 
+/* Number of body bytes of the last response as they came over the
+   wire, i.e. before curl undid any Content-Encoding; compare with the
+   decoded size to see what compression saved. */
+off_t
+ocfetchwiresize(CURL* curl)
+{
+    CURLcode cstat = CURLE_OK;
+#if LIBCURL_VERSION_NUM >= 0x073700
+    curl_off_t size = 0;
+    cstat = curl_easy_getinfo(curl,CURLINFO_SIZE_DOWNLOAD_T,&size);
+#else
+    double size = 0;
+    cstat = curl_easy_getinfo(curl,CURLINFO_SIZE_DOWNLOAD,&size);
+#endif
+    if(cstat != CURLE_OK || size < 0) return 0;
+    return (off_t)size;
+}
+
 OCerror
 ocfetchurl_file(CURL* curl, const char* url, FILE* stream,
 		off_t* sizep, long* filetime)
@@ -82,6 +117,68 @@ fail:
 	return OCTHROW(OC_ECURL);
 }
 
+/* Like ocfetchurl, but hand the response to a writer as it arrives;
+   the writer stops the transfer by returning less than it was given.
+   The number of bytes the writer accepted goes in *sizep. */
+OCerror
+ocfetchurl_stream(CURL* curl, const char* url,
+		  size_t (*writer)(void*,size_t,size_t,void*),
+		  void* data, off_t* sizep, long* filetime)
+{
+	OCerror stat = OC_NOERR;
+	CURLcode cstat = CURLE_OK;
+        long httpcode = 0;
+	struct Streamdata streamdata;
+
+	streamdata.writer = writer;
+	streamdata.data = data;
+	streamdata.size = 0;
+	if(sizep != NULL) *sizep = 0;
+
+	/* Set the URL */
+	cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_URL, (void*)url));
+	if (cstat != CURLE_OK)
+		goto fail;
+
+	/* send all data to this function  */
+	cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteStreamCallback));
+	if (cstat != CURLE_OK)
+		goto fail;
+
+	cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)&streamdata));
+	if (cstat != CURLE_OK)
+		goto fail;
+
+        /* One last thing; always try to get the last modified time */
+	cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_FILETIME, (long)1));
+
+	cstat = CURLERR(curl_easy_perform(curl));
+        httpcode = ocfetchhttpcode(curl);
+	if(sizep != NULL) *sizep = streamdata.size;
+	if(cstat == CURLE_WRITE_ERROR)
+	    return OCTHROW(OC_EDATADDS); /* the writer gave up */
+	if(cstat != CURLE_OK) goto fail;
+
+        /* Get the last modified time */
+	if(filetime != NULL)
+            cstat = CURLERR(curl_easy_getinfo(curl,CURLINFO_FILETIME,filetime));
+        if(cstat != CURLE_OK) goto fail;
+
+	return OCTHROW(stat);
+
+fail:
+	nclog(NCLOGERR, "curl error: %s", curl_easy_strerror(cstat));
+	switch (httpcode) {
+	case 400: stat = OC_EBADURL; break;
+	case 401: stat = OC_EAUTH; break;
+	case 404: stat = OC_ENOFILE; break;
+	case 500: stat = OC_EDAPSVC; break;
+	case 200: break;
+	default: stat = OC_ECURL; break;
+	}
+	return OCTHROW(stat);
+}
+
 OCerror
 ocfetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime)
 {
@@ -240,8 +337,8 @@ occurlopen(CURL** curlp)
 	int stat = OC_NOERR;
 	CURLcode cstat = CURLE_OK;
 	CURL* curl;
-	/* initialize curl*/
-	curl = curl_easy_init();
+	/* get a curl handle from the shared pool */
+	curl = NC_curl_acquire();
 	if (curl == NULL)
 		stat = OC_ECURL;
 	else {
@@ -257,8 +354,7 @@ occurlopen(CURL** curlp)
 void
 occurlclose(CURL* curl)
 {
-	if (curl != NULL)
-		curl_easy_cleanup(curl);
+	NC_curl_release(curl);
 }
 
 OCerror
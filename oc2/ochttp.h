@@ -9,8 +9,12 @@ extern void curlclose(CURL*);
 
 extern OCerror ocfetchurl(CURL*, const char*, NCbytes*, long*);
 extern OCerror ocfetchurl_file(CURL*, const char*, FILE*, off_t*, long*);
+extern OCerror ocfetchurl_stream(CURL*, const char*,
+			size_t (*writer)(void*,size_t,size_t,void*),
+			void* data, off_t*, long*);
 
 extern long ocfetchhttpcode(CURL* curl);
+extern off_t ocfetchwiresize(CURL* curl);
 
 extern OCerror ocfetchlastmodified(CURL* curl, char* url, long* filetime);
 
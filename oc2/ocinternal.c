@@ -366,6 +366,7 @@ occlose(OCstate* state)
 	ocroot_free(root);
     }
     nclistfree(state->trees);
+    ocprefetchclear(state);
     ncurifree(state->uri);
     ncbytesfree(state->packet);
     ocfree(state->error.code);
@@ -183,6 +183,20 @@ struct OCstate {
 	long idle; /* KEEPIDLE value */
 	long interval; /* KEEPINTVL value */
     } curlkeepalive; /* keepalive info */
+    struct {/* response body bytes fetched so far; see oc_transfer_counts */
+	unsigned long long wire; /* as sent, possibly compressed */
+	unsigned long long decoded; /* as handed to the readers */
+    } transfer;
+    struct OCprefetch {/* DATADDS being read ahead; see oc_prefetch */
+	char* constraint; /* NULL => none pending */
+	char* url;
+	CURL* curl; /* duplicate of state->curl */
+	NCbytes* packet;
+	long lastmodified;
+	int stat;
+	char curlerrorbuf[CURL_ERROR_SIZE];
+	struct NCbgtask* task;
+    } prefetch;
 };
 
 /*! OCtree holds extra state info about trees */
@@ -205,6 +219,7 @@ typedef struct OCtree
         off_t   ddslen;   /* length of ddslen (assert(ddslen <= bod)) */
         XXDR*   xdrs;		/* access either memory or file */
         OCdata* data;
+        struct OCarena* arena; /* holds data and everything under it */
     } data;
 } OCtree;
 
@@ -5,7 +5,19 @@
 #include "ocinternal.h"
 #include "occompile.h"
 #include "ocdebug.h"
-
+#include "nchashmap.h"
+
+/* Index of a list of nodes by name or full name: all the nodes with
+   a given name can be visited in list order without a linear search */
+#define OCNOINDEX ((size_t)-1)
+typedef struct OCnameindex {
+    NC_hashmap* first; /* name => index of first node with that name */
+    size_t* next; /* index => index of next node with same name */
+} OCnameindex;
+
+static OCerror ocnameindex(OCnameindex*, NClist* nodes, int fullname);
+static size_t ocnamefirst(OCnameindex*, const char* name);
+static void ocnameindexfree(OCnameindex*);
 static OCerror mergedas1(OCnode* dds, OCnode* das);
 static OCerror mergedods1(OCnode* dds, OCnode* das);
 static OCerror mergeother1(OCnode* root, OCnode* das);
@@ -157,10 +169,6 @@ ocroot_free(OCnode* root)
     tree = root->tree;
     state = tree->state;
 
-    /* Free up the OCDATA instance, if any */
-    if(tree->data.data != NULL)
-	ocdata_free(state,tree->data.data);
-
     for(i=0;i<nclistlength(state->trees);i++) {
 	OCnode* node = (OCnode*)nclistget(state->trees,(size_t)i);
 	if(root == node)
@@ -177,6 +185,8 @@ octree_free(OCtree* tree)
     ocnodes_free(tree->nodes);
     ocfree(tree->constraint);
     ocfree(tree->text);
+    /* Free up the OCDATA instances, if any */
+    ocarena_free(tree->data.arena);
     if(tree->data.xdrs != NULL) {
         xxdr_free(tree->data.xdrs);
     }
@@ -250,6 +260,9 @@ ocddsdasmerge(OCstate* state, OCnode* dasroot, OCnode* ddsroot)
     NClist* dasnodes = nclistnew();
     NClist* varnodes = nclistnew();
     NClist* ddsnodes;
+    NC_hashmap* dasnames = NULL;
+    OCnameindex byfullname = {NULL,NULL};
+    OCnameindex byname = {NULL,NULL};
     unsigned int i,j;
 
     if(dasroot->tree == NULL || dasroot->tree->dxdclass != OCDAS)
@@ -266,6 +279,7 @@ ocddsdasmerge(OCstate* state, OCnode* dasroot, OCnode* ddsroot)
           Simultaneously look for potential ambiguities
           if found; complain but continue: result are indeterminate.
           also collect globals separately*/
+    dasnames = NC_hashmapnew(0);
     for(i=0;i<nclistlength(dasroot->tree->nodes);i++) {
 	OCnode* das = (OCnode*)nclistget(dasroot->tree->nodes,i);
 	int hasattributes = 0;
@@ -284,13 +298,11 @@ ocddsdasmerge(OCstate* state, OCnode* dasroot, OCnode* ddsroot)
 	}
 	if(hasattributes) {
 	    /* Look for previously collected nodes with same name*/
-            for(j=0;j<nclistlength(dasnodes);j++) {
-	        OCnode* das2 = (OCnode*)nclistget(dasnodes,j);
-		if(das->name == NULL || das2->name == NULL) continue;
-		if(strcmp(das->name,das2->name)==0) {
-		    nclog(NCLOGWARN,"oc_mergedas: potentially ambiguous DAS name: %s",das->name);
-		}
-	    }
+	    size_t namelen = strlen(das->name)+1;
+	    if(NC_hashmapget(dasnames,das->name,namelen,NULL))
+		nclog(NCLOGWARN,"oc_mergedas: potentially ambiguous DAS name: %s",das->name);
+	    else
+		NC_hashmapadd(dasnames,(uintptr_t)das,das->name,namelen);
 	    nclistpush(dasnodes,(void*)das);
 	}
     }
@@ -300,6 +312,8 @@ ocddsdasmerge(OCstate* state, OCnode* dasroot, OCnode* ddsroot)
 	OCnode* dds = (OCnode*)nclistget(ddsnodes,i);
 	if(dds->octype == OC_Atomic) nclistpush(varnodes,(void*)dds);
     }
+    if((stat = ocnameindex(&byfullname,varnodes,1))) goto done;
+    if((stat = ocnameindex(&byname,varnodes,0))) goto done;
 
     /* 3. For each das node, locate matching DDS node(s) and attach
           attributes to the DDS node(s).
@@ -307,18 +321,27 @@ ocddsdasmerge(OCstate* state, OCnode* dasroot, OCnode* ddsroot)
           1. DAS->fullname :: DDS->fullname
           2. DAS->name :: DDS->fullname (support DAS names with embedded '.')
           3. DAS->name :: DDS->name
+          The three candidate chains are walked together so that
+          matches are merged in DDS order, each just once.
     */
     for(i=0;i<nclistlength(dasnodes);i++) {
 	OCnode* das = (OCnode*)nclistget(dasnodes,i);
-        for(j=0;j<nclistlength(varnodes);j++) {
-	    OCnode* dds = (OCnode*)nclistget(varnodes,j);
-	    if(strcmp(das->fullname,dds->fullname)==0
-	       || strcmp(das->name,dds->fullname)==0
-	       || strcmp(das->name,dds->name)==0) {
-		mergedas1(dds,das);
-		/* remove from dasnodes list*/
-		nclistset(dasnodes,i,(void*)NULL);
-	    }
+	size_t j1 = ocnamefirst(&byfullname,das->fullname);
+	size_t j2 = ocnamefirst(&byfullname,das->name);
+	size_t j3 = ocnamefirst(&byname,das->name);
+	for(;;) {
+	    size_t k = j1;
+	    OCnode* dds;
+	    if(j2 < k) k = j2;
+	    if(j3 < k) k = j3;
+	    if(k == OCNOINDEX) break;
+	    dds = (OCnode*)nclistget(varnodes,k);
+	    mergedas1(dds,das);
+	    /* remove from dasnodes list*/
+	    nclistset(dasnodes,i,(void*)NULL);
+	    if(j1 == k) j1 = byfullname.next[j1];
+	    if(j2 == k) j2 = byfullname.next[j2];
+	    if(j3 == k) j3 = byname.next[j3];
 	}
     }
 
@@ -349,9 +372,54 @@ done:
     nclistfree(dodsglobals);
     nclistfree(dasnodes);
     nclistfree(varnodes);
+    if(dasnames != NULL) NC_hashmapfree(dasnames);
+    ocnameindexfree(&byfullname);
+    ocnameindexfree(&byname);
     return OCTHROW(stat);
 }
 
+/* Build the chains in reverse so that each one is in list order */
+static OCerror
+ocnameindex(OCnameindex* index, NClist* nodes, int fullname)
+{
+    size_t i, len = nclistlength(nodes);
+    index->first = NC_hashmapnew(len);
+    index->next = (size_t*)malloc(sizeof(size_t)*(len+1));
+    if(index->first == NULL || index->next == NULL)
+	return OCTHROW(OC_ENOMEM);
+    for(i=len;i-- > 0;) {
+	OCnode* node = (OCnode*)nclistget(nodes,i);
+	const char* name = (fullname ? node->fullname : node->name);
+	uintptr_t head;
+	size_t namelen;
+	index->next[i] = OCNOINDEX;
+	if(name == NULL) continue;
+	namelen = strlen(name)+1;
+	if(NC_hashmapget(index->first,name,namelen,&head)) {
+	    index->next[i] = (size_t)head;
+	    NC_hashmapsetdata(index->first,name,namelen,(uintptr_t)i);
+	} else
+	    NC_hashmapadd(index->first,(uintptr_t)i,name,namelen);
+    }
+    return OC_NOERR;
+}
+
+static size_t
+ocnamefirst(OCnameindex* index, const char* name)
+{
+    uintptr_t head;
+    if(name == NULL || !NC_hashmapget(index->first,name,strlen(name)+1,&head))
+	return OCNOINDEX;
+    return (size_t)head;
+}
+
+static void
+ocnameindexfree(OCnameindex* index)
+{
+    if(index->first != NULL) NC_hashmapfree(index->first);
+    nullfree(index->next);
+}
+
 static OCerror
 mergedas1(OCnode* dds, OCnode* das)
 {
@@ -23,12 +23,17 @@
 #include "ochttp.h"
 #include "ocread.h"
 #include "occurlfunctions.h"
+#include "dapparselex.h"
+#include "ncthreads.h"
+#include "nccurlpool.h"
 #include "ncwinpath.h"
 
 /*Forward*/
 static int readpacket(OCstate* state, NCURI*, NCbytes*, OCdxd, long*);
 static int readfile(const char* path, const char* suffix, NCbytes* packet);
 static int readfiletofile(const char* path, const char* suffix, FILE* stream, off_t*);
+static void octransfer(OCstate* state, CURL* curl, size_t decoded);
+static OCerror streamfile(NCURI* url, size_t (*writer)(void*,size_t,size_t,void*), void* data);
 
 int
 readDDS(OCstate* state, OCtree* tree)
@@ -90,6 +95,7 @@ readpacket(OCstate* state, NCURI* url,NCbytes* packet,OCdxd dxd,long* lastmodifi
    const char* suffix = ocdxdextension(dxd);
    char* fetchurl = NULL;
    CURL* curl = state->curl;
+   size_t len0 = ncbyteslength(packet);
 
    fileprotocol = (strcmp(url->protocol,"file")==0);
 
@@ -106,6 +112,7 @@ readpacket(OCstate* state, NCURI* url,NCbytes* packet,OCdxd dxd,long* lastmodifi
 	if(ocdebug > 0)
             {fprintf(stderr,"fetch url=%s\n",fetchurl); fflush(stderr);}
         stat = ocfetchurl(curl,fetchurl,packet,lastmodified);
+	octransfer(state,curl,ncbyteslength(packet)-len0);
 	if(stat)
 	    oc_curl_printerror(state);
 	if(ocdebug > 0)
@@ -121,6 +128,109 @@ fprintf(stderr,"readpacket: packet.size=%lu\n",
     return OCTHROW(stat);
 }
 
+/* Run in the background by ocprefetch */
+static int
+prefetchtask(void* arg, size_t unused)
+{
+    struct OCprefetch* pf = (struct OCprefetch*)arg;
+    pf->stat = ocfetchurl(pf->curl,pf->url,pf->packet,&pf->lastmodified);
+    return pf->stat;
+}
+
+/* Wait for any read ahead and forget it */
+void
+ocprefetchclear(OCstate* state)
+{
+    struct OCprefetch* pf = &state->prefetch;
+    if(pf->task != NULL) {
+	(void)NC_join_task(pf->task);
+	pf->task = NULL;
+	octransfer(state,pf->curl,ncbyteslength(pf->packet));
+    }
+    if(pf->curl != NULL) occurlclose(pf->curl);
+    pf->curl = NULL;
+    ncbytesfree(pf->packet);
+    pf->packet = NULL;
+    ocfree(pf->constraint);
+    pf->constraint = NULL;
+    ocfree(pf->url);
+    pf->url = NULL;
+}
+
+/*
+Start reading the DATADDS for a constraint on a duplicate curl
+handle while the caller goes on with other work; a later readDATADDS
+with the same constraint takes the response instead of asking the
+server again. Any earlier read ahead is dropped. This is a no-op for
+file:// urls and when threads are not available.
+*/
+int
+ocprefetch(OCstate* state, const char* constraint)
+{
+    int stat = OC_NOERR;
+    struct OCprefetch* pf = &state->prefetch;
+
+    ocprefetchclear(state);
+    if(constraint == NULL || !NC_threads_available()
+       || strcmp(state->uri->protocol,"file")==0)
+	return OC_NOERR;
+    if((pf->curl = NC_curl_duplicate(state->curl)) == NULL)
+	return OC_NOERR; /* just don't read ahead */
+    curl_easy_setopt(pf->curl,CURLOPT_ERRORBUFFER,pf->curlerrorbuf);
+    ncurisetquery(state->uri,constraint);
+    pf->url = ncuribuild(state->uri,NULL,ocdxdextension(OCDATADDS),
+			 NCURIBASE|NCURIQUERY|NCURIENCODE);
+    pf->constraint = nulldup(constraint);
+    pf->packet = ncbytesnew();
+    pf->lastmodified = -1;
+    if(pf->url == NULL || pf->constraint == NULL || pf->packet == NULL)
+	{stat = OC_ENOMEM; goto fail;}
+    if(ocdebug > 0)
+        {fprintf(stderr,"prefetch url=%s\n",pf->url); fflush(stderr);}
+    if(NC_start_task(prefetchtask,pf,&pf->task) != NC_NOERR)
+	{stat = OC_ENOMEM; goto fail;}
+    return OC_NOERR;
+
+fail:
+    ocprefetchclear(state);
+    return OCTHROW(stat);
+}
+
+/*
+If the pending read ahead was for this constraint and succeeded, move
+its response into the packet or file and return 1; otherwise drop it
+and return 0 so the caller reads as usual.
+*/
+static int
+takeprefetch(OCstate* state, const char* constraint, NCbytes* packet,
+	     FILE* file, off_t* sizep, long* lastmodp)
+{
+    struct OCprefetch* pf = &state->prefetch;
+    int taken = 0;
+    size_t len;
+
+    if(pf->constraint == NULL) return 0;
+    (void)NC_join_task(pf->task);
+    pf->task = NULL;
+    if(pf->stat == OC_NOERR && constraint != NULL && strcmp(pf->constraint,constraint)==0) {
+	len = ncbyteslength(pf->packet);
+	if(file == NULL) {
+	    ncbytesappendn(packet,ncbytescontents(pf->packet),len);
+	    ncbytesnull(packet);
+	    taken = 1;
+	} else {
+	    fseek(file,0,SEEK_SET);
+	    taken = (fwrite(ncbytescontents(pf->packet),1,len,file) == len);
+	}
+	if(taken) {
+	    if(sizep) *sizep = (off_t)len;
+	    if(lastmodp) *lastmodp = pf->lastmodified;
+	}
+    }
+    ocprefetchclear(state);
+    return taken;
+}
+
 int
 readDATADDS(OCstate* state, OCtree* tree, OCflags flags)
 {
@@ -131,10 +241,14 @@ readDATADDS(OCstate* state, OCtree* tree, OCflags flags)
 fprintf(stderr,"readDATADDS:\n");
 #endif
     if((flags & OCONDISK) == 0) {
-        ncurisetquery(state->uri,tree->constraint);
-        stat = readpacket(state,state->uri,state->packet,OCDATADDS,&lastmod);
-        if(stat == OC_NOERR)
+	if(takeprefetch(state,tree->constraint,state->packet,NULL,NULL,&lastmod)) {
             state->datalastmodified = lastmod;
+	} else {
+            ncurisetquery(state->uri,tree->constraint);
+            stat = readpacket(state,state->uri,state->packet,OCDATADDS,&lastmod);
+            if(stat == OC_NOERR)
+                state->datalastmodified = lastmod;
+	}
         tree->data.datasize = ncbyteslength(state->packet);
     } else { /*((flags & OCONDISK) != 0) */
         NCURI* url = state->uri;
@@ -143,7 +257,10 @@ fprintf(stderr,"readDATADDS:\n");
 
         fileprotocol = (strcmp(url->protocol,"file")==0);
 
-        if(fileprotocol) {
+        if(takeprefetch(state,tree->constraint,NULL,tree->data.file,
+			&tree->data.datasize,&lastmod)) {
+            state->datalastmodified = lastmod;
+        } else if(fileprotocol) {
             readurl = ncuribuild(url,NULL,NULL,NCURIBASE);
             stat = readfiletofile(readurl, ".dods", tree->data.file, &tree->data.datasize);
         } else {
@@ -157,6 +274,7 @@ fprintf(stderr,"readDATADDS:\n");
                 {fprintf(stderr, "fetch url=%s\n", readurl);fflush(stderr);}
             stat = ocfetchurl_file(state->curl, readurl, tree->data.file,
                                    &tree->data.datasize, &lastmod);
+            octransfer(state,state->curl,(size_t)tree->data.datasize);
             if(stat == OC_NOERR)
                 state->datalastmodified = lastmod;
             if (ocdebug > 0) 
@@ -167,6 +285,591 @@ fprintf(stderr,"readDATADDS:\n");
     return OCTHROW(stat);
 }
 
+/**************************************************/
+/* Streaming DATADDS decoding (see oc_stream_data) */
+
+/* Size of the window of decoded values handed to the callback */
+#define OCSTREAMWINDOW 0x10000
+/* Give up if this much arrives without the "Data:" mark */
+#define OCSTREAMMAXDDS 0x100000
+
+typedef struct OCstream {
+    OCstate* state;
+    OCtype etype;
+    size_t nelems;
+    OCstreamfcn fcn;
+    void* userdata;
+    enum {OCS_DDS, OCS_COUNTS, OCS_VALUES, OCS_DONE} phase;
+    OCerror stat;
+    NCbytes* dds; /* the response up to the "Data:" mark */
+    size_t xdrsize; /* of one value */
+    size_t memsize; /* of one decoded value */
+    unsigned char carry[8]; /* an item split between two writes */
+    size_t ncarry;
+    size_t next; /* index of the next value to decode */
+    size_t nwindow; /* # decoded values waiting in window */
+    char* window;
+} OCstream;
+
+/* Check the DDS part of the response against what was asked for */
+static OCerror
+streamcheckdds(OCstream* st, size_t ddslen)
+{
+    OCerror stat = OC_NOERR;
+    OCtree* tree = NULL;
+    OCnode* var;
+    size_t i, nelems;
+
+    tree = (OCtree*)ocmalloc(sizeof(OCtree));
+    MEMCHECK(tree,OC_ENOMEM);
+    memset((void*)tree,0,sizeof(OCtree));
+    tree->dxdclass = OCDATADDS;
+    tree->state = st->state;
+    tree->text = ocstrndup(ncbytescontents(st->dds),ddslen);
+    if(tree->text == NULL) {stat = OC_ENOMEM; goto done;}
+    stat = DAPparse(st->state,tree,tree->text);
+    if(stat != OC_NOERR) goto done;
+    if(tree->root == NULL || nclistlength(tree->root->subnodes) != 1)
+	{stat = OC_EDATADDS; goto done;}
+    var = (OCnode*)nclistget(tree->root->subnodes,0);
+    if(var->octype != OC_Atomic || var->etype != st->etype
+       || var->array.rank == 0)
+	{stat = OC_EDATADDS; goto done;}
+    for(nelems=1,i=0;i<var->array.rank;i++) {
+	OCnode* dim = (OCnode*)nclistget(var->array.dimensions,i);
+	nelems *= dim->dim.declsize;
+    }
+    if(nelems != st->nelems) stat = OC_EINVALCOORDS;
+done:
+    if(tree->root != NULL)
+	ocroot_free(tree->root);
+    else
+	octree_free(tree);
+    return OCTHROW(stat);
+}
+
+/* Hand the decoded values to the callback */
+static OCerror
+streamflush(OCstream* st)
+{
+    OCerror stat = OC_NOERR;
+    if(st->nwindow > 0) {
+	stat = st->fcn(st->userdata,st->window,st->next - st->nwindow,st->nwindow);
+	st->nwindow = 0;
+    }
+    return stat;
+}
+
+/* Decode n whole values from xdr into the window */
+static void
+streamdecode(OCstream* st, const unsigned char* xdr, size_t n)
+{
+    size_t i;
+    char* mem = st->window + st->nwindow*st->memsize;
+
+    switch (st->etype) {
+    case OC_Int32: case OC_UInt32: case OC_Float32:
+	memcpy(mem,xdr,n*XDRUNIT);
+	if(!xxdr_network_order) {
+	    unsigned int* p = (unsigned int*)mem;
+	    for(i=0;i<n;i++,p++) swapinline32(p);
+	}
+	break;
+    case OC_Int64: case OC_UInt64:
+	memcpy(mem,xdr,n*2*XDRUNIT);
+	if(!xxdr_network_order) {
+	    unsigned long long* llp = (unsigned long long*)mem;
+	    for(i=0;i<n;i++,llp++) swapinline64(llp);
+	}
+	break;
+    case OC_Float64: {
+	double* dp = (double*)mem;
+	for(i=0;i<n;i++,dp++)
+	    xxdrntohdouble((char*)(xdr+i*2*XDRUNIT),dp);
+	} break;
+    case OC_Int16: case OC_UInt16: {
+	unsigned short* sp = (unsigned short*)mem;
+	for(i=0;i<n;i++,sp++) {
+	    unsigned int tmp;
+	    memcpy(&tmp,xdr+i*XDRUNIT,XDRUNIT);
+	    if(!xxdr_network_order)
+		swapinline32(&tmp);
+	    *sp = (unsigned short)tmp;
+	}
+	} break;
+    case OC_Byte: case OC_UByte: case OC_Char:
+	memcpy(mem,xdr,n); /* arrays of bytes are packed */
+	break;
+    default: OCPANIC("unexpected etype"); break;
+    }
+    st->nwindow += n;
+    st->next += n;
+}
+
+/* Consume len bytes of values; returns # of bytes used */
+static size_t
+streamvalues(OCstream* st, const unsigned char* p, size_t len)
+{
+    size_t used = 0;
+    size_t windowcap = OCSTREAMWINDOW / st->memsize;
+
+    /* Finish any value split over the previous write */
+    if(st->ncarry > 0) {
+	size_t need = st->xdrsize - st->ncarry;
+	if(need > len) need = len;
+	memcpy(st->carry+st->ncarry,p,need);
+	st->ncarry += need;
+	used += need;
+	if(st->ncarry < st->xdrsize) return used;
+	streamdecode(st,st->carry,1);
+	st->ncarry = 0;
+    }
+    while(st->next < st->nelems && len - used >= st->xdrsize) {
+	size_t n = (len - used) / st->xdrsize;
+	if(n > st->nelems - st->next) n = st->nelems - st->next;
+	if(n > windowcap - st->nwindow) n = windowcap - st->nwindow;
+	streamdecode(st,p+used,n);
+	used += n*st->xdrsize;
+	if(st->nwindow == windowcap
+	   && (st->stat = streamflush(st)) != OC_NOERR) return used;
+    }
+    if(st->next == st->nelems) {
+	st->stat = streamflush(st);
+	st->phase = OCS_DONE; /* ignore any padding */
+	return len;
+    }
+    /* Keep the start of a split value */
+    memcpy(st->carry,p+used,len-used);
+    st->ncarry = len-used;
+    return len;
+}
+
+/* The curl writer */
+static size_t
+streamwriter(void* ptr, size_t size, size_t nmemb, void* data)
+{
+    OCstream* st = (OCstream*)data;
+    const unsigned char* p = (const unsigned char*)ptr;
+    size_t len = size*nmemb;
+    size_t used = 0;
+
+    while(used < len && st->stat == OC_NOERR) {
+	switch (st->phase) {
+	case OCS_DDS: {
+	    size_t bod, ddslen, seen = ncbyteslength(st->dds);
+	    ncbytesappendn(st->dds,p+used,len-used);
+	    used = len;
+	    if(!ocfindbod(st->dds,&bod,&ddslen)) {
+		if(ncbyteslength(st->dds) > OCSTREAMMAXDDS)
+		    st->stat = OC_EDATADDS;
+		break;
+	    }
+	    if((st->stat = streamcheckdds(st,ddslen)) != OC_NOERR) break;
+	    /* Go back over what followed the mark */
+	    used = bod - seen;
+	    st->phase = OCS_COUNTS;
+	    } break;
+	case OCS_COUNTS: { /* the element count, twice */
+	    unsigned int counts[2];
+	    size_t need = sizeof(counts) - st->ncarry;
+	    if(need > len - used) need = len - used;
+	    memcpy(st->carry+st->ncarry,p+used,need);
+	    st->ncarry += need;
+	    used += need;
+	    if(st->ncarry < sizeof(counts)) break;
+	    memcpy(counts,st->carry,sizeof(counts));
+	    if(!xxdr_network_order) {
+		swapinline32(&counts[0]);
+		swapinline32(&counts[1]);
+	    }
+	    st->ncarry = 0;
+	    if(counts[0] != st->nelems || counts[1] != st->nelems)
+		{st->stat = OC_EINVALCOORDS; break;}
+	    st->phase = OCS_VALUES;
+	    } break;
+	case OCS_VALUES:
+	    used += streamvalues(st,p+used,len-used);
+	    break;
+	case OCS_DONE:
+	    used = len;
+	    break;
+	}
+    }
+    return (st->stat == OC_NOERR ? len : 0);
+}
+
+int
+readDATADDSstream(OCstate* state, const char* constraint, OCtype etype,
+		  size_t nelems, OCstreamfcn fcn, void* userdata)
+{
+    int stat = OC_NOERR;
+    OCstream st;
+    char* readurl = NULL;
+    long lastmod = -1;
+    off_t received = 0;
+
+    memset((void*)&st,0,sizeof(st));
+    st.state = state;
+    st.etype = etype;
+    st.nelems = nelems;
+    st.fcn = fcn;
+    st.userdata = userdata;
+    st.phase = OCS_DDS;
+    st.memsize = octypesize(etype);
+    switch (etype) {
+    case OC_Byte: case OC_UByte: case OC_Char: st.xdrsize = 1; break;
+    case OC_Int64: case OC_UInt64: case OC_Float64: st.xdrsize = 2*XDRUNIT; break;
+    default: st.xdrsize = XDRUNIT; break;
+    }
+    st.dds = ncbytesnew();
+    st.window = (char*)malloc(OCSTREAMWINDOW);
+    if(st.dds == NULL || st.window == NULL) {stat = OC_ENOMEM; goto done;}
+
+    ocprefetchclear(state); /* any read ahead is for something else */
+    if(strcmp(state->uri->protocol,"file")==0) {
+	stat = streamfile(state->uri,streamwriter,&st);
+    } else {
+	ncurisetquery(state->uri,constraint);
+	readurl = ncuribuild(state->uri,NULL,ocdxdextension(OCDATADDS),
+			     NCURIBASE|NCURIQUERY|NCURIENCODE);
+	if(readurl == NULL) {stat = OC_ENOMEM; goto done;}
+	if(ocdebug > 0)
+	    {fprintf(stderr,"stream url=%s\n",readurl); fflush(stderr);}
+	stat = ocfetchurl_stream(state->curl,readurl,streamwriter,&st,&received,&lastmod);
+	octransfer(state,state->curl,(size_t)received);
+	state->error.httpcode = ocfetchhttpcode(state->curl);
+    }
+    if(st.stat != OC_NOERR)
+	stat = st.stat;
+    else if(stat == OC_NOERR && st.phase == OCS_DDS) {
+	/* No data mark: this should be an Error {...} from the server */
+	ncbytesnull(st.dds);
+	stat = streamcheckdds(&st,ncbyteslength(st.dds));
+	if(stat == OC_NOERR) stat = OC_EDATADDS;
+    } else if(stat == OC_NOERR && st.phase != OCS_DONE) {
+	nclog(NCLOGERR,"DAP DATADDS packet is apparently too short");
+	stat = OC_EDATADDS;
+    }
+    if(stat == OC_NOERR)
+	state->datalastmodified = lastmod;
+    else if(stat == OC_EDAPSVC && state->error.code != NULL)
+	nclog(NCLOGERR,"oc_open: server error retrieving url: code=%s message=\"%s\"",
+	      state->error.code,
+	      (state->error.message?state->error.message:""));
+done:
+    ocfree(readurl);
+    ncbytesfree(st.dds);
+    ocfree(st.window);
+    return OCTHROW(stat);
+}
+
+/* Size of the pieces in which file:// urls are read */
+#define OCSTREAMPIECE 0x4000
+
+/* Feed the .dods file of a file:// url through a stream writer, in
+   pieces, as curl would feed a response; the constraint is ignored */
+static OCerror
+streamfile(NCURI* url, size_t (*writer)(void*,size_t,size_t,void*), void* data)
+{
+    OCerror stat = OC_NOERR;
+    char* readurl = NULL;
+    const char* path;
+    char filename[1024];
+    char* piece = NULL;
+    FILE* stream = NULL;
+    size_t count;
+
+    readurl = ncuribuild(url,NULL,NULL,NCURIBASE);
+    piece = (char*)malloc(OCSTREAMPIECE);
+    if(readurl == NULL || piece == NULL) {stat = OC_ENOMEM; goto done;}
+    path = readurl;
+    if(ocstrncmp(path,"file://",7)==0) path += 7; /* assume absolute path*/
+    if(!occopycat(filename,sizeof(filename),2,path,".dods"))
+	{stat = OC_EOVERRUN; goto done;}
+    if((stream = NCfopen(filename,"rb")) == NULL) {stat = OC_EOPEN; goto done;}
+    while((count = fread(piece,1,OCSTREAMPIECE,stream)) > 0) {
+	if(writer(piece,1,count,data) != count) break;
+    }
+    if(ferror(stream)) stat = OC_EIO;
+done:
+    if(stream != NULL) fclose(stream);
+    ocfree(piece);
+    ocfree(readurl);
+    return OCTHROW(stat);
+}
+
+/**************************************************/
+/* Streaming sequence records (see oc_stream_records) */
+
+/* Default number of records handed over at a time */
+#define OCRECORDBATCH 1000
+
+typedef struct OCrecstream {
+    OCstate* state;
+    const char* name; /* of the sequence; NULL => the first one */
+    size_t batchsize;
+    OCrecordfcn fcn;
+    void* userdata;
+    enum {OCR_DDS, OCR_VARS, OCR_RECORDS, OCR_DONE} phase;
+    OCerror stat;
+    NCbytes* dds; /* the response up to the "Data:" mark */
+    OCtree* tree; /* of the DDS; its arena holds the variables before seq */
+    OCnode* seq;
+    size_t nextvar; /* top-level variable being decoded in OCR_VARS */
+    char* buf; /* undecoded data, from the first record of the batch on */
+    size_t len;
+    size_t alloc;
+    size_t pos; /* of the first byte in buf not yet decoded */
+    OCarena* arena; /* holds the records of the batch */
+    OCdata** records; /* the batch */
+    size_t nrecords;
+    size_t next; /* index of the first record of the batch */
+} OCrecstream;
+
+/* Parse the DDS part of the response and find the sequence */
+static OCerror
+recstreamdds(OCrecstream* st, size_t ddslen)
+{
+    OCerror stat = OC_NOERR;
+    OCtree* tree = NULL;
+    size_t i;
+
+    tree = (OCtree*)ocmalloc(sizeof(OCtree));
+    MEMCHECK(tree,OC_ENOMEM);
+    memset((void*)tree,0,sizeof(OCtree));
+    tree->dxdclass = OCDATADDS;
+    tree->state = st->state;
+    tree->text = ocstrndup(ncbytescontents(st->dds),ddslen);
+    if(tree->text == NULL) {stat = OC_ENOMEM; goto fail;}
+    stat = DAPparse(st->state,tree,tree->text);
+    if(stat != OC_NOERR) goto fail;
+    if(tree->root == NULL || tree->root->octype != OC_Dataset)
+	{stat = OC_EDATADDS; goto fail;}
+    tree->root->tree = tree;
+    occomputesemantics(tree->nodes);
+    occomputefullnames(tree->root);
+    for(i=0;i<nclistlength(tree->root->subnodes);i++) {
+	OCnode* var = (OCnode*)nclistget(tree->root->subnodes,i);
+	if(var->octype == OC_Sequence
+	   && (st->name == NULL || strcmp(var->name,st->name)==0))
+	    {st->seq = var; break;}
+    }
+    if(st->seq == NULL) {stat = OC_EDATADDS; goto fail;}
+    tree->data.arena = ocarena_new();
+    if(tree->data.arena == NULL) {stat = OC_ENOMEM; goto fail;}
+    st->tree = tree;
+    return OC_NOERR;
+
+fail:
+    st->seq = NULL;
+    octree_free(tree);
+    return OCTHROW(stat);
+}
+
+/* Hand the batch to the callback and reclaim it */
+static OCerror
+recstreamflush(OCrecstream* st)
+{
+    OCerror stat = OC_NOERR;
+    OCtree* tree = st->tree;
+    OCarena* keep = tree->data.arena;
+    size_t n = st->nrecords;
+
+    if(n == 0) return OC_NOERR;
+    tree->data.arena = st->arena;
+    if(occompilebatch(st->seq,st->records,n) == NULL)
+	stat = OC_ENOMEM;
+    tree->data.arena = keep;
+    if(stat == OC_NOERR)
+	stat = st->fcn(st->userdata,(OCdatanode*)st->records,st->next,n);
+    st->next += n;
+    st->nrecords = 0;
+    ocarena_free(st->arena);
+    st->arena = NULL;
+    return stat;
+}
+
+/*
+Decode as much of buf as possible. Nothing decoded before pos is
+still referenced when no records are pending, and that part of buf
+is dropped then, so buf holds about one batch worth of data.
+*/
+static OCerror
+recstreamdecode(OCrecstream* st)
+{
+    OCerror stat = OC_NOERR;
+    OCtree* tree = st->tree;
+    OCarena* keep = tree->data.arena;
+    OCdata* data;
+
+    for(;;) {
+	if(st->nrecords == 0 && st->pos > 0) {
+	    st->len -= st->pos;
+	    memmove(st->buf,st->buf+st->pos,st->len);
+	    st->pos = 0;
+	    if(tree->data.xdrs != NULL) xxdr_free(tree->data.xdrs);
+	    tree->data.xdrs = NULL;
+	}
+	if(tree->data.xdrs == NULL) {
+	    tree->data.xdrs = xxdr_memcreate(st->buf,(off_t)st->len,0);
+	    if(tree->data.xdrs == NULL) {stat = OC_ENOMEM; break;}
+	}
+	if(st->phase == OCR_VARS) {
+	    OCnode* var = (OCnode*)nclistget(tree->root->subnodes,st->nextvar);
+	    if(var == st->seq) {st->phase = OCR_RECORDS; continue;}
+	    if(!xxdr_setpos(tree->data.xdrs,(off_t)st->pos)) break;
+	    stat = occompilevar(st->state,var,tree->data.xdrs,&data);
+	    if(stat != OC_NOERR) break;
+	    st->nextvar++;
+	} else if(st->phase == OCR_RECORDS) {
+	    if(st->arena == NULL && (st->arena = ocarena_new()) == NULL)
+		{stat = OC_ENOMEM; break;}
+	    if(!xxdr_setpos(tree->data.xdrs,(off_t)st->pos)) break;
+	    tree->data.arena = st->arena;
+	    stat = occompileseqrecord(st->state,st->seq,tree->data.xdrs,&data);
+	    tree->data.arena = keep;
+	    if(stat != OC_NOERR) break;
+	    if(data == NULL) { /* end of the sequence */
+		stat = recstreamflush(st);
+		st->phase = OCR_DONE; /* ignore the rest */
+		break;
+	    }
+	    st->records[st->nrecords++] = data;
+	} else
+	    break;
+	st->pos = (size_t)xxdr_getpos(tree->data.xdrs);
+	if(st->nrecords == st->batchsize
+	   && (stat = recstreamflush(st)) != OC_NOERR) break;
+    }
+    /* Running out of data means waiting for more */
+    if(stat == OC_EXDR) stat = OC_NOERR;
+    /* buf may move before the next call */
+    if(tree->data.xdrs != NULL) xxdr_free(tree->data.xdrs);
+    tree->data.xdrs = NULL;
+    return stat;
+}
+
+static OCerror
+recstreamappend(OCrecstream* st, const char* p, size_t len)
+{
+    if(st->len + len > st->alloc) {
+	size_t alloc = (st->alloc == 0 ? OCSTREAMPIECE : 2*st->alloc);
+	char* buf;
+	while(alloc < st->len + len) alloc *= 2;
+	if((buf = (char*)realloc(st->buf,alloc)) == NULL)
+	    return OC_ENOMEM;
+	st->buf = buf;
+	st->alloc = alloc;
+    }
+    memcpy(st->buf+st->len,p,len);
+    st->len += len;
+    return recstreamdecode(st);
+}
+
+/* The curl writer */
+static size_t
+recstreamwriter(void* ptr, size_t size, size_t nmemb, void* data)
+{
+    OCrecstream* st = (OCrecstream*)data;
+    size_t len = size*nmemb;
+
+    if(st->stat != OC_NOERR) return 0;
+    switch (st->phase) {
+    case OCR_DDS: {
+	size_t bod, ddslen;
+	ncbytesappendn(st->dds,ptr,len);
+	if(!ocfindbod(st->dds,&bod,&ddslen)) {
+	    if(ncbyteslength(st->dds) > OCSTREAMMAXDDS)
+		st->stat = OC_EDATADDS;
+	    break;
+	}
+	if((st->stat = recstreamdds(st,ddslen)) != OC_NOERR) break;
+	st->phase = OCR_VARS;
+	/* Go on with what followed the mark */
+	st->stat = recstreamappend(st,ncbytescontents(st->dds)+bod,
+				   ncbyteslength(st->dds)-bod);
+	} break;
+    case OCR_VARS: case OCR_RECORDS:
+	st->stat = recstreamappend(st,(const char*)ptr,len);
+	break;
+    case OCR_DONE:
+	break;
+    }
+    return (st->stat == OC_NOERR ? len : 0);
+}
+
+int
+readDATADDSrecords(OCstate* state, const char* constraint, const char* name,
+		   size_t batchsize, OCrecordfcn fcn, void* userdata)
+{
+    int stat = OC_NOERR;
+    OCrecstream st;
+    char* readurl = NULL;
+    long lastmod = -1;
+    off_t received = 0;
+
+    memset((void*)&st,0,sizeof(st));
+    st.state = state;
+    st.name = name;
+    st.batchsize = (batchsize == 0 ? OCRECORDBATCH : batchsize);
+    st.fcn = fcn;
+    st.userdata = userdata;
+    st.phase = OCR_DDS;
+    st.dds = ncbytesnew();
+    st.records = (OCdata**)malloc(st.batchsize*sizeof(OCdata*));
+    if(st.dds == NULL || st.records == NULL) {stat = OC_ENOMEM; goto done;}
+
+    ocprefetchclear(state); /* any read ahead is for something else */
+    if(strcmp(state->uri->protocol,"file")==0) {
+	stat = streamfile(state->uri,recstreamwriter,&st);
+    } else {
+	ncurisetquery(state->uri,constraint);
+	readurl = ncuribuild(state->uri,NULL,ocdxdextension(OCDATADDS),
+			     NCURIBASE|NCURIQUERY|NCURIENCODE);
+	if(readurl == NULL) {stat = OC_ENOMEM; goto done;}
+	if(ocdebug > 0)
+	    {fprintf(stderr,"stream url=%s\n",readurl); fflush(stderr);}
+	stat = ocfetchurl_stream(state->curl,readurl,recstreamwriter,&st,&received,&lastmod);
+	octransfer(state,state->curl,(size_t)received);
+	state->error.httpcode = ocfetchhttpcode(state->curl);
+    }
+    if(st.stat != OC_NOERR)
+	stat = st.stat;
+    else if(stat == OC_NOERR && st.phase == OCR_DDS) {
+	/* No data mark: this should be an Error {...} from the server */
+	ncbytesnull(st.dds);
+	stat = recstreamdds(&st,ncbyteslength(st.dds));
+	if(stat == OC_NOERR) stat = OC_EDATADDS;
+    } else if(stat == OC_NOERR && st.phase != OCR_DONE) {
+	nclog(NCLOGERR,"DAP DATADDS packet is apparently too short");
+	stat = OC_EDATADDS;
+    }
+    if(stat == OC_NOERR)
+	state->datalastmodified = lastmod;
+    else if(stat == OC_EDAPSVC && state->error.code != NULL)
+	nclog(NCLOGERR,"oc_open: server error retrieving url: code=%s message=\"%s\"",
+	      state->error.code,
+	      (state->error.message?state->error.message:""));
+done:
+    ocfree(readurl);
+    ncbytesfree(st.dds);
+    ocfree(st.records);
+    ocfree(st.buf);
+    ocarena_free(st.arena);
+    octree_free(st.tree);
+    return OCTHROW(stat);
+}
+
+/* Account for a response fetched on curl, of which decoded bytes
+   reached the reader */
+static void
+octransfer(OCstate* state, CURL* curl, size_t decoded)
+{
+    if(curl == NULL) return;
+    state->transfer.wire += (unsigned long long)ocfetchwiresize(curl);
+    state->transfer.decoded += (unsigned long long)decoded;
+}
+
 static int
 readfiletofile(const char* path, const char* suffix, FILE* stream, off_t* sizep)
 {
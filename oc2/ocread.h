@@ -10,4 +10,11 @@ extern int readDAS(OCstate*, OCtree*);
 
 extern int readDATADDS(OCstate*, OCtree*, int inmemory);
 
+extern int ocprefetch(OCstate*, const char* constraint);
+extern int readDATADDSstream(OCstate*, const char* constraint, OCtype etype,
+			     size_t nelems, OCstreamfcn, void* userdata);
+extern int readDATADDSrecords(OCstate*, const char* constraint, const char* name,
+			      size_t batchsize, OCrecordfcn, void* userdata);
+extern void ocprefetchclear(OCstate*);
+
 #endif /*READ_H*/
@@ -133,25 +133,25 @@ freeOCnode(OCnode* cdf, int deep)
 int
 ocfindbod(NCbytes* buffer, size_t* bodp, size_t* ddslenp)
 {
-    unsigned int i;
-    char* content;
+    char* content = ncbytescontents(buffer);
     size_t len = ncbyteslength(buffer);
+    char* p = content;
+    char* end = content + len;
     const char** marks;
-    
-    content = ncbytescontents(buffer);
-
-    for(marks = DDSdatamarks;*marks;marks++) {
-	const char* mark = *marks;
-        size_t tlen = strlen(mark);
-        for(i=0;i<len;i++) {
-	    if((i+tlen) <= len 
-	        && (ocstrncmp(content+i,mark,tlen)==0)) {
-	       *ddslenp = i;
-	        i += tlen;
-	        *bodp = i;
+
+    /* Stop at the first mark of either kind, so that a large packet
+       is scanned once and only up to the end of the DDS */
+    while(p < end && (p = memchr(p,'D',(size_t)(end-p))) != NULL) {
+        for(marks = DDSdatamarks;*marks;marks++) {
+	    const char* mark = *marks;
+            size_t tlen = strlen(mark);
+	    if(tlen <= (size_t)(end-p) && memcmp(p,mark,tlen)==0) {
+	        *ddslenp = (size_t)(p-content);
+	        *bodp = *ddslenp + tlen;
 	        return 1;
 	    }
 	}
+	p++;
     }
     *ddslenp = 0;
     *bodp = 0;
@@ -706,3 +706,69 @@ ocmerge(const char** list1, const char** list2)
     merge[l1+l2] = NULL;
     return merge;    
 }
+
+/**************************************************/
+/* Arena: many small zeroed allocations that are freed together */
+
+#define OCARENABLOCK ((size_t)64*1024)
+/* Every allocation is rounded up to this to keep pointers, off_t
+   and doubles aligned */
+#define OCARENAALIGN ((size_t)16)
+
+typedef struct OCarenablock {
+    struct OCarenablock* next;
+    size_t size; /* bytes available after the header */
+    size_t used;
+} OCarenablock;
+
+/* Keep the space after the header aligned */
+#define OCARENAHEADER ((sizeof(OCarenablock)+OCARENAALIGN-1) & ~(OCARENAALIGN-1))
+
+struct OCarena {
+    OCarenablock* blocks; /* the first one is being filled */
+};
+
+OCarena*
+ocarena_new(void)
+{
+    return (OCarena*)calloc(1,sizeof(OCarena));
+}
+
+void*
+ocarena_alloc(OCarena* arena, size_t size)
+{
+    OCarenablock* block;
+    size = (size + OCARENAALIGN - 1) & ~(OCARENAALIGN - 1);
+    if(size == 0) size = OCARENAALIGN;
+    block = arena->blocks;
+    if(block == NULL || block->size - block->used < size) {
+        size_t blocksize = (size > OCARENABLOCK/4 ? size : OCARENABLOCK);
+	OCarenablock* newblock = (OCarenablock*)calloc(1,OCARENAHEADER+blocksize);
+	if(newblock == NULL) return NULL;
+	newblock->size = blocksize;
+	if(block != NULL && blocksize != OCARENABLOCK) {
+	    /* A large allocation gets a block of its own; keep filling
+	       the current one */
+	    newblock->next = block->next;
+	    block->next = newblock;
+	} else {
+	    newblock->next = block;
+	    arena->blocks = newblock;
+	}
+	block = newblock;
+    }
+    block->used += size;
+    return ((char*)block) + OCARENAHEADER + (block->used - size);
+}
+
+void
+ocarena_free(OCarena* arena)
+{
+    OCarenablock* block;
+    if(arena == NULL) return;
+    while((block = arena->blocks) != NULL) {
+	arena->blocks = block->next;
+	free(block);
+    }
+    free(arena);
+}
@@ -37,6 +37,13 @@ extern void ocmakedimlist(NClist* path, NClist* dims);
 
 extern int ocfindbod(NCbytes* buffer, size_t*, size_t*);
 
+/* An arena hands out zeroed memory that can only be freed all at
+   once; used for the data tree of a DATADDS */
+typedef struct OCarena OCarena;
+extern OCarena* ocarena_new(void);
+extern void* ocarena_alloc(OCarena*, size_t size);
+extern void ocarena_free(OCarena*);
+
 /* Reclaimers*/
 extern void ocfreeprojectionclause(OCprojectionclause* clause);
 
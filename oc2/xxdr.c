@@ -67,10 +67,16 @@
 #endif
 
 #include "xxdr.h"
+#include "ncswap.h"
+
+/* Units decoded at a time by xxdr_ushortn */
+#define XXDRBLOCK 1024
 
 int xxdr_network_order; /* network order is big endian */
 static int xxdr_big_endian; /* what is this machine? */
 
+static int xxdr_memgetbytes(XXDR* xdrs, char* addr, off_t len);
+
 #ifdef XXDRTRACE
 static void
 xxdrtrace(XXDR* xdr, char* where, off_t arg)
@@ -155,6 +161,81 @@ xxdr_ulonglong(XXDR* xdr, unsigned long long* llp)
    return 1;
 }
 
+/* get n values of the given size (4 or 8) into memory, converting
+   them from network order in one pass */
+static int
+xxdr_getswapped(XXDR* xdr, void* memory, off_t n, size_t size)
+{
+    off_t len = n*(off_t)size;
+    const void* src = memory;
+    if(!memory || n < 0) return 0;
+    if(xdr->getbytes == xxdr_memgetbytes) {
+	/* swap straight out of the packet rather than copying first */
+	if(xdr->pos + len > xdr->length) return 0;
+	src = xdr->data + xdr->base + xdr->pos;
+	xdr->pos += len;
+    } else if(!xdr->getbytes(xdr,(char*)memory,len))
+	return 0;
+    if(xxdr_network_order) {
+	if(src != memory) memcpy(memory,src,(size_t)len);
+    } else if(n < NC_SWAP_BULK) {
+	/* e.g. scalars: not worth the bulk kernels */
+	off_t i;
+	char* p = (char*)memory;
+	const char* q = (const char*)src;
+	for(i=0;i<n;i++,p+=size,q+=size) {
+	    if(size == sizeof(unsigned int)) {
+		unsigned int x;
+		memcpy(&x,q,sizeof(x));
+		swapinline32(&x);
+		memcpy(p,&x,sizeof(x));
+	    } else {
+		unsigned long long x;
+		memcpy(&x,q,sizeof(x));
+		swapinline64(&x);
+		memcpy(p,&x,sizeof(x));
+	    }
+	}
+    } else if(size == sizeof(unsigned int))
+	NC_swapn4(memory,src,(size_t)n);
+    else
+	NC_swapn8(memory,src,(size_t)n);
+    return 1;
+}
+
+/* get n unsigned ints from underlying stream*/
+int
+xxdr_uintn(XXDR* xdr, unsigned int* ip, off_t n)
+{
+    return xxdr_getswapped(xdr,ip,n,sizeof(unsigned int));
+}
+
+/* get n long longs from underlying stream*/
+int
+xxdr_ulonglongn(XXDR* xdr, unsigned long long* llp, off_t n)
+{
+    return xxdr_getswapped(xdr,llp,n,sizeof(unsigned long long));
+}
+
+/* get n unsigned shorts from underlying stream; they are not
+   packed, so go through a block of whole units at a time */
+int
+xxdr_ushortn(XXDR* xdr, unsigned short* sp, off_t n)
+{
+    unsigned int units[XXDRBLOCK];
+    if(!sp) return 0;
+    while(n > 0) {
+	off_t i;
+	off_t count = (n < XXDRBLOCK ? n : XXDRBLOCK);
+	if(!xxdr_uintn(xdr,units,count)) return 0;
+	for(i=0;i<count;i++)
+	    sp[i] = (unsigned short)units[i];
+	sp += count;
+	n -= count;
+    }
+    return 1;
+}
+
 /* get some bytes from underlying stream;
    will move xdrs pointer to next XDRUNIT boundary*/
 int
@@ -490,19 +571,13 @@ xxdr_double(XXDR* xdr, double* dp)
 void
 xxdrntohdouble(char* c8, double* dp)
 {
-    unsigned int ii[2];
-    memcpy(ii,c8,(size_t)2*XDRUNIT);
+    unsigned long long ll;
+    memcpy(&ll,c8,sizeof(ll));
     if(!xxdr_big_endian) {
-	unsigned int tmp;
 	/* reverse byte order */
-	swapinline32(&ii[0]);
-	swapinline32(&ii[1]);
-	/* interchange ii[0] and ii[1] */
-	tmp = ii[0];
-	ii[0] = ii[1];
-	ii[1] = tmp;
+	swapinline64(&ll);
     }
-    if(dp) *dp = *(double*)ii;
+    if(dp) memcpy(dp,&ll,sizeof(ll));
 }
 
 void
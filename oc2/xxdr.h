@@ -157,6 +157,15 @@ extern int xxdr_float(XXDR* , float*);
 /* get a double from underlying stream*/
 extern int xxdr_double(XXDR* , double*);
 
+/* Bulk versions: get n consecutive values from underlying stream,
+   byte swapped as a whole array; the unsigned int version also does
+   Int32 and Float32, the unsigned long long one also Float64 */
+extern int xxdr_uintn(XXDR*, unsigned int*, off_t n);
+extern int xxdr_ulonglongn(XXDR*, unsigned long long*, off_t n);
+
+/* get n unsigned shorts, each of which takes a full XDRUNIT */
+extern int xxdr_ushortn(XXDR*, unsigned short*, off_t n);
+
 /* get some bytes from underlying stream;
    Warning: will read up to the next XDRUNIT boundary
 */
@@ -0,0 +1,244 @@
+#include "config.h"
+#include <sys/types.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#include <hdf5.h>
+/* Older versions of the hdf library may define H5PL_type_t here */
+#include <H5PLextern.h>
+
+#ifndef DLL_EXPORT
+#define DLL_EXPORT
+#endif
+
+/* See the memory management WARNING in H5Zbzip2.c. */
+
+#include "h5lz4.h"
+
+/* The layout of a compressed chunk is that of the standard HDF5 LZ4
+   plugin, all integers big-endian:
+     8 bytes  uncompressed size of the chunk
+     4 bytes  block size
+   and then, for each block,
+     4 bytes  compressed size of the block
+     n bytes  the block, stored as is if LZ4 could not shrink it
+*/
+#define LZ4_HDRSIZE 12
+#define LZ4_BLOCKHDRSIZE 4
+
+const H5Z_class2_t H5Z_LZ4[1] = {{
+    H5Z_CLASS_T_VERS,       /* H5Z_class_t version */
+    (H5Z_filter_t)H5Z_FILTER_LZ4,         /* Filter id number             */
+    1,              /* encoder_present flag (set to true) */
+    1,              /* decoder_present flag (set to true) */
+    "lz4",                  /* Filter name for debugging    */
+    (H5Z_can_apply_func_t)H5Z_lz4_can_apply, /* The "can apply" callback  */
+    NULL,                       /* The "set local" callback     */
+    (H5Z_func_t)H5Z_filter_lz4,         /* The actual filter function   */
+}};
+
+/* External Discovery Functions */
+H5PL_type_t
+H5PLget_plugin_type(void)
+{
+    return H5PL_TYPE_FILTER;
+}
+
+const void*
+H5PLget_plugin_info(void)
+{
+    return H5Z_LZ4;
+}
+
+/* Make this explicit */
+/*
+ * The "can_apply" callback returns positive a valid combination, zero for an
+ * invalid combination and negative for an error.
+ */
+htri_t
+H5Z_lz4_can_apply(hid_t dcpl_id, hid_t type_id, hid_t space_id)
+{
+    return 1; /* Assume it can always apply */
+}
+
+static void
+put32(unsigned char* p, unsigned long long v)
+{
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static unsigned long long
+get32(const unsigned char* p)
+{
+    return ((unsigned long long)p[0] << 24) | ((unsigned long long)p[1] << 16)
+           | ((unsigned long long)p[2] << 8) | (unsigned long long)p[3];
+}
+
+size_t H5Z_filter_lz4(unsigned int flags, size_t cd_nelmts,
+                     const unsigned int cd_values[], size_t nbytes,
+                     size_t *buf_size, void **buf)
+{
+  unsigned char *inbuf = (unsigned char*)*buf;
+  unsigned char *outbuf = NULL;
+  size_t outbuflen, outdatalen;
+  unsigned long long origsize, blocksize;
+  size_t done;
+
+  if (flags & H5Z_FLAG_REVERSE) {
+
+    /** Decompress data.
+     **
+     ** The header tells us the size of the result, and each block
+     ** its own compressed size, so this is a single pass.
+     **/
+
+    const unsigned char *in, *inend = inbuf + nbytes;
+    unsigned long long compsize;
+
+    if (nbytes < LZ4_HDRSIZE) {
+      fprintf(stderr, "lz4 decompression: truncated chunk\n");
+      goto cleanupAndFail;
+    }
+    origsize = (get32(inbuf) << 32) | get32(inbuf + 4);
+    blocksize = get32(inbuf + 8);
+    if (blocksize == 0 && origsize > 0) {
+      fprintf(stderr, "lz4 decompression: invalid block size\n");
+      goto cleanupAndFail;
+    }
+
+    outbuflen = (size_t)origsize;
+#ifdef HAVE_H5FREE_MEMORY
+    outbuf = H5allocate_memory(outbuflen > 0 ? outbuflen : 1,0);
+#else
+    outbuf = (unsigned char*)malloc(outbuflen > 0 ? outbuflen : 1);
+#endif
+    if (outbuf == NULL) {
+      fprintf(stderr, "memory allocation failed for lz4 decompression\n");
+      goto cleanupAndFail;
+    }
+
+    in = inbuf + LZ4_HDRSIZE;
+    for (done = 0; done < outbuflen; ) {
+      size_t thisblock = outbuflen - done;
+
+      if (thisblock > blocksize)
+        thisblock = (size_t)blocksize;
+      if (in + LZ4_BLOCKHDRSIZE > inend) {
+        fprintf(stderr, "lz4 decompression: truncated chunk\n");
+        goto cleanupAndFail;
+      }
+      compsize = get32(in);
+      in += LZ4_BLOCKHDRSIZE;
+      if (compsize > (unsigned long long)(inend - in)) {
+        fprintf(stderr, "lz4 decompression: truncated chunk\n");
+        goto cleanupAndFail;
+      }
+      if (compsize == thisblock) {
+        /* Stored uncompressed. */
+        memcpy(outbuf + done, in, thisblock);
+      } else {
+        int ret = LZ4_decompress_safe((const char*)in, (char*)outbuf + done,
+                                      (int)compsize, (int)thisblock);
+        if (ret < 0 || (size_t)ret != thisblock) {
+          fprintf(stderr, "lz4 decompression failed with error %d\n", ret);
+          goto cleanupAndFail;
+        }
+      }
+      in += compsize;
+      done += thisblock;
+    }
+    outdatalen = outbuflen;
+
+  } else {
+
+    /** Compress data.
+     **
+     ** The worst case size is known for each block, so the one-shot
+     ** interface is used for each.
+     **/
+
+    unsigned char *out;
+    size_t nblocks;
+    int acceleration = 1;
+
+    blocksize = H5Z_LZ4_DEFAULT_BLOCK_SIZE;
+    if (cd_nelmts > 0 && cd_values[0] > 0)
+      blocksize = cd_values[0];
+    if (cd_nelmts > 1 && cd_values[1] > 1)
+      acceleration = (int)cd_values[1];
+    if (blocksize > LZ4_MAX_INPUT_SIZE) {
+      fprintf(stderr, "invalid lz4 block size: %llu\n", blocksize);
+      goto cleanupAndFail;
+    }
+    if (blocksize > nbytes)
+      blocksize = nbytes;
+    nblocks = blocksize ? (nbytes + blocksize - 1) / blocksize : 0;
+
+    /* Prepare the output buffer. */
+    outbuflen = LZ4_HDRSIZE
+        + nblocks * (LZ4_BLOCKHDRSIZE + (size_t)LZ4_compressBound((int)blocksize));
+#ifdef HAVE_H5FREE_MEMORY
+    outbuf = H5allocate_memory(outbuflen,0);
+#else
+    outbuf = (unsigned char*)malloc(outbuflen);
+#endif
+    if (outbuf == NULL) {
+      fprintf(stderr, "memory allocation failed for lz4 compression\n");
+      goto cleanupAndFail;
+    }
+
+    origsize = nbytes;
+    put32(outbuf, origsize >> 32);
+    put32(outbuf + 4, origsize & 0xffffffffULL);
+    put32(outbuf + 8, blocksize);
+    out = outbuf + LZ4_HDRSIZE;
+    for (done = 0; done < nbytes; ) {
+      size_t thisblock = nbytes - done;
+      int compsize;
+
+      if (thisblock > blocksize)
+        thisblock = (size_t)blocksize;
+      compsize = LZ4_compress_fast((const char*)inbuf + done,
+                                   (char*)out + LZ4_BLOCKHDRSIZE, (int)thisblock,
+                                   LZ4_compressBound((int)thisblock), acceleration);
+      if (compsize <= 0) {
+        fprintf(stderr, "lz4 compression failed\n");
+        goto cleanupAndFail;
+      }
+      if ((size_t)compsize >= thisblock) {
+        /* Incompressible: store as is. */
+        memcpy(out + LZ4_BLOCKHDRSIZE, inbuf + done, thisblock);
+        compsize = (int)thisblock;
+      }
+      put32(out, (unsigned long long)compsize);
+      out += LZ4_BLOCKHDRSIZE + compsize;
+      done += thisblock;
+    }
+    outdatalen = (size_t)(out - outbuf);
+  }
+
+  /* Always replace the input buffer with the output buffer. */
+#ifdef HAVE_H5FREE_MEMORY
+  H5free_memory(*buf);
+#else
+  free(*buf);
+#endif
+
+  *buf = outbuf;
+  *buf_size = outbuflen;
+  return outdatalen;
+
+ cleanupAndFail:
+  if (outbuf)
+#ifdef HAVE_H5FREE_MEMORY
+    H5free_memory(outbuf);
+#else
+  free(outbuf);
+#endif
+
+  return 0;
+}
@@ -0,0 +1,161 @@
+#include "config.h"
+#include <sys/types.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#include <hdf5.h>
+/* Older versions of the hdf library may define H5PL_type_t here */
+#include <H5PLextern.h>
+
+#ifndef DLL_EXPORT
+#define DLL_EXPORT
+#endif
+
+/* See the memory management WARNING in H5Zbzip2.c. */
+
+#include "h5zstd.h"
+
+/* A compressed chunk is a single zstd frame, with the content size
+   recorded in the frame header, as written by the standard HDF5
+   Zstandard plugin. */
+
+#define ZSTD_DEFAULT_LEVEL 3
+
+const H5Z_class2_t H5Z_ZSTD[1] = {{
+    H5Z_CLASS_T_VERS,       /* H5Z_class_t version */
+    (H5Z_filter_t)H5Z_FILTER_ZSTD,         /* Filter id number             */
+    1,              /* encoder_present flag (set to true) */
+    1,              /* decoder_present flag (set to true) */
+    "zstd",                  /* Filter name for debugging    */
+    (H5Z_can_apply_func_t)H5Z_zstd_can_apply, /* The "can apply" callback  */
+    NULL,                       /* The "set local" callback     */
+    (H5Z_func_t)H5Z_filter_zstd,         /* The actual filter function   */
+}};
+
+/* External Discovery Functions */
+H5PL_type_t
+H5PLget_plugin_type(void)
+{
+    return H5PL_TYPE_FILTER;
+}
+
+const void*
+H5PLget_plugin_info(void)
+{
+    return H5Z_ZSTD;
+}
+
+/* Make this explicit */
+/*
+ * The "can_apply" callback returns positive a valid combination, zero for an
+ * invalid combination and negative for an error.
+ */
+htri_t
+H5Z_zstd_can_apply(hid_t dcpl_id, hid_t type_id, hid_t space_id)
+{
+    return 1; /* Assume it can always apply */
+}
+
+size_t H5Z_filter_zstd(unsigned int flags, size_t cd_nelmts,
+                     const unsigned int cd_values[], size_t nbytes,
+                     size_t *buf_size, void **buf)
+{
+  char *outbuf = NULL;
+  size_t outbuflen, outdatalen;
+
+  if (flags & H5Z_FLAG_REVERSE) {
+
+    /** Decompress data.
+     **
+     ** The frame header holds the size of the result, so the
+     ** one-shot interface can be used.
+     **/
+
+    unsigned long long framesize = ZSTD_getFrameContentSize(*buf, nbytes);
+
+    if (framesize == ZSTD_CONTENTSIZE_ERROR || framesize == ZSTD_CONTENTSIZE_UNKNOWN
+        || framesize != (size_t)framesize) {
+      fprintf(stderr, "zstd decompression: invalid frame header\n");
+      goto cleanupAndFail;
+    }
+
+    /* Prepare the output buffer. */
+    outbuflen = (size_t)framesize;
+#ifdef HAVE_H5FREE_MEMORY
+    outbuf = H5allocate_memory(outbuflen > 0 ? outbuflen : 1,0);
+#else
+    outbuf = (char*)malloc(outbuflen > 0 ? outbuflen : 1);
+#endif
+    if (outbuf == NULL) {
+      fprintf(stderr, "memory allocation failed for zstd decompression\n");
+      goto cleanupAndFail;
+    }
+
+    outdatalen = ZSTD_decompress(outbuf, outbuflen, *buf, nbytes);
+    if (ZSTD_isError(outdatalen)) {
+      fprintf(stderr, "zstd decompression failed: %s\n",
+              ZSTD_getErrorName(outdatalen));
+      goto cleanupAndFail;
+    }
+
+  } else {
+
+    /** Compress data.
+     **
+     ** The worst case size is known, so the one-shot interface is used.
+     **/
+
+    int level = ZSTD_DEFAULT_LEVEL;
+
+    /* Get compression level if present. */
+    if (cd_nelmts > 0 && cd_values[0] != 0) {
+      level = (int)cd_values[0];
+      if (level < ZSTD_minCLevel() || level > ZSTD_maxCLevel()) {
+        fprintf(stderr, "invalid zstd compression level: %d\n", level);
+        goto cleanupAndFail;
+      }
+    }
+
+    /* Prepare the output buffer. */
+    outbuflen = ZSTD_compressBound(nbytes);
+#ifdef HAVE_H5FREE_MEMORY
+    outbuf = H5allocate_memory(outbuflen,0);
+#else
+    outbuf = (char*)malloc(outbuflen);
+#endif
+    if (outbuf == NULL) {
+      fprintf(stderr, "memory allocation failed for zstd compression\n");
+      goto cleanupAndFail;
+    }
+
+    /* Compress data. */
+    outdatalen = ZSTD_compress(outbuf, outbuflen, *buf, nbytes, level);
+    if (ZSTD_isError(outdatalen)) {
+      fprintf(stderr, "zstd compression failed: %s\n",
+              ZSTD_getErrorName(outdatalen));
+      goto cleanupAndFail;
+    }
+  }
+
+  /* Always replace the input buffer with the output buffer. */
+#ifdef HAVE_H5FREE_MEMORY
+  H5free_memory(*buf);
+#else
+  free(*buf);
+#endif
+
+  *buf = outbuf;
+  *buf_size = outbuflen;
+  return outdatalen;
+
+ cleanupAndFail:
+  if (outbuf)
+#ifdef HAVE_H5FREE_MEMORY
+    H5free_memory(outbuf);
+#else
+  free(outbuf);
+#endif
+
+  return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef H5LZ4_H
+#define H5LZ4_H
+
+#include <lz4.h>
+
+#ifdef _MSC_VER
+  #ifdef DLL_EXPORT /* define when building the library */
+    #define DECLSPEC __declspec(dllexport)
+  #else
+    #define DECLSPEC __declspec(dllimport)
+  #endif
+#else
+  #define DECLSPEC extern
+#endif
+
+/* The id registered with The HDF Group for LZ4; files written with
+   this plugin can be read with the standard HDF5 LZ4 plugin and vice
+   versa. */
+#define H5Z_FILTER_LZ4 32004
+
+/* Parameters (all optional):
+   cd_values[0]: block size in bytes; 0 => the default (1 GiB). Each
+                 chunk is cut into blocks of this size, which are
+                 compressed independently.
+   cd_values[1]: LZ4 acceleration; 0 or 1 => the default. Larger values
+                 trade ratio for speed. Only used when writing.
+*/
+#define H5Z_LZ4_DEFAULT_BLOCK_SIZE (1U << 30)
+
+/* declare the hdf5 interface */
+DECLSPEC H5PL_type_t H5PLget_plugin_type(void);
+DECLSPEC const void* H5PLget_plugin_info(void);
+DECLSPEC const H5Z_class2_t H5Z_LZ4[1];
+
+/* Declare  filter specific functions */
+DECLSPEC htri_t H5Z_lz4_can_apply(hid_t dcpl_id, hid_t type_id, hid_t space_id);
+DECLSPEC size_t H5Z_filter_lz4(unsigned flags,size_t cd_nelmts,const unsigned cd_values[],
+                    size_t nbytes,size_t *buf_size,void**buf);
+
+#endif /*H5LZ4_H*/
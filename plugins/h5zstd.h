@@ -0,0 +1,37 @@
+#ifndef H5ZSTD_H
+#define H5ZSTD_H
+
+#include <zstd.h>
+
+#ifdef _MSC_VER
+  #ifdef DLL_EXPORT /* define when building the library */
+    #define DECLSPEC __declspec(dllexport)
+  #else
+    #define DECLSPEC __declspec(dllimport)
+  #endif
+#else
+  #define DECLSPEC extern
+#endif
+
+/* The id registered with The HDF Group for Zstandard; files written
+   with this plugin can be read with the standard HDF5 Zstandard plugin
+   and vice versa. */
+#define H5Z_FILTER_ZSTD 32015
+
+/* Parameters (all optional):
+   cd_values[0]: compression level, as a signed int; 0 => the zstd
+                 default (3). Negative levels are the fast modes.
+                 Only used when writing.
+*/
+
+/* declare the hdf5 interface */
+DECLSPEC H5PL_type_t H5PLget_plugin_type(void);
+DECLSPEC const void* H5PLget_plugin_info(void);
+DECLSPEC const H5Z_class2_t H5Z_ZSTD[1];
+
+/* Declare  filter specific functions */
+DECLSPEC htri_t H5Z_zstd_can_apply(hid_t dcpl_id, hid_t type_id, hid_t space_id);
+DECLSPEC size_t H5Z_filter_zstd(unsigned flags,size_t cd_nelmts,const unsigned cd_values[],
+                    size_t nbytes,size_t *buf_size,void**buf);
+
+#endif /*H5ZSTD_H*/
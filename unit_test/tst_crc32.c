@@ -0,0 +1,84 @@
+/* This is part of the netCDF package. Copyright 2019 University
+   Corporation for Atmospheric Research/Unidata. See COPYRIGHT file
+   for conditions of use.
+
+   Test the CRC-32 functions in libdispatch/crc32.c, used for the
+   DAP4 checksums and for hashing names, against a bit at a time
+   reference, for every length and alignment around the points where
+   they switch between kernels.
+*/
+
+#include "config.h"
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "nccrc32.h"
+
+#define MAXLEN 1100
+#define MAXOFFSET 16
+
+/* The CRC-32 of the ASCII digits 1 to 9. */
+#define CHECK_VALUE 0xcbf43926U
+
+static unsigned char data[MAXLEN + MAXOFFSET];
+
+/* Compute the CRC-32 one bit at a time. */
+static unsigned int
+reference(unsigned int crc, const unsigned char *buf, size_t len)
+{
+    size_t i;
+    int k;
+
+    crc = ~crc;
+    for (i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (k = 0; k < 8; k++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320U : crc >> 1;
+    }
+    return ~crc;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (unsigned char)((i * 2654435761U) >> 13);
+
+    printf("\n*** Testing netcdf internal CRC-32 functions.\n");
+    printf("Testing known values...");
+    {
+        if (NC_crc32(0, "123456789", 9) != CHECK_VALUE) ERR;
+        if (NC_crc32_portable(0, "123456789", 9) != CHECK_VALUE) ERR;
+        if (NC_crc32(0, "", 0) != 0) ERR;
+        if (NC_crc32(0, NULL, 10) != 0) ERR;
+    }
+    SUMMARIZE_ERR;
+    printf("Testing all lengths and alignments...");
+    {
+        size_t len, off;
+
+        for (off = 0; off < MAXOFFSET; off++) {
+            for (len = 0; len <= MAXLEN; len++) {
+                unsigned int crc = reference(0, data + off, len);
+                if (NC_crc32(0, data + off, len) != crc) ERR;
+                if (NC_crc32_portable(0, data + off, len) != crc) ERR;
+            }
+        }
+    }
+    SUMMARIZE_ERR;
+    printf("Testing a crc continued over pieces...");
+    {
+        size_t split;
+        unsigned int crc = reference(0, data, MAXLEN);
+
+        for (split = 0; split <= MAXLEN; split += 7) {
+            unsigned int part = NC_crc32(0, data, split);
+            if (NC_crc32(part, data + split, MAXLEN - split) != crc) ERR;
+            part = NC_crc32_portable(0, data, split);
+            if (NC_crc32_portable(part, data + split, MAXLEN - split) != crc) ERR;
+        }
+    }
+    SUMMARIZE_ERR;
+    FINAL_RESULTS;
+}
@@ -0,0 +1,136 @@
+/* This is part of the netCDF package. Copyright 2019 University
+   Corporation for Atmospheric Research/Unidata. See COPYRIGHT file
+   for conditions of use.
+
+   Test the pool of curl handles in libdispatch/dcurlpool.c: released
+   handles are handed out again, come back without the options of
+   their previous user, and still perform requests (here on a file://
+   url, so no server is needed). Duplicated handles keep the options
+   of the original.
+*/
+
+#include "config.h"
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <nc_tests.h>
+#include "err_macros.h"
+#include "nccurlpool.h"
+
+#define FILE_NAME "tst_curlpool.txt"
+#define CONTENT "pooled handles\n"
+
+static char received[256];
+static size_t nreceived;
+
+static size_t
+writer(void *ptr, size_t size, size_t nmemb, void *data)
+{
+    size_t n = size * nmemb;
+    (void)data;
+    if (nreceived + n > sizeof(received)) return 0;
+    memcpy(received + nreceived, ptr, n);
+    nreceived += n;
+    return n;
+}
+
+/* Read FILE_NAME through curl; return 0 on success. */
+static int
+fetch(CURL *curl, const char *url)
+{
+    nreceived = 0;
+    if (curl_easy_setopt(curl, CURLOPT_URL, url) != CURLE_OK) return 1;
+    if (curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writer) != CURLE_OK) return 1;
+    if (curl_easy_perform(curl) != CURLE_OK) return 1;
+    if (nreceived != strlen(CONTENT) || memcmp(received, CONTENT, nreceived)) return 1;
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    char url[4096];
+    char cwd[4000];
+    FILE *f;
+
+    if (nc_initialize()) ERR;
+    if (!(f = fopen(FILE_NAME, "w"))) ERR;
+    fputs(CONTENT, f);
+    fclose(f);
+    if (!getcwd(cwd, sizeof(cwd))) ERR;
+    snprintf(url, sizeof(url), "file://%s/%s", cwd, FILE_NAME);
+
+    printf("\n*** Testing netcdf internal curl handle pool.\n");
+    printf("Testing reuse of released handles...");
+    {
+        CURL *h1, *h2, *h3;
+        size_t created0, reused0, created, reused;
+
+        NC_curl_poolstats(&created0, &reused0);
+        if (!(h1 = NC_curl_acquire())) ERR;
+        if (!(h2 = NC_curl_acquire())) ERR;
+        if (h1 == h2) ERR;
+        NC_curl_release(h1);
+        if (!(h3 = NC_curl_acquire())) ERR;
+        if (h3 != h1) ERR;
+        NC_curl_poolstats(&created, &reused);
+        if (reused != reused0 + 1) ERR;
+        if (created > created0 + 2) ERR;
+        NC_curl_release(h2);
+        NC_curl_release(h3);
+        NC_curl_release(NULL);
+    }
+    SUMMARIZE_ERR;
+    printf("Testing requests on recycled handles...");
+    {
+        CURL *h;
+        int i;
+
+        for (i = 0; i < 3; i++) {
+            if (!(h = NC_curl_acquire())) ERR;
+            if (fetch(h, url)) ERR;
+            /* Leave an option behind that must not survive release */
+            if (curl_easy_setopt(h, CURLOPT_NOBODY, 1L) != CURLE_OK) ERR;
+            NC_curl_release(h);
+        }
+    }
+    SUMMARIZE_ERR;
+    printf("Testing more handles than the pool keeps...");
+    {
+        CURL *h[NC_CURL_POOLMAX + 4];
+        int i;
+
+        for (i = 0; i < NC_CURL_POOLMAX + 4; i++)
+            if (!(h[i] = NC_curl_acquire())) ERR;
+        for (i = 0; i < NC_CURL_POOLMAX + 4; i++)
+            NC_curl_release(h[i]);
+        if (!(h[0] = NC_curl_acquire())) ERR;
+        if (fetch(h[0], url)) ERR;
+        NC_curl_release(h[0]);
+    }
+    SUMMARIZE_ERR;
+    printf("Testing duplicated handles...");
+    {
+        CURL *h, *dup;
+        size_t created0, created;
+
+        if (NC_curl_duplicate(NULL)) ERR;
+        if (!(h = NC_curl_acquire())) ERR;
+        if (fetch(h, url)) ERR;
+        NC_curl_poolstats(&created0, NULL);
+        if (!(dup = NC_curl_duplicate(h))) ERR;
+        if (dup == h) ERR;
+        NC_curl_poolstats(&created, NULL);
+        if (created != created0 + 1) ERR;
+        /* The copy keeps the url and options of the original */
+        nreceived = 0;
+        if (curl_easy_perform(dup) != CURLE_OK) ERR;
+        if (nreceived != strlen(CONTENT) || memcmp(received, CONTENT, nreceived)) ERR;
+        NC_curl_release(dup);
+        NC_curl_release(h);
+    }
+    SUMMARIZE_ERR;
+    remove(FILE_NAME);
+    if (nc_finalize()) ERR;
+    FINAL_RESULTS;
+}